@@ -1,7 +1,8 @@
 #!/bin/bash
 
 # GBendo ROM Testing Script
-# Tests all ROMs in a directory with the refactored emulator
+# Tests all ROMs in a directory with the headless runner's batch mode (no
+# display needed): every ROM runs in one process on a thread pool
 # Usage: ./test_roms.sh [ROM_DIRECTORY] [OPTIONS]
 
 # set -euo pipefail  # Temporarily disabled for debugging
@@ -17,8 +18,9 @@ NC='\033[0m' # No Color
 
 # Default configuration
 ROM_DIR="${1:-../tests/roms}"
-GBENDO_PATH="../gbendo"
-TEST_DURATION=10  # seconds per ROM
+GBENDO_PATH="../gbendo-headless"
+TEST_DURATION=10  # emulated seconds per ROM, run unthrottled
+JOBS=0            # worker threads, 0 = one per CPU
 ENABLE_PROFILING=false
 VERBOSE=false
 OUTPUT_DIR="test_results"
@@ -40,8 +42,9 @@ print_usage() {
     echo "Usage: $0 [ROM_DIRECTORY] [OPTIONS]"
     echo ""
     echo "Options:"
-    echo "  -p, --profile          Enable performance profiling"
-    echo "  -t, --time SECONDS     Test duration per ROM (default: 10)"
+    echo "  -p, --profile          Report FPS and speed per ROM"
+    echo "  -t, --time SECONDS     Emulated seconds per ROM (default: 10)"
+    echo "  -j, --jobs N           Worker threads (default: one per CPU)"
     echo "  -v, --verbose          Enable verbose output"
     echo "  -o, --output DIR       Output directory for results (default: test_results)"
     echo "  -h, --help             Show this help message"
@@ -67,6 +70,10 @@ parse_args() {
                 TEST_DURATION="$2"
                 shift 2
                 ;;
+            -j|--jobs)
+                JOBS="$2"
+                shift 2
+                ;;
             -v|--verbose)
                 VERBOSE=true
                 shift
@@ -100,7 +107,7 @@ setup_output() {
     echo "# GBendo ROM Test Results - $(date)" > "$LOG_FILE"
     echo "# Test Configuration:" >> "$LOG_FILE"
     echo "# ROM Directory: $ROM_DIR" >> "$LOG_FILE"
-    echo "# Test Duration: ${TEST_DURATION}s per ROM" >> "$LOG_FILE"
+    echo "# Test Duration: ${TEST_DURATION}s emulated per ROM" >> "$LOG_FILE"
     echo "# Profiling: $ENABLE_PROFILING" >> "$LOG_FILE"
     echo "# Verbose: $VERBOSE" >> "$LOG_FILE"
     echo "" >> "$LOG_FILE"
@@ -131,11 +138,16 @@ log_message() {
     esac
 }
 
+# Read a field from one result line of the batch JSON
+result_field() {
+    sed -n "s/.*\"$1\": *\"\{0,1\}\([^\",}]*\).*/\1/p" <<< "$2"
+}
+
 # Check if GBendo binary exists and is executable
 check_gbendo() {
     if [[ ! -f "$GBENDO_PATH" ]]; then
         log_message "ERROR" "GBendo binary not found at: $GBENDO_PATH"
-        echo -e "${YELLOW}Tip: Run 'make clean && make -j\$(nproc)' to build GBendo${NC}"
+        echo -e "${YELLOW}Tip: Run 'make gbendo-headless' to build the headless runner${NC}"
         exit 1
     fi
     
@@ -166,61 +178,50 @@ check_rom_directory() {
     log_message "INFO" "Found $TOTAL_ROMS ROM files in: $ROM_DIR"
 }
 
-# Test a single ROM
-test_rom() {
-    local rom_path="$1"
-    local rom_name=$(basename "$rom_path")
-    local test_output_file="$OUTPUT_DIR/${rom_name%.gb*}_test.txt"
-    local profile_output_file="$OUTPUT_DIR/${rom_name%.gb*}_profile.txt"
-    
-    log_message "INFO" "Testing ROM: $rom_name"
-    
-    # Build command
-    local cmd="timeout ${TEST_DURATION}s $GBENDO_PATH"
-    if [[ "$ENABLE_PROFILING" == "true" ]]; then
-        cmd="$cmd --profile"
+# Run every ROM in one batch and log a line per result
+run_batch() {
+    local job_file="$OUTPUT_DIR/jobs.txt"
+    local batch_output="$OUTPUT_DIR/batch.json"
+    local frames=$((TEST_DURATION * 60))
+
+    printf '%s\n' "$@" > "$job_file"
+    log_message "INFO" "Running ${#@} ROMs for $frames frames each"
+
+    local start_batch_time=$(date +%s)
+    local cmd=("$GBENDO_PATH" --batch "$job_file" --frames "$frames")
+    if [[ "$JOBS" -gt 0 ]]; then
+        cmd+=(--jobs "$JOBS")
     fi
-    if [[ "$VERBOSE" == "true" ]]; then
-        cmd="$cmd --verbose"
+    "${cmd[@]}" > "$batch_output" 2> "$OUTPUT_DIR/batch_errors.txt"
+    local batch_duration=$(( $(date +%s) - start_batch_time ))
+
+    if ! grep -q '"results"' "$batch_output"; then
+        log_message "ERROR" "Batch run failed; see $OUTPUT_DIR/batch_errors.txt"
+        FAILED_TESTS=$TOTAL_ROMS
+        return 1
     fi
-    cmd="$cmd \"$rom_path\""
-    
-    # Execute test
-    local start_test_time=$(date +%s)
-    if eval "$cmd" > "$test_output_file" 2>&1; then
-        local end_test_time=$(date +%s)
-        local test_duration=$((end_test_time - start_test_time))
-        
-        # Extract profiling data if available
-        if [[ "$ENABLE_PROFILING" == "true" ]]; then
-            grep -A 20 "Performance Profile Report" "$test_output_file" > "$profile_output_file" 2>/dev/null || true
-        fi
-        
-        log_message "SUCCESS" "$rom_name completed successfully (${test_duration}s)"
-        ((SUCCESSFUL_TESTS++))
-        
-        # Extract key metrics if verbose
-        if [[ "$VERBOSE" == "true" ]] && [[ "$ENABLE_PROFILING" == "true" ]]; then
-            local fps=$(grep "FPS:" "$test_output_file" | tail -1 | awk '{print $2}' || echo "N/A")
-            local cpu_usage=$(grep "CPU usage:" "$test_output_file" | tail -1 | awk '{print $3}' || echo "N/A")
-            echo -e "  ${PURPLE}├─ FPS: $fps${NC}"
-            echo -e "  ${PURPLE}└─ CPU Usage: $cpu_usage${NC}"
-        fi
-        
-        return 0
-    else
-        local exit_code=$?
-        log_message "ERROR" "$rom_name failed with exit code $exit_code"
-        ((FAILED_TESTS++))
-        
-        # Show error details if verbose
-        if [[ "$VERBOSE" == "true" ]]; then
-            echo -e "  ${RED}Error details:${NC}"
-            tail -5 "$test_output_file" | sed 's/^/  │ /'
+
+    while IFS= read -r line; do
+        local rom_path=$(result_field rom "$line")
+        local rom_name=$(basename "$rom_path")
+        local status=$(result_field status "$line")
+        local result_file="$OUTPUT_DIR/${rom_name%.gb*}_test.txt"
+        echo "$line" > "$result_file"
+
+        if [[ "$status" == "ok" ]]; then
+            log_message "SUCCESS" "$rom_name completed successfully"
+            ((SUCCESSFUL_TESTS++))
+            if [[ "$VERBOSE" == "true" ]] && [[ "$ENABLE_PROFILING" == "true" ]]; then
+                echo -e "  ${PURPLE}├─ FPS: $(result_field fps "$line")${NC}"
+                echo -e "  ${PURPLE}└─ Speed: $(result_field speed "$line")x${NC}"
+            fi
+        else
+            log_message "ERROR" "$rom_name $status after $(result_field frames "$line") frames (PC=$(result_field pc "$line"))"
+            ((FAILED_TESTS++))
         fi
-        
-        return $exit_code
-    fi
+    done < <(grep '^    {"rom"' "$batch_output")
+
+    log_message "INFO" "Batch finished in ${batch_duration}s"
 }
 
 # Generate final report
@@ -256,26 +257,27 @@ generate_report() {
     
     # Generate CSV report for analysis
     local csv_file="$OUTPUT_DIR/test_summary.csv"
-    echo "ROM_Name,Status,Duration,FPS,CPU_Usage" > "$csv_file"
+    echo "ROM_Name,Status,Duration,FPS,Speed" > "$csv_file"
     
     # Process individual test results
     for result_file in "$OUTPUT_DIR"/*_test.txt; do
         if [[ -f "$result_file" ]]; then
             local rom_name=$(basename "$result_file" "_test.txt")
+            local line=$(cat "$result_file")
             local status="SUCCESS"
             local fps="N/A"
-            local cpu_usage="N/A"
+            local speed="N/A"
             
-            if grep -q "ERROR" "$result_file"; then
+            if [[ "$(result_field status "$line")" != "ok" ]]; then
                 status="FAILED"
             fi
             
             if [[ "$ENABLE_PROFILING" == "true" ]]; then
-                fps=$(grep "FPS:" "$result_file" | tail -1 | awk '{print $2}' 2>/dev/null || echo "N/A")
-                cpu_usage=$(grep "CPU usage:" "$result_file" | tail -1 | awk '{print $3}' 2>/dev/null || echo "N/A")
+                fps=$(result_field fps "$line")
+                speed=$(result_field speed "$line")
             fi
             
-            echo "$rom_name,$status,$TEST_DURATION,$fps,$cpu_usage" >> "$csv_file"
+            echo "$rom_name,$status,$TEST_DURATION,${fps:-N/A},${speed:-N/A}" >> "$csv_file"
         fi
     done
     
@@ -352,7 +354,6 @@ main() {
     
     # Process each ROM file - using array to avoid subshell issues
     local rom_files=()
-    local rom_count=0
     
     # Build array of ROM files
     log_message "INFO" "Running find command..."
@@ -368,16 +369,7 @@ main() {
         exit 1
     fi
     
-    # Process each ROM file
-    for rom_file in "${rom_files[@]}"; do
-        ((rom_count++))
-        echo -e "\n${CYAN}[${rom_count}/${TOTAL_ROMS}]${NC} Testing: $(basename "$rom_file")"
-        test_rom "$rom_file"
-        
-        # Progress indicator
-        local progress=$((rom_count * 100 / TOTAL_ROMS))
-        echo -ne "${BLUE}Progress: [$progress%] $rom_count/$TOTAL_ROMS ROMs tested${NC}\r"
-    done
+    run_batch "${rom_files[@]}"
     
     echo "" # New line after progress indicator
     generate_report
@@ -1,8 +1,12 @@
 #include "apu.h"
 #include "../gbendo.h"
-#include "../ui/ui.h"
+#include "../ui/ui_debug.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 /* Channel 1/2 duty cycle waveforms */
 static const bool DUTY_WAVEFORMS[4][8] = {
@@ -15,11 +19,26 @@ static const bool DUTY_WAVEFORMS[4][8] = {
 /* LFSR divisor values */
 static const uint8_t NOISE_DIVISORS[] = {8, 16, 32, 48, 64, 80, 96, 112};
 
+/* Cycles between frame sequencer steps */
+#define FRAME_SEQUENCER_PERIOD (CPU_CLOCK_SPEED / FRAME_SEQUENCER_RATE)
+
+/* Past this many cycles without apu_end_frame() the APU ends a frame itself,
+   so single-stepping cannot overrun the step buffer (two frames, well inside
+   BLIP_MAX_SAMPLES) */
+#define APU_AUTO_END_FRAME_CYCLES (70224 * 2)
+
+/* Output high-pass per sample: the DMG's coupling capacitor keeps
+   0.999958 of its charge per clock, 0.999958^(4194304 / 44100) ~ 0.996 */
+#define APU_HIGHPASS_CHARGE 0.996f
+
 void apu_init(APU* apu) {
     memset(apu, 0, sizeof(APU));
-    /* Initialize sample timer to cycles per sample */
-    apu->sample_timer = CPU_CLOCK_SPEED / SAMPLE_RATE;
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        blip_init(&apu->output.blip[side], CPU_CLOCK_SPEED, SAMPLE_RATE);
+    }
+    apu->output.decimation = 1;
     apu->power = true;
+    apu->frame_sequencer_timer = FRAME_SEQUENCER_PERIOD;
     
     /* Set default master volume (max) and enable all channels on both outputs */
     apu->left_volume = 7;
@@ -65,104 +84,296 @@ void apu_init(APU* apu) {
 }
 
 void apu_reset(APU* apu) {
+    APU_Stems* stems = apu->stems;
+    APU_SampleBuffer buffer = apu->output.buffer;
     apu_init(apu);
+    apu->output.buffer.data = buffer.data;
+    apu->output.buffer.capacity = buffer.capacity;
+    if (stems) {
+        apu->stems = stems;
+        apu_enable_stems(apu, true);  /* Starts them over */
+    }
+}
+
+void apu_cleanup(APU* apu) {
+    apu_enable_stems(apu, false);
+    free(apu->output.buffer.data);
+    memset(&apu->output.buffer, 0, sizeof(apu->output.buffer));
+}
+
+void apu_clone(APU* dst, const APU* src) {
+    APU_SampleBuffer buffer = dst->output.buffer;
+    *dst = *src;
+    dst->output.buffer = buffer;
+    dst->stems = NULL;
+}
+
+bool apu_enable_stems(APU* apu, bool enable) {
+    if (!enable) {
+        if (apu->stems) free(apu->stems->buffer.data);
+        free(apu->stems);
+        apu->stems = NULL;
+        return true;
+    }
+    if (!apu->stems) {
+        apu->stems = calloc(1, sizeof(APU_Stems));
+        if (!apu->stems) {
+            fprintf(stderr, "Failed to allocate APU stems\n");
+            return false;
+        }
+    }
+    APU_SampleBuffer buffer = apu->stems->buffer;
+    memset(apu->stems, 0, sizeof(APU_Stems));
+    apu->stems->buffer.data = buffer.data;
+    apu->stems->buffer.capacity = buffer.capacity;
+    for (int ch = 0; ch < APU_STEM_CHANNELS; ch++) {
+        blip_init(&apu->stems->blip[ch], CPU_CLOCK_SPEED * apu->output.decimation, SAMPLE_RATE);
+    }
+    return true;
+}
+
+/* NR50 master volume steps, so mixing never divides */
+static const float MASTER_VOLUME[8] = {
+    0.0f, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7, 1.0f
+};
+
+/* Gain of each channel on each side, from NR50/NR51 */
+static void apu_stereo_gains(const APU* apu, float gain[APU_OUTPUT_CHANNELS][4]) {
+    float left = apu->power ? MASTER_VOLUME[apu->left_volume & 7] : 0.0f;
+    float right = apu->power ? MASTER_VOLUME[apu->right_volume & 7] : 0.0f;
+    for (int ch = 0; ch < 4; ch++) {
+        gain[0][ch] = (apu->left_enables >> ch) & 1 ? left : 0.0f;
+        gain[1][ch] = (apu->right_enables >> ch) & 1 ? right : 0.0f;
+    }
+}
+
+/* Whether channel reaches either side at a non-zero volume */
+static bool apu_channel_audible(const APU* apu, int channel) {
+    if (!apu->power) return false;
+    return ((apu->left_enables >> channel) & 1 && apu->left_volume & 7) ||
+           ((apu->right_enables >> channel) & 1 && apu->right_volume & 7);
+}
+
+/* Record a channel's pre-mix level in its stem */
+static void apu_stem_level(APU* apu, int channel, float level, uint32_t clock) {
+    APU_Stems* stems = apu->stems;
+    if (!apu_channel_audible(apu, channel)) level = 0.0f;
+    if (level != stems->level[channel]) {
+        blip_add_delta(&stems->blip[channel], clock, level - stems->level[channel]);
+        stems->level[channel] = level;
+    }
+}
+
+/* Report channel's amplitude at clock (cycles into the output frame) to the
+   step buffers if it changed */
+static void apu_mix_channel(APU* apu, int channel, uint32_t clock) {
+    APU_Output* out = &apu->output;
+    float gain[APU_OUTPUT_CHANNELS][4];
+    apu_stereo_gains(apu, gain);
+    float level = apu_get_channel_output(apu, channel);
+    if (apu->stems) apu_stem_level(apu, channel, level, clock);
+
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        float amp = level * gain[side][channel];
+        if (amp != out->channel_amp[side][channel]) {
+            blip_add_delta(&out->blip[side], clock, amp - out->channel_amp[side][channel]);
+            out->channel_amp[side][channel] = amp;
+        }
+    }
+}
+
+/* Mix all four channels into one side: store their new amplitudes in amp
+   and return the summed change */
+static inline float mix_four(const float* level, const float* gain, float* amp) {
+#ifdef __SSE__
+    __m128 next = _mm_mul_ps(_mm_load_ps(level), _mm_load_ps(gain));
+    __m128 diff = _mm_sub_ps(next, _mm_load_ps(amp));
+    _mm_store_ps(amp, next);
+    /* Horizontal sum */
+    __m128 shuf = _mm_shuffle_ps(diff, diff, _MM_SHUFFLE(2, 3, 0, 1));
+    diff = _mm_add_ps(diff, shuf);
+    shuf = _mm_movehl_ps(shuf, diff);
+    return _mm_cvtss_f32(_mm_add_ss(diff, shuf));
+#else
+    float delta = 0.0f;
+    for (int ch = 0; ch < 4; ch++) {
+        float next = level[ch] * gain[ch];
+        delta += next - amp[ch];
+        amp[ch] = next;
+    }
+    return delta;
+#endif
+}
+
+/* Pick up register writes, envelope and length changes: one summed delta
+   per side instead of one per channel */
+static void apu_mix_all(APU* apu) {
+    APU_Output* out = &apu->output;
+    _Alignas(16) float level[4];
+    _Alignas(16) float gain[APU_OUTPUT_CHANNELS][4];
+    for (int ch = 0; ch < 4; ch++) {
+        level[ch] = apu_get_channel_output(apu, ch);
+        if (apu->stems) apu_stem_level(apu, ch, level[ch], out->frame_clock);
+    }
+    apu_stereo_gains(apu, gain);
+
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        float delta = mix_four(level, gain[side], out->channel_amp[side]);
+        if (delta != 0.0f) {
+            blip_add_delta(&out->blip[side], out->frame_clock, delta);
+        }
+    }
 }
 
-static void update_pulse_channel(PulseChannel* ch, uint32_t cycles) {
+/* Advance a channel timer by cycles in closed form. Returns how many times
+   it expired; the timer is left holding the cycles to the next expiry. */
+static uint32_t timer_advance(uint16_t* timer, uint32_t period, uint32_t cycles) {
+    if (*timer > cycles) {
+        *timer -= cycles;
+        return 0;
+    }
+    cycles -= *timer;
+    *timer = (uint16_t)(period - cycles % period);
+    return 1 + cycles / period;
+}
+
+static void update_pulse_channel(APU* apu, PulseChannel* ch, int index, uint32_t cycles) {
     if (!ch->enabled) return;
+    uint32_t period = (2048 - ch->frequency) * 4;
     
-    /* Update frequency timer */
-    while (cycles > 0) {
-        if (ch->frequency_timer > cycles) {
-            ch->frequency_timer -= cycles;
-            cycles = 0;
-        } else {
-            cycles -= ch->frequency_timer;
-            /* Timer expired, reset and advance duty position */
-            ch->frequency_timer = (2048 - ch->frequency) * 4;
-            ch->duty_position = (ch->duty_position + 1) & 7;
+    if (ch->volume > 0 && apu_channel_audible(apu, index)) {
+        /* Audible: jump from one duty edge to the next */
+        const bool* duty = DUTY_WAVEFORMS[ch->duty & 3];
+        uint32_t clock = apu->output.frame_clock;
+        for (;;) {
+            bool level = duty[ch->duty_position];
+            uint32_t steps = 1;
+            while (duty[(ch->duty_position + steps) & 7] == level) steps++;
+            
+            uint32_t to_edge = ch->frequency_timer + (steps - 1) * period;
+            if (to_edge > cycles) break;
+            cycles -= to_edge;
+            clock += to_edge;
+            ch->frequency_timer = period;
+            ch->duty_position = (ch->duty_position + steps) & 7;
+            apu_mix_channel(apu, index, clock);
         }
     }
+    
+    /* Remaining cycles hold no edge (or nothing is heard) */
+    uint32_t steps = timer_advance(&ch->frequency_timer, period, cycles);
+    ch->duty_position = (ch->duty_position + steps) & 7;
 }
 
-static void update_wave_channel(WaveChannel* ch, uint32_t cycles) {
+static void update_wave_channel(APU* apu, WaveChannel* ch, uint32_t cycles) {
     if (!ch->enabled || !ch->wave_table_enabled) return;
+    uint32_t period = (2048 - ch->frequency) * 2;
     
-    /* Update frequency timer */
-    while (cycles > 0) {
-        if (ch->frequency_timer > cycles) {
-            ch->frequency_timer -= cycles;
-            cycles = 0;
-        } else {
-            cycles -= ch->frequency_timer;
-            /* Timer expired, reset and advance wave position */
-            ch->frequency_timer = (2048 - ch->frequency) * 2;
-            ch->wave_position = (ch->wave_position + 1) & 31;
+    if ((ch->volume & 3) != 0 && apu_channel_audible(apu, 2)) {
+        /* Audible: jump to the next position whose level differs */
+        uint32_t shift = (ch->volume & 3) - 1;
+        uint32_t clock = apu->output.frame_clock;
+        for (;;) {
+            uint8_t level = ch->wave_pattern[ch->wave_position] >> shift;
+            uint32_t steps = 1;
+            while (steps < 32 && (ch->wave_pattern[(ch->wave_position + steps) & 31] >> shift) == level) steps++;
+            if (steps == 32) break;  /* Flat wave */
+            
+            uint32_t to_edge = ch->frequency_timer + (steps - 1) * period;
+            if (to_edge > cycles) break;
+            cycles -= to_edge;
+            clock += to_edge;
+            ch->frequency_timer = period;
+            ch->wave_position = (ch->wave_position + steps) & 31;
+            apu_mix_channel(apu, 2, clock);
         }
     }
+    
+    uint32_t steps = timer_advance(&ch->frequency_timer, period, cycles);
+    ch->wave_position = (ch->wave_position + steps) & 31;
 }
 
-static void update_noise_channel(NoiseChannel* ch, uint32_t cycles) {
+static void update_noise_channel(APU* apu, NoiseChannel* ch, uint32_t cycles) {
     if (!ch->enabled) return;
+    uint32_t period = (uint32_t)NOISE_DIVISORS[ch->divisor_code & 7] << ch->clock_shift;
+    bool audible = ch->volume > 0 && apu_channel_audible(apu, 3);
     
-    /* Update LFSR timer */
-    while (cycles > 0) {
-        if (ch->frequency_timer > cycles) {
-            ch->frequency_timer -= cycles;
-            cycles = 0;
-        } else {
-            cycles -= ch->frequency_timer;
-            /* Timer expired, clock LFSR and reset timer */
-            uint32_t divisor = NOISE_DIVISORS[ch->divisor_code & 7];
-            ch->frequency_timer = divisor << ch->clock_shift;
-            
-            /* Clock LFSR */
-            uint16_t bit = (ch->lfsr & 1) ^ ((ch->lfsr >> 1) & 1);
-            ch->lfsr >>= 1;
-            ch->lfsr |= (bit << 14);
-            if (ch->width_mode) {
-                ch->lfsr &= ~(1 << 6);
-                ch->lfsr |= (bit << 6);
-            }
+    /* The timer advances in closed form; the LFSR has no shortcut and is
+       clocked once per expiry, with its output timestamped when heard */
+    uint32_t clock = apu->output.frame_clock + ch->frequency_timer;
+    uint32_t steps = timer_advance(&ch->frequency_timer, period, cycles);
+    for (uint32_t i = 0; i < steps; i++, clock += period) {
+        uint16_t bit = (ch->lfsr & 1) ^ ((ch->lfsr >> 1) & 1);
+        ch->lfsr >>= 1;
+        ch->lfsr |= (bit << 14);
+        if (ch->width_mode) {
+            ch->lfsr &= ~(1 << 6);
+            ch->lfsr |= (bit << 6);
         }
+        if (audible) apu_mix_channel(apu, 3, clock);
     }
 }
 
-void apu_step(APU* apu, uint32_t cycles) {
-    if (!apu->power) return;
-    
-    /* Update channels */
-    update_pulse_channel(&apu->pulse1, cycles);
-    update_pulse_channel(&apu->pulse2, cycles);
-    update_wave_channel(&apu->wave, cycles);
-    update_noise_channel(&apu->noise, cycles);
-    
-    /* Update frame sequencer (512 Hz for length/envelope/sweep) */
-    apu->frame_sequencer += cycles;
-    if (apu->frame_sequencer >= FRAME_SEQUENCER_RATE) {
-        apu->frame_sequencer -= FRAME_SEQUENCER_RATE;
+/* One 512 Hz frame sequencer step */
+static void clock_frame_sequencer(APU* apu) {
+    /* Clock length counters (step 0, 2, 4, 6) */
+    if ((apu->frame_sequencer & 1) == 0) {
+        apu_update_length_counters(apu);
+    }
+    
+    /* Clock sweep (step 2, 6) */
+    if ((apu->frame_sequencer & 3) == 2) {
+        apu_update_sweep(apu);
+    }
+    
+    /* Clock volume envelopes (step 7) */
+    if (apu->frame_sequencer == 7) {
+        apu_update_envelopes(apu);
+    }
+    
+    apu->frame_sequencer = (apu->frame_sequencer + 1) & 7;
+}
+
+/* Run the channels up to the CPU's current cycle */
+static void apu_sync(APU* apu) {
+    APU_Output* out = &apu->output;
+    
+    /* Changes made since the last sync become audible now */
+    apu_mix_all(apu);
+    
+    while (apu->pending_cycles > 0) {
+        uint32_t cycles = apu->pending_cycles;
         
-        /* Clock length counters (step 0, 2, 4, 6) */
-        if ((apu->frame_sequencer & 1) == 0) {
-            apu_update_length_counters(apu);
+        if (apu->power) {
+            /* Stop at the next frame sequencer step */
+            if (cycles > apu->frame_sequencer_timer) cycles = apu->frame_sequencer_timer;
+            update_pulse_channel(apu, &apu->pulse1, 0, cycles);
+            update_pulse_channel(apu, &apu->pulse2, 1, cycles);
+            update_wave_channel(apu, &apu->wave, cycles);
+            update_noise_channel(apu, &apu->noise, cycles);
+            apu->frame_sequencer_timer -= cycles;
         }
         
-        /* Clock volume envelopes (step 7) */
-        if (apu->frame_sequencer == 7) {
-            apu_update_envelopes(apu);
-        }
+        out->frame_clock += cycles;
+        apu->pending_cycles -= cycles;
         
-        /* Clock sweep (step 2, 6) */
-        if ((apu->frame_sequencer & 3) == 2) {
-            apu_update_sweep(apu);
+        if (apu->power && apu->frame_sequencer_timer == 0) {
+            apu->frame_sequencer_timer = FRAME_SEQUENCER_PERIOD;
+            clock_frame_sequencer(apu);
+            apu_mix_all(apu);
         }
     }
+}
+
+void apu_step(APU* apu, uint32_t cycles) {
+    /* Only note the time; channels catch up when something observes them */
+    apu->pending_cycles += cycles;
     
-    /* Generate audio samples */
-    apu->sample_timer -= cycles;
-    while (apu->sample_timer <= 0) {
-        apu->sample_timer += CPU_CLOCK_SPEED / SAMPLE_RATE;
-        apu_generate_samples(apu);
+    if (apu->power && apu->pending_cycles >= apu->frame_sequencer_timer) {
+        apu_sync(apu);
+    }
+    if (apu->output.frame_clock + apu->pending_cycles >= APU_AUTO_END_FRAME_CYCLES) {
+        apu_end_frame(apu);
     }
 }
 
@@ -366,45 +577,116 @@ float apu_get_channel_output(APU* apu, int channel) {
     return output;
 }
 
-void apu_generate_samples(APU* apu) {
-    if (!apu->power) return;
-    
-    /* Generate one sample */
-    float left = 0.0f;
-    float right = 0.0f;
-    
-    /* Mix channels */
-    for (int ch = 0; ch < 4; ch++) {
-        float sample = apu_get_channel_output(apu, ch);
+/* Room for count more frames of channels samples each. Grows the buffer
+   geometrically; returns how many of the count fit. */
+static uint32_t sample_buffer_reserve(APU_SampleBuffer* buffer, uint32_t count, uint32_t channels) {
+    uint32_t needed = buffer->frames + count;
+    if (needed > buffer->capacity && buffer->capacity < APU_BUFFER_MAX_FRAMES) {
+        uint32_t capacity = buffer->capacity ? buffer->capacity : APU_BUFFER_SAMPLES;
+        while (capacity < needed && capacity < APU_BUFFER_MAX_FRAMES) capacity *= 2;
+        if (capacity > APU_BUFFER_MAX_FRAMES) capacity = APU_BUFFER_MAX_FRAMES;
         
-        if (apu->left_enables & (1 << ch)) {
-            left += sample * (apu->left_volume / 7.0f);
-        }
-        if (apu->right_enables & (1 << ch)) {
-            right += sample * (apu->right_volume / 7.0f);
+        float* grown = realloc(buffer->data, (size_t)capacity * channels * sizeof(float));
+        if (grown) {
+            buffer->data = grown;
+            buffer->capacity = capacity;
         }
     }
     
-    /* Store in buffer */
-    uint32_t buffer_size = sizeof(apu->buffer) / sizeof(float);
-    if (apu->buffer_position < buffer_size) {
-        apu->buffer[apu->buffer_position++] = (left + right) * 0.5f;
+    uint32_t room = buffer->capacity - buffer->frames;
+    if (count > room) {
+        buffer->dropped += count - room;
+        count = room;
+    }
+    return count;
+}
+
+static uint32_t sample_buffer_drain(APU_SampleBuffer* buffer, uint32_t channels,
+                                    float* samples, uint32_t max_frames) {
+    uint32_t count = buffer->frames < max_frames ? buffer->frames : max_frames;
+    if (count == 0 || !samples) return 0;
+    
+    memcpy(samples, buffer->data, (size_t)count * channels * sizeof(float));
+    buffer->frames -= count;
+    memmove(buffer->data, buffer->data + (size_t)count * channels,
+            (size_t)buffer->frames * channels * sizeof(float));
+    return count;
+}
+
+static void apu_end_stems_frame(APU_Stems* stems, uint32_t clocks) {
+    float channel_samples[BLIP_MAX_SAMPLES];
+    uint32_t count = 0;
+    float* samples = NULL;
+    
+    for (int ch = 0; ch < APU_STEM_CHANNELS; ch++) {
+        uint32_t made = blip_end_frame(&stems->blip[ch], clocks, channel_samples, BLIP_MAX_SAMPLES);
+        if (ch == 0) {
+            count = sample_buffer_reserve(&stems->buffer, made, APU_STEM_CHANNELS);
+            samples = stems->buffer.data + (size_t)stems->buffer.frames * APU_STEM_CHANNELS;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            samples[i * APU_STEM_CHANNELS + ch] = channel_samples[i];
+        }
     }
+    stems->buffer.frames += count;
 }
 
-uint32_t apu_get_samples(APU* apu, float* samples, uint32_t max_count) {
-    uint32_t count = apu->buffer_position;
-    if (count > max_count) count = max_count;
+void apu_end_frame(APU* apu) {
+    APU_Output* out = &apu->output;
+    apu_sync(apu);
     
-    if (count > 0 && samples) {
-        memcpy(samples, apu->buffer, count * sizeof(float));
-        apu->buffer_position = 0;  /* Reset buffer */
+    /* One integration pass per side turns the frame's transitions into samples */
+    float side_samples[APU_OUTPUT_CHANNELS][BLIP_MAX_SAMPLES];
+    uint32_t made = 0;
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        made = blip_end_frame(&out->blip[side], out->frame_clock, side_samples[side], BLIP_MAX_SAMPLES);
     }
+    if (apu->stems) apu_end_stems_frame(apu->stems, out->frame_clock);
+    out->frame_clock = 0;
     
-    return count;
+    /* Interleave, removing the DC offset the unipolar channel outputs leave behind */
+    uint32_t count = sample_buffer_reserve(&out->buffer, made, APU_OUTPUT_CHANNELS);
+    float* samples = out->buffer.data + (size_t)out->buffer.frames * APU_OUTPUT_CHANNELS;
+    for (uint32_t i = 0; i < count; i++) {
+        for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+            float in = side_samples[side][i];
+            out->hp_out[side] = in - out->hp_in[side] + APU_HIGHPASS_CHARGE * out->hp_out[side];
+            out->hp_in[side] = in;
+            samples[i * APU_OUTPUT_CHANNELS + side] = out->hp_out[side];
+        }
+    }
+    out->buffer.frames += count;
+    
+    /* Rates change between frames, while the step buffers hold only tails */
+    uint32_t clock_rate = CPU_CLOCK_SPEED * out->decimation;
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        blip_set_rates(&out->blip[side], clock_rate, SAMPLE_RATE);
+    }
+    if (apu->stems) {
+        for (int ch = 0; ch < APU_STEM_CHANNELS; ch++) {
+            blip_set_rates(&apu->stems->blip[ch], clock_rate, SAMPLE_RATE);
+        }
+    }
+}
+
+uint32_t apu_drain(APU* apu, float* samples, uint32_t max_frames) {
+    return sample_buffer_drain(&apu->output.buffer, APU_OUTPUT_CHANNELS, samples, max_frames);
+}
+
+uint32_t apu_drain_stems(APU* apu, float* samples, uint32_t max_frames) {
+    if (!apu->stems) return 0;
+    return sample_buffer_drain(&apu->stems->buffer, APU_STEM_CHANNELS, samples, max_frames);
+}
+
+void apu_set_decimation(APU* apu, uint32_t factor) {
+    if (factor < 1) factor = 1;
+    if (factor > APU_MAX_DECIMATION) factor = APU_MAX_DECIMATION;
+    apu->output.decimation = factor;
 }
 
 uint8_t apu_read_register(APU* apu, uint16_t address) {
+    apu_sync(apu);  /* NR52 reports length counter state */
+    
     switch (address) {
         /* Channel 1 - Pulse with sweep */
         case 0xFF10: /* NR10 - Sweep */
@@ -501,10 +783,10 @@ uint8_t apu_read_register(APU* apu, uint16_t address) {
 
 void apu_write_register(APU* apu, uint16_t address, uint8_t value) {
     if (!apu->power && address != 0xFF26) return;
+    apu_sync(apu);  /* The old value holds up to this cycle */
     
     /* Debug: Log APU register writes */
-    static int write_count = 0;
-    if (write_count < 50) {
+    if (apu->debug_write_count < 50) {
         /* Decode register name */
         const char* reg_name = NULL;
         switch (address) {
@@ -535,7 +817,7 @@ void apu_write_register(APU* apu, uint16_t address, uint8_t value) {
         } else {
             ui_debug_log(UI_DEBUG_APU, "[APU] Write 0x%04X = 0x%02X", address, value);
         }
-        write_count++;
+        apu->debug_write_count++;
     }
     
     switch (address) {
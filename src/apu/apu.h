@@ -3,10 +3,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "blip.h"
 
 /* APU Constants */
 #define SAMPLE_RATE 44100
 #define FRAME_SEQUENCER_RATE 512  /* 512 Hz */
+#define APU_BUFFER_SAMPLES 1024   /* One frame (~738 samples) plus slack: the
+                                     initial buffer and a handy drain size */
+#define APU_BUFFER_MAX_FRAMES (SAMPLE_RATE * 4)  /* Undrained output kept at most */
+#define APU_MAX_DECIMATION 16
+#define APU_OUTPUT_CHANNELS 2     /* Stereo, interleaved left/right */
 
 /* Channel Control */
 typedef struct {
@@ -58,6 +64,42 @@ typedef struct {
     uint8_t envelope_timer;
 } NoiseChannel;
 
+/* Frames waiting for their consumer. Grows as needed, so a long frame or
+   a late drain loses nothing; past APU_BUFFER_MAX_FRAMES the excess is
+   dropped and counted. */
+typedef struct {
+    float* data;               /* Interleaved frames */
+    uint32_t frames;           /* Waiting to be drained */
+    uint32_t capacity;         /* In frames */
+    uint64_t dropped;          /* Frames lost at the size limit */
+} APU_SampleBuffer;
+
+/* Audio output: channel transitions go into one band-limited step buffer
+   per side, apu_end_frame() turns them into interleaved stereo samples */
+typedef struct {
+    BlipBuffer blip[APU_OUTPUT_CHANNELS];
+    /* Last amplitude reported per side and channel */
+    _Alignas(16) float channel_amp[APU_OUTPUT_CHANNELS][4];
+    uint32_t frame_clock;      /* Cycles synced since the last apu_end_frame() */
+    float hp_in[APU_OUTPUT_CHANNELS];   /* DC blocker state */
+    float hp_out[APU_OUTPUT_CHANNELS];
+    uint32_t decimation;       /* Clocks per sample multiplier, 1 = normal */
+
+    APU_SampleBuffer buffer;   /* Stereo frames */
+} APU_Output;
+
+/* Optional per-channel stems for debugging: each channel's level as it
+   enters the mixer (before panning and master volume, silent while panned
+   off both sides), band-limited like the main output and interleaved as
+   four-channel frames. */
+#define APU_STEM_CHANNELS 4
+
+typedef struct {
+    BlipBuffer blip[APU_STEM_CHANNELS];
+    float level[APU_STEM_CHANNELS];    /* Last level reported per channel */
+    APU_SampleBuffer buffer;           /* Four-channel frames */
+} APU_Stems;
+
 typedef struct {
     /* Sound channels */
     PulseChannel pulse1;
@@ -73,17 +115,32 @@ typedef struct {
     uint8_t right_enables;  /* Which channels output to right */
 
     /* Timing */
-    int32_t sample_timer;  /* Must be signed to detect negative for sample generation */
-    uint32_t frame_sequencer;
+    uint32_t frame_sequencer;        /* Next step, 0-7 */
+    uint32_t frame_sequencer_timer;  /* Cycles until that step */
+    uint32_t pending_cycles;         /* Run by the CPU, not yet by the channels;
+                                        output.frame_clock is the last synced cycle */
 
-    /* Audio buffer */
-    float buffer[SAMPLE_RATE / 60];  /* 1 frame worth of samples */
-    uint32_t buffer_position;
+    /* Audio output (not part of the emulated state) */
+    APU_Output output;
+    APU_Stems* stems;                /* NULL unless enabled */
+    uint32_t debug_write_count;      /* Register writes logged (capped at 50) */
 } APU;
 
-/* APU initialization and control */
+/* APU initialization and control. apu_reset() keeps stems enabled and the
+   output buffers allocated; apu_cleanup() frees them. */
 void apu_init(APU* apu);
 void apu_reset(APU* apu);
+void apu_cleanup(APU* apu);
+
+/* Make dst, fresh from apu_init(), continue exactly where src is. Samples
+   src has not handed out yet stay with src, and stems are not copied. */
+void apu_clone(APU* dst, const APU* src);
+
+/* Start or stop recording per-channel stems */
+bool apu_enable_stems(APU* apu, bool enable);
+
+/* Account for cycles run by the CPU. The channels only catch up when a
+   register is accessed, the frame sequencer is due, or the frame ends. */
 void apu_step(APU* apu, uint32_t cycles);
 
 /* Register access */
@@ -97,10 +154,26 @@ void apu_update_envelopes(APU* apu);
 void apu_update_sweep(APU* apu);
 
 /* Audio generation */
-void apu_generate_samples(APU* apu);
 float apu_get_channel_output(APU* apu, int channel);
 
-/* Get samples from buffer and reset buffer position */
-uint32_t apu_get_samples(APU* apu, float* samples, uint32_t max_count);
+/* Turn the transitions recorded since the last call into samples. Called
+   once per emulated frame; apu_step() also ends a frame on its own when
+   nobody does. */
+void apu_end_frame(APU* apu);
+
+/* Move up to max_frames stereo frames (interleaved left/right, so twice as
+   many floats) out of the buffer, oldest first. Whatever does not fit stays
+   for the next call; drain until it returns 0 to empty the buffer. */
+uint32_t apu_drain(APU* apu, float* samples, uint32_t max_frames);
+
+/* Same for the stems: up to max_frames four-channel frames */
+uint32_t apu_drain_stems(APU* apu, float* samples, uint32_t max_frames);
+
+/* Fast-forward: produce 1/factor of the samples (1 = normal, at most
+   APU_MAX_DECIMATION). The step
+   buffer band-limits the decimation, so running factor times faster still
+   yields a continuous real-time stream, just higher pitched. Takes effect
+   at the next frame. */
+void apu_set_decimation(APU* apu, uint32_t factor);
 
 #endif /* GB_APU_H */
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "blip.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#define BLIP_FRAC_BITS  32
+#define BLIP_PHASE_BITS 6   /* log2(BLIP_PHASES) */
+#define BLIP_CUTOFF     0.9 /* Fraction of Nyquist kept by the kernel */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Step derivative kernels, one row per sub-sample phase; shared and read-only
+   once built */
+static float blip_kernel[BLIP_PHASES][BLIP_KERNEL_TAPS];
+static pthread_once_t blip_kernel_once = PTHREAD_ONCE_INIT;
+
+static void blip_build_kernel(void) {
+    const double half = BLIP_KERNEL_TAPS / 2.0;
+
+    for (int phase = 0; phase < BLIP_PHASES; phase++) {
+        double frac = (double)phase / BLIP_PHASES;
+        double sum = 0.0;
+        double taps[BLIP_KERNEL_TAPS];
+
+        for (int i = 0; i < BLIP_KERNEL_TAPS; i++) {
+            /* Distance of tap i from the step, centred in the kernel */
+            double x = i - half + 1.0 - frac;
+            double sinc = x == 0.0 ? 1.0 : sin(M_PI * BLIP_CUTOFF * x) / (M_PI * BLIP_CUTOFF * x);
+            /* Blackman window over the kernel span */
+            double w = (x + half) / BLIP_KERNEL_TAPS;
+            double window = w <= 0.0 || w >= 1.0 ? 0.0
+                          : 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        /* Every phase must add exactly the full step */
+        for (int i = 0; i < BLIP_KERNEL_TAPS; i++) {
+            blip_kernel[phase][i] = (float)(taps[i] / sum);
+        }
+    }
+}
+
+void blip_init(BlipBuffer* blip, uint32_t clock_rate, uint32_t sample_rate) {
+    pthread_once(&blip_kernel_once, blip_build_kernel);
+    memset(blip, 0, sizeof(*blip));
+    blip->factor = ((uint64_t)sample_rate << BLIP_FRAC_BITS) / clock_rate;
+}
+
+void blip_set_rates(BlipBuffer* blip, uint32_t clock_rate, uint32_t sample_rate) {
+    blip->factor = ((uint64_t)sample_rate << BLIP_FRAC_BITS) / clock_rate;
+}
+
+void blip_clear(BlipBuffer* blip) {
+    blip->offset = 0;
+    blip->integrator = 0.0f;
+    memset(blip->deltas, 0, sizeof(blip->deltas));
+}
+
+uint32_t blip_max_frame_clocks(const BlipBuffer* blip) {
+    /* Leave one sample for the sub-sample offset carried into the frame */
+    return (uint32_t)(((uint64_t)(BLIP_MAX_SAMPLES - 1) << BLIP_FRAC_BITS) / blip->factor);
+}
+
+void blip_add_delta(BlipBuffer* blip, uint32_t clock, float delta) {
+    uint64_t pos = blip->offset + (uint64_t)clock * blip->factor;
+    uint32_t index = (uint32_t)(pos >> BLIP_FRAC_BITS);
+    uint32_t phase = (uint32_t)(pos >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+    if (index >= BLIP_MAX_SAMPLES) return;  /* Frame ran past the buffer */
+
+    const float* kernel = blip_kernel[phase];
+    float* out = blip->deltas + index;
+    for (int i = 0; i < BLIP_KERNEL_TAPS; i++) {
+        out[i] += delta * kernel[i];
+    }
+}
+
+uint32_t blip_end_frame(BlipBuffer* blip, uint32_t clocks, float* out, uint32_t max_count) {
+    uint64_t pos = blip->offset + (uint64_t)clocks * blip->factor;
+    uint32_t count = (uint32_t)(pos >> BLIP_FRAC_BITS);
+    if (count > BLIP_MAX_SAMPLES) count = BLIP_MAX_SAMPLES;
+    blip->offset = pos & ((1ull << BLIP_FRAC_BITS) - 1);
+
+    /* One integration pass over the completed samples */
+    float sum = blip->integrator;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += blip->deltas[i];
+        if (i < max_count) out[i] = sum;
+    }
+    blip->integrator = sum;
+
+    /* Kernel tails that reach past the frame move to the front */
+    memmove(blip->deltas, blip->deltas + count, BLIP_KERNEL_TAPS * sizeof(float));
+    memset(blip->deltas + BLIP_KERNEL_TAPS, 0, count * sizeof(float));
+    return count;
+}
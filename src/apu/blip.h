@@ -0,0 +1,44 @@
+#ifndef GB_BLIP_H
+#define GB_BLIP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Band-limited step ("delta") buffer.
+ *
+ * Channels report amplitude changes with the exact clock they happen at.
+ * Each change is spread over BLIP_KERNEL_TAPS output samples as the
+ * derivative of a band-limited step (a windowed sinc picked from
+ * BLIP_PHASES sub-sample offsets). Output samples are the running sum of
+ * those deltas, computed once per frame by blip_end_frame(). Amplitude
+ * changes faster than half the sample rate are filtered instead of aliased. */
+
+#define BLIP_KERNEL_TAPS  16
+#define BLIP_PHASES       64
+#define BLIP_MAX_SAMPLES  2048   /* Output samples a frame may span */
+
+typedef struct {
+    uint64_t factor;       /* Output samples per clock, 32.32 fixed point */
+    uint64_t offset;       /* Sub-sample position of clock 0 in this frame, 32.32 */
+    float integrator;      /* Running sum carried across frames */
+    float deltas[BLIP_MAX_SAMPLES + BLIP_KERNEL_TAPS];
+} BlipBuffer;
+
+void blip_init(BlipBuffer* blip, uint32_t clock_rate, uint32_t sample_rate);
+void blip_clear(BlipBuffer* blip);
+
+/* Change the clock or sample rate between frames, keeping pending output */
+void blip_set_rates(BlipBuffer* blip, uint32_t clock_rate, uint32_t sample_rate);
+
+/* Largest clock count a frame may cover before blip_end_frame() is due */
+uint32_t blip_max_frame_clocks(const BlipBuffer* blip);
+
+/* Add an amplitude change of delta at clock (relative to the frame start) */
+void blip_add_delta(BlipBuffer* blip, uint32_t clock, float delta);
+
+/* End a frame of `clocks` clocks: integrate the completed samples into out
+   (at most max_count are stored; the rest are dropped) and carry the kernel
+   tails over to the next frame. Returns the number of samples completed. */
+uint32_t blip_end_frame(BlipBuffer* blip, uint32_t clocks, float* out, uint32_t max_count);
+
+#endif /* GB_BLIP_H */
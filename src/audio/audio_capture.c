@@ -0,0 +1,174 @@
+#include "audio_capture.h"
+#include <string.h>
+#include <strings.h>
+
+/* RIFF + "fmt " (18-byte IEEE float format) + "fact" + "data" headers */
+#define WAV_HEADER_SIZE 58
+#define WAV_FORMAT_IEEE_FLOAT 3
+
+static inline void store_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void store_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void build_wav_header(uint8_t* h, uint16_t channels, uint32_t sample_rate, uint64_t samples) {
+    uint64_t bytes = samples * sizeof(float);
+    uint32_t data_size = bytes > UINT32_MAX - WAV_HEADER_SIZE ? UINT32_MAX - WAV_HEADER_SIZE : (uint32_t)bytes;
+
+    memcpy(h, "RIFF", 4);
+    store_u32(h + 4, WAV_HEADER_SIZE - 8 + data_size);
+    memcpy(h + 8, "WAVE", 4);
+
+    memcpy(h + 12, "fmt ", 4);
+    store_u32(h + 16, 18);
+    store_u16(h + 20, WAV_FORMAT_IEEE_FLOAT);
+    store_u16(h + 22, channels);
+    store_u32(h + 24, sample_rate);
+    store_u32(h + 28, sample_rate * channels * (uint32_t)sizeof(float));
+    store_u16(h + 32, (uint16_t)(channels * sizeof(float)));
+    store_u16(h + 34, 32);
+    store_u16(h + 36, 0);
+
+    /* Non-PCM formats carry the frame count in a fact chunk */
+    memcpy(h + 38, "fact", 4);
+    store_u32(h + 42, 4);
+    store_u32(h + 46, (uint32_t)(data_size / (channels * sizeof(float))));
+
+    memcpy(h + 50, "data", 4);
+    store_u32(h + 54, data_size);
+}
+
+AudioCaptureFormat audio_capture_format_for_path(const char* path) {
+    size_t length = strlen(path);
+    if (length >= 4 && strcasecmp(path + length - 4, ".wav") == 0) {
+        return AUDIO_CAPTURE_WAV;
+    }
+    return AUDIO_CAPTURE_RAW;
+}
+
+static void* capture_writer_main(void* arg) {
+    AudioCapture* cap = arg;
+
+    for (;;) {
+        const float* first;
+        const float* second;
+        uint32_t first_count, second_count;
+        uint32_t queued = audio_ring_peek(&cap->ring, &first, &first_count, &second, &second_count);
+
+        if (queued == 0) {
+            if (atomic_load(&cap->stopping)) break;
+            sem_wait(&cap->queued);
+            continue;
+        }
+
+        /* Straight from the ring; consumed even on failure so the producer
+           never stalls on a dead file */
+        if (fwrite(first, sizeof(float), first_count, cap->file) != first_count ||
+            fwrite(second, sizeof(float), second_count, cap->file) != second_count) {
+            atomic_store(&cap->failed, true);
+        }
+        audio_ring_consume(&cap->ring, queued);
+        cap->samples_written += queued;
+    }
+    return NULL;
+}
+
+bool audio_capture_open(AudioCapture* cap, const char* path, AudioCaptureFormat format,
+                        uint16_t channels, uint32_t sample_rate) {
+    memset(cap, 0, sizeof(*cap));
+    if (channels == 0) {
+        fprintf(stderr, "Audio capture needs at least one channel\n");
+        return false;
+    }
+    cap->format = format;
+    cap->channels = channels;
+    cap->sample_rate = sample_rate;
+
+    cap->file = fopen(path, "wb");
+    if (!cap->file) {
+        fprintf(stderr, "Failed to open audio capture file: %s\n", path);
+        return false;
+    }
+
+    /* Placeholder sizes, patched by audio_capture_close() */
+    if (format == AUDIO_CAPTURE_WAV) {
+        uint8_t header[WAV_HEADER_SIZE];
+        build_wav_header(header, channels, sample_rate, 0);
+        if (fwrite(header, 1, sizeof(header), cap->file) != sizeof(header)) {
+            fprintf(stderr, "Failed to write audio capture header: %s\n", path);
+            fclose(cap->file);
+            cap->file = NULL;
+            return false;
+        }
+    }
+
+    if (!audio_ring_init(&cap->ring, AUDIO_CAPTURE_RING_SAMPLES)) {
+        fclose(cap->file);
+        cap->file = NULL;
+        return false;
+    }
+    sem_init(&cap->queued, 0, 0);
+    atomic_init(&cap->stopping, false);
+    atomic_init(&cap->failed, false);
+
+    if (pthread_create(&cap->thread, NULL, capture_writer_main, cap) != 0) {
+        fprintf(stderr, "Failed to start audio capture thread\n");
+        sem_destroy(&cap->queued);
+        audio_ring_cleanup(&cap->ring);
+        fclose(cap->file);
+        cap->file = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool audio_capture_write(AudioCapture* cap, const float* frames, uint32_t count) {
+    if (!cap->file || atomic_load(&cap->failed)) return false;
+
+    uint32_t capacity = audio_ring_capacity(&cap->ring);
+    uint32_t remaining = count * cap->channels;
+    /* Whole frames per chunk, at most half the ring */
+    uint32_t chunk_max = capacity / 2 / cap->channels * cap->channels;
+
+    while (remaining > 0) {
+        uint32_t chunk = remaining < chunk_max ? remaining : chunk_max;
+        while (!audio_ring_wait(&cap->ring, capacity - chunk, AUDIO_CAPTURE_WAIT_MS)) {
+            if (atomic_load(&cap->failed)) return false;
+        }
+        audio_ring_write(&cap->ring, frames, chunk);
+        sem_post(&cap->queued);
+        frames += chunk;
+        remaining -= chunk;
+    }
+    return true;
+}
+
+bool audio_capture_close(AudioCapture* cap) {
+    if (!cap->file) return false;
+
+    atomic_store(&cap->stopping, true);
+    sem_post(&cap->queued);
+    pthread_join(cap->thread, NULL);
+
+    bool ok = !atomic_load(&cap->failed);
+    if (cap->format == AUDIO_CAPTURE_WAV) {
+        uint8_t header[WAV_HEADER_SIZE];
+        build_wav_header(header, cap->channels, cap->sample_rate, cap->samples_written);
+        ok = ok && fseek(cap->file, 0, SEEK_SET) == 0 &&
+             fwrite(header, 1, sizeof(header), cap->file) == sizeof(header);
+    }
+    if (fclose(cap->file) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Audio capture is incomplete\n");
+
+    sem_destroy(&cap->queued);
+    audio_ring_cleanup(&cap->ring);
+    cap->file = NULL;
+    return ok;
+}
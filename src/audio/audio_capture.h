@@ -0,0 +1,58 @@
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "audio_ring.h"
+
+/* Streaming audio capture.
+ *
+ * The emulation thread appends frames to a fixed-size ring; a writer thread
+ * hands the ring's contents straight to fwrite() (no staging copy) as a
+ * 32-bit float WAV or raw PCM file. Memory stays bounded at any emulation
+ * speed: when the writer falls behind, the producer waits for room instead
+ * of dropping samples, so captures are complete enough to diff. Samples are
+ * written in host byte order; WAV requires a little-endian host. */
+
+#define AUDIO_CAPTURE_RING_SAMPLES 65536   /* ~0.37 s of stereo at 44.1 kHz */
+#define AUDIO_CAPTURE_WAIT_MS      250
+
+typedef enum {
+    AUDIO_CAPTURE_WAV,
+    AUDIO_CAPTURE_RAW     /* Headerless interleaved float32 */
+} AudioCaptureFormat;
+
+typedef struct {
+    FILE* file;
+    AudioCaptureFormat format;
+    uint16_t channels;
+    uint32_t sample_rate;
+
+    AudioRing ring;
+    sem_t queued;               /* Posted by the producer after each write */
+    pthread_t thread;
+    atomic_bool stopping;
+    atomic_bool failed;         /* A write failed; the file is incomplete */
+    uint64_t samples_written;   /* Writer thread only until it is joined */
+} AudioCapture;
+
+/* ".wav" selects WAV, anything else raw PCM */
+AudioCaptureFormat audio_capture_format_for_path(const char* path);
+
+bool audio_capture_open(AudioCapture* cap, const char* path, AudioCaptureFormat format,
+                        uint16_t channels, uint32_t sample_rate);
+
+/* Producer: append count interleaved frames. Blocks while the writer
+   catches up; returns false once the capture has failed. */
+bool audio_capture_write(AudioCapture* cap, const float* frames, uint32_t count);
+
+/* Write out everything queued, finish the header and close. Returns false
+   if any write failed. */
+bool audio_capture_close(AudioCapture* cap);
+
+#endif /* AUDIO_CAPTURE_H */
@@ -0,0 +1,165 @@
+#include "audio_ring.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bool audio_ring_init(AudioRing* ring, uint32_t min_capacity) {
+    memset(ring, 0, sizeof(*ring));
+
+    uint32_t capacity = 1;
+    while (capacity < min_capacity) {
+        if (capacity > UINT32_MAX / 2) {
+            fprintf(stderr, "Audio ring capacity too large: %u\n", min_capacity);
+            return false;
+        }
+        capacity <<= 1;
+    }
+
+    ring->data = calloc(capacity, sizeof(float));
+    if (!ring->data) {
+        fprintf(stderr, "Failed to allocate audio ring\n");
+        return false;
+    }
+    if (sem_init(&ring->drained, 0, 0) != 0) {
+        fprintf(stderr, "Failed to create audio ring semaphore\n");
+        free(ring->data);
+        ring->data = NULL;
+        return false;
+    }
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overruns, 0);
+    atomic_init(&ring->underruns, 0);
+    atomic_init(&ring->waiting, false);
+    return true;
+}
+
+void audio_ring_cleanup(AudioRing* ring) {
+    if (ring->data) sem_destroy(&ring->drained);
+    free(ring->data);
+    memset(ring, 0, sizeof(*ring));
+}
+
+uint32_t audio_ring_capacity(const AudioRing* ring) {
+    return ring->data ? ring->mask + 1 : 0;
+}
+
+uint32_t audio_ring_available(const AudioRing* ring) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t audio_ring_write(AudioRing* ring, const float* samples, uint32_t count) {
+    if (!ring->data) return 0;
+
+    /* Only this thread moves head; tail is published by the reader */
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t space = (ring->mask + 1) - (head - tail);
+
+    uint32_t n = count < space ? count : space;
+    if (n < count) {
+        atomic_fetch_add_explicit(&ring->overruns, count - n, memory_order_relaxed);
+    }
+
+    uint32_t start = head & ring->mask;
+    uint32_t first = ring->mask + 1 - start;
+    if (first > n) first = n;
+    memcpy(ring->data + start, samples, first * sizeof(float));
+    memcpy(ring->data, samples + first, (n - first) * sizeof(float));
+
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
+
+uint32_t audio_ring_read(AudioRing* ring, float* samples, uint32_t count) {
+    if (!ring->data) return 0;
+
+    /* Only this thread moves tail; head is published by the writer */
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t queued = head - tail;
+
+    uint32_t n = count < queued ? count : queued;
+    if (n < count) {
+        atomic_fetch_add_explicit(&ring->underruns, count - n, memory_order_relaxed);
+    }
+
+    uint32_t start = tail & ring->mask;
+    uint32_t first = ring->mask + 1 - start;
+    if (first > n) first = n;
+    memcpy(samples, ring->data + start, first * sizeof(float));
+    memcpy(samples + first, ring->data, (n - first) * sizeof(float));
+
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    if (atomic_load(&ring->waiting)) sem_post(&ring->drained);
+    return n;
+}
+
+uint32_t audio_ring_peek(const AudioRing* ring, const float** first, uint32_t* first_count,
+                         const float** second, uint32_t* second_count) {
+    uint32_t queued = ring->data ? audio_ring_available(ring) : 0;
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t start = tail & ring->mask;
+    uint32_t span = ring->mask + 1 - start;
+    if (span > queued) span = queued;
+
+    *first = ring->data + start;
+    *first_count = span;
+    *second = ring->data;
+    *second_count = queued - span;
+    return queued;
+}
+
+void audio_ring_consume(AudioRing* ring, uint32_t count) {
+    uint32_t tail = (uint32_t)atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    if (atomic_load(&ring->waiting)) sem_post(&ring->drained);
+}
+
+void audio_ring_clear(AudioRing* ring) {
+    uint32_t head = (uint32_t)atomic_load_explicit(&ring->head, memory_order_acquire);
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+    if (atomic_load(&ring->waiting)) sem_post(&ring->drained);
+}
+
+bool audio_ring_wait(AudioRing* ring, uint32_t level, uint32_t timeout_ms) {
+    if (!ring->data) return false;
+
+    /* Announce the wait before checking, so a read that lands in between
+       either shows in the level or posts */
+    atomic_store(&ring->waiting, true);
+    bool drained = true;
+    while (audio_ring_available(ring) > level) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (sem_timedwait(&ring->drained, &deadline) != 0 && errno == ETIMEDOUT) {
+            drained = false;
+            break;
+        }
+    }
+    atomic_store(&ring->waiting, false);
+
+    /* Drop posts that raced the last check; they would only cost the next
+       wait a spurious wake-up */
+    while (sem_trywait(&ring->drained) == 0) {}
+    return drained;
+}
+
+uint64_t audio_ring_underruns(const AudioRing* ring) {
+    return atomic_load_explicit(&ring->underruns, memory_order_relaxed);
+}
+
+uint64_t audio_ring_overruns(const AudioRing* ring) {
+    return atomic_load_explicit(&ring->overruns, memory_order_relaxed);
+}
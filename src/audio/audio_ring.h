@@ -0,0 +1,74 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+
+/* Lock-free single-producer/single-consumer sample ring.
+ *
+ * The emulation thread writes, the audio callback reads; neither ever waits
+ * for the other. Capacity is a power of two and the indices run freely, so
+ * positions are masked rather than wrapped with a modulo, and each side
+ * copies at most two contiguous spans per call. Samples that do not fit are
+ * dropped and counted as overruns; samples the reader asked for but did not
+ * get are counted as underruns.
+ *
+ * For audio-clock pacing the producer may also block until the reader has
+ * drained the ring to a given level. The reader wakes it with sem_post(),
+ * which never blocks, so the audio callback stays wait-free. */
+
+#define AUDIO_RING_CACHE_LINE 64
+
+typedef struct {
+    float* data;
+    uint32_t mask;            /* capacity - 1 */
+
+    /* Written by the producer only */
+    _Alignas(AUDIO_RING_CACHE_LINE) atomic_uint_fast32_t head;
+    atomic_uint_fast64_t overruns;
+
+    atomic_bool waiting;      /* Producer is blocked in audio_ring_wait() */
+
+    /* Written by the consumer only */
+    _Alignas(AUDIO_RING_CACHE_LINE) atomic_uint_fast32_t tail;
+    atomic_uint_fast64_t underruns;
+    sem_t drained;            /* Posted after a read while the producer waits */
+} AudioRing;
+
+/* Capacity is rounded up to a power of two */
+bool audio_ring_init(AudioRing* ring, uint32_t min_capacity);
+void audio_ring_cleanup(AudioRing* ring);
+
+uint32_t audio_ring_capacity(const AudioRing* ring);
+
+/* Samples currently queued. Exact from either side for its own view. */
+uint32_t audio_ring_available(const AudioRing* ring);
+
+/* Producer: queue up to count samples, returns how many fit */
+uint32_t audio_ring_write(AudioRing* ring, const float* samples, uint32_t count);
+
+/* Consumer: dequeue up to count samples, returns how many were there */
+uint32_t audio_ring_read(AudioRing* ring, float* samples, uint32_t count);
+
+/* Consumer, zero-copy: point at the queued samples in place, as up to two
+   spans (the second starts after the wrap), without dequeuing them. Returns
+   the total; follow with audio_ring_consume(). */
+uint32_t audio_ring_peek(const AudioRing* ring, const float** first, uint32_t* first_count,
+                         const float** second, uint32_t* second_count);
+
+/* Consumer: dequeue count samples seen through audio_ring_peek() */
+void audio_ring_consume(AudioRing* ring, uint32_t count);
+
+/* Consumer: drop everything queued */
+void audio_ring_clear(AudioRing* ring);
+
+/* Producer: block until at most level samples are queued. Returns false if
+   the reader made no progress for timeout_ms (e.g. the device stalled). */
+bool audio_ring_wait(AudioRing* ring, uint32_t level, uint32_t timeout_ms);
+
+uint64_t audio_ring_underruns(const AudioRing* ring);
+uint64_t audio_ring_overruns(const AudioRing* ring);
+
+#endif /* AUDIO_RING_H */
@@ -0,0 +1,140 @@
+#include "resampler.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RESAMPLER_CUTOFF 0.9   /* Fraction of the lower Nyquist rate kept */
+
+static void build_kernel(Resampler* rs, double cutoff) {
+    const double centre = RESAMPLER_TAPS / 2 - 1;
+
+    for (int phase = 0; phase <= RESAMPLER_PHASES; phase++) {
+        double frac = (double)phase / RESAMPLER_PHASES;
+        double taps[RESAMPLER_TAPS];
+        double sum = 0.0;
+
+        for (int i = 0; i < RESAMPLER_TAPS; i++) {
+            double x = i - centre - frac;
+            double sinc = x == 0.0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            /* Blackman window over the kernel span */
+            double w = (x + RESAMPLER_TAPS / 2.0) / RESAMPLER_TAPS;
+            double window = w <= 0.0 || w >= 1.0 ? 0.0
+                          : 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+
+        /* Unity gain at DC for every phase */
+        for (int i = 0; i < RESAMPLER_TAPS; i++) {
+            rs->kernel[phase][i] = (float)(taps[i] / sum);
+        }
+    }
+}
+
+bool resampler_init(Resampler* rs, uint32_t input_rate, uint32_t output_rate) {
+    memset(rs, 0, sizeof(*rs));
+    if (input_rate == 0 || output_rate == 0) {
+        fprintf(stderr, "Invalid resampler rates: %u -> %u\n", input_rate, output_rate);
+        return false;
+    }
+
+    /* Downsampling must also cut below the output Nyquist rate */
+    double ratio = (double)output_rate / input_rate;
+    build_kernel(rs, RESAMPLER_CUTOFF * (ratio < 1.0 ? ratio : 1.0));
+
+    rs->base_step = (double)input_rate / output_rate;
+    rs->step = rs->base_step;
+    return true;
+}
+
+void resampler_reset(Resampler* rs) {
+    rs->step = rs->base_step;
+    rs->position = 0.0;
+    rs->fifo_length = 0;
+}
+
+void resampler_set_fill(Resampler* rs, uint32_t queued, uint32_t target) {
+    if (target == 0) return;
+    double error = ((double)queued - target) / target;
+    if (error > 1.0) error = 1.0;
+    if (error < -1.0) error = -1.0;
+    rs->step = rs->base_step * (1.0 + RESAMPLER_DRC_MAX * error);
+}
+
+double resampler_get_adjust(const Resampler* rs) {
+    return rs->base_step / rs->step - 1.0;
+}
+
+static inline float dot_taps(const float* in, const float* kernel) {
+#ifdef __SSE__
+    __m128 acc = _mm_mul_ps(_mm_loadu_ps(in), _mm_load_ps(kernel));
+    for (int i = 4; i < RESAMPLER_TAPS; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_load_ps(kernel + i)));
+    }
+    /* Horizontal sum */
+    __m128 shuf = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1));
+    acc = _mm_add_ps(acc, shuf);
+    shuf = _mm_movehl_ps(shuf, acc);
+    return _mm_cvtss_f32(_mm_add_ss(acc, shuf));
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < RESAMPLER_TAPS; i++) {
+        sum += in[i] * kernel[i];
+    }
+    return sum;
+#endif
+}
+
+uint32_t resampler_process(Resampler* rs, const float* in, uint32_t count,
+                           float* out, uint32_t out_capacity) {
+    uint32_t produced = 0;
+
+    while (count > 0 && produced < out_capacity) {
+        /* Append what fits to the FIFO, one row per channel */
+        uint32_t take = RESAMPLER_FIFO - rs->fifo_length;
+        if (take > count) take = count;
+        for (uint32_t i = 0; i < take; i++) {
+            for (int c = 0; c < RESAMPLER_CHANNELS; c++) {
+                rs->fifo[c][rs->fifo_length + i] = in[i * RESAMPLER_CHANNELS + c];
+            }
+        }
+        rs->fifo_length += take;
+        in += take * RESAMPLER_CHANNELS;
+        count -= take;
+
+        /* Emit every output whose taps are all available */
+        while (produced < out_capacity) {
+            uint32_t index = (uint32_t)rs->position;
+            if (index + RESAMPLER_TAPS > rs->fifo_length) break;
+
+            double phase_pos = (rs->position - index) * RESAMPLER_PHASES;
+            uint32_t phase = (uint32_t)phase_pos;
+            float blend = (float)(phase_pos - phase);
+            for (int c = 0; c < RESAMPLER_CHANNELS; c++) {
+                const float* taps = rs->fifo[c] + index;
+                float a = dot_taps(taps, rs->kernel[phase]);
+                float b = dot_taps(taps, rs->kernel[phase + 1]);
+                out[produced * RESAMPLER_CHANNELS + c] = a + (b - a) * blend;
+            }
+            produced++;
+            rs->position += rs->step;
+        }
+
+        /* Drop input no future output reaches */
+        uint32_t consumed = (uint32_t)rs->position;
+        if (consumed > rs->fifo_length) consumed = rs->fifo_length;
+        for (int c = 0; c < RESAMPLER_CHANNELS; c++) {
+            memmove(rs->fifo[c], rs->fifo[c] + consumed, (rs->fifo_length - consumed) * sizeof(float));
+        }
+        rs->fifo_length -= consumed;
+        rs->position -= consumed;
+    }
+    return produced;
+}
@@ -0,0 +1,53 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Polyphase windowed-sinc resampler with dynamic rate control.
+ *
+ * Converts the APU's fixed SAMPLE_RATE stream to the device rate. The
+ * conversion ratio is nudged by up to RESAMPLER_DRC_MAX depending on how far
+ * the audio queue is from its target fill, so an emulator paced by the
+ * display (60 Hz) rather than by the Game Boy's 59.73 Hz neither starves
+ * nor floods the device. Each output sample is a blend of two adjacent
+ * kernel phases, computed with SSE when available.
+ *
+ * Audio is stereo: input and output are interleaved left/right frames,
+ * and all counts are in frames. */
+
+#define RESAMPLER_TAPS    16
+#define RESAMPLER_PHASES  128
+#define RESAMPLER_DRC_MAX 0.005   /* +-0.5% */
+#define RESAMPLER_FIFO    (2048 + RESAMPLER_TAPS)
+#define RESAMPLER_CHANNELS 2
+
+typedef struct {
+    /* One extra row so phase + 1 is always valid */
+    _Alignas(16) float kernel[RESAMPLER_PHASES + 1][RESAMPLER_TAPS];
+
+    double base_step;       /* Input samples per output sample at nominal rate */
+    double step;            /* base_step with the rate control applied */
+    double position;        /* Next output, in input samples from fifo[0] */
+
+    /* Input history, one row per channel */
+    float fifo[RESAMPLER_CHANNELS][RESAMPLER_FIFO];
+    uint32_t fifo_length;   /* In frames */
+} Resampler;
+
+bool resampler_init(Resampler* rs, uint32_t input_rate, uint32_t output_rate);
+void resampler_reset(Resampler* rs);
+
+/* Adjust the ratio from the queue fill: a fuller queue consumes input
+   faster (fewer outputs), an emptier one slower */
+void resampler_set_fill(Resampler* rs, uint32_t queued, uint32_t target);
+
+/* Current output/input rate adjustment, e.g. -0.002 for 0.2% fewer samples */
+double resampler_get_adjust(const Resampler* rs);
+
+/* Resample count input frames into out; returns the number of frames
+   written. Input that would produce more than out_capacity frames is dropped. */
+uint32_t resampler_process(Resampler* rs, const float* in, uint32_t count,
+                           float* out, uint32_t out_capacity);
+
+#endif /* RESAMPLER_H */
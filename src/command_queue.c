@@ -0,0 +1,39 @@
+#include "command_queue.h"
+#include <time.h>
+
+#define COMMAND_QUEUE_MASK (COMMAND_QUEUE_SIZE - 1u)
+
+void command_queue_init(CommandQueue* queue) {
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->dropped, 0);
+}
+
+bool command_queue_push(CommandQueue* queue, CommandType type, int32_t value) {
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail == COMMAND_QUEUE_SIZE) {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    queue->slots[head & COMMAND_QUEUE_MASK] = (Command){
+        type, value, (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec
+    };
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool command_queue_pop(CommandQueue* queue, Command* command) {
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail) return false;
+    *command = queue->slots[tail & COMMAND_QUEUE_MASK];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+uint64_t command_queue_dropped(const CommandQueue* queue) {
+    return atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,71 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Lock-free single-producer/single-consumer queue of small commands.
+ *
+ * The GUI thread owns the window and the event pump; the emulation thread
+ * owns the GBEmulator. Button presses and menu actions cross over as
+ * commands, applied by the emulation thread in the order they were sent
+ * (buttons as soon as the game reads the joypad, the rest between frames),
+ * so a tap shorter than a frame is still seen as a press and a release.
+ * The same queue type carries notices back the other way. */
+
+#define COMMAND_QUEUE_SIZE 256      /* Power of two */
+#define COMMAND_QUEUE_CACHE_LINE 64
+
+typedef enum {
+    /* GUI -> emulation */
+    COMMAND_BUTTON_PRESS,       /* value: Joypad_Button */
+    COMMAND_BUTTON_RELEASE,     /* value: Joypad_Button */
+    COMMAND_REWIND,             /* value: rewind key held (1) or released (0) */
+    COMMAND_FAST_FORWARD,       /* value: fast-forward key held (1) or released (0) */
+    COMMAND_FAST_FORWARD_TOGGLE,
+    COMMAND_PAUSE,              /* value: paused (1) or running (0) */
+    COMMAND_PALETTE,            /* value: ppu_set_palette() index */
+    COMMAND_RESET,
+    COMMAND_SAVE_STATE,
+    COMMAND_LOAD_STATE,
+    COMMAND_SCREENSHOT,
+    COMMAND_QUIT,               /* Leave the emulation thread */
+
+    /* Emulation -> GUI */
+    COMMAND_NOTICE_BUSY,        /* An I/O job could not be queued */
+    COMMAND_NOTICE_SPEED        /* value: measured speed in percent of real time,
+                                   COMMAND_SPEED_MEASURING before the first
+                                   measurement, 0 when fast-forward ends */
+} CommandType;
+
+#define COMMAND_SPEED_MEASURING (-1)
+
+typedef struct {
+    CommandType type;
+    int32_t value;
+    uint64_t time_ns;           /* CLOCK_MONOTONIC when it was pushed */
+} Command;
+
+typedef struct {
+    Command slots[COMMAND_QUEUE_SIZE];
+
+    /* Written by the producer only */
+    _Alignas(COMMAND_QUEUE_CACHE_LINE) atomic_uint head;
+    atomic_uint_fast64_t dropped;
+
+    /* Written by the consumer only */
+    _Alignas(COMMAND_QUEUE_CACHE_LINE) atomic_uint tail;
+} CommandQueue;
+
+void command_queue_init(CommandQueue* queue);
+
+/* Producer: false (and counted as dropped) when the queue is full */
+bool command_queue_push(CommandQueue* queue, CommandType type, int32_t value);
+
+/* Consumer: false when empty */
+bool command_queue_pop(CommandQueue* queue, Command* command);
+
+uint64_t command_queue_dropped(const CommandQueue* queue);
+
+#endif /* COMMAND_QUEUE_H */
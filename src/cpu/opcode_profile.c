@@ -0,0 +1,265 @@
+#include "opcode_profile.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OPCODE_PROFILE_PROBE_RUNS 1000
+#define OPCODE_PROFILE_MAX_CLASSES 32    /* opcode_profile_class() has 22 */
+
+/* One executed opcode, for ranking */
+typedef struct {
+    bool cb;
+    uint8_t opcode;
+    const OpcodeStats* stats;
+    double host_ns;
+} OpcodeEntry;
+
+typedef struct {
+    const char* name;
+    uint64_t count;
+    double host_ns;
+} ClassTotal;
+
+void opcode_profile_init(OpcodeProfile* profile) {
+    memset(profile, 0, sizeof(*profile));
+    profile->countdown = OPCODE_PROFILE_SAMPLE_INTERVAL;
+    profile->rng = 0x9E3779B9u;
+    profiler_calibrate();
+
+    /* The cheapest empty probe pair is what every sample pays on top of the
+       instruction itself */
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < OPCODE_PROFILE_PROBE_RUNS; i++) {
+        uint64_t start = profiler_ticks();
+        uint64_t ticks = profiler_ticks_end() - start;
+        if (ticks < best) best = ticks;
+    }
+    profile->probe_ticks = best;
+}
+
+const char* opcode_profile_class(bool cb, uint8_t opcode) {
+    if (cb) {
+        switch (opcode >> 6) {
+            case 0: return "ROT/SHIFT";
+            case 1: return "BIT";
+            case 2: return "RES";
+            default: return "SET";
+        }
+    }
+
+    if (opcode == 0x76) return "HALT";
+    if (opcode >= 0x40 && opcode <= 0x7F) return "LD reg";
+    if (opcode >= 0x80 && opcode <= 0xBF) return "ALU reg";
+    if ((opcode & 0xC7) == 0x04 || (opcode & 0xC7) == 0x05) return "INC/DEC";
+
+    switch (opcode) {
+        case 0x00: case 0x10: case 0x27: case 0x2F: case 0x37: case 0x3F:
+        case 0xF3: case 0xFB:
+            return "MISC";
+        case 0x07: case 0x0F: case 0x17: case 0x1F:
+            return "ROT A";
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+            return "JR";
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9:
+            return "JP";
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+            return "CALL";
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9:
+            return "RET";
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+            return "RST";
+        case 0xC1: case 0xD1: case 0xE1: case 0xF1: case 0xC5: case 0xD5: case 0xE5: case 0xF5:
+            return "PUSH/POP";
+        case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+            return "ALU imm";
+        case 0x03: case 0x13: case 0x23: case 0x33: case 0x0B: case 0x1B: case 0x2B: case 0x3B:
+        case 0x09: case 0x19: case 0x29: case 0x39: case 0xE8:
+            return "ALU16";
+        case 0x01: case 0x11: case 0x21: case 0x31: case 0x08: case 0xF8: case 0xF9:
+            return "LD16";
+        case 0xCB:
+            return "CB";
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB: case 0xEC:
+        case 0xED: case 0xF4: case 0xFC: case 0xFD:
+            return "INVALID";
+        default:
+            /* LD r,n, LD (rr),A and back, LDH and LD (nn) */
+            return "LD mem/imm";
+    }
+}
+
+/* Mean sampled time of one execution, probe overhead removed */
+static double average_ns(const OpcodeProfile* profile, const OpcodeStats* stats) {
+    if (stats->samples == 0) return 0.0;
+    double ticks = (double)stats->sample_ticks / stats->samples - (double)profile->probe_ticks;
+    return ticks > 0.0 ? profiler_ticks_to_ns((uint64_t)ticks) : 0.0;
+}
+
+double opcode_profile_host_ns(const OpcodeProfile* profile, const OpcodeStats* stats) {
+    return average_ns(profile, stats) * stats->count;
+}
+
+/* Executed opcodes, main table first; the caller frees the list */
+static OpcodeEntry* collect_entries(const OpcodeProfile* profile, uint32_t* count) {
+    OpcodeEntry* entries = malloc(512 * sizeof(OpcodeEntry));
+    *count = 0;
+    if (!entries) return NULL;
+    for (int table = 0; table < 2; table++) {
+        const OpcodeStats* stats = table ? profile->cb : profile->main;
+        for (int op = 0; op < 256; op++) {
+            if (stats[op].count == 0) continue;
+            OpcodeEntry* entry = &entries[(*count)++];
+            entry->cb = table == 1;
+            entry->opcode = (uint8_t)op;
+            entry->stats = &stats[op];
+            entry->host_ns = opcode_profile_host_ns(profile, &stats[op]);
+        }
+    }
+    return entries;
+}
+
+static int compare_by_count(const void* a, const void* b) {
+    uint64_t x = ((const OpcodeEntry*)a)->stats->count;
+    uint64_t y = ((const OpcodeEntry*)b)->stats->count;
+    return (x < y) - (x > y);
+}
+
+static int compare_by_host_time(const void* a, const void* b) {
+    double x = ((const OpcodeEntry*)a)->host_ns;
+    double y = ((const OpcodeEntry*)b)->host_ns;
+    return (x < y) - (x > y);
+}
+
+static int compare_classes(const void* a, const void* b) {
+    double x = ((const ClassTotal*)a)->host_ns;
+    double y = ((const ClassTotal*)b)->host_ns;
+    return (x < y) - (x > y);
+}
+
+static void format_opcode(char* out, size_t size, const OpcodeEntry* entry) {
+    snprintf(out, size, entry->cb ? "CB %02X" : "%02X", entry->opcode);
+}
+
+void opcode_profile_print_report(const OpcodeProfile* profile, FILE* out) {
+    uint32_t count;
+    OpcodeEntry* entries = collect_entries(profile, &count);
+    if (!entries) {
+        fprintf(stderr, "Failed to allocate opcode report\n");
+        return;
+    }
+
+    uint64_t instructions = 0;
+    double host_ns = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        instructions += entries[i].stats->count;
+        host_ns += entries[i].host_ns;
+    }
+
+    fprintf(out, "\n=== Opcode Profile ===\n");
+    fprintf(out, "Instructions: %llu in %u opcodes (1 in %d timed, %.1f ns probe overhead removed)\n",
+            (unsigned long long)instructions, count, OPCODE_PROFILE_SAMPLE_INTERVAL,
+            profiler_ticks_to_ns(profile->probe_ticks));
+    if (count == 0) {
+        free(entries);
+        return;
+    }
+    uint32_t top = count < OPCODE_PROFILE_TOP ? count : OPCODE_PROFILE_TOP;
+    char name[8];
+
+    qsort(entries, count, sizeof(OpcodeEntry), compare_by_count);
+    fprintf(out, "\nBy count:\n");
+    fprintf(out, "%-8s %-12s %14s %7s %10s %10s\n", "Opcode", "Class", "Count", "%", "Cycles/op", "Avg (ns)");
+    for (uint32_t i = 0; i < top; i++) {
+        const OpcodeStats* stats = entries[i].stats;
+        format_opcode(name, sizeof(name), &entries[i]);
+        fprintf(out, "%-8s %-12s %14llu %6.2f%% %10.1f %10.1f\n",
+                name, opcode_profile_class(entries[i].cb, entries[i].opcode),
+                (unsigned long long)stats->count, 100.0 * stats->count / instructions,
+                (double)stats->cycles / stats->count, average_ns(profile, stats));
+    }
+
+    qsort(entries, count, sizeof(OpcodeEntry), compare_by_host_time);
+    fprintf(out, "\nBy host time:\n");
+    fprintf(out, "%-8s %-12s %14s %7s %10s %14s\n", "Opcode", "Class", "Host (ms)", "%", "Avg (ns)", "Count");
+    for (uint32_t i = 0; i < top; i++) {
+        const OpcodeStats* stats = entries[i].stats;
+        format_opcode(name, sizeof(name), &entries[i]);
+        fprintf(out, "%-8s %-12s %14.3f %6.2f%% %10.1f %14llu\n",
+                name, opcode_profile_class(entries[i].cb, entries[i].opcode),
+                entries[i].host_ns / 1e6, host_ns > 0.0 ? 100.0 * entries[i].host_ns / host_ns : 0.0,
+                average_ns(profile, stats), (unsigned long long)stats->count);
+    }
+
+    /* Totals per class, ranked by host time */
+    ClassTotal classes[OPCODE_PROFILE_MAX_CLASSES];
+    uint32_t class_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const char* name = opcode_profile_class(entries[i].cb, entries[i].opcode);
+        uint32_t c = 0;
+        while (c < class_count && strcmp(classes[c].name, name) != 0) c++;
+        if (c == class_count) {
+            classes[c] = (ClassTotal){ name, 0, 0.0 };
+            class_count++;
+        }
+        classes[c].count += entries[i].stats->count;
+        classes[c].host_ns += entries[i].host_ns;
+    }
+    qsort(classes, class_count, sizeof(ClassTotal), compare_classes);
+    fprintf(out, "\nBy class:\n");
+    fprintf(out, "%-12s %14s %7s %14s %7s\n", "Class", "Count", "%", "Host (ms)", "%");
+    for (uint32_t c = 0; c < class_count; c++) {
+        fprintf(out, "%-12s %14llu %6.2f%% %14.3f %6.2f%%\n",
+                classes[c].name, (unsigned long long)classes[c].count, 100.0 * classes[c].count / instructions,
+                classes[c].host_ns / 1e6, host_ns > 0.0 ? 100.0 * classes[c].host_ns / host_ns : 0.0);
+    }
+    free(entries);
+}
+
+bool opcode_profile_export(const OpcodeProfile* profile, const char* path) {
+    uint32_t count;
+    OpcodeEntry* entries = collect_entries(profile, &count);
+    if (!entries) {
+        fprintf(stderr, "Failed to allocate opcode export\n");
+        return false;
+    }
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write opcode profile: %s\n", path);
+        free(entries);
+        return false;
+    }
+
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+    if (json) {
+        fprintf(f, "{\n");
+        fprintf(f, "  \"sample_interval\": %d,\n", OPCODE_PROFILE_SAMPLE_INTERVAL);
+        fprintf(f, "  \"probe_overhead_ns\": %.1f,\n", profiler_ticks_to_ns(profile->probe_ticks));
+        fprintf(f, "  \"opcodes\": [");
+    } else {
+        fprintf(f, "prefix,opcode,class,count,cycles,samples,avg_ns,host_ns\n");
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const OpcodeEntry* entry = &entries[i];
+        const OpcodeStats* stats = entry->stats;
+        const char* cls = opcode_profile_class(entry->cb, entry->opcode);
+        if (json) {
+            fprintf(f, "%s\n    {\"prefix\": \"%s\", \"opcode\": \"%02X\", \"class\": \"%s\", "
+                    "\"count\": %llu, \"cycles\": %llu, \"samples\": %llu, \"avg_ns\": %.1f, \"host_ns\": %.0f}",
+                    i ? "," : "", entry->cb ? "CB" : "", entry->opcode, cls,
+                    (unsigned long long)stats->count, (unsigned long long)stats->cycles,
+                    (unsigned long long)stats->samples, average_ns(profile, stats), entry->host_ns);
+        } else {
+            fprintf(f, "%s,%02X,%s,%llu,%llu,%llu,%.1f,%.0f\n",
+                    entry->cb ? "CB" : "", entry->opcode, cls,
+                    (unsigned long long)stats->count, (unsigned long long)stats->cycles,
+                    (unsigned long long)stats->samples, average_ns(profile, stats), entry->host_ns);
+        }
+    }
+    if (json) fprintf(f, "\n  ]\n}\n");
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Error: Cannot write opcode profile: %s\n", path);
+    free(entries);
+    return ok;
+}
@@ -0,0 +1,81 @@
+#ifndef GB_OPCODE_PROFILE_H
+#define GB_OPCODE_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "../profiler.h"
+
+/* Per-opcode execution histogram for the SM83 dispatcher.
+ *
+ * Attached to a CPU with sm83_set_opcode_profile(); a CPU without one pays
+ * a single NULL check per instruction. Every instruction is counted along
+ * with the emulated cycles it took (taken branches included). One in
+ * OPCODE_PROFILE_SAMPLE_INTERVAL on average is also timed on the host with
+ * the profiler's TSC probes, from fetch to the end of dispatch, which gives
+ * a per-opcode host cost without timing every instruction. The gap between
+ * samples is random: a fixed one would lock onto loops whose length divides
+ * it and time the same instruction every time. CB-prefixed instructions
+ * are counted under their second byte in cb[], not under main[0xCB]. */
+
+#define OPCODE_PROFILE_SAMPLE_INTERVAL 64
+#define OPCODE_PROFILE_TOP             16   /* Rows per ranking in the report */
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;        /* Emulated cycles over all executions */
+    uint64_t samples;       /* Executions timed on the host */
+    uint64_t sample_ticks;  /* Profiler ticks over the timed executions */
+} OpcodeStats;
+
+typedef struct OpcodeProfile {
+    OpcodeStats main[256];
+    OpcodeStats cb[256];
+    uint32_t countdown;     /* Instructions until the next timed one */
+    uint32_t rng;           /* xorshift32 state for the sample gaps */
+    uint64_t probe_ticks;   /* Cost of an empty probe pair, subtracted from samples */
+} OpcodeProfile;
+
+/* Clears the counters and measures the probe overhead */
+void opcode_profile_init(OpcodeProfile* profile);
+
+/* Called by sm83_step() before the fetch: true if this instruction is timed */
+static inline bool opcode_profile_sample_due(OpcodeProfile* profile) {
+    if (--profile->countdown != 0) return false;
+    uint32_t x = profile->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    profile->rng = x;
+    /* Uniform in [1, 2 * interval - 1]: the mean gap is the interval */
+    profile->countdown = 1 + x % (2 * OPCODE_PROFILE_SAMPLE_INTERVAL - 1);
+    return true;
+}
+
+/* Called by sm83_step() after dispatch; start_ticks is only read if sampled */
+static inline void opcode_profile_record(OpcodeProfile* profile, uint8_t opcode, uint8_t cb_opcode,
+                                         uint32_t cycles, bool sampled, uint64_t start_ticks) {
+    OpcodeStats* stats = opcode == 0xCB ? &profile->cb[cb_opcode] : &profile->main[opcode];
+    stats->count++;
+    stats->cycles += cycles;
+    if (sampled) {
+        stats->samples++;
+        stats->sample_ticks += profiler_ticks_end() - start_ticks;
+    }
+}
+
+/* Instruction group for an opcode, e.g. "LD reg" or "BIT" (cb selects the CB table) */
+const char* opcode_profile_class(bool cb, uint8_t opcode);
+
+/* Estimated host time of all executions: count times the mean sampled time.
+   0 for opcodes that were never timed. */
+double opcode_profile_host_ns(const OpcodeProfile* profile, const OpcodeStats* stats);
+
+/* Opcodes ranked by count and by estimated host time, and totals per class */
+void opcode_profile_print_report(const OpcodeProfile* profile, FILE* out);
+
+/* Writes every executed opcode to path: JSON if it ends in ".json",
+   CSV otherwise. Returns false if the file cannot be written. */
+bool opcode_profile_export(const OpcodeProfile* profile, const char* path);
+
+#endif /* GB_OPCODE_PROFILE_H */
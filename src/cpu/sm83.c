@@ -1,8 +1,9 @@
 #include "sm83.h"
 #include "sm83_ops.h"
+#include "opcode_profile.h"
 #include "../memory/memory.h"
 #include "../gbendo.h"
-#include "../ui/ui.h"
+#include "../ui/ui_debug.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -53,6 +54,10 @@ void sm83_init(SM83_CPU* cpu) {
     memset(cpu, 0, sizeof(SM83_CPU));
 }
 
+void sm83_set_opcode_profile(SM83_CPU* cpu, struct OpcodeProfile* profile) {
+    cpu->opcode_profile = profile;
+}
+
 void sm83_reset(SM83_CPU* cpu) {
     /* Initial register values after boot ROM */
     cpu->af = 0x01B0;
@@ -62,6 +67,9 @@ void sm83_reset(SM83_CPU* cpu) {
     cpu->sp = 0xFFFE;
     cpu->pc = 0x0100;  /* Start of cartridge ROM after boot ROM */
     cpu->ime = false;  /* IME disabled at reset (matches DMG power-on) */
+    cpu->ei_delay = false;
+    cpu->halted = false;
+    cpu->stopped = false;
     cpu->cycles = 0;
 }
 
@@ -255,8 +263,18 @@ int sm83_step(SM83_CPU* cpu) {
     
     /* EI delay is applied after the next instruction completes (handled at end of step) */
     
+    OpcodeProfile* profile = cpu->opcode_profile;
+    bool sampled = false;
+    uint64_t sample_start = 0;
+    uint32_t cycles_start = cpu->cycles;
+    if (profile && opcode_profile_sample_due(profile)) {
+        sampled = true;
+        sample_start = profiler_ticks();
+    }
+
     uint16_t pc_before = cpu->pc;
     uint8_t opcode = memory_read(mem, cpu->pc++);
+    uint8_t cb_opcode = 0;
     uint32_t cycles = instruction_cycles[opcode];
     bool executed_ei = false;
     
@@ -540,7 +558,7 @@ int sm83_step(SM83_CPU* cpu) {
         case 0xCA: jp_cc_nn(cpu, sm83_get_flag(cpu, FLAG_Z), mem); break;
         case 0xCB: {
             /* CB-prefixed instructions */
-            uint8_t cb_opcode = memory_read(mem, cpu->pc++);
+            cb_opcode = memory_read(mem, cpu->pc++);
             cycles = cb_cycles[cb_opcode];
             uint8_t bit = (cb_opcode >> 3) & 0x07;
             uint8_t reg = cb_opcode & 0x07;
@@ -660,6 +678,9 @@ int sm83_step(SM83_CPU* cpu) {
     }
 
     sm83_add_cycles(cpu, cycles);
+    if (profile) {
+        opcode_profile_record(profile, opcode, cb_opcode, cpu->cycles - cycles_start, sampled, sample_start);
+    }
     
     /* Apply EI delay now: enable IME after completing the instruction
        following EI (not the EI instruction itself). */
@@ -669,7 +690,7 @@ int sm83_step(SM83_CPU* cpu) {
     }
     
     /* Debug output - show state after execution */
-    GBEmulator* gb = gb_get_debug_gb();
+    GBEmulator* gb = gb_get_debug_gb(mem);
     if (gb) {
         /* Show every instruction for first 1000 cycles, then every 1000th cycle */
         bool should_log = (gb->cycles < 1000) || (gb->cycles % 1000 == 0);
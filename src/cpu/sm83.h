@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+struct OpcodeProfile;
+
 /* Sharp SM83 CPU (based on Intel 8080 architecture) */
 typedef struct {
     /* Main registers */
@@ -50,6 +52,7 @@ typedef struct {
     bool stopped;   /* CPU is stopped flag */
     void* mem;      /* Points to Memory struct */
     uint32_t cycles;/* Clock cycle counter */
+    struct OpcodeProfile* opcode_profile;  /* Optional execution histogram, not part of the state */
 
     /* Flag register bit fields */
     struct {
@@ -66,6 +69,9 @@ void sm83_init(SM83_CPU* cpu);
 void sm83_reset(SM83_CPU* cpu);
 int sm83_step(SM83_CPU* cpu);  /* Execute one instruction */
 
+/* Counts every executed opcode into profile (caller-owned; NULL stops) */
+void sm83_set_opcode_profile(SM83_CPU* cpu, struct OpcodeProfile* profile);
+
 /* Interrupt handling */
 void sm83_request_interrupt(SM83_CPU* cpu, uint8_t interrupt);
 void sm83_service_interrupts(SM83_CPU* cpu);
@@ -31,8 +31,8 @@ void stop(SM83_CPU* cpu) {
 
 void di(SM83_CPU* cpu) {
     cpu->ime = false;
-    if (gb_is_debug_enabled()) {
-        GBEmulator* gb = gb_get_debug_gb();
+    if (gb_is_debug_enabled(cpu->mem)) {
+        GBEmulator* gb = gb_get_debug_gb(cpu->mem);
         if (gb) {
             printf("[CPU] DI - Interrupts disabled at PC=0x%04X\n", cpu->pc - 1);
         }
@@ -42,8 +42,8 @@ void di(SM83_CPU* cpu) {
 void ei(SM83_CPU* cpu) {
     /* EI actually enables interrupts after the next instruction */
     cpu->ei_delay = true;
-    if (gb_is_debug_enabled()) {
-        GBEmulator* gb = gb_get_debug_gb();
+    if (gb_is_debug_enabled(cpu->mem)) {
+        GBEmulator* gb = gb_get_debug_gb(cpu->mem);
         if (gb) {
             printf("[CPU] EI - Interrupts will be enabled after next instruction at PC=0x%04X\n", cpu->pc - 1);
         }
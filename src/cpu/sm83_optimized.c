@@ -24,10 +24,6 @@ __attribute__((unused)) static const uint8_t instruction_cycles[256] = {
     /*F*/ 12, 12,  8,  4,  0, 16,  8, 16, 12,  8, 16,  4,  0,  0,  8, 16
 };
 
-/* Jump tables for instruction dispatch */
-InstructionHandler instruction_table[256];
-InstructionHandler cb_instruction_table[256];
-
 /* Fast instruction implementations - no function call overhead */
 
 /* NOP - 0x00 */
@@ -143,26 +139,16 @@ static int generic_inc_bc(SM83_CPU* cpu, void* mem) {
     return 8; 
 }
 
-/* Initialize jump tables with optimized handlers */
-void sm83_init_jump_tables(void) {
-    /* Initialize all entries to NULL first */
-    memset(instruction_table, 0, sizeof(instruction_table));
-    memset(cb_instruction_table, 0, sizeof(cb_instruction_table));
-    
-    /* Install optimized handlers for most common instructions */
-    instruction_table[0x00] = generic_nop;         /* NOP */
-    instruction_table[0x01] = generic_ld_bc_nn;    /* LD BC,nn */
-    instruction_table[0x02] = generic_ld_bc_a;     /* LD (BC),A */
-    instruction_table[0x03] = generic_inc_bc;      /* INC BC */
-    
-    /* Install generic handlers for all other instructions */
-    for (int i = 4; i < 256; i++) {
-        if (!instruction_table[i]) {
-            /* Install a generic handler that calls the original switch-based implementation */
-            instruction_table[i] = NULL; /* Will be handled by fallback */
-        }
-    }
-}
+/* Jump tables for instruction dispatch, fixed at compile time so every
+   emulator instance shares them read-only. NULL entries are handled by the
+   switch-based fallback. */
+const InstructionHandler instruction_table[256] = {
+    [0x00] = generic_nop,         /* NOP */
+    [0x01] = generic_ld_bc_nn,    /* LD BC,nn */
+    [0x02] = generic_ld_bc_a,     /* LD (BC),A */
+    [0x03] = generic_inc_bc,      /* INC BC */
+};
+const InstructionHandler cb_instruction_table[256] = { NULL };
 
 
 /* Enhanced instruction dispatch with fallback */
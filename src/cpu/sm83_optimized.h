@@ -7,9 +7,9 @@
 /* Fast instruction dispatch using function pointers */
 typedef int (*InstructionHandler)(SM83_CPU* cpu, void* mem);
 
-/* Jump tables for faster instruction dispatch */
-extern InstructionHandler instruction_table[256];
-extern InstructionHandler cb_instruction_table[256];
+/* Jump tables for faster instruction dispatch (read-only) */
+extern const InstructionHandler instruction_table[256];
+extern const InstructionHandler cb_instruction_table[256];
 
 /* Optimized CPU step function using jump table */
 static inline int sm83_step_optimized(SM83_CPU* cpu) {
@@ -27,9 +27,6 @@ static inline int sm83_step_optimized(SM83_CPU* cpu) {
     return instruction_table[opcode](cpu, mem);
 }
 
-/* Initialize jump tables */
-void sm83_init_jump_tables(void);
-
 /* Optimized memory access macros */
 #define FAST_READ8(mem, addr) (((Memory*)(mem))->memory_read_fast(mem, addr))
 #define FAST_WRITE8(mem, addr, val) (((Memory*)(mem))->memory_write_fast(mem, addr, val))
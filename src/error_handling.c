@@ -6,7 +6,7 @@
 #include <string.h>
 
 /* Global error context */
-ErrorContext g_error_context = {0};
+_Thread_local ErrorContext g_error_context = {0};
 
 /* Error handling functions */
 void error_init(void) {
@@ -41,7 +41,8 @@ typedef struct {
     const char* error_function;
 } ErrorContext;
 
-extern ErrorContext g_error_context;
+/* Per thread, like errno: each emulator thread reports its own errors */
+extern _Thread_local ErrorContext g_error_context;
 
 /* Error reporting macros */
 #define SET_ERROR(code, msg) \
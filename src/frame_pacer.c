@@ -0,0 +1,103 @@
+#include "frame_pacer.h"
+#include <string.h>
+#include <errno.h>
+
+static int64_t diff_ns(const struct timespec* a, const struct timespec* b) {
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+static void add_ns(struct timespec* t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+void frame_pacer_init(FramePacer* pacer, double hz) {
+    memset(pacer, 0, sizeof(*pacer));
+    frame_pacer_set_period(pacer, (long)(1e9 / hz));
+}
+
+void frame_pacer_set_period(FramePacer* pacer, long period_ns) {
+    pacer->period_ns = period_ns;
+    frame_pacer_resync(pacer);
+}
+
+void frame_pacer_resync(FramePacer* pacer) {
+    clock_gettime(CLOCK_MONOTONIC, &pacer->deadline);
+    pacer->has_mark = false;
+}
+
+void frame_pacer_wait(FramePacer* pacer) {
+    add_ns(&pacer->deadline, pacer->period_ns);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t remaining = diff_ns(&pacer->deadline, &now);
+    if (remaining < -(int64_t)pacer->period_ns) {
+        /* Too slow to catch up (or the host was suspended): start over from now */
+        pacer->deadline = now;
+        pacer->resyncs++;
+        return;
+    }
+
+    if (remaining > FRAME_PACER_SPIN_NS) {
+        struct timespec wake = pacer->deadline;
+        wake.tv_nsec -= FRAME_PACER_SPIN_NS;
+        if (wake.tv_nsec < 0) {
+            wake.tv_nsec += 1000000000L;
+            wake.tv_sec--;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR) {}
+    }
+    do {
+        cpu_relax();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (diff_ns(&pacer->deadline, &now) > 0);
+}
+
+void frame_pacer_mark(FramePacer* pacer) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (pacer->has_mark) {
+        uint64_t frame_ns = (uint64_t)diff_ns(&now, &pacer->last_mark);
+        uint64_t bucket = frame_ns / FRAME_PACER_BUCKET_NS;
+        if (bucket >= FRAME_PACER_BUCKETS) bucket = FRAME_PACER_BUCKETS - 1;
+        pacer->histogram[bucket]++;
+        pacer->frames++;
+        if (frame_ns > pacer->max_ns) pacer->max_ns = frame_ns;
+    }
+    pacer->last_mark = now;
+    pacer->has_mark = true;
+}
+
+/* Middle of the bucket holding the rank-th smallest frame time */
+static uint64_t percentile_ns(const FramePacer* pacer, uint64_t rank) {
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < FRAME_PACER_BUCKETS; i++) {
+        seen += pacer->histogram[i];
+        if (seen >= rank) {
+            uint64_t ns = (uint64_t)i * FRAME_PACER_BUCKET_NS + FRAME_PACER_BUCKET_NS / 2;
+            return ns < pacer->max_ns ? ns : pacer->max_ns;
+        }
+    }
+    return pacer->max_ns;
+}
+
+void frame_pacer_stats(const FramePacer* pacer, FramePacerStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->frames = pacer->frames;
+    stats->resyncs = pacer->resyncs;
+    if (pacer->frames == 0) return;
+    /* Nearest rank: the smallest time at least p of the frames fit in */
+    stats->p50_ns = percentile_ns(pacer, (pacer->frames * 50 + 99) / 100);
+    stats->p99_ns = percentile_ns(pacer, (pacer->frames * 99 + 99) / 100);
+    stats->max_ns = pacer->max_ns;
+}
@@ -0,0 +1,64 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Frame pacing for the emulation thread.
+ *
+ * Frames are due on an absolute schedule (start + n * period), so rounding
+ * and oversleeping never add up. Waiting sleeps until FRAME_PACER_SPIN_NS
+ * before the deadline and spins on the clock for the rest: a plain sleep
+ * routinely wakes a scheduler tick late, which shows as judder on displays
+ * that refresh at the emulated rate. A pacer that falls more than a frame
+ * behind starts over from now instead of rushing to catch up.
+ *
+ * Frame times (the interval between successive frame_pacer_mark() calls)
+ * go into a fixed-bucket histogram, so percentiles cost no sorting and no
+ * allocation. */
+
+#define FRAME_PACER_SPIN_NS       1000000L     /* Spin for the last 1 ms */
+#define FRAME_PACER_BUCKET_NS     10000L       /* 10 us histogram resolution */
+#define FRAME_PACER_BUCKETS       10000        /* Up to 100 ms; longer lands in the last */
+
+typedef struct {
+    long period_ns;
+    struct timespec deadline;       /* When the next frame is due */
+    uint64_t resyncs;               /* Times the schedule restarted after falling behind */
+
+    struct timespec last_mark;
+    bool has_mark;
+    uint32_t histogram[FRAME_PACER_BUCKETS];
+    uint64_t frames;                /* Frame times recorded */
+    uint64_t max_ns;
+} FramePacer;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    uint64_t resyncs;
+} FramePacerStats;
+
+/* Paces at hz frames per second, starting now */
+void frame_pacer_init(FramePacer* pacer, double hz);
+
+/* Changes the period and restarts the schedule from now; the next frame
+   time is not recorded, since it spans the change */
+void frame_pacer_set_period(FramePacer* pacer, long period_ns);
+
+/* Restarts the schedule from now, e.g. after a pause */
+void frame_pacer_resync(FramePacer* pacer);
+
+/* Blocks until the next frame is due */
+void frame_pacer_wait(FramePacer* pacer);
+
+/* Records the time since the previous mark as one frame time */
+void frame_pacer_mark(FramePacer* pacer);
+
+/* Frame time percentiles, to FRAME_PACER_BUCKET_NS resolution (max is exact) */
+void frame_pacer_stats(const FramePacer* pacer, FramePacerStats* stats);
+
+#endif /* FRAME_PACER_H */
@@ -1,17 +1,24 @@
 #include "gbendo.h"
+#include "savestate.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-/* Global debug flag - set by gb_enable_debug/gb_disable_debug */
-static GBEmulator* g_debug_gb = NULL;
-
-/* Helper function to check if debug is enabled */
-bool gb_is_debug_enabled(void) {
-    return g_debug_gb != NULL && g_debug_gb->debug_mode;
+/* Helper function to check if debug is enabled for the emulator owning mem */
+bool gb_is_debug_enabled(const Memory* mem) {
+    GBEmulator* gb = gb_get_debug_gb(mem);
+    return gb != NULL && gb->debug_mode;
 }
 
-/* Helper function to get debug GB pointer (for subsystems) */
-GBEmulator* gb_get_debug_gb(void) {
-    return g_debug_gb;
+/* Helper function to get debug GB pointer (for subsystems).
+   Set on the emulator's own memory by gb_enable_debug(), so each instance
+   has its own debug mode. */
+GBEmulator* gb_get_debug_gb(const Memory* mem) {
+    return mem ? (GBEmulator*)mem->debug_gb : NULL;
 }
 
 void gb_init(GBEmulator* gb) {
@@ -20,6 +27,7 @@ void gb_init(GBEmulator* gb) {
     sm83_init(&gb->cpu);
     ppu_init(&gb->ppu, &gb->memory);  /* Pass memory to PPU for interrupt requests */
     apu_init(&gb->apu);
+    profiler_init(&gb->profiler);
 
     /* Wire CPU <-> Memory */
     gb->cpu.mem = &gb->memory;
@@ -33,7 +41,9 @@ void gb_init(GBEmulator* gb) {
 
     /* Mark initial state */
     gb->cycles = 0;
+    gb->instructions = 0;
     gb->frame_complete = false;
+    gb->cpu_fault = false;
     gb->debug_mode = false;
 }
 
@@ -44,16 +54,45 @@ void gb_reset(GBEmulator* gb) {
     apu_reset(&gb->apu);
     gb->cycles = 0;
     gb->frame_complete = false;
+    gb->cpu_fault = false;
 }
 
 void gb_cleanup(GBEmulator* gb) {
     memory_cleanup(&gb->memory);
+    apu_cleanup(&gb->apu);
+}
+
+bool gb_clone(GBEmulator* dst, const GBEmulator* src) {
+    gb_init(dst);
+    if (!memory_clone(&dst->memory, &src->memory)) {
+        gb_cleanup(dst);
+        return false;
+    }
+
+    /* Plain state copies, pointed back at the copy's own memory */
+    dst->cpu = src->cpu;
+    dst->cpu.mem = &dst->memory;
+    dst->cpu.opcode_profile = NULL;
+    dst->ppu = src->ppu;
+    dst->ppu.memory = &dst->memory;
+    apu_clone(&dst->apu, &src->apu);
+
+    dst->cycles = src->cycles;
+    dst->instructions = src->instructions;
+    dst->frame_complete = src->frame_complete;
+    dst->cpu_fault = src->cpu_fault;
+    dst->breakpoint = src->breakpoint;
+    return true;
 }
 
 bool gb_load_rom(GBEmulator* gb, const char* filename) {
     return memory_load_rom(&gb->memory, filename);
 }
 
+bool gb_load_rom_data(GBEmulator* gb, const uint8_t* data, size_t size) {
+    return memory_load_rom_data(&gb->memory, data, size);
+}
+
 void gb_unload_rom(GBEmulator* gb) {
     /* Reset emulator state to stop any running processes */
     gb->cycles = 0;
@@ -89,8 +128,12 @@ void gb_run_frame(GBEmulator* gb) {
     uint32_t target = gb->cycles + cycles_per_frame;
     while (gb->cycles < target) {
         int cyc = sm83_step(&gb->cpu);
-        if (cyc <= 0) break;
+        if (cyc <= 0) {
+            gb->cpu_fault = true;
+            break;
+        }
         gb->cycles += cyc;
+        gb->instructions++;
         
         /* Step PPU with the same cycles */
         ppu_step(&gb->ppu, cyc);
@@ -98,6 +141,7 @@ void gb_run_frame(GBEmulator* gb) {
         /* Step APU with the same cycles */
         apu_step(&gb->apu, cyc);
     }
+    apu_end_frame(&gb->apu);
     gb->frame_complete = true;
 }
 
@@ -108,32 +152,49 @@ void gb_run_frame_optimized(GBEmulator* gb) {
     uint32_t batch_cycles = 0;
     
     /* Process instructions in batches to reduce function call overhead */
-    while (gb->cycles < target) {
+    bool fault = false;
+    while (gb->cycles < target && !fault) {
         /* Process up to 16 instructions before updating subsystems */
         const int batch_size = 16;
         batch_cycles = 0;
         
         for (int i = 0; i < batch_size && gb->cycles < target; i++) {
+            PROFILE_DETAIL_START(&gb->profiler, CPU_STEP);
             int cyc = sm83_step(&gb->cpu);
-            if (cyc <= 0) break;
+            PROFILE_DETAIL_END(&gb->profiler, CPU_STEP);
+            if (cyc <= 0) {
+                /* Invalid opcode: end the frame instead of spinning on it */
+                gb->cpu_fault = true;
+                fault = true;
+                break;
+            }
             
             gb->cycles += cyc;
+            gb->instructions++;
             batch_cycles += cyc;
         }
         
         /* Update subsystems once per batch */
         if (batch_cycles > 0) {
+            PROFILE_DETAIL_START(&gb->profiler, PPU_STEP);
             ppu_step(&gb->ppu, batch_cycles);
+            PROFILE_DETAIL_END(&gb->profiler, PPU_STEP);
+            PROFILE_DETAIL_START(&gb->profiler, APU_STEP);
             apu_step(&gb->apu, batch_cycles);
+            PROFILE_DETAIL_END(&gb->profiler, APU_STEP);
         }
     }
+    apu_end_frame(&gb->apu);
     gb->frame_complete = true;
 }
 
 void gb_step(GBEmulator* gb) {
     int cyc = sm83_step(&gb->cpu);
-    if (cyc > 0) {
+    if (cyc <= 0) {
+        gb->cpu_fault = true;
+    } else {
         gb->cycles += cyc;
+        gb->instructions++;
         
         /* Step PPU with the same cycles */
         ppu_step(&gb->ppu, cyc);
@@ -148,14 +209,12 @@ void gb_resume(GBEmulator* gb) { (void)gb; }
 
 void gb_enable_debug(GBEmulator* gb) {
     gb->debug_mode = true;
-    g_debug_gb = gb;
+    gb->memory.debug_gb = gb;
 }
 
 void gb_disable_debug(GBEmulator* gb) {
     gb->debug_mode = false;
-    if (g_debug_gb == gb) {
-        g_debug_gb = NULL;
-    }
+    gb->memory.debug_gb = NULL;
 }
 
 void gb_set_breakpoint(GBEmulator* gb, uint16_t address) {
@@ -167,7 +226,7 @@ void gb_clear_breakpoint(GBEmulator* gb) {
 }
 
 /* Save state version for compatibility checking */
-#define GB_SAVE_STATE_VERSION 1
+#define GB_SAVE_STATE_VERSION 2
 
 /* Complete emulator save state structure */
 typedef struct {
@@ -275,8 +334,9 @@ typedef struct {
         uint8_t right_volume;
         uint8_t left_enables;
         uint8_t right_enables;
-        int32_t sample_timer;
         uint32_t frame_sequencer;
+        uint32_t frame_sequencer_timer;
+        uint32_t pending_cycles;
     } apu;
     
     /* Emulator timing state */
@@ -384,263 +444,291 @@ static inline void load_apu_pulse_channel(void* dst_channel, const void* src_cha
 }
 
 
-bool gb_save_state(GBEmulator* gb, const char* filename) {
-    if (!gb || !filename) return false;
-    
-    FILE* file = fopen(filename, "wb");
-    if (!file) {
-        fprintf(stderr, "Failed to open save state file for writing: %s\n", filename);
-        return false;
-    }
-    
-    GB_SaveState state = {0};
-    state.version = GB_SAVE_STATE_VERSION;
+/* Copy emulator core state (everything except Memory) into a save state */
+static void gb_state_capture(const GBEmulator* gb, GB_SaveState* state) {
+    memset(state, 0, sizeof(*state));
+    state->version = GB_SAVE_STATE_VERSION;
     
     /* Save CPU state */
-    SAVE_FIELD(state.cpu, gb->cpu, af);
-    SAVE_FIELD(state.cpu, gb->cpu, bc);
-    SAVE_FIELD(state.cpu, gb->cpu, de);
-    SAVE_FIELD(state.cpu, gb->cpu, hl);
-    SAVE_FIELD(state.cpu, gb->cpu, sp);
-    SAVE_FIELD(state.cpu, gb->cpu, pc);
-    SAVE_FIELD(state.cpu, gb->cpu, ime);
-    SAVE_FIELD(state.cpu, gb->cpu, ei_delay);
-    SAVE_FIELD(state.cpu, gb->cpu, halted);
-    SAVE_FIELD(state.cpu, gb->cpu, stopped);
-    SAVE_FIELD(state.cpu, gb->cpu, cycles);
+    SAVE_FIELD(state->cpu, gb->cpu, af);
+    SAVE_FIELD(state->cpu, gb->cpu, bc);
+    SAVE_FIELD(state->cpu, gb->cpu, de);
+    SAVE_FIELD(state->cpu, gb->cpu, hl);
+    SAVE_FIELD(state->cpu, gb->cpu, sp);
+    SAVE_FIELD(state->cpu, gb->cpu, pc);
+    SAVE_FIELD(state->cpu, gb->cpu, ime);
+    SAVE_FIELD(state->cpu, gb->cpu, ei_delay);
+    SAVE_FIELD(state->cpu, gb->cpu, halted);
+    SAVE_FIELD(state->cpu, gb->cpu, stopped);
+    SAVE_FIELD(state->cpu, gb->cpu, cycles);
     
     /* Save PPU state */
-    SAVE_FIELD(state.ppu, gb->ppu, lcdc);
-    SAVE_FIELD(state.ppu, gb->ppu, stat);
-    SAVE_FIELD(state.ppu, gb->ppu, scy);
-    SAVE_FIELD(state.ppu, gb->ppu, scx);
-    SAVE_FIELD(state.ppu, gb->ppu, ly);
-    SAVE_FIELD(state.ppu, gb->ppu, lyc);
-    SAVE_FIELD(state.ppu, gb->ppu, bgp);
-    SAVE_FIELD(state.ppu, gb->ppu, obp0);
-    SAVE_FIELD(state.ppu, gb->ppu, obp1);
-    SAVE_FIELD(state.ppu, gb->ppu, wy);
-    SAVE_FIELD(state.ppu, gb->ppu, wx);
-    SAVE_FIELD(state.ppu, gb->ppu, bgpi);
-    SAVE_FIELD(state.ppu, gb->ppu, obpi);
-    SAVE_ARRAY(state.ppu, gb->ppu, bgpd);
-    SAVE_ARRAY(state.ppu, gb->ppu, obpd);
-    state.ppu.mode = (uint8_t)gb->ppu.mode;
-    SAVE_FIELD(state.ppu, gb->ppu, clock);
-    SAVE_FIELD(state.ppu, gb->ppu, line_cycles);
-    SAVE_FIELD(state.ppu, gb->ppu, frame_ready);
-    SAVE_FIELD(state.ppu, gb->ppu, cgb_mode);
-    SAVE_FIELD(state.ppu, gb->ppu, vram_bank);
-    SAVE_ARRAY(state.ppu, gb->ppu, vram);
-    SAVE_ARRAY(state.ppu, gb->ppu, oam);
-    SAVE_FIELD(state.ppu, gb->ppu, hdma_active);
-    SAVE_FIELD(state.ppu, gb->ppu, hdma_hblank);
-    SAVE_FIELD(state.ppu, gb->ppu, hdma_source);
-    SAVE_FIELD(state.ppu, gb->ppu, hdma_dest);
-    SAVE_FIELD(state.ppu, gb->ppu, hdma_remaining);
+    SAVE_FIELD(state->ppu, gb->ppu, lcdc);
+    SAVE_FIELD(state->ppu, gb->ppu, stat);
+    SAVE_FIELD(state->ppu, gb->ppu, scy);
+    SAVE_FIELD(state->ppu, gb->ppu, scx);
+    SAVE_FIELD(state->ppu, gb->ppu, ly);
+    SAVE_FIELD(state->ppu, gb->ppu, lyc);
+    SAVE_FIELD(state->ppu, gb->ppu, bgp);
+    SAVE_FIELD(state->ppu, gb->ppu, obp0);
+    SAVE_FIELD(state->ppu, gb->ppu, obp1);
+    SAVE_FIELD(state->ppu, gb->ppu, wy);
+    SAVE_FIELD(state->ppu, gb->ppu, wx);
+    SAVE_FIELD(state->ppu, gb->ppu, bgpi);
+    SAVE_FIELD(state->ppu, gb->ppu, obpi);
+    SAVE_ARRAY(state->ppu, gb->ppu, bgpd);
+    SAVE_ARRAY(state->ppu, gb->ppu, obpd);
+    state->ppu.mode = (uint8_t)gb->ppu.mode;
+    SAVE_FIELD(state->ppu, gb->ppu, clock);
+    SAVE_FIELD(state->ppu, gb->ppu, line_cycles);
+    SAVE_FIELD(state->ppu, gb->ppu, frame_ready);
+    SAVE_FIELD(state->ppu, gb->ppu, cgb_mode);
+    SAVE_FIELD(state->ppu, gb->ppu, vram_bank);
+    SAVE_ARRAY(state->ppu, gb->ppu, vram);
+    SAVE_ARRAY(state->ppu, gb->ppu, oam);
+    SAVE_FIELD(state->ppu, gb->ppu, hdma_active);
+    SAVE_FIELD(state->ppu, gb->ppu, hdma_hblank);
+    SAVE_FIELD(state->ppu, gb->ppu, hdma_source);
+    SAVE_FIELD(state->ppu, gb->ppu, hdma_dest);
+    SAVE_FIELD(state->ppu, gb->ppu, hdma_remaining);
     
     /* Save APU state using helper functions */
-    save_apu_pulse_channel(&state.apu.pulse1, &gb->apu.pulse1, true);  /* pulse1 has sweep */
-    save_apu_pulse_channel(&state.apu.pulse2, &gb->apu.pulse2, false); /* pulse2 no sweep */
+    save_apu_pulse_channel(&state->apu.pulse1, &gb->apu.pulse1, true);  /* pulse1 has sweep */
+    save_apu_pulse_channel(&state->apu.pulse2, &gb->apu.pulse2, false); /* pulse2 no sweep */
     
     /* Save wave channel */
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, enabled);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, volume);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, frequency);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, length_timer);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, frequency_timer);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, wave_position);
-    SAVE_ARRAY(state.apu.wave, gb->apu.wave, wave_pattern);
-    SAVE_FIELD(state.apu.wave, gb->apu.wave, wave_table_enabled);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, enabled);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, volume);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, frequency);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, length_timer);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, frequency_timer);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, wave_position);
+    SAVE_ARRAY(state->apu.wave, gb->apu.wave, wave_pattern);
+    SAVE_FIELD(state->apu.wave, gb->apu.wave, wave_table_enabled);
     
     /* Save noise channel */
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, enabled);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, volume);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, divisor_code);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, width_mode);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, clock_shift);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, length_timer);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, frequency_timer);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, lfsr);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, initial_volume);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, envelope_increase);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, envelope_period);
-    SAVE_FIELD(state.apu.noise, gb->apu.noise, envelope_timer);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, enabled);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, volume);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, divisor_code);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, width_mode);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, clock_shift);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, length_timer);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, frequency_timer);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, lfsr);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, initial_volume);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, envelope_increase);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, envelope_period);
+    SAVE_FIELD(state->apu.noise, gb->apu.noise, envelope_timer);
     
     /* Save APU global state */
-    SAVE_FIELD(state.apu, gb->apu, power);
-    SAVE_FIELD(state.apu, gb->apu, left_volume);
-    SAVE_FIELD(state.apu, gb->apu, right_volume);
-    SAVE_FIELD(state.apu, gb->apu, left_enables);
-    SAVE_FIELD(state.apu, gb->apu, right_enables);
-    SAVE_FIELD(state.apu, gb->apu, sample_timer);
-    SAVE_FIELD(state.apu, gb->apu, frame_sequencer);
+    SAVE_FIELD(state->apu, gb->apu, power);
+    SAVE_FIELD(state->apu, gb->apu, left_volume);
+    SAVE_FIELD(state->apu, gb->apu, right_volume);
+    SAVE_FIELD(state->apu, gb->apu, left_enables);
+    SAVE_FIELD(state->apu, gb->apu, right_enables);
+    SAVE_FIELD(state->apu, gb->apu, frame_sequencer);
+    SAVE_FIELD(state->apu, gb->apu, frame_sequencer_timer);
+    SAVE_FIELD(state->apu, gb->apu, pending_cycles);
     
     /* Save emulator timing state */
-    state.cycles = gb->cycles;
-    state.frame_complete = gb->frame_complete;
-    
-    /* Write state structure */
-    size_t written = fwrite(&state, 1, sizeof(GB_SaveState), file);
-    if (written != sizeof(GB_SaveState)) {
-        fclose(file);
-        fprintf(stderr, "Failed to write save state data\n");
-        return false;
-    }
-    
-    /* Write memory state using existing function */
-    fclose(file);
-    
-    /* Build memory state filename (append .mem to the save state file) */
-    char mem_filename[2048];
-    snprintf(mem_filename, sizeof(mem_filename), "%s.mem", filename);
-    
-    if (!memory_save_state(&gb->memory, mem_filename)) {
-        fprintf(stderr, "Failed to save memory state\n");
-        return false;
-    }
-    
-    printf("Save state written to: %s\n", filename);
-    return true;
+    state->cycles = gb->cycles;
+    state->frame_complete = gb->frame_complete;
 }
 
-bool gb_load_state(GBEmulator* gb, const char* filename) {
-    if (!gb || !filename) return false;
-    
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        fprintf(stderr, "Failed to open save state file for reading: %s\n", filename);
-        return false;
-    }
-    
-    GB_SaveState state;
-    size_t read = fread(&state, 1, sizeof(GB_SaveState), file);
-    fclose(file);
-    
-    if (read != sizeof(GB_SaveState)) {
-        fprintf(stderr, "Failed to read save state data\n");
-        return false;
-    }
-    
-    /* Verify version compatibility */
-    if (state.version != GB_SAVE_STATE_VERSION) {
-        fprintf(stderr, "Incompatible save state version: %u (expected %u)\n", 
-                state.version, GB_SAVE_STATE_VERSION);
-        return false;
-    }
-    
+/* Restore emulator core state from a save state, keeping wiring pointers */
+static void gb_state_restore(GBEmulator* gb, const GB_SaveState* state) {
     /* Preserve critical pointer references that must not be overwritten */
     void* saved_cpu_mem = gb->cpu.mem;
     Memory* saved_ppu_memory = gb->ppu.memory;
     
     /* Restore CPU state */
-    LOAD_FIELD(gb->cpu, state.cpu, af);
-    LOAD_FIELD(gb->cpu, state.cpu, bc);
-    LOAD_FIELD(gb->cpu, state.cpu, de);
-    LOAD_FIELD(gb->cpu, state.cpu, hl);
-    LOAD_FIELD(gb->cpu, state.cpu, sp);
-    LOAD_FIELD(gb->cpu, state.cpu, pc);
-    LOAD_FIELD(gb->cpu, state.cpu, ime);
-    LOAD_FIELD(gb->cpu, state.cpu, ei_delay);
-    LOAD_FIELD(gb->cpu, state.cpu, halted);
-    LOAD_FIELD(gb->cpu, state.cpu, stopped);
-    LOAD_FIELD(gb->cpu, state.cpu, cycles);
+    LOAD_FIELD(gb->cpu, state->cpu, af);
+    LOAD_FIELD(gb->cpu, state->cpu, bc);
+    LOAD_FIELD(gb->cpu, state->cpu, de);
+    LOAD_FIELD(gb->cpu, state->cpu, hl);
+    LOAD_FIELD(gb->cpu, state->cpu, sp);
+    LOAD_FIELD(gb->cpu, state->cpu, pc);
+    LOAD_FIELD(gb->cpu, state->cpu, ime);
+    LOAD_FIELD(gb->cpu, state->cpu, ei_delay);
+    LOAD_FIELD(gb->cpu, state->cpu, halted);
+    LOAD_FIELD(gb->cpu, state->cpu, stopped);
+    LOAD_FIELD(gb->cpu, state->cpu, cycles);
     
     /* Restore CPU pointer */
     gb->cpu.mem = saved_cpu_mem;
     
     /* Restore PPU state */
-    LOAD_FIELD(gb->ppu, state.ppu, lcdc);
-    LOAD_FIELD(gb->ppu, state.ppu, stat);
-    LOAD_FIELD(gb->ppu, state.ppu, scy);
-    LOAD_FIELD(gb->ppu, state.ppu, scx);
-    LOAD_FIELD(gb->ppu, state.ppu, ly);
-    LOAD_FIELD(gb->ppu, state.ppu, lyc);
-    LOAD_FIELD(gb->ppu, state.ppu, bgp);
-    LOAD_FIELD(gb->ppu, state.ppu, obp0);
-    LOAD_FIELD(gb->ppu, state.ppu, obp1);
-    LOAD_FIELD(gb->ppu, state.ppu, wy);
-    LOAD_FIELD(gb->ppu, state.ppu, wx);
-    LOAD_FIELD(gb->ppu, state.ppu, bgpi);
-    LOAD_FIELD(gb->ppu, state.ppu, obpi);
-    LOAD_ARRAY(gb->ppu, state.ppu, bgpd);
-    LOAD_ARRAY(gb->ppu, state.ppu, obpd);
-    gb->ppu.mode = (PPU_Mode)state.ppu.mode;
-    LOAD_FIELD(gb->ppu, state.ppu, clock);
-    LOAD_FIELD(gb->ppu, state.ppu, line_cycles);
-    LOAD_FIELD(gb->ppu, state.ppu, frame_ready);
-    LOAD_FIELD(gb->ppu, state.ppu, cgb_mode);
-    LOAD_FIELD(gb->ppu, state.ppu, vram_bank);
-    LOAD_ARRAY(gb->ppu, state.ppu, vram);
-    LOAD_ARRAY(gb->ppu, state.ppu, oam);
-    LOAD_FIELD(gb->ppu, state.ppu, hdma_active);
-    LOAD_FIELD(gb->ppu, state.ppu, hdma_hblank);
-    LOAD_FIELD(gb->ppu, state.ppu, hdma_source);
-    LOAD_FIELD(gb->ppu, state.ppu, hdma_dest);
-    LOAD_FIELD(gb->ppu, state.ppu, hdma_remaining);
+    LOAD_FIELD(gb->ppu, state->ppu, lcdc);
+    LOAD_FIELD(gb->ppu, state->ppu, stat);
+    LOAD_FIELD(gb->ppu, state->ppu, scy);
+    LOAD_FIELD(gb->ppu, state->ppu, scx);
+    LOAD_FIELD(gb->ppu, state->ppu, ly);
+    LOAD_FIELD(gb->ppu, state->ppu, lyc);
+    LOAD_FIELD(gb->ppu, state->ppu, bgp);
+    LOAD_FIELD(gb->ppu, state->ppu, obp0);
+    LOAD_FIELD(gb->ppu, state->ppu, obp1);
+    LOAD_FIELD(gb->ppu, state->ppu, wy);
+    LOAD_FIELD(gb->ppu, state->ppu, wx);
+    LOAD_FIELD(gb->ppu, state->ppu, bgpi);
+    LOAD_FIELD(gb->ppu, state->ppu, obpi);
+    LOAD_ARRAY(gb->ppu, state->ppu, bgpd);
+    LOAD_ARRAY(gb->ppu, state->ppu, obpd);
+    gb->ppu.mode = (PPU_Mode)state->ppu.mode;
+    LOAD_FIELD(gb->ppu, state->ppu, clock);
+    LOAD_FIELD(gb->ppu, state->ppu, line_cycles);
+    LOAD_FIELD(gb->ppu, state->ppu, frame_ready);
+    LOAD_FIELD(gb->ppu, state->ppu, cgb_mode);
+    LOAD_FIELD(gb->ppu, state->ppu, vram_bank);
+    LOAD_ARRAY(gb->ppu, state->ppu, vram);
+    LOAD_ARRAY(gb->ppu, state->ppu, oam);
+    LOAD_FIELD(gb->ppu, state->ppu, hdma_active);
+    LOAD_FIELD(gb->ppu, state->ppu, hdma_hblank);
+    LOAD_FIELD(gb->ppu, state->ppu, hdma_source);
+    LOAD_FIELD(gb->ppu, state->ppu, hdma_dest);
+    LOAD_FIELD(gb->ppu, state->ppu, hdma_remaining);
     
     /* Restore PPU pointer */
     gb->ppu.memory = saved_ppu_memory;
     
     /* Restore APU state using helper functions */
-    load_apu_pulse_channel(&gb->apu.pulse1, &state.apu.pulse1, true);  /* pulse1 has sweep */
-    load_apu_pulse_channel(&gb->apu.pulse2, &state.apu.pulse2, false); /* pulse2 no sweep */
+    load_apu_pulse_channel(&gb->apu.pulse1, &state->apu.pulse1, true);  /* pulse1 has sweep */
+    load_apu_pulse_channel(&gb->apu.pulse2, &state->apu.pulse2, false); /* pulse2 no sweep */
     
     /* Restore wave channel */
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, enabled);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, volume);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, frequency);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, length_timer);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, frequency_timer);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, wave_position);
-    LOAD_ARRAY(gb->apu.wave, state.apu.wave, wave_pattern);
-    LOAD_FIELD(gb->apu.wave, state.apu.wave, wave_table_enabled);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, enabled);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, volume);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, frequency);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, length_timer);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, frequency_timer);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, wave_position);
+    LOAD_ARRAY(gb->apu.wave, state->apu.wave, wave_pattern);
+    LOAD_FIELD(gb->apu.wave, state->apu.wave, wave_table_enabled);
     
     /* Restore noise channel */
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, enabled);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, volume);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, divisor_code);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, width_mode);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, clock_shift);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, length_timer);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, frequency_timer);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, lfsr);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, initial_volume);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, envelope_increase);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, envelope_period);
-    LOAD_FIELD(gb->apu.noise, state.apu.noise, envelope_timer);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, enabled);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, volume);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, divisor_code);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, width_mode);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, clock_shift);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, length_timer);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, frequency_timer);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, lfsr);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, initial_volume);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, envelope_increase);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, envelope_period);
+    LOAD_FIELD(gb->apu.noise, state->apu.noise, envelope_timer);
     
     /* Restore APU global state */
-    LOAD_FIELD(gb->apu, state.apu, power);
-    LOAD_FIELD(gb->apu, state.apu, left_volume);
-    LOAD_FIELD(gb->apu, state.apu, right_volume);
-    LOAD_FIELD(gb->apu, state.apu, left_enables);
-    LOAD_FIELD(gb->apu, state.apu, right_enables);
-    LOAD_FIELD(gb->apu, state.apu, sample_timer);
-    LOAD_FIELD(gb->apu, state.apu, frame_sequencer);
+    LOAD_FIELD(gb->apu, state->apu, power);
+    LOAD_FIELD(gb->apu, state->apu, left_volume);
+    LOAD_FIELD(gb->apu, state->apu, right_volume);
+    LOAD_FIELD(gb->apu, state->apu, left_enables);
+    LOAD_FIELD(gb->apu, state->apu, right_enables);
+    LOAD_FIELD(gb->apu, state->apu, frame_sequencer);
+    LOAD_FIELD(gb->apu, state->apu, frame_sequencer_timer);
+    LOAD_FIELD(gb->apu, state->apu, pending_cycles);
     
     /* Restore emulator timing state */
-    gb->cycles = state.cycles;
-    gb->frame_complete = state.frame_complete;
+    gb->cycles = state->cycles;
+    gb->frame_complete = state->frame_complete;
+}
+
+/* Snapshot layout: [GB_SaveState][padding][MemorySnapshot][cart RAM].
+   The memory part starts on a 16-byte boundary so its header stays aligned. */
+#define GB_SNAPSHOT_ALIGN(n) (((n) + 15u) & ~(size_t)15u)
+#define GB_SNAPSHOT_MEM_OFFSET GB_SNAPSHOT_ALIGN(sizeof(GB_SaveState))
+
+size_t gb_snapshot_size(const GBEmulator* gb) {
+    if (!gb) return 0;
+    return GB_SNAPSHOT_MEM_OFFSET + memory_snapshot_size(&gb->memory);
+}
+
+size_t gb_snapshot_save(const GBEmulator* gb, void* buf) {
+    if (!gb || !buf) return 0;
+    
+    uint8_t* bytes = (uint8_t*)buf;
+    gb_state_capture(gb, (GB_SaveState*)bytes);
+    memset(bytes + sizeof(GB_SaveState), 0, GB_SNAPSHOT_MEM_OFFSET - sizeof(GB_SaveState));
+    return GB_SNAPSHOT_MEM_OFFSET + memory_snapshot_save(&gb->memory, bytes + GB_SNAPSHOT_MEM_OFFSET);
+}
+
+bool gb_snapshot_load(GBEmulator* gb, const void* buf) {
+    if (!gb || !buf) return false;
+    
+    const uint8_t* bytes = (const uint8_t*)buf;
+    const GB_SaveState* state = (const GB_SaveState*)bytes;
+    if (state->version != GB_SAVE_STATE_VERSION) return false;
     
-    /* Preserve Memory struct pointers before loading memory state */
-    void* saved_mem_ppu = gb->memory.ppu;
-    void* saved_mem_apu = gb->memory.apu;
+    /* Memory goes first: it rejects snapshots from a different cartridge
+       before any CPU/PPU/APU state has been touched */
+    if (!memory_snapshot_load(&gb->memory, bytes + GB_SNAPSHOT_MEM_OFFSET)) return false;
     
-    /* Load memory state using existing function 
-       Note: memory_load_state preserves the ppu and apu pointers in Memory struct */
-    char mem_filename[2048];
-    snprintf(mem_filename, sizeof(mem_filename), "%s.mem", filename);
+    gb_state_restore(gb, state);
+    return true;
+}
+
+/* Save state files use the chunked format from savestate.h; snapshots stay
+   a private in-memory layout */
+bool gb_save_state(GBEmulator* gb, const char* filename) {
+    if (!gb || !filename) return false;
+    
+    size_t size = savestate_encode(gb, NULL, 0);
+    uint8_t* buf = malloc(size);
+    if (!buf) {
+        fprintf(stderr, "Failed to allocate save state buffer\n");
+        return false;
+    }
+    savestate_encode(gb, buf, size);
     
-    if (!memory_load_state(&gb->memory, mem_filename)) {
-        fprintf(stderr, "Failed to load memory state\n");
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open save state file for writing: %s\n", filename);
+        free(buf);
         return false;
     }
     
-    /* Restore Memory struct pointers */
-    gb->memory.ppu = saved_mem_ppu;
-    gb->memory.apu = saved_mem_apu;
+    size_t written = fwrite(buf, 1, size, file);
+    fclose(file);
+    free(buf);
+    
+    if (written != size) {
+        fprintf(stderr, "Failed to write save state data\n");
+        return false;
+    }
+    
+    printf("Save state written to: %s\n", filename);
+    return true;
+}
+
+bool gb_load_state(GBEmulator* gb, const char* filename) {
+    if (!gb || !filename) return false;
+    
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open save state file for reading: %s\n", filename);
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        fprintf(stderr, "Save state file is empty: %s\n", filename);
+        return false;
+    }
+    
+    /* Chunks are copied straight from the mapping into the emulator */
+    size_t size = (size_t)st.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map save state file: %s\n", filename);
+        return false;
+    }
+    
+    bool ok = savestate_decode(gb, data, size);
+    munmap(data, size);
+    if (!ok) return false;
     
     printf("Save state loaded from: %s\n", filename);
     return true;
-}
\ No newline at end of file
+}
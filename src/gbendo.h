@@ -5,6 +5,7 @@
 #include "memory/memory.h"
 #include "ppu/ppu.h"
 #include "apu/apu.h"
+#include "profiler.h"
 
 /* Clock Frequencies */
 #define CPU_CLOCK_SPEED 4194304  /* ~4.19 MHz */
@@ -18,11 +19,16 @@ typedef struct {
     
     /* Timing */
     uint32_t cycles;
+    uint64_t instructions;      /* Executed since gb_init(), for throughput stats */
     bool frame_complete;
+    bool cpu_fault;             /* Hit an invalid opcode; cleared by gb_reset() */
     
     /* Debug */
     bool debug_mode;
     uint32_t breakpoint;
+
+    /* Performance profiling, disabled until profiler_enable() */
+    Profiler profiler;
 } GBEmulator;
 
 /* Emulator lifecycle */
@@ -30,6 +36,14 @@ void gb_init(GBEmulator* gb);
 void gb_reset(GBEmulator* gb);
 void gb_cleanup(GBEmulator* gb);
 
+/* Initialize dst as a copy of src that runs on independently: same CPU,
+ * PPU, APU and memory state, framebuffer included. The ROM image is shared
+ * (reference counted, so either may be cleaned up first) and everything
+ * else is copied directly, without going through a snapshot. Debug mode,
+ * profiling, stems and undrained audio stay with src. Returns false if out
+ * of memory; dst then needs no cleanup. */
+bool gb_clone(GBEmulator* dst, const GBEmulator* src);
+
 /* Emulation control */
 void gb_run_frame(GBEmulator* gb);
 void gb_run_frame_optimized(GBEmulator* gb);
@@ -39,18 +53,28 @@ void gb_resume(GBEmulator* gb);
 
 /* ROM management */
 bool gb_load_rom(GBEmulator* gb, const char* filename);
+bool gb_load_rom_data(GBEmulator* gb, const uint8_t* data, size_t size);  /* Copies the image */
 void gb_unload_rom(GBEmulator* gb);
 
 /* State management */
 bool gb_save_state(GBEmulator* gb, const char* filename);
 bool gb_load_state(GBEmulator* gb, const char* filename);
 
+/* In-memory snapshots (no files, no allocation).
+ * The buffer must hold gb_snapshot_size() bytes and be aligned like a
+ * malloc() result. The size only changes when a different ROM is loaded.
+ * Snapshots cover CPU, PPU, APU, timer, MBC and RAM state; the framebuffer
+ * and pending audio samples are not included. */
+size_t gb_snapshot_size(const GBEmulator* gb);
+size_t gb_snapshot_save(const GBEmulator* gb, void* buf);
+bool gb_snapshot_load(GBEmulator* gb, const void* buf);
+
 /* Debug interface */
 void gb_set_breakpoint(GBEmulator* gb, uint16_t address);
 void gb_clear_breakpoint(GBEmulator* gb);
 void gb_enable_debug(GBEmulator* gb);
 void gb_disable_debug(GBEmulator* gb);
-bool gb_is_debug_enabled(void);
-GBEmulator* gb_get_debug_gb(void);
+bool gb_is_debug_enabled(const Memory* mem);
+GBEmulator* gb_get_debug_gb(const Memory* mem);
 
 #endif /* GBENDO_H */
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* One worker's share of the job list: jobs[next..end) */
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t next;      /* The owner takes jobs from the front */
+    uint32_t end;       /* Thieves take from the back */
+} BatchQueue;
+
+typedef struct {
+    const BatchJob* jobs;
+    BatchResult* results;
+    BatchQueue* queues;
+    uint32_t worker_count;
+} BatchPool;
+
+typedef struct {
+    BatchPool* pool;
+    uint32_t index;
+    GBEmulator* gb;     /* Pre-allocated, reused for every job */
+    pthread_t thread;
+    bool started;
+} BatchWorker;
+
+static const char* const status_names[] = {
+    "ok",
+    "load_failed",
+    "crashed",
+    "hung"
+};
+
+const char* batch_status_name(BatchStatus status) {
+    return status_names[status];
+}
+
+uint32_t batch_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (uint32_t)cpus : 1;
+}
+
+uint64_t batch_framebuffer_hash(const uint32_t* framebuffer) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        uint32_t pixel = framebuffer[i];
+        for (int b = 0; b < 4; b++) {
+            hash ^= (pixel >> (b * 8)) & 0xFF;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+/* "path/to/rom.gb frames=600" -> path and frame count */
+static bool parse_job_line(char* line, uint32_t default_frames, BatchJob* job) {
+    size_t length = strlen(line);
+    while (length > 0 && isspace((unsigned char)line[length - 1])) line[--length] = '\0';
+
+    job->frames = default_frames;
+    char* option = strstr(line, " frames=");
+    if (option) {
+        char* end;
+        unsigned long frames = strtoul(option + 8, &end, 10);
+        if (end == option + 8 || *end != '\0' || frames == 0 || frames > UINT32_MAX) {
+            fprintf(stderr, "Error: Invalid frame count in job: %s\n", line);
+            return false;
+        }
+        job->frames = (uint32_t)frames;
+        while (option > line && isspace((unsigned char)option[-1])) option--;
+        *option = '\0';
+    }
+
+    if (strlen(line) >= sizeof(job->rom)) {
+        fprintf(stderr, "Error: ROM path too long: %s\n", line);
+        return false;
+    }
+    strcpy(job->rom, line);
+    return true;
+}
+
+bool batch_load_jobs(const char* path, uint32_t default_frames, BatchJob** jobs, uint32_t* count) {
+    *jobs = NULL;
+    *count = 0;
+
+    bool from_stdin = strcmp(path, "-") == 0;
+    FILE* f = from_stdin ? stdin : fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open job list: %s\n", path);
+        return false;
+    }
+
+    uint32_t capacity = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    bool ok = true;
+    while (getline(&line, &line_size, f) != -1) {
+        char* p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        if (*count == capacity) {
+            uint32_t grown = capacity ? capacity * 2 : 64;
+            BatchJob* resized = realloc(*jobs, grown * sizeof(BatchJob));
+            if (!resized) {
+                fprintf(stderr, "Failed to allocate job list\n");
+                ok = false;
+                break;
+            }
+            *jobs = resized;
+            capacity = grown;
+        }
+        if (!parse_job_line(p, default_frames, &(*jobs)[*count])) {
+            ok = false;
+            break;
+        }
+        (*count)++;
+    }
+    free(line);
+    if (!from_stdin) fclose(f);
+
+    if (ok && *count == 0) {
+        fprintf(stderr, "Error: Job list is empty: %s\n", path);
+        ok = false;
+    }
+    if (!ok) {
+        free(*jobs);
+        *jobs = NULL;
+        *count = 0;
+    }
+    return ok;
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+bool batch_check_failed(const GBEmulator* gb, BatchStatus* status) {
+    if (gb->cpu_fault) {
+        *status = BATCH_CRASHED;
+        return true;
+    }
+    /* Only interrupts end HALT and only the CPU writes IE, so this never
+       recovers; STOP waits for a button nobody presses */
+    if (gb->cpu.stopped || (gb->cpu.halted && (gb->memory.ie_register & 0x1F) == 0)) {
+        *status = BATCH_HUNG;
+        return true;
+    }
+    return false;
+}
+
+void batch_run_job(GBEmulator* gb, const BatchJob* job, BatchResult* result) {
+    memset(result, 0, sizeof(*result));
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (!gb_load_rom(gb, job->rom)) {
+        result->status = BATCH_LOAD_FAILED;
+        result->seconds = seconds_since(&start);
+        return;
+    }
+    gb_reset(gb);
+    uint64_t instructions_before = gb->instructions;
+
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    result->status = BATCH_OK;
+    while (result->frames < job->frames) {
+        uint32_t cycles_before = gb->cycles;
+        gb_run_frame_optimized(gb);
+        result->cycles += (uint32_t)(gb->cycles - cycles_before);
+        gb->frame_complete = false;
+        result->frames++;
+
+        /* Nobody listens; drained so the buffer stays one frame long */
+        while (apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+
+        if (batch_check_failed(gb, &result->status)) break;
+    }
+
+    result->instructions = gb->instructions - instructions_before;
+    result->final_hash = batch_framebuffer_hash(gb->ppu.framebuffer);
+    result->pc = gb->cpu.pc;
+    result->seconds = seconds_since(&start);
+}
+
+static bool queue_pop(BatchQueue* queue, uint32_t* job) {
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->next < queue->end;
+    if (found) *job = queue->next++;
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+/* Move the back half of the first non-empty victim's slice to the thief */
+static bool queue_steal(BatchPool* pool, uint32_t thief) {
+    for (uint32_t i = 1; i < pool->worker_count; i++) {
+        BatchQueue* victim = &pool->queues[(thief + i) % pool->worker_count];
+        pthread_mutex_lock(&victim->lock);
+        uint32_t left = victim->end - victim->next;
+        if (left == 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        uint32_t take = (left + 1) / 2;
+        uint32_t begin = victim->end - take;
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        BatchQueue* own = &pool->queues[thief];
+        pthread_mutex_lock(&own->lock);
+        own->next = begin;
+        own->end = begin + take;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    return false;
+}
+
+static void* batch_worker_main(void* arg) {
+    BatchWorker* worker = arg;
+    BatchPool* pool = worker->pool;
+
+    for (;;) {
+        uint32_t job;
+        if (!queue_pop(&pool->queues[worker->index], &job)) {
+            /* Nothing left anywhere: the rest is already running */
+            if (!queue_steal(pool, worker->index)) break;
+            continue;
+        }
+        batch_run_job(worker->gb, &pool->jobs[job], &pool->results[job]);
+    }
+    return NULL;
+}
+
+bool batch_run(const BatchJob* jobs, BatchResult* results, uint32_t count, uint32_t threads) {
+    if (count == 0) return true;
+    if (threads == 0) threads = batch_default_threads();
+    if (threads > count) threads = count;
+
+    BatchQueue* queues = calloc(threads, sizeof(BatchQueue));
+    BatchWorker* workers = calloc(threads, sizeof(BatchWorker));
+    GBEmulator* arena = malloc(threads * sizeof(GBEmulator));
+    if (!queues || !workers || !arena) {
+        fprintf(stderr, "Failed to allocate %u batch workers\n", threads);
+        free(queues);
+        free(workers);
+        free(arena);
+        return false;
+    }
+
+    BatchPool pool = { jobs, results, queues, threads };
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_mutex_init(&queues[i].lock, NULL);
+        queues[i].next = (uint32_t)((uint64_t)count * i / threads);
+        queues[i].end = (uint32_t)((uint64_t)count * (i + 1) / threads);
+        workers[i].pool = &pool;
+        workers[i].index = i;
+        workers[i].gb = &arena[i];
+        gb_init(workers[i].gb);
+    }
+
+    /* The calling thread is worker 0; a worker that fails to start just
+       leaves its slice to be stolen */
+    for (uint32_t i = 1; i < threads; i++) {
+        workers[i].started = pthread_create(&workers[i].thread, NULL, batch_worker_main, &workers[i]) == 0;
+        if (!workers[i].started) fprintf(stderr, "Failed to start batch worker %u\n", i);
+    }
+    batch_worker_main(&workers[0]);
+    for (uint32_t i = 1; i < threads; i++) {
+        if (workers[i].started) pthread_join(workers[i].thread, NULL);
+    }
+
+    for (uint32_t i = 0; i < threads; i++) {
+        gb_cleanup(workers[i].gb);
+        pthread_mutex_destroy(&queues[i].lock);
+    }
+    free(arena);
+    free(workers);
+    free(queues);
+    return true;
+}
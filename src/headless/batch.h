@@ -0,0 +1,66 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../gbendo.h"
+
+/* Batch runner for the headless binary.
+ *
+ * Runs a list of ROM jobs on a work-stealing thread pool, one emulator per
+ * worker, and records a result per job. Each worker starts with a contiguous
+ * slice of the job list and takes jobs from its front; a worker that runs
+ * dry steals the back half of another worker's remaining slice, so a few
+ * slow ROMs do not leave the other cores idle. A worker's GBEmulator is
+ * initialized once and reused: loading the next ROM and resetting gives the
+ * same state as a fresh instance. */
+
+#define BATCH_PATH_MAX 2048
+
+typedef struct {
+    char rom[BATCH_PATH_MAX];
+    uint32_t frames;
+} BatchJob;
+
+typedef enum {
+    BATCH_OK,
+    BATCH_LOAD_FAILED,
+    BATCH_CRASHED,      /* Executed an invalid opcode */
+    BATCH_HUNG          /* STOP, or HALT with no interrupt enabled to wake it */
+} BatchStatus;
+
+typedef struct {
+    BatchStatus status;
+    uint32_t frames;        /* Frames run, including the one that failed */
+    uint64_t cycles;
+    uint64_t instructions;
+    double seconds;         /* Wall-clock time for this job */
+    uint64_t final_hash;    /* batch_framebuffer_hash() after the last frame */
+    uint16_t pc;            /* Where the CPU stopped */
+} BatchResult;
+
+/* Reads a job list: one ROM path per line, optionally followed by
+   " frames=N". Blank lines and lines starting with '#' are skipped; "-"
+   reads standard input. Jobs without frames= run default_frames. The
+   caller frees *jobs. */
+bool batch_load_jobs(const char* path, uint32_t default_frames, BatchJob** jobs, uint32_t* count);
+
+/* Runs every job on threads workers (0 = one per online CPU) and fills
+   results[i] for jobs[i]. Returns false if the pool could not start. */
+bool batch_run(const BatchJob* jobs, BatchResult* results, uint32_t count, uint32_t threads);
+
+/* True once gb can make no more progress: an invalid opcode (crashed), or
+   STOP or HALT with nothing able to wake it (hung) */
+bool batch_check_failed(const GBEmulator* gb, BatchStatus* status);
+
+/* Runs one job on an emulator that gb_init() has set up */
+void batch_run_job(GBEmulator* gb, const BatchJob* job, BatchResult* result);
+
+uint32_t batch_default_threads(void);
+const char* batch_status_name(BatchStatus status);
+
+/* FNV-1a over the framebuffer's pixel values (byte order independent) */
+uint64_t batch_framebuffer_hash(const uint32_t* framebuffer);
+
+#endif /* BATCH_H */
@@ -0,0 +1,135 @@
+#include "branch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../input/input.h"
+
+#define BRANCH_INPUT_FRAMES 8   /* Frames each random button mask is held */
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* xorshift32; the multiply spreads consecutive seeds apart */
+static uint32_t next_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+void branch_play(GBEmulator* gb, uint32_t seed, uint32_t frames, BranchResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->reported = true;
+    result->status = BATCH_OK;
+    result->seed = seed;
+
+    uint32_t state = seed * 2654435761u;
+    if (state == 0) state = 1;
+    uint64_t instructions_before = gb->instructions;
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+
+    while (result->frames < frames) {
+        if (result->frames % BRANCH_INPUT_FRAMES == 0) {
+            input_set_held(&gb->memory, (uint8_t)next_random(&state));
+        }
+        gb_run_frame_optimized(gb);
+        gb->frame_complete = false;
+        result->frames++;
+        while (apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+        if (batch_check_failed(gb, &result->status)) break;
+    }
+
+    result->instructions = gb->instructions - instructions_before;
+    result->final_hash = batch_framebuffer_hash(gb->ppu.framebuffer);
+    result->pc = gb->cpu.pc;
+}
+
+/* In the child: the checkpoint is this process's private copy-on-write
+   view, so it can be run in place */
+static void branch_child(const GBEmulator* checkpoint, uint32_t seed, uint32_t frames,
+                         const struct timespec* start, int fd) {
+    BranchResult result;
+    branch_play((GBEmulator*)checkpoint, seed, frames, &result);
+    result.seconds = seconds_since(start);
+    ssize_t written = write(fd, &result, sizeof(result));
+    _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+}
+
+bool branch_run(const GBEmulator* checkpoint, const BranchOptions* options, BranchResult* results) {
+    uint32_t count = options->branches;
+    uint32_t jobs = options->jobs ? options->jobs : batch_default_threads();
+    pid_t* pids = calloc(count, sizeof(pid_t));
+    int* fds = calloc(count, sizeof(int));
+    if (!pids || !fds) {
+        fprintf(stderr, "Failed to allocate %u branches\n", count);
+        free(pids);
+        free(fds);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+        results[i].seed = options->seed + i;
+    }
+
+    uint32_t launched = 0, running = 0;
+    bool launching = true;
+    while ((launching && launched < count) || running > 0) {
+        if (launching && launched < count && running < jobs) {
+            int fd[2];
+            if (pipe(fd) != 0) {
+                perror("pipe");
+                launching = false;
+                continue;
+            }
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(fd[0]);
+                branch_child(checkpoint, results[launched].seed, options->frames, &start, fd[1]);
+            }
+            close(fd[1]);
+            if (pid < 0) {
+                perror("fork");
+                close(fd[0]);
+                launching = false;
+                continue;
+            }
+            pids[launched] = pid;
+            fds[launched] = fd[0];
+            launched++;
+            running++;
+            continue;
+        }
+
+        int status;
+        pid_t done = waitpid(-1, &status, 0);
+        if (done < 0) break;
+        for (uint32_t i = 0; i < launched; i++) {
+            if (pids[i] != done) continue;
+            /* The child wrote its result before exiting; a dead one did not */
+            BranchResult result;
+            if (read(fds[i], &result, sizeof(result)) == (ssize_t)sizeof(result)) results[i] = result;
+            close(fds[i]);
+            pids[i] = 0;
+            running--;
+            break;
+        }
+    }
+
+    free(pids);
+    free(fds);
+    return launched > 0;
+}
@@ -0,0 +1,46 @@
+#ifndef BRANCH_H
+#define BRANCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../gbendo.h"
+#include "batch.h"
+
+/* Fork-based branching for the headless runner.
+ *
+ * From one checkpoint emulator, each branch is a forked child process that
+ * plays its own random input for a number of frames and reports how it
+ * ended. fork() shares the parent's pages copy-on-write, so a branch costs
+ * the pages it touches rather than a state restore, and every branch starts
+ * from the untouched checkpoint: returning to it is free. Up to `jobs`
+ * children run at once. */
+
+typedef struct {
+    uint32_t branches;
+    uint32_t frames;        /* Frames each branch runs past the checkpoint */
+    uint32_t seed;          /* Branch i plays the input of seed + i */
+    uint32_t jobs;          /* Children alive at once, 0 = one per online CPU */
+} BranchOptions;
+
+typedef struct {
+    bool reported;          /* False if the child died without a result */
+    BatchStatus status;     /* BATCH_OK, BATCH_CRASHED or BATCH_HUNG */
+    uint32_t seed;
+    uint32_t frames;        /* Frames run, including the one that failed */
+    uint64_t instructions;
+    uint64_t final_hash;    /* batch_framebuffer_hash() after the last frame */
+    uint16_t pc;
+    double seconds;         /* From fork to result */
+} BranchResult;
+
+/* Runs options->branches children from checkpoint (left as it is) and
+   fills results[i] for branch i. False if no child could be started. */
+bool branch_run(const GBEmulator* checkpoint, const BranchOptions* options, BranchResult* results);
+
+/* What a branch does in its child: run frames of seeded random input on
+   gb. Called directly on a gb_clone() of the checkpoint it replays the
+   same branch in process. */
+void branch_play(GBEmulator* gb, uint32_t seed, uint32_t frames, BranchResult* result);
+
+#endif /* BRANCH_H */
@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include "../gbendo.h"
+#include "../ui/ui_debug.h"
+#include "../audio/audio_capture.h"
+#include "../cpu/opcode_profile.h"
+#include "../io_worker.h"
+#include "batch.h"
+#include "branch.h"
+#include "../lockstep.h"
+
+/* Headless runner: the emulation core with no window, audio device or SDL.
+ *
+ * Runs a ROM unthrottled (or capped with --speed) for a number of frames
+ * and/or a wall-clock budget, optionally hashing or dumping the framebuffer
+ * at chosen frames, and prints a JSON summary on stdout for benchmark and
+ * CI scripts. Battery RAM is
+ * neither loaded nor written so runs are repeatable. */
+
+#define HEADLESS_DEFAULT_FRAMES 3600   /* One emulated minute */
+#define HEADLESS_MAX_MARKS      256    /* Frames listed per --hash-at / --png-at */
+#define HEADLESS_PATH_MAX       2048
+#define HEADLESS_BRANCH_FRAMES  600    /* Default --branch-frames */
+
+typedef struct {
+    uint32_t frames[HEADLESS_MAX_MARKS];
+    uint32_t count;
+} FrameList;
+
+typedef struct {
+    uint32_t frame;
+    uint64_t hash;
+} FrameHash;
+
+static bool s_verbose = false;
+
+/* The core logs through the GUI's debug console; here --verbose sends every
+   component to stderr instead */
+bool ui_is_debug_enabled(UIDebugComponent component) {
+    (void)component;
+    return s_verbose;
+}
+
+void ui_debug_log(UIDebugComponent component, const char* format, ...) {
+    if (!ui_is_debug_enabled(component)) return;
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    size_t length = strlen(format);
+    if (length == 0 || format[length - 1] != '\n') fputc('\n', stderr);
+}
+
+static void print_usage(const char* prog_name) {
+    printf("Usage: %s [OPTIONS] rom_file\n", prog_name);
+    printf("       %s --batch JOBS [--jobs N] [--frames N]\n", prog_name);
+    printf("       %s --lockstep K [--frames N] rom_file\n", prog_name);
+    printf("       %s --branches N [--frames N] [--branch-frames M] [--seed S] [--jobs N] rom_file\n", prog_name);
+    printf("\nRuns a ROM without a window or audio device, as fast as possible,\n");
+    printf("and prints a JSON summary on stdout.\n");
+    printf("\nOptions:\n");
+    printf("  --frames N          Stop after N frames (default: %d unless --seconds is given)\n", HEADLESS_DEFAULT_FRAMES);
+    printf("  --seconds S         Stop after S seconds of wall-clock time\n");
+    printf("  --speed X           Run at most X times real time (default: uncapped)\n");
+    printf("  --hash-at LIST      Hash the framebuffer after these frames (e.g. 60,120,600)\n");
+    printf("  --png-at LIST       Save the framebuffer as PNG after these frames\n");
+    printf("  --png-prefix P      File name prefix for --png-at (default: frame, gives frame-60.png)\n");
+    printf("  --capture-audio F   Record the stereo output to F (.wav, otherwise raw float32)\n");
+    printf("  --opcode-profile F  Count executed opcodes, rank them on stderr and write them\n");
+    printf("                      to F (.json, otherwise CSV)\n");
+    printf("  --batch JOBS        Run every ROM listed in JOBS (one per line, optionally\n");
+    printf("                      followed by frames=N; - reads stdin) on a thread pool\n");
+    printf("  --jobs N            Batch worker threads or concurrent branches (default: one per CPU)\n");
+    printf("  --lockstep K        Run K copies of the ROM in lockstep on one core, observing\n");
+    printf("                      RAM, and report their aggregate frame rate\n");
+    printf("  --branches N        Run to a checkpoint at --frames, then fork N children that\n");
+    printf("                      each play random input from it and report how they ended\n");
+    printf("  --branch-frames M   Frames each branch runs past the checkpoint (default: %d)\n", HEADLESS_BRANCH_FRAMES);
+    printf("  --seed S            Branch i plays the random input of seed S + i (default: 1)\n");
+    printf("  -v, --verbose       Send core debug logging to stderr\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+/* Comma-separated frame numbers, in any order */
+static bool parse_frame_list(const char* text, FrameList* list) {
+    const char* p = text;
+    while (*p) {
+        char* end;
+        unsigned long frame = strtoul(p, &end, 10);
+        if (end == p || frame == 0 || frame > UINT32_MAX || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Error: Invalid frame list: %s\n", text);
+            return false;
+        }
+        if (list->count == HEADLESS_MAX_MARKS) {
+            fprintf(stderr, "Error: At most %d frames per list\n", HEADLESS_MAX_MARKS);
+            return false;
+        }
+        list->frames[list->count++] = (uint32_t)frame;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return list->count > 0;
+}
+
+static bool frame_listed(const FrameList* list, uint32_t frame) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        if (list->frames[i] == frame) return true;
+    }
+    return false;
+}
+
+static void print_json_string(const char* s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static double elapsed_seconds(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* --batch: every job on the pool, one JSON result per line in job order */
+static int run_batch(const char* jobs_path, uint32_t default_frames, uint32_t threads) {
+    BatchJob* jobs;
+    uint32_t count;
+    if (!batch_load_jobs(jobs_path, default_frames, &jobs, &count)) return 1;
+
+    BatchResult* results = calloc(count, sizeof(*results));
+    if (!results) {
+        fprintf(stderr, "Failed to allocate batch results\n");
+        free(jobs);
+        return 1;
+    }
+    if (threads == 0) threads = batch_default_threads();
+    if (threads > count) threads = count;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool ran = batch_run(jobs, results, count, threads);
+    double seconds = elapsed_seconds(&start);
+    if (!ran) {
+        free(results);
+        free(jobs);
+        return 1;
+    }
+
+    uint32_t failed = 0;
+    printf("{\n");
+    printf("  \"jobs\": %u,\n", count);
+    printf("  \"threads\": %u,\n", threads);
+    printf("  \"seconds\": %.6f,\n", seconds);
+    printf("  \"results\": [\n");
+    for (uint32_t i = 0; i < count; i++) {
+        const BatchResult* r = &results[i];
+        double rate = r->seconds > 0.0 ? 1.0 / r->seconds : 0.0;
+        if (r->status != BATCH_OK) failed++;
+
+        printf("    {\"rom\": ");
+        print_json_string(jobs[i].rom);
+        printf(", \"status\": \"%s\", \"frames\": %u, \"cycles\": %llu, \"instructions\": %llu, "
+               "\"seconds\": %.6f, \"fps\": %.2f, \"speed\": %.3f, \"final_hash\": \"%016llx\", "
+               "\"pc\": \"%04X\"}%s\n",
+               batch_status_name(r->status), r->frames,
+               (unsigned long long)r->cycles, (unsigned long long)r->instructions,
+               r->seconds, r->frames * rate, r->cycles * rate / CPU_CLOCK_SPEED,
+               (unsigned long long)r->final_hash, r->pc, i + 1 < count ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"failed\": %u,\n", failed);
+    printf("  \"ok\": %s\n", failed == 0 ? "true" : "false");
+    printf("}\n");
+
+    free(results);
+    free(jobs);
+    return failed == 0 ? 0 : 1;
+}
+
+/* --lockstep: K copies stepped together, as a training loop would */
+static int run_lockstep(const char* rom_file, uint32_t instances, uint32_t frames) {
+    FILE* f = fopen(rom_file, "rb");
+    uint8_t* rom = NULL;
+    long size = -1;
+    if (f && fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        rom = malloc((size_t)size);
+        if (rom && fread(rom, 1, (size_t)size, f) != (size_t)size) {
+            free(rom);
+            rom = NULL;
+        }
+    }
+    if (f) fclose(f);
+
+    Lockstep ls;
+    if (!rom || !lockstep_init(&ls, rom, (size_t)size, instances)) {
+        fprintf(stderr, "Failed to load ROM: %s\n", rom_file);
+        free(rom);
+        return 1;
+    }
+    free(rom);
+
+    uint8_t* observations = malloc((size_t)instances * LOCKSTEP_RAM_SIZE);
+    if (!observations) {
+        fprintf(stderr, "Failed to allocate observations\n");
+        lockstep_cleanup(&ls);
+        return 1;
+    }
+
+    uint32_t faulted = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        faulted = lockstep_step(&ls, NULL, LOCKSTEP_OBSERVE_RAM, observations);
+    }
+    double seconds = elapsed_seconds(&start);
+
+    uint64_t instructions = 0;
+    for (uint32_t i = 0; i < instances; i++) instructions += ls.instances[i].instructions;
+
+    double rate = seconds > 0.0 ? 1.0 / seconds : 0.0;
+    printf("{\n");
+    printf("  \"rom\": ");
+    print_json_string(rom_file);
+    printf(",\n");
+    printf("  \"instances\": %u,\n", instances);
+    printf("  \"frames\": %u,\n", frames);
+    printf("  \"seconds\": %.6f,\n", seconds);
+    printf("  \"aggregate_fps\": %.2f,\n", (double)instances * frames * rate);
+    printf("  \"instructions_per_second\": %.0f,\n", instructions * rate);
+    printf("  \"speed\": %.3f,\n", (double)instances * frames * rate / FRAME_RATE);
+    printf("  \"faulted\": %u,\n", faulted);
+    printf("  \"ok\": %s\n", faulted == 0 ? "true" : "false");
+    printf("}\n");
+
+    free(observations);
+    lockstep_cleanup(&ls);
+    return faulted == 0 ? 0 : 1;
+}
+
+/* --branches: fork children from one checkpoint, one JSON result per line */
+static int run_branches(const char* rom_file, uint32_t checkpoint_frames, const BranchOptions* options) {
+    GBEmulator* gb = malloc(sizeof(GBEmulator));
+    BranchResult* results = calloc(options->branches, sizeof(*results));
+    if (!gb || !results) {
+        fprintf(stderr, "Failed to allocate branches\n");
+        free(gb);
+        free(results);
+        return 1;
+    }
+    gb_init(gb);
+    if (!gb_load_rom(gb, rom_file)) {
+        fprintf(stderr, "Failed to load ROM: %s\n", rom_file);
+        gb_cleanup(gb);
+        free(gb);
+        free(results);
+        return 1;
+    }
+    gb_reset(gb);
+
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    for (uint32_t frame = 0; frame < checkpoint_frames; frame++) {
+        gb_run_frame_optimized(gb);
+        gb->frame_complete = false;
+        while (apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool ran = branch_run(gb, options, results);
+    double seconds = elapsed_seconds(&start);
+    if (!ran) {
+        gb_cleanup(gb);
+        free(gb);
+        free(results);
+        return 1;
+    }
+
+    uint32_t failed = 0;
+    printf("{\n");
+    printf("  \"rom\": ");
+    print_json_string(rom_file);
+    printf(",\n");
+    printf("  \"checkpoint\": %u,\n", checkpoint_frames);
+    printf("  \"checkpoint_hash\": \"%016llx\",\n",
+           (unsigned long long)batch_framebuffer_hash(gb->ppu.framebuffer));
+    printf("  \"branches\": %u,\n", options->branches);
+    printf("  \"seconds\": %.6f,\n", seconds);
+    printf("  \"results\": [\n");
+    for (uint32_t i = 0; i < options->branches; i++) {
+        const BranchResult* r = &results[i];
+        if (!r->reported || r->status != BATCH_OK) failed++;
+
+        printf("    {\"seed\": %u, \"status\": \"%s\", \"frames\": %u, \"instructions\": %llu, "
+               "\"seconds\": %.6f, \"final_hash\": \"%016llx\", \"pc\": \"%04X\"}%s\n",
+               r->seed, r->reported ? batch_status_name(r->status) : "died", r->frames,
+               (unsigned long long)r->instructions, r->seconds,
+               (unsigned long long)r->final_hash, r->pc, i + 1 < options->branches ? "," : "");
+    }
+    printf("  ],\n");
+    printf("  \"failed\": %u,\n", failed);
+    printf("  \"ok\": %s\n", failed == 0 ? "true" : "false");
+    printf("}\n");
+
+    gb_cleanup(gb);
+    free(gb);
+    free(results);
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* rom_file = NULL;
+    const char* capture_path = NULL;
+    const char* opcode_profile_path = NULL;
+    const char* png_prefix = "frame";
+    const char* batch_path = NULL;
+    uint32_t batch_threads = 0;
+    uint32_t lockstep_instances = 0;
+    BranchOptions branch = { 0, HEADLESS_BRANCH_FRAMES, 1, 0 };
+    uint32_t max_frames = 0;
+    double max_seconds = 0.0;
+    double speed_cap = 0.0;
+    FrameList hash_at = {0};
+    FrameList png_at = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            s_verbose = true;
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            if (i + 1 < argc) {
+                long frames = atol(argv[++i]);
+                if (frames <= 0 || frames > UINT32_MAX) {
+                    fprintf(stderr, "Error: Frame count must be a positive integer\n");
+                    return 1;
+                }
+                max_frames = (uint32_t)frames;
+            } else {
+                fprintf(stderr, "Error: --frames requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            if (i + 1 < argc) {
+                max_seconds = atof(argv[++i]);
+                if (max_seconds <= 0.0) {
+                    fprintf(stderr, "Error: Seconds must be a positive number\n");
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --seconds requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--speed") == 0) {
+            if (i + 1 < argc) {
+                speed_cap = atof(argv[++i]);
+                if (speed_cap <= 0.0) {
+                    fprintf(stderr, "Error: Speed must be a positive number\n");
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --speed requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hash-at") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --hash-at requires a frame list\n");
+                return 1;
+            }
+            if (!parse_frame_list(argv[++i], &hash_at)) return 1;
+        } else if (strcmp(argv[i], "--png-at") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --png-at requires a frame list\n");
+                return 1;
+            }
+            if (!parse_frame_list(argv[++i], &png_at)) return 1;
+        } else if (strcmp(argv[i], "--png-prefix") == 0) {
+            if (i + 1 < argc) {
+                png_prefix = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --png-prefix requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--capture-audio") == 0) {
+            if (i + 1 < argc) {
+                capture_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --capture-audio requires a file name\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--opcode-profile") == 0) {
+            if (i + 1 < argc) {
+                opcode_profile_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --opcode-profile requires a file name\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            if (i + 1 < argc) {
+                batch_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --batch requires a job list\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            if (i + 1 < argc) {
+                long threads = atol(argv[++i]);
+                if (threads <= 0 || threads > 4096) {
+                    fprintf(stderr, "Error: Job count must be between 1 and 4096\n");
+                    return 1;
+                }
+                batch_threads = (uint32_t)threads;
+            } else {
+                fprintf(stderr, "Error: --jobs requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--lockstep") == 0) {
+            if (i + 1 < argc) {
+                long instances = atol(argv[++i]);
+                if (instances <= 0 || instances > 65536) {
+                    fprintf(stderr, "Error: Lockstep instances must be between 1 and 65536\n");
+                    return 1;
+                }
+                lockstep_instances = (uint32_t)instances;
+            } else {
+                fprintf(stderr, "Error: --lockstep requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--branches") == 0) {
+            if (i + 1 < argc) {
+                long branches = atol(argv[++i]);
+                if (branches <= 0 || branches > 65536) {
+                    fprintf(stderr, "Error: Branch count must be between 1 and 65536\n");
+                    return 1;
+                }
+                branch.branches = (uint32_t)branches;
+            } else {
+                fprintf(stderr, "Error: --branches requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--branch-frames") == 0) {
+            if (i + 1 < argc) {
+                long frames = atol(argv[++i]);
+                if (frames <= 0 || frames > UINT32_MAX) {
+                    fprintf(stderr, "Error: Branch frame count must be a positive integer\n");
+                    return 1;
+                }
+                branch.frames = (uint32_t)frames;
+            } else {
+                fprintf(stderr, "Error: --branch-frames requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            if (i + 1 < argc) {
+                branch.seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+            } else {
+                fprintf(stderr, "Error: --seed requires a value\n");
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            rom_file = argv[i];
+        }
+    }
+
+    if (batch_path) {
+        if (rom_file || lockstep_instances || branch.branches || max_seconds > 0.0 ||
+            speed_cap > 0.0 || hash_at.count || png_at.count || capture_path ||
+            opcode_profile_path) {
+            fprintf(stderr, "Error: --batch only combines with --frames and --jobs\n");
+            return 1;
+        }
+        return run_batch(batch_path, max_frames ? max_frames : HEADLESS_DEFAULT_FRAMES, batch_threads);
+    }
+    if (!rom_file) {
+        fprintf(stderr, "Error: No ROM file given\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (lockstep_instances) {
+        if (branch.branches || max_seconds > 0.0 || speed_cap > 0.0 || hash_at.count ||
+            png_at.count || capture_path || opcode_profile_path) {
+            fprintf(stderr, "Error: --lockstep only combines with --frames\n");
+            return 1;
+        }
+        return run_lockstep(rom_file, lockstep_instances, max_frames ? max_frames : HEADLESS_DEFAULT_FRAMES);
+    }
+    if (branch.branches) {
+        if (max_seconds > 0.0 || speed_cap > 0.0 || hash_at.count || png_at.count ||
+            capture_path || opcode_profile_path) {
+            fprintf(stderr, "Error: --branches only combines with --frames, --branch-frames, "
+                            "--seed and --jobs\n");
+            return 1;
+        }
+        branch.jobs = batch_threads;
+        return run_branches(rom_file, max_frames ? max_frames : HEADLESS_DEFAULT_FRAMES, &branch);
+    }
+    if (max_frames == 0 && max_seconds == 0.0) {
+        max_frames = HEADLESS_DEFAULT_FRAMES;
+    }
+
+    GBEmulator gb;
+    gb_init(&gb);
+    if (s_verbose) gb_enable_debug(&gb);
+    if (!gb_load_rom(&gb, rom_file)) {
+        fprintf(stderr, "Failed to load ROM: %s\n", rom_file);
+        gb_cleanup(&gb);
+        return 1;
+    }
+    gb_reset(&gb);
+
+    /* Heap allocated: 16 KB of counters is too much for the stack next to
+       the emulator */
+    OpcodeProfile* opcodes = NULL;
+    if (opcode_profile_path) {
+        opcodes = malloc(sizeof(OpcodeProfile));
+        if (!opcodes) {
+            fprintf(stderr, "Failed to allocate opcode profile\n");
+            gb_cleanup(&gb);
+            return 1;
+        }
+        opcode_profile_init(opcodes);
+        sm83_set_opcode_profile(&gb.cpu, opcodes);
+    }
+
+    AudioCapture capture;
+    bool capturing = false;
+    if (capture_path) {
+        capturing = audio_capture_open(&capture, capture_path, audio_capture_format_for_path(capture_path),
+                                       APU_OUTPUT_CHANNELS, SAMPLE_RATE);
+        if (!capturing) {
+            gb_cleanup(&gb);
+            return 1;
+        }
+    }
+
+    /* PNG encoding and writing happen off the emulation thread */
+    IoWorker io;
+    bool io_running = png_at.count > 0 && io_worker_start(&io);
+    if (png_at.count > 0 && !io_running) {
+        if (capturing) audio_capture_close(&capture);
+        gb_cleanup(&gb);
+        return 1;
+    }
+
+    FrameHash* hashes = NULL;
+    if (hash_at.count > 0) {
+        hashes = malloc(hash_at.count * sizeof(*hashes));
+        if (!hashes) {
+            fprintf(stderr, "Failed to allocate frame hashes\n");
+            if (io_running) io_worker_stop(&io);
+            if (capturing) audio_capture_close(&capture);
+            gb_cleanup(&gb);
+            return 1;
+        }
+    }
+    uint32_t hash_count = 0;
+    bool ok = true;
+
+    uint64_t total_cycles = 0;
+    uint32_t frame = 0;
+    float audio_samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (max_frames == 0 || frame < max_frames) {
+        uint32_t cycles_before = gb.cycles;
+        gb_run_frame_optimized(&gb);
+        total_cycles += (uint32_t)(gb.cycles - cycles_before);
+        gb.frame_complete = false;
+        frame++;
+
+        /* Drained every frame so the APU buffer never fills up */
+        uint32_t frame_samples;
+        while ((frame_samples = apu_drain(&gb.apu, audio_samples, APU_BUFFER_SAMPLES)) > 0) {
+            if (capturing && !audio_capture_write(&capture, audio_samples, frame_samples)) ok = false;
+        }
+
+        if (frame_listed(&hash_at, frame) && hash_count < hash_at.count) {
+            hashes[hash_count].frame = frame;
+            hashes[hash_count].hash = batch_framebuffer_hash(gb.ppu.framebuffer);
+            hash_count++;
+        }
+        if (io_running && frame_listed(&png_at, frame)) {
+            char png_path[HEADLESS_PATH_MAX];
+            snprintf(png_path, sizeof(png_path), "%s-%u.png", png_prefix, frame);
+            if (!io_worker_screenshot(&io, gb.ppu.framebuffer, png_path)) {
+                /* Both slots busy: wait rather than skip the frame */
+                io_worker_flush(&io);
+                if (!io_worker_screenshot(&io, gb.ppu.framebuffer, png_path)) ok = false;
+            }
+        }
+
+        /* Checking the clock once per frame is cheap next to the frame itself */
+        if (max_seconds > 0.0 && elapsed_seconds(&start) >= max_seconds) break;
+
+        if (speed_cap > 0.0) {
+            /* Sleep to where this frame is due at the capped speed; an
+               absolute schedule keeps rounding from adding up */
+            double due = frame / (FRAME_RATE * speed_cap);
+            struct timespec deadline = start;
+            deadline.tv_sec += (time_t)due;
+            deadline.tv_nsec += (long)((due - (double)(time_t)due) * 1e9);
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_nsec -= 1000000000L;
+                deadline.tv_sec++;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+        }
+    }
+
+    double seconds = elapsed_seconds(&start);
+
+    if (io_running) {
+        io_worker_stop(&io);
+        IoResult result;
+        while (io_worker_poll(&io, &result)) {
+            if (!result.ok) {
+                fprintf(stderr, "Failed to save frame: %s\n", result.path);
+                ok = false;
+            }
+        }
+    }
+    if (capturing && !audio_capture_close(&capture)) ok = false;
+    if (opcodes) {
+        opcode_profile_print_report(opcodes, stderr);
+        if (!opcode_profile_export(opcodes, opcode_profile_path)) ok = false;
+    }
+
+    double rate = seconds > 0.0 ? 1.0 / seconds : 0.0;
+    printf("{\n");
+    printf("  \"rom\": ");
+    print_json_string(rom_file);
+    printf(",\n");
+    printf("  \"frames\": %u,\n", frame);
+    printf("  \"cycles\": %llu,\n", (unsigned long long)total_cycles);
+    printf("  \"instructions\": %llu,\n", (unsigned long long)gb.instructions);
+    printf("  \"seconds\": %.6f,\n", seconds);
+    printf("  \"fps\": %.2f,\n", frame * rate);
+    printf("  \"instructions_per_second\": %.0f,\n", gb.instructions * rate);
+    printf("  \"cycles_per_second\": %.0f,\n", total_cycles * rate);
+    printf("  \"speed\": %.3f,\n", total_cycles * rate / CPU_CLOCK_SPEED);
+    printf("  \"final_hash\": \"%016llx\",\n", (unsigned long long)batch_framebuffer_hash(gb.ppu.framebuffer));
+    printf("  \"hashes\": [");
+    for (uint32_t i = 0; i < hash_count; i++) {
+        printf("%s{\"frame\": %u, \"hash\": \"%016llx\"}", i ? ", " : "",
+               hashes[i].frame, (unsigned long long)hashes[i].hash);
+    }
+    printf("],\n");
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+
+    free(hashes);
+    free(opcodes);
+    gb_cleanup(&gb);
+    return ok ? 0 : 1;
+}
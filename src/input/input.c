@@ -77,6 +77,16 @@ void input_set_state(Memory* mem, uint8_t state_mask) {
     memory_update_joyp(mem);
 }
 
+void input_set_held(Memory* mem, uint8_t state_mask) {
+    if (!mem) return;
+    uint8_t held = (uint8_t)(mem->joypad_state_dirs | (mem->joypad_state_buttons << 4));
+    for (unsigned bit = 0x01; bit <= 0x80; bit <<= 1) {
+        if (!((state_mask ^ held) & bit)) continue;
+        if (state_mask & bit) input_press(mem, (Joypad_Button)bit);
+        else input_release(mem, (Joypad_Button)bit);
+    }
+}
+
 uint8_t input_read_joyp(Memory* mem) {
     if (!mem) return 0xFF;
     return mem->io_registers[0x00];
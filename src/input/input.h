@@ -26,6 +26,10 @@ void input_release(Memory* mem, Joypad_Button b);
 /* Helper to set whole state (bits as Joypad_Button) */
 void input_set_state(Memory* mem, uint8_t state_mask);
 
+/* Hold exactly the buttons in state_mask (same bits), pressing and releasing
+ * the ones that changed so new presses raise the joypad interrupt */
+void input_set_held(Memory* mem, uint8_t state_mask);
+
 /* Read current visible JOYP register (returns 0..255 as stored in 0xFF00) */
 uint8_t input_read_joyp(Memory* mem);
 
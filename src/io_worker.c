@@ -0,0 +1,345 @@
+#include "io_worker.h"
+#include "savestate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+/* ---- File output ---- */
+
+/* Write through a temporary file so a failed write never clobbers the old one */
+static bool write_file(const char* path, const uint8_t* data, size_t size) {
+    char tmp_path[IO_PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open file for writing: %s\n", tmp_path);
+        return false;
+    }
+
+    size_t written = fwrite(data, 1, size, file);
+    bool ok = fclose(file) == 0 && written == size;
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write file: %s\n", path);
+        remove(tmp_path);
+    }
+    return ok;
+}
+
+/* Grow the worker scratch buffer; only touched from the worker thread */
+static bool reserve_scratch(IoWorker* io, size_t size) {
+    if (size <= io->scratch_capacity) return true;
+    uint8_t* grown = realloc(io->scratch, size);
+    if (!grown) return false;
+    io->scratch = grown;
+    io->scratch_capacity = size;
+    return true;
+}
+
+/* ---- PNG encoding ---- */
+
+#define PNG_WIDTH  SCREEN_WIDTH
+#define PNG_HEIGHT SCREEN_HEIGHT
+#define PNG_ROW    (1 + PNG_WIDTH * 3)   /* Filter byte + RGB */
+#define PNG_RAW    (PNG_ROW * PNG_HEIGHT)
+
+static uint8_t* png_put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+/* Chunk data must already be in place at p + 8 */
+static uint8_t* png_finish_chunk(uint8_t* p, const char* type, uint32_t length) {
+    png_put_u32(p, length);
+    memcpy(p + 4, type, 4);
+    uint32_t crc = (uint32_t)crc32(0L, p + 4, length + 4);
+    return png_put_u32(p + 8 + length, crc);
+}
+
+static bool write_screenshot(IoWorker* io, const IoJob* job) {
+    if (job->size != PNG_WIDTH * PNG_HEIGHT * sizeof(uint32_t)) return false;
+
+    size_t bound = compressBound(PNG_RAW);
+    if (!reserve_scratch(io, PNG_RAW + 8 + 25 + 12 + bound + 12)) return false;
+
+    /* ARGB8888 framebuffer to unfiltered RGB rows */
+    uint8_t* raw = io->scratch;
+    const uint8_t* src = job->data;
+    for (int y = 0; y < PNG_HEIGHT; y++) {
+        uint8_t* row = raw + y * PNG_ROW;
+        *row++ = 0;
+        for (int x = 0; x < PNG_WIDTH; x++) {
+            uint32_t pixel;
+            memcpy(&pixel, src + (y * PNG_WIDTH + x) * sizeof(uint32_t), sizeof(pixel));
+            *row++ = (uint8_t)(pixel >> 16);
+            *row++ = (uint8_t)(pixel >> 8);
+            *row++ = (uint8_t)pixel;
+        }
+    }
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint8_t* png = raw + PNG_RAW;
+    uint8_t* p = png;
+    memcpy(p, signature, sizeof(signature));
+    p += sizeof(signature);
+
+    uint8_t* ihdr = p + 8;
+    png_put_u32(ihdr, PNG_WIDTH);
+    png_put_u32(ihdr + 4, PNG_HEIGHT);
+    ihdr[8] = 8;   /* Bit depth */
+    ihdr[9] = 2;   /* Truecolor */
+    ihdr[10] = 0;  /* Deflate */
+    ihdr[11] = 0;  /* Adaptive filtering */
+    ihdr[12] = 0;  /* No interlace */
+    p = png_finish_chunk(p, "IHDR", 13);
+
+    uLongf packed = (uLongf)bound;
+    if (compress2(p + 8, &packed, raw, PNG_RAW, Z_BEST_COMPRESSION) != Z_OK) return false;
+    p = png_finish_chunk(p, "IDAT", (uint32_t)packed);
+    p = png_finish_chunk(p, "IEND", 0);
+
+    return write_file(job->path, png, (size_t)(p - png));
+}
+
+/* ---- Worker thread ---- */
+
+static bool run_job(IoWorker* io, const IoJob* job) {
+    switch (job->type) {
+        case IO_JOB_SAVE_STATE: {
+            /* Deflate the bulk memory chunks; fall back to the plain image */
+            size_t bound = savestate_deflate_bound(job->size);
+            size_t packed = reserve_scratch(io, bound)
+                          ? savestate_deflate(job->data, job->size, io->scratch, bound) : 0;
+            if (packed) return write_file(job->path, io->scratch, packed);
+            return write_file(job->path, job->data, job->size);
+        }
+        case IO_JOB_SCREENSHOT:
+            return write_screenshot(io, job);
+        case IO_JOB_BATTERY_RAM:
+            return write_file(job->path, job->data, job->size);
+    }
+    return false;
+}
+
+/* Oldest queued job, or NULL. Caller holds the lock. */
+static IoJob* next_job(IoWorker* io) {
+    IoJob* next = NULL;
+    for (int i = 0; i < IO_WORKER_SLOTS; i++) {
+        IoJob* job = &io->slots[i];
+        if (job->state == IO_SLOT_QUEUED && (!next || job->sequence < next->sequence)) {
+            next = job;
+        }
+    }
+    return next;
+}
+
+static void post_result(IoWorker* io, const IoJob* job, bool ok) {
+    if (io->result_count == IO_WORKER_RESULTS) {
+        /* Nobody is polling; drop the oldest */
+        io->result_head = (io->result_head + 1) % IO_WORKER_RESULTS;
+        io->result_count--;
+    }
+    IoResult* result = &io->results[(io->result_head + io->result_count) % IO_WORKER_RESULTS];
+    result->type = job->type;
+    result->ok = ok;
+    memcpy(result->path, job->path, sizeof(result->path));
+    io->result_count++;
+}
+
+static void* worker_main(void* arg) {
+    IoWorker* io = arg;
+
+    pthread_mutex_lock(&io->lock);
+    for (;;) {
+        IoJob* job = next_job(io);
+        if (!job) {
+            if (!io->running) break;
+            pthread_cond_wait(&io->wake, &io->lock);
+            continue;
+        }
+
+        job->state = IO_SLOT_BUSY;
+        pthread_mutex_unlock(&io->lock);
+        bool ok = run_job(io, job);
+        pthread_mutex_lock(&io->lock);
+
+        job->state = IO_SLOT_FREE;
+        post_result(io, job, ok);
+        pthread_cond_broadcast(&io->idle);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return NULL;
+}
+
+/* ---- Lifecycle ---- */
+
+bool io_worker_start(IoWorker* io) {
+    memset(io, 0, sizeof(*io));
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->wake, NULL);
+    pthread_cond_init(&io->idle, NULL);
+    io->running = true;
+
+    if (pthread_create(&io->thread, NULL, worker_main, io) != 0) {
+        fprintf(stderr, "Failed to start I/O worker thread\n");
+        pthread_cond_destroy(&io->idle);
+        pthread_cond_destroy(&io->wake);
+        pthread_mutex_destroy(&io->lock);
+        io->running = false;
+        return false;
+    }
+    return true;
+}
+
+void io_worker_stop(IoWorker* io) {
+    pthread_mutex_lock(&io->lock);
+    io->running = false;
+    pthread_cond_signal(&io->wake);
+    pthread_mutex_unlock(&io->lock);
+    pthread_join(io->thread, NULL);
+
+    pthread_cond_destroy(&io->idle);
+    pthread_cond_destroy(&io->wake);
+    pthread_mutex_destroy(&io->lock);
+    for (int i = 0; i < IO_WORKER_SLOTS; i++) {
+        free(io->slots[i].data);
+    }
+    free(io->scratch);
+    free(io->ram_shadow);
+    memset(io, 0, sizeof(*io));
+}
+
+/* ---- Submission (emulation thread) ---- */
+
+/* Claim a free slot with room for size bytes. Caller holds the lock. */
+static IoJob* claim_slot(IoWorker* io, IoJobType type, const char* path, size_t size) {
+    IoJob* job = NULL;
+    for (int i = 0; i < IO_WORKER_SLOTS; i++) {
+        if (io->slots[i].state == IO_SLOT_FREE) {
+            job = &io->slots[i];
+            break;
+        }
+    }
+    if (!job) return NULL;
+
+    /* Slots keep their buffers, so this only allocates for the first job of a size */
+    if (size > job->capacity) {
+        uint8_t* grown = realloc(job->data, size);
+        if (!grown) return NULL;
+        job->data = grown;
+        job->capacity = size;
+    }
+
+    job->type = type;
+    job->size = size;
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    return job;
+}
+
+static void submit(IoWorker* io, IoJob* job) {
+    job->state = IO_SLOT_QUEUED;
+    job->sequence = io->next_sequence++;
+    pthread_cond_signal(&io->wake);
+}
+
+bool io_worker_save_state(IoWorker* io, const GBEmulator* gb, const char* path) {
+    size_t size = savestate_encode(gb, NULL, 0);
+
+    pthread_mutex_lock(&io->lock);
+    IoJob* job = claim_slot(io, IO_JOB_SAVE_STATE, path, size);
+    if (job) {
+        savestate_encode(gb, job->data, size);
+        submit(io, job);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return job != NULL;
+}
+
+bool io_worker_screenshot(IoWorker* io, const uint32_t* framebuffer, const char* path) {
+    size_t size = PNG_WIDTH * PNG_HEIGHT * sizeof(uint32_t);
+
+    pthread_mutex_lock(&io->lock);
+    IoJob* job = claim_slot(io, IO_JOB_SCREENSHOT, path, size);
+    if (job) {
+        memcpy(job->data, framebuffer, size);
+        submit(io, job);
+    }
+    pthread_mutex_unlock(&io->lock);
+    return job != NULL;
+}
+
+/* Room for a shadow of size bytes; its contents are invalid until copied */
+static bool reserve_ram_shadow(IoWorker* io, size_t size) {
+    if (io->ram_shadow_size == size) return true;
+    uint8_t* shadow = realloc(io->ram_shadow, size);
+    if (!shadow) return false;
+    io->ram_shadow = shadow;
+    io->ram_shadow_size = 0;
+    return true;
+}
+
+void io_worker_track_ram(IoWorker* io, const Memory* mem) {
+    const MBC_State* mbc = (const MBC_State*)mem->mbc_data;
+    if (!mbc || !mbc->ram_data || !mbc->ram_size) return;
+    if (!reserve_ram_shadow(io, mbc->ram_size)) return;  /* The next flush just writes */
+    memcpy(io->ram_shadow, mbc->ram_data, mbc->ram_size);
+    io->ram_shadow_size = mbc->ram_size;
+}
+
+bool io_worker_save_ram(IoWorker* io, const Memory* mem, const char* path) {
+    const MBC_State* mbc = (const MBC_State*)mem->mbc_data;
+    if (!mbc || !mbc->ram_data || !mbc->ram_size) return true;
+
+    size_t size = mbc->ram_size;
+    if (io->ram_shadow_size == size && memcmp(io->ram_shadow, mbc->ram_data, size) == 0) {
+        return true;  /* Unchanged since the last flush */
+    }
+    if (!reserve_ram_shadow(io, size)) return false;
+
+    pthread_mutex_lock(&io->lock);
+    IoJob* job = claim_slot(io, IO_JOB_BATTERY_RAM, path, size);
+    if (job) {
+        memcpy(job->data, mbc->ram_data, size);
+        submit(io, job);
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    if (!job) return false;
+    memcpy(io->ram_shadow, mbc->ram_data, size);
+    io->ram_shadow_size = size;
+    return true;
+}
+
+/* ---- Completion ---- */
+
+bool io_worker_poll(IoWorker* io, IoResult* result) {
+    pthread_mutex_lock(&io->lock);
+    bool found = io->result_count > 0;
+    if (found) {
+        *result = io->results[io->result_head];
+        io->result_head = (io->result_head + 1) % IO_WORKER_RESULTS;
+        io->result_count--;
+    }
+    pthread_mutex_unlock(&io->lock);
+    return found;
+}
+
+void io_worker_flush(IoWorker* io) {
+    pthread_mutex_lock(&io->lock);
+    for (;;) {
+        bool pending = false;
+        for (int i = 0; i < IO_WORKER_SLOTS; i++) {
+            if (io->slots[i].state != IO_SLOT_FREE) pending = true;
+        }
+        if (!pending) break;
+        pthread_cond_wait(&io->idle, &io->lock);
+    }
+    pthread_mutex_unlock(&io->lock);
+}
@@ -0,0 +1,98 @@
+#ifndef IO_WORKER_H
+#define IO_WORKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "gbendo.h"
+
+/* Background file writer.
+ *
+ * The emulation thread copies what needs saving (an encoded save state, a
+ * framebuffer, cartridge RAM) into one of two job slots and returns at once.
+ * A worker thread does the slow part - deflate, PNG encoding, the write
+ * itself - and posts a result that the main loop polls to report back to the
+ * UI. Files are written to "<path>.tmp" and renamed into place, so an
+ * interrupted write never replaces a good file. */
+
+#define IO_WORKER_SLOTS   2   /* Jobs that can be queued or in flight */
+#define IO_WORKER_RESULTS 8   /* Completed jobs waiting to be polled */
+#define IO_PATH_MAX       2048
+
+typedef enum {
+    IO_JOB_SAVE_STATE,
+    IO_JOB_SCREENSHOT,
+    IO_JOB_BATTERY_RAM
+} IoJobType;
+
+typedef enum {
+    IO_SLOT_FREE,
+    IO_SLOT_QUEUED,
+    IO_SLOT_BUSY
+} IoSlotState;
+
+typedef struct {
+    IoJobType type;
+    IoSlotState state;
+    uint64_t sequence;          /* Submission order */
+    char path[IO_PATH_MAX];
+    uint8_t* data;              /* Owned; grows to the largest job seen */
+    size_t size;
+    size_t capacity;
+} IoJob;
+
+typedef struct {
+    IoJobType type;
+    bool ok;
+    char path[IO_PATH_MAX];
+} IoResult;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        /* Signals the worker: job queued or stopping */
+    pthread_cond_t idle;        /* Signals waiters: a job finished */
+    bool running;
+
+    IoJob slots[IO_WORKER_SLOTS];
+    uint64_t next_sequence;
+
+    IoResult results[IO_WORKER_RESULTS];
+    size_t result_head;
+    size_t result_count;
+
+    /* Worker-side scratch for compressed output */
+    uint8_t* scratch;
+    size_t scratch_capacity;
+
+    /* Cartridge RAM as last queued, to skip flushes when nothing changed */
+    uint8_t* ram_shadow;
+    size_t ram_shadow_size;
+} IoWorker;
+
+/* Lifecycle. io_worker_stop() finishes all queued jobs before returning. */
+bool io_worker_start(IoWorker* io);
+void io_worker_stop(IoWorker* io);
+
+/* Queue jobs. Each returns false without blocking when both slots are in use
+   (or on allocation failure); the caller may simply retry later. */
+bool io_worker_save_state(IoWorker* io, const GBEmulator* gb, const char* path);
+bool io_worker_screenshot(IoWorker* io, const uint32_t* framebuffer, const char* path);
+
+/* Queue a battery RAM write if the cartridge RAM changed since the last one.
+   Returns true when there was nothing to do. */
+bool io_worker_save_ram(IoWorker* io, const Memory* mem, const char* path);
+
+/* Take the cartridge RAM as already on disk (just loaded from the battery
+   file, or fresh), so io_worker_save_ram() writes only once it changes */
+void io_worker_track_ram(IoWorker* io, const Memory* mem);
+
+/* Pop one completed job. Returns false when there is none. */
+bool io_worker_poll(IoWorker* io, IoResult* result);
+
+/* Block until every queued job has completed */
+void io_worker_flush(IoWorker* io);
+
+#endif /* IO_WORKER_H */
@@ -0,0 +1,160 @@
+#include "libgbendo.h"
+#include <stdlib.h>
+#include "../gbendo.h"
+#include "../lockstep.h"
+#include "../input/input.h"
+#include "../ui/ui_debug.h"
+
+/* The handle is the core's GBEmulator, kept out of the public header; a
+   batch's instances are handed out as handles, so nothing else goes here */
+struct Gbendo {
+    GBEmulator gb;
+};
+
+struct GbendoBatch {
+    Lockstep lockstep;
+};
+
+_Static_assert(GBENDO_SCREEN_WIDTH == SCREEN_WIDTH && GBENDO_SCREEN_HEIGHT == SCREEN_HEIGHT,
+               "public screen size must match the PPU");
+_Static_assert(GBENDO_AUDIO_RATE == SAMPLE_RATE && GBENDO_AUDIO_CHANNELS == APU_OUTPUT_CHANNELS,
+               "public audio format must match the APU");
+_Static_assert(GBENDO_BUTTON_RIGHT == JP_RIGHT && GBENDO_BUTTON_START == JP_START,
+               "public button bits must match the joypad");
+_Static_assert(GBENDO_RAM_SIZE == LOCKSTEP_RAM_SIZE &&
+               (int)GBENDO_OBSERVE_RAM == (int)LOCKSTEP_OBSERVE_RAM &&
+               (int)GBENDO_OBSERVE_SCREEN == (int)LOCKSTEP_OBSERVE_SCREEN,
+               "public observations must match the lockstep batch");
+
+/* The core logs through the GUI's debug console; an embedded core stays quiet */
+bool ui_is_debug_enabled(UIDebugComponent component) {
+    (void)component;
+    return false;
+}
+
+void ui_debug_log(UIDebugComponent component, const char* format, ...) {
+    (void)component;
+    (void)format;
+}
+
+uint32_t gbendo_api_version(void) {
+    return GBENDO_API_VERSION;
+}
+
+Gbendo* gbendo_create(void) {
+    Gbendo* handle = malloc(sizeof(Gbendo));
+    if (!handle) return NULL;
+    gb_init(&handle->gb);
+    return handle;
+}
+
+void gbendo_destroy(Gbendo* handle) {
+    if (!handle) return;
+    gb_cleanup(&handle->gb);
+    free(handle);
+}
+
+Gbendo* gbendo_clone(const Gbendo* handle) {
+    Gbendo* clone = malloc(sizeof(Gbendo));
+    if (!clone) return NULL;
+    if (!gb_clone(&clone->gb, &handle->gb)) {
+        free(clone);
+        return NULL;
+    }
+    return clone;
+}
+
+bool gbendo_load_rom(Gbendo* handle, const void* data, size_t size) {
+    if (!data || !gb_load_rom_data(&handle->gb, data, size)) return false;
+    gb_reset(&handle->gb);
+    return true;
+}
+
+void gbendo_reset(Gbendo* handle) {
+    gb_reset(&handle->gb);
+}
+
+void gbendo_set_input(Gbendo* handle, uint8_t buttons) {
+    input_set_held(&handle->gb.memory, buttons);
+}
+
+bool gbendo_run_frame(Gbendo* handle) {
+    GBEmulator* gb = &handle->gb;
+    if (!gb->memory.mbc_data || gb->cpu_fault) return false;
+    gb_run_frame_optimized(gb);
+    gb->frame_complete = false;
+    return !gb->cpu_fault;
+}
+
+bool gbendo_run_cycles(Gbendo* handle, uint32_t cycles) {
+    GBEmulator* gb = &handle->gb;
+    if (!gb->memory.mbc_data) return false;
+    uint32_t run = 0;
+    while (run < cycles && !gb->cpu_fault) {
+        uint32_t before = gb->cycles;
+        gb_step(gb);
+        run += gb->cycles - before;
+    }
+    /* Make this stretch's audio readable now rather than at the next frame */
+    apu_end_frame(&gb->apu);
+    return !gb->cpu_fault;
+}
+
+const uint32_t* gbendo_framebuffer(const Gbendo* handle) {
+    return handle->gb.ppu.framebuffer;
+}
+
+uint32_t gbendo_read_audio(Gbendo* handle, float* samples, uint32_t max_frames) {
+    return apu_drain(&handle->gb.apu, samples, max_frames);
+}
+
+size_t gbendo_snapshot_size(const Gbendo* handle) {
+    return gb_snapshot_size(&handle->gb);
+}
+
+size_t gbendo_snapshot_save(const Gbendo* handle, void* buffer) {
+    return gb_snapshot_save(&handle->gb, buffer);
+}
+
+bool gbendo_snapshot_load(Gbendo* handle, const void* buffer) {
+    return gb_snapshot_load(&handle->gb, buffer);
+}
+
+GbendoBatch* gbendo_batch_create(const void* rom, size_t size, uint32_t count) {
+    if (!rom) return NULL;
+    GbendoBatch* batch = malloc(sizeof(GbendoBatch));
+    if (!batch) return NULL;
+    if (!lockstep_init(&batch->lockstep, rom, size, count)) {
+        free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+void gbendo_batch_destroy(GbendoBatch* batch) {
+    if (!batch) return;
+    lockstep_cleanup(&batch->lockstep);
+    free(batch);
+}
+
+void gbendo_batch_reset(GbendoBatch* batch) {
+    lockstep_reset(&batch->lockstep);
+}
+
+uint32_t gbendo_batch_count(const GbendoBatch* batch) {
+    return batch->lockstep.count;
+}
+
+size_t gbendo_batch_observation_size(GbendoObservation observe) {
+    return lockstep_observation_size((LockstepObservation)observe);
+}
+
+uint32_t gbendo_batch_step(GbendoBatch* batch, const uint8_t* buttons,
+                           GbendoObservation observe, void* out) {
+    return lockstep_step(&batch->lockstep, buttons, (LockstepObservation)observe, out);
+}
+
+Gbendo* gbendo_batch_instance(GbendoBatch* batch, uint32_t index) {
+    if (index >= batch->lockstep.count) return NULL;
+    return (Gbendo*)&batch->lockstep.instances[index];
+}
@@ -0,0 +1,130 @@
+#ifndef LIBGBENDO_H
+#define LIBGBENDO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* libgbendo: the emulation core behind an opaque handle, for embedding in
+ * other programs without SDL (make lib builds libgbendo.a and libgbendo.so).
+ *
+ * This header is the whole public interface and does not expose the core's
+ * structs, so they can change without breaking callers; GBENDO_API_VERSION
+ * only goes up when this header changes incompatibly.
+ *
+ * Each handle is independent and may run on its own thread; a single handle
+ * must not be used from two threads at once. After gbendo_create() and
+ * gbendo_load_rom(), running frames, setting input, reading the framebuffer
+ * and draining audio into a caller buffer do not allocate, as long as audio
+ * is drained at least every few frames. */
+
+#define GBENDO_API_VERSION 1
+
+#if defined(__GNUC__)
+#define GBENDO_API __attribute__((visibility("default")))
+#else
+#define GBENDO_API
+#endif
+
+#define GBENDO_SCREEN_WIDTH  160
+#define GBENDO_SCREEN_HEIGHT 144
+#define GBENDO_AUDIO_RATE    44100   /* Stereo frames per second */
+#define GBENDO_AUDIO_CHANNELS 2      /* Interleaved left/right */
+
+/* Button bits for gbendo_set_input() */
+#define GBENDO_BUTTON_RIGHT  0x01
+#define GBENDO_BUTTON_LEFT   0x02
+#define GBENDO_BUTTON_UP     0x04
+#define GBENDO_BUTTON_DOWN   0x08
+#define GBENDO_BUTTON_A      0x10
+#define GBENDO_BUTTON_B      0x20
+#define GBENDO_BUTTON_SELECT 0x40
+#define GBENDO_BUTTON_START  0x80
+
+typedef struct Gbendo Gbendo;
+
+/* GBENDO_API_VERSION of the library actually linked */
+GBENDO_API uint32_t gbendo_api_version(void);
+
+/* NULL if out of memory */
+GBENDO_API Gbendo* gbendo_create(void);
+GBENDO_API void gbendo_destroy(Gbendo* gb);
+
+/* A new handle in gb's exact state, sharing its ROM image rather than
+   copying it: the branch point for tree search. NULL if out of memory or
+   the cartridge type cannot be cloned. Destroy each handle as usual. */
+GBENDO_API Gbendo* gbendo_clone(const Gbendo* gb);
+
+/* Loads a cartridge image (copied, so the buffer can go away) and resets.
+   On failure the previous ROM stays loaded. */
+GBENDO_API bool gbendo_load_rom(Gbendo* gb, const void* data, size_t size);
+GBENDO_API void gbendo_reset(Gbendo* gb);
+
+/* The buttons held from now on, as GBENDO_BUTTON_* bits */
+GBENDO_API void gbendo_set_input(Gbendo* gb, uint8_t buttons);
+
+/* Run one video frame, or at least the given number of CPU cycles
+   (4194304 per second). Both return false once the CPU has hit an invalid
+   opcode; it stays stopped until gbendo_reset() or gbendo_load_rom(). They
+   also return false without running while no ROM is loaded. */
+GBENDO_API bool gbendo_run_frame(Gbendo* gb);
+GBENDO_API bool gbendo_run_cycles(Gbendo* gb, uint32_t cycles);
+
+/* GBENDO_SCREEN_WIDTH * GBENDO_SCREEN_HEIGHT pixels, 0xAARRGGBB, row by
+   row. Owned by the handle and updated in place while running. */
+GBENDO_API const uint32_t* gbendo_framebuffer(const Gbendo* gb);
+
+/* Moves up to max_frames stereo frames (2 * max_frames floats) of the
+   audio produced so far into samples and returns how many it moved; call
+   until it returns 0 to empty the buffer. */
+GBENDO_API uint32_t gbendo_read_audio(Gbendo* gb, float* samples, uint32_t max_frames);
+
+/* Snapshots of the whole machine state in a caller buffer of
+   gbendo_snapshot_size() bytes, aligned like a malloc() result. The size
+   only changes when another ROM is loaded. The framebuffer and undrained
+   audio are not part of a snapshot. */
+GBENDO_API size_t gbendo_snapshot_size(const Gbendo* gb);
+GBENDO_API size_t gbendo_snapshot_save(const Gbendo* gb, void* buffer);
+GBENDO_API bool gbendo_snapshot_load(Gbendo* gb, const void* buffer);
+
+/* Lockstep batches: count copies of one ROM stepped together, for search
+ * and training loops. The copies share a single ROM image; each step takes
+ * one button mask per copy (or NULL to keep the held buttons), runs all of
+ * them one frame and writes every copy's observation into one contiguous
+ * buffer of count * gbendo_batch_observation_size() bytes, copy after copy.
+ * Audio is discarded, and the screen is only drawn when it is observed. */
+
+typedef struct GbendoBatch GbendoBatch;
+
+typedef enum {
+    GBENDO_OBSERVE_NONE,
+    GBENDO_OBSERVE_SCREEN,      /* Framebuffer, as gbendo_framebuffer() */
+    GBENDO_OBSERVE_RAM          /* GBENDO_RAM_SIZE bytes: C000-DFFF, then FF80-FFFF */
+} GbendoObservation;
+
+#define GBENDO_RAM_SIZE (0x2000 + 0x80)
+
+/* NULL if out of memory or the ROM does not load */
+GBENDO_API GbendoBatch* gbendo_batch_create(const void* rom, size_t size, uint32_t count);
+GBENDO_API void gbendo_batch_destroy(GbendoBatch* batch);
+GBENDO_API void gbendo_batch_reset(GbendoBatch* batch);
+GBENDO_API uint32_t gbendo_batch_count(const GbendoBatch* batch);
+GBENDO_API size_t gbendo_batch_observation_size(GbendoObservation observe);
+
+/* Returns how many copies have stopped on an invalid opcode */
+GBENDO_API uint32_t gbendo_batch_step(GbendoBatch* batch, const uint8_t* buttons,
+                                      GbendoObservation observe, void* out);
+
+/* Copy index as a handle, e.g. to snapshot or restore it. It belongs to the
+   batch: do not destroy it or load another ROM into it. */
+GBENDO_API Gbendo* gbendo_batch_instance(GbendoBatch* batch, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBGBENDO_H */
@@ -0,0 +1,113 @@
+#include "lockstep.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input/input.h"
+
+size_t lockstep_observation_size(LockstepObservation observe) {
+    switch (observe) {
+        case LOCKSTEP_OBSERVE_SCREEN: return SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t);
+        case LOCKSTEP_OBSERVE_RAM:    return LOCKSTEP_RAM_SIZE;
+        default:                      return 0;
+    }
+}
+
+bool lockstep_init(Lockstep* ls, const uint8_t* rom, size_t size, uint32_t count) {
+    memset(ls, 0, sizeof(*ls));
+    if (count == 0) return false;
+
+    ls->rom = malloc(size);
+    ls->rom_refs = malloc(sizeof(atomic_uint));
+    ls->instances = malloc((size_t)count * sizeof(GBEmulator));
+    ls->order = malloc((size_t)count * sizeof(LockstepSlot));
+    if (!ls->rom || !ls->rom_refs || !ls->instances || !ls->order) {
+        fprintf(stderr, "Failed to allocate %u lockstep instances\n", count);
+        free(ls->rom);
+        free(ls->rom_refs);
+        free(ls->instances);
+        free(ls->order);
+        memset(ls, 0, sizeof(*ls));
+        return false;
+    }
+    memcpy(ls->rom, rom, size);
+    atomic_init(ls->rom_refs, 1);   /* The batch's own reference */
+    ls->rom_size = size;
+
+    for (uint32_t i = 0; i < count; i++) {
+        GBEmulator* gb = &ls->instances[i];
+        gb_init(gb);
+        ls->count = i + 1;
+        if (!memory_load_rom_shared(&gb->memory, ls->rom, size, ls->rom_refs)) {
+            lockstep_cleanup(ls);
+            return false;
+        }
+        gb_reset(gb);
+    }
+    return true;
+}
+
+void lockstep_cleanup(Lockstep* ls) {
+    for (uint32_t i = 0; i < ls->count; i++) {
+        gb_cleanup(&ls->instances[i]);
+    }
+    free(ls->instances);
+    free(ls->order);
+    /* Clones of the instances may still map the ROM */
+    if (ls->rom) memory_release_rom(ls->rom, ls->rom_refs);
+    memset(ls, 0, sizeof(*ls));
+}
+
+void lockstep_reset(Lockstep* ls) {
+    for (uint32_t i = 0; i < ls->count; i++) {
+        gb_reset(&ls->instances[i]);
+    }
+    ls->frames = 0;
+}
+
+static int compare_slots(const void* a, const void* b) {
+    const LockstepSlot* x = a;
+    const LockstepSlot* y = b;
+    if (x->pc != y->pc) return x->pc < y->pc ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static void observe_instance(const GBEmulator* gb, LockstepObservation observe, uint8_t* out) {
+    if (observe == LOCKSTEP_OBSERVE_SCREEN) {
+        memcpy(out, gb->ppu.framebuffer, sizeof(gb->ppu.framebuffer));
+    } else if (observe == LOCKSTEP_OBSERVE_RAM) {
+        memcpy(out, gb->memory.wram, 0x2000);
+        memcpy(out + 0x2000, gb->memory.hram, 0x7F);
+        out[0x207F] = gb->memory.ie_register;
+    }
+}
+
+uint32_t lockstep_step(Lockstep* ls, const uint8_t* buttons, LockstepObservation observe, void* out) {
+    /* Group instances by where they are: same code, same branches */
+    for (uint32_t i = 0; i < ls->count; i++) {
+        ls->order[i].pc = ls->instances[i].cpu.pc;
+        ls->order[i].index = i;
+    }
+    qsort(ls->order, ls->count, sizeof(LockstepSlot), compare_slots);
+
+    size_t stride = lockstep_observation_size(observe);
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    uint32_t faulted = 0;
+    for (uint32_t k = 0; k < ls->count; k++) {
+        uint32_t i = ls->order[k].index;
+        GBEmulator* gb = &ls->instances[i];
+
+        if (!gb->cpu_fault) {
+            if (buttons) input_set_held(&gb->memory, buttons[i]);
+            gb->ppu.skip_render = observe != LOCKSTEP_OBSERVE_SCREEN;
+            gb_run_frame_optimized(gb);
+            gb->frame_complete = false;
+            while (apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+        }
+        if (gb->cpu_fault) faulted++;
+
+        /* Written while the instance is still in cache */
+        if (stride) observe_instance(gb, observe, (uint8_t*)out + (size_t)i * stride);
+    }
+    ls->frames++;
+    return faulted;
+}
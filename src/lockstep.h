@@ -0,0 +1,62 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gbendo.h"
+
+/* Lockstep batches: many copies of one ROM advanced a frame at a time.
+ *
+ * Meant for search and training loops that run the same game thousands of
+ * times with different inputs. All instances map a single copy of the ROM
+ * and live in one allocation. Each step applies one button mask per
+ * instance, runs every instance one frame and writes the chosen
+ * observation of all of them into one contiguous caller buffer, instance
+ * after instance.
+ *
+ * Instances run one after another on the calling thread, ordered by their
+ * PC at the start of the frame, so copies in the same code run back to back
+ * and share warm caches and branch history. When only RAM is observed the
+ * PPU skips drawing. Audio is discarded. */
+
+/* Per instance: WRAM (C000-DFFF), then HRAM and IE (FF80-FFFF) */
+#define LOCKSTEP_RAM_SIZE (0x2000 + 0x80)
+
+typedef enum {
+    LOCKSTEP_OBSERVE_NONE,
+    LOCKSTEP_OBSERVE_SCREEN,    /* SCREEN_WIDTH * SCREEN_HEIGHT pixels (uint32_t) */
+    LOCKSTEP_OBSERVE_RAM        /* LOCKSTEP_RAM_SIZE bytes */
+} LockstepObservation;
+
+typedef struct {
+    uint16_t pc;
+    uint32_t index;
+} LockstepSlot;
+
+typedef struct {
+    GBEmulator* instances;      /* count emulators */
+    uint32_t count;
+    uint8_t* rom;               /* The one ROM image they all map */
+    atomic_uint* rom_refs;      /* Shared with the instances and their clones */
+    size_t rom_size;
+    LockstepSlot* order;        /* This frame's run order */
+    uint64_t frames;            /* Steps since init or reset */
+} Lockstep;
+
+/* Copies the ROM once and boots count instances from it */
+bool lockstep_init(Lockstep* ls, const uint8_t* rom, size_t size, uint32_t count);
+void lockstep_cleanup(Lockstep* ls);
+void lockstep_reset(Lockstep* ls);
+
+/* Observation bytes per instance */
+size_t lockstep_observation_size(LockstepObservation observe);
+
+/* Hold buttons[i] (JP_* bits; NULL keeps the held buttons) on instance i,
+   run every instance one frame and write the observations to out
+   (count * lockstep_observation_size() bytes, unused for NONE). Instances
+   that hit an invalid opcode stay stopped until reset; returns how many. */
+uint32_t lockstep_step(Lockstep* ls, const uint8_t* buttons, LockstepObservation observe, void* out);
+
+#endif /* LOCKSTEP_H */
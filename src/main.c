@@ -3,13 +3,31 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <errno.h>
+#include <pthread.h>
 #include <SDL2/SDL.h>
 #include "gbendo.h"
 #include "ui/window.h"
 #include "ui/ui.h"
 #include "cpu/sm83_optimized.h"
+#include "cpu/opcode_profile.h"
 #include "error_handling.h"
 #include "profiler.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "audio/audio_capture.h"
+#include "io_worker.h"
+#include "triple_buffer.h"
+#include "frame_pacer.h"
+#include "command_queue.h"
+#include "input/input.h"
+
+/* Fast-forward (Tab held, or ` to toggle) runs this many times real time */
+#define FAST_FORWARD_DEFAULT_SPEED 4
+#define FAST_FORWARD_MAX_SPEED 64
+
+/* Joypad reads apply newly arrived input at most this often */
+#define INPUT_POLL_DEFAULT_US 1000
 
 static void print_usage(const char* prog_name) {
     printf("Usage: %s [OPTIONS] [rom_file]\n", prog_name);
@@ -19,19 +37,480 @@ static void print_usage(const char* prog_name) {
     printf("  -f, --fullscreen    Run in fullscreen mode\n");
     printf("  --vsync             Enable vsync (default: enabled)\n");
     printf("  --no-vsync          Disable vsync\n");
+    printf("  --audio-sync        Pace emulation by the audio device instead of the display\n");
+    printf("                      (lowest audio latency; implies --no-vsync)\n");
     printf("  -v, --verbose       Enable verbose debug output\n");
     printf("  --profile           Enable performance profiling\n");
+    printf("  --rewind-mb N       Rewind history budget in MB, 0 disables (default: 16)\n");
+    printf("  --rewind-interval N Frames between rewind captures (default: 2)\n");
+    printf("  --run-ahead N       Run N frames ahead to cut input latency (0-%d, default: 0)\n", RUNAHEAD_MAX_FRAMES);
+    printf("  --capture-audio F   Record the stereo output to F (.wav, otherwise raw float32)\n");
+    printf("  --capture-stems F   Record each sound channel separately to F (4 channels)\n");
+    printf("  --ff-speed N        Fast-forward speed cap, 0 for uncapped (default: %d)\n", FAST_FORWARD_DEFAULT_SPEED);
+    printf("  --ff-mute           Mute audio while fast-forwarding instead of speeding it up\n");
+    printf("  --input-poll-us N   Apply new input when the game reads the joypad, at most\n");
+    printf("                      every N microseconds, 0 for every read (default: %d)\n", INPUT_POLL_DEFAULT_US);
+    printf("  --opcode-profile F  Count executed opcodes, print a ranking on exit and write\n");
+    printf("                      them to F (.json, otherwise CSV)\n");
     printf("  -h, --help          Show this help message\n");
 }
 
+/* Path of a file kept next to the ROM, e.g. "game.gb.sav". False if it
+   does not fit: a truncated path could name the ROM itself. */
+static bool rom_side_path(char* out, size_t size, const char* rom_path, const char* suffix) {
+    int length = snprintf(out, size, "%s%s", rom_path, suffix);
+    if (length < 0 || (size_t)length >= size) {
+        fprintf(stderr, "Path too long: %s%s\n", rom_path, suffix);
+        return false;
+    }
+    return true;
+}
+
+/* Battery RAM is loaded with the ROM and written back by the I/O worker */
+static void load_battery_ram(GBEmulator* gb, const char* rom_path, bool verbose) {
+    char sav_path[2048];
+    if (!rom_side_path(sav_path, sizeof(sav_path), rom_path, ".sav")) return;
+    if (memory_load_ram(&gb->memory, sav_path) && verbose) {
+        printf("[DEBUG] Battery RAM loaded from: %s\n", sav_path);
+    }
+}
+
+static void flush_battery_ram(IoWorker* io, GBEmulator* gb, const char* rom_path) {
+    char sav_path[2048];
+    if (!rom_side_path(sav_path, sizeof(sav_path), rom_path, ".sav")) return;
+    if (!io_worker_save_ram(io, &gb->memory, sav_path)) {
+        /* Both slots busy: wait once rather than lose the data */
+        io_worker_flush(io);
+        io_worker_save_ram(io, &gb->memory, sav_path);
+    }
+}
+
+static void report_io_result(const IoResult* result, bool verbose) {
+    const char* message = NULL;
+    switch (result->type) {
+        case IO_JOB_SAVE_STATE:
+            message = result->ok ? "State saved" : "Failed to save state";
+            break;
+        case IO_JOB_SCREENSHOT:
+            message = result->ok ? "Screenshot saved" : "Failed to save screenshot";
+            break;
+        case IO_JOB_BATTERY_RAM:
+            if (result->ok) {
+                if (verbose) printf("[DEBUG] Battery RAM written to: %s\n", result->path);
+                return;
+            }
+            message = "Failed to save battery RAM";
+            break;
+    }
+    if (result->ok) {
+        printf("%s: %s\n", message, result->path);
+    } else {
+        fprintf(stderr, "%s: %s\n", message, result->path);
+    }
+    ui_show_status(message);
+}
+
+/* A running ROM. The GUI thread owns the window, the event pump and
+ * presentation; the emulation thread owns everything below while it runs.
+ * They meet only in the triple buffer (frames out), the command queues
+ * (input and menu actions in, notices out) and the I/O worker, so a slow
+ * SDL_RenderPresent() never holds up emulation. The GUI thread touches the
+ * emulator itself only while the emulation thread is stopped: loading and
+ * unloading ROMs, and the final report. */
+typedef struct {
+    GBEmulator gb;
+    RewindBuffer rewind;
+    bool rewind_enabled;
+    RunAhead run_ahead;
+    AudioCapture capture, stems_capture;
+    bool capturing, capturing_stems;
+    IoWorker io;
+    bool verbose;
+    bool audio_sync;
+    int ff_speed;               /* Fast-forward cap in multiples of real time, 0 = uncapped */
+    bool ff_mute;
+    long present_interval_ns;   /* Host refresh period: at most one frame rendered per period
+                                   while fast-forwarding */
+
+    FramePacer pacer;           /* Kept across ROMs so the report covers the whole run */
+    TripleBuffer frames;
+    CommandQueue commands;      /* GUI -> emulation */
+    CommandQueue input;         /* GUI -> emulation, buttons only: also drained mid-frame */
+    CommandQueue notices;       /* Emulation -> GUI */
+    uint32_t input_poll_us;
+
+    /* Time from a key event to the joypad state the game reads */
+    uint64_t input_events;
+    uint64_t input_latency_total_ns;
+    uint64_t input_latency_max_ns;
+    OpcodeProfile opcodes;      /* --opcode-profile */
+    char rom_path[2048];        /* Fixed while the thread runs */
+    pthread_t thread;
+    bool running;
+} Session;
+
+/* Large (the framebuffers alone are ~400KB), so not on the stack */
+static Session s_session;
+
+static void notify_busy(Session* session) {
+    command_queue_push(&session->notices, COMMAND_NOTICE_BUSY, 0);
+}
+
+/* The state is copied now and compressed and written by the I/O worker */
+static void session_save_state(Session* session) {
+    char save_path[2048];
+    if (!rom_side_path(save_path, sizeof(save_path), session->rom_path, ".gbstate")) return;
+    if (!io_worker_save_state(&session->io, &session->gb, save_path)) {
+        fprintf(stderr, "Cannot save state: previous writes still in progress\n");
+        notify_busy(session);
+    }
+}
+
+static void session_load_state(Session* session) {
+    char load_path[2048];
+    if (!rom_side_path(load_path, sizeof(load_path), session->rom_path, ".gbstate")) return;
+    if (gb_load_state(&session->gb, load_path)) {
+        printf("State loaded successfully\n");
+    } else {
+        fprintf(stderr, "Failed to load state\n");
+    }
+}
+
+static void session_screenshot(Session* session) {
+    char stamp[32];
+    char shot_path[2048];
+    time_t now = time(NULL);
+    struct tm local;
+    strftime(stamp, sizeof(stamp), "-%Y%m%d-%H%M%S.png", localtime_r(&now, &local));
+    if (!rom_side_path(shot_path, sizeof(shot_path), session->rom_path, stamp)) return;
+    if (!io_worker_screenshot(&session->io, session->gb.ppu.framebuffer, shot_path)) {
+        notify_busy(session);
+    }
+}
+
+/* Applies every button event queued so far. Runs on the emulation thread,
+   between frames and from JOYP reads (memory_set_input_poll), so a press
+   reaches the game as soon as it next looks rather than a frame later. */
+static void session_poll_input(void* user) {
+    Session* session = user;
+    Command command;
+    while (command_queue_pop(&session->input, &command)) {
+        if (command.type == COMMAND_BUTTON_PRESS) {
+            input_press(&session->gb.memory, (Joypad_Button)command.value);
+        } else if (command.type == COMMAND_BUTTON_RELEASE) {
+            input_release(&session->gb.memory, (Joypad_Button)command.value);
+        } else {
+            continue;
+        }
+        uint64_t latency = profiler_get_time_ns() - command.time_ns;
+        session->input_events++;
+        session->input_latency_total_ns += latency;
+        if (latency > session->input_latency_max_ns) session->input_latency_max_ns = latency;
+    }
+}
+
+/* One emulated frame: run, publish the picture, queue the audio. While
+   fast-forwarding, run-ahead is bypassed and frames the caller skipped
+   (gb->ppu.skip_render) are not published. */
+static void session_run_frame(Session* session, bool rewind_held, bool fast_forward, uint32_t* frame_count) {
+    GBEmulator* gb = &session->gb;
+
+    /* While the rewind key is held, step back one capture per displayed frame */
+    bool rewinding = session->rewind_enabled && rewind_held &&
+                     rewind_step(&session->rewind, gb);
+
+    PROFILE_START(&gb->profiler, FRAME_RENDER);
+    if (rewinding || fast_forward) {
+        gb_run_frame_optimized(gb);
+    } else {
+        runahead_run_frame(&session->run_ahead, gb);
+    }
+    PROFILE_END(&gb->profiler, FRAME_RENDER);
+
+    if (session->rewind_enabled && !rewinding) {
+        rewind_capture(&session->rewind, gb);
+    }
+
+    profiler_increment_frame_count(&gb->profiler);
+    profiler_set_instruction_count(&gb->profiler, gb->instructions);
+    profiler_update_metrics(&gb->profiler);
+
+    if (!gb->frame_complete) return;
+
+    (*frame_count)++;
+    if (session->verbose && (*frame_count % 60 == 0)) {
+        printf("[DEBUG] Frame %u - Cycles: %u, PC: 0x%04X, LY: %u, LCDC: 0x%02X\n",
+               *frame_count, gb->cycles, gb->cpu.pc, gb->ppu.ly, gb->ppu.lcdc);
+    }
+    /* Only publish if LCD is currently enabled - avoids showing VRAM during tile uploads */
+    if ((gb->ppu.lcdc & 0x80) && !gb->ppu.skip_render) {  /* LCDC_DISPLAY_ENABLE */
+        triple_buffer_write(&session->frames, gb->ppu.framebuffer);
+    }
+    gb->frame_complete = false;
+
+    /* Write back battery RAM every ~5 seconds if it changed */
+    if (*frame_count % 300 == 0) {
+        flush_battery_ram(&session->io, gb, session->rom_path);
+    }
+
+    /* Queue audio samples from APU buffer (dropped while rewinding or
+       muted fast-forward; under audio sync silence stands in for rewind so
+       the clock keeps running) */
+    bool muted = fast_forward && session->ff_mute;
+    float audio_samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    uint32_t frame_samples;
+    while ((frame_samples = apu_drain(&gb->apu, audio_samples, APU_BUFFER_SAMPLES)) > 0) {
+        if (rewinding && session->audio_sync) {
+            memset(audio_samples, 0, frame_samples * APU_OUTPUT_CHANNELS * sizeof(float));
+        }
+        if ((!rewinding || session->audio_sync) && !muted) {
+            audio_queue_samples(audio_samples, frame_samples);
+        }
+        if (session->capturing && !rewinding) {
+            audio_capture_write(&session->capture, audio_samples, frame_samples);
+        }
+    }
+    if (session->capturing_stems) {
+        float stem_samples[APU_BUFFER_SAMPLES * APU_STEM_CHANNELS];
+        uint32_t stem_frames;
+        while ((stem_frames = apu_drain_stems(&gb->apu, stem_samples, APU_BUFFER_SAMPLES)) > 0) {
+            if (!rewinding) audio_capture_write(&session->stems_capture, stem_samples, stem_frames);
+        }
+    }
+}
+
+static void timespec_add_ns(struct timespec* t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static long timespec_diff_ns(const struct timespec* a, const struct timespec* b) {
+    return (a->tv_sec - b->tv_sec) * 1000000000L + (a->tv_nsec - b->tv_nsec);
+}
+
+/* Entering or leaving fast-forward: speed up (or mute) the audio and put
+   the indicator up or take it down */
+static void session_set_fast_forward(Session* session, bool fast_forward) {
+    GBEmulator* gb = &session->gb;
+    uint32_t decimation = 1;
+    if (fast_forward) {
+        /* Muted output is thrown away, so make as little of it as possible */
+        decimation = APU_MAX_DECIMATION;
+        if (!session->ff_mute && session->ff_speed > 0 && session->ff_speed < APU_MAX_DECIMATION) {
+            decimation = (uint32_t)session->ff_speed;
+        }
+    }
+    apu_set_decimation(&gb->apu, decimation);
+    gb->ppu.skip_render = false;
+    command_queue_push(&session->notices, COMMAND_NOTICE_SPEED,
+                       fast_forward ? COMMAND_SPEED_MEASURING : 0);
+}
+
+static void* emulation_main(void* arg) {
+    Session* session = arg;
+    GBEmulator* gb = &session->gb;
+    bool paused = false;
+    bool rewind_held = false;
+    bool ff_held = false, ff_toggled = false, fast_forward = false;
+    double shown_fps = 0.0;
+    uint32_t frame_count = 0;
+
+    /* Paced by the emulated refresh rate, or by the audio device under
+       audio sync; the display no longer has a say */
+    const long frame_ns = (long)(1e9 / FRAME_RATE);
+    FramePacer* pacer = &session->pacer;
+    frame_pacer_set_period(pacer, frame_ns);
+    struct timespec next_render;
+    clock_gettime(CLOCK_MONOTONIC, &next_render);
+    memory_set_input_poll(&gb->memory, session_poll_input, session, session->input_poll_us);
+
+    for (;;) {
+        Command command;
+        while (command_queue_pop(&session->commands, &command)) {
+            switch (command.type) {
+                case COMMAND_REWIND:
+                    rewind_held = command.value != 0;
+                    break;
+                case COMMAND_FAST_FORWARD:
+                    ff_held = command.value != 0;
+                    break;
+                case COMMAND_FAST_FORWARD_TOGGLE:
+                    ff_toggled = !ff_toggled;
+                    break;
+                case COMMAND_PAUSE:
+                    paused = command.value != 0;
+                    break;
+                case COMMAND_PALETTE:
+                    ppu_set_palette(&gb->ppu, command.value);
+                    break;
+                case COMMAND_RESET:
+                    printf("Resetting emulator...\n");
+                    gb_reset(gb);
+                    if (session->verbose) {
+                        printf("[DEBUG] Emulator reset\n");
+                    }
+                    break;
+                case COMMAND_SAVE_STATE:
+                    session_save_state(session);
+                    break;
+                case COMMAND_LOAD_STATE:
+                    session_load_state(session);
+                    break;
+                case COMMAND_SCREENSHOT:
+                    session_screenshot(session);
+                    break;
+                case COMMAND_QUIT:
+                    /* Leave the emulator at normal speed for whoever runs it next */
+                    if (fast_forward) {
+                        apu_set_decimation(&gb->apu, 1);
+                        gb->ppu.skip_render = false;
+                    }
+                    memory_set_input_poll(&gb->memory, NULL, NULL, 0);
+                    return NULL;
+                default:
+                    break;
+            }
+        }
+
+        session_poll_input(session);
+
+        if (paused) {
+            /* Keep answering commands; the presenter repeats the last frame */
+            struct timespec idle = { 0, 16000000L };
+            nanosleep(&idle, NULL);
+            frame_pacer_resync(pacer);
+            continue;
+        }
+
+        /* Rewinding takes priority over fast-forward */
+        bool want_fast_forward = (ff_held || ff_toggled) && !rewind_held;
+        if (want_fast_forward != fast_forward) {
+            fast_forward = want_fast_forward;
+            session_set_fast_forward(session, fast_forward);
+            shown_fps = 0.0;
+            /* Fast-forward frame times stay out of the statistics */
+            frame_pacer_set_period(pacer, fast_forward && session->ff_speed > 0 ?
+                                          frame_ns / session->ff_speed : frame_ns);
+        }
+
+        if (fast_forward) {
+            /* Render at most one frame per host refresh; the rest only run */
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            gb->ppu.skip_render = timespec_diff_ns(&now, &next_render) < 0;
+            if (!gb->ppu.skip_render) {
+                next_render = now;
+                timespec_add_ns(&next_render, session->present_interval_ns);
+            }
+        }
+
+        session_run_frame(session, rewind_held, fast_forward, &frame_count);
+
+        if (fast_forward) {
+            /* The profiler measures the frame rate about once a second */
+            double fps = profiler_get_current_metrics(&gb->profiler).fps;
+            if (fps != shown_fps) {
+                shown_fps = fps;
+                command_queue_push(&session->notices, COMMAND_NOTICE_SPEED,
+                                   (int32_t)(fps * 100.0 / FRAME_RATE + 0.5));
+            }
+            if (session->ff_speed > 0) frame_pacer_wait(pacer);   /* Else uncapped */
+            continue;
+        }
+        if (session->audio_sync) {
+            /* Audio sync: block until the device has played down to its latency target */
+            audio_wait_for_room();
+        } else {
+            frame_pacer_wait(pacer);
+        }
+        frame_pacer_mark(pacer);
+    }
+}
+
+/* Starts the emulation thread on the ROM already loaded into session->gb */
+static bool session_start(Session* session, const char* rom_path) {
+    if (!rom_side_path(session->rom_path, sizeof(session->rom_path), rom_path, "")) return false;
+    /* Battery RAM was just loaded: only write it back once the game changes it */
+    io_worker_track_ram(&session->io, &session->gb.memory);
+    triple_buffer_init(&session->frames);
+    command_queue_init(&session->commands);
+    command_queue_init(&session->input);
+    command_queue_init(&session->notices);
+    if (pthread_create(&session->thread, NULL, emulation_main, session) != 0) {
+        fprintf(stderr, "Failed to start the emulation thread\n");
+        return false;
+    }
+    session->running = true;
+    return true;
+}
+
+/* Stops the emulation thread between frames; the emulator is the GUI
+   thread's again when this returns */
+static void session_stop(Session* session) {
+    if (!session->running) return;
+    /* The emulation thread drains the queue every frame, so this only waits
+       for room if it is stuck behind a flood of key events */
+    while (!command_queue_push(&session->commands, COMMAND_QUIT, 0)) {
+        SDL_Delay(1);
+    }
+    pthread_join(session->thread, NULL);
+    session->running = false;
+}
+
+/* Menu actions and settings the emulation thread needs, sent as commands.
+   Paused and palette are sent when they change (and at least once). */
+static void session_forward_ui(Session* session, int* paused, int* palette) {
+    CommandQueue* commands = &session->commands;
+    int now_paused = ui_is_paused() ? 1 : 0;
+    if (now_paused != *paused && command_queue_push(commands, COMMAND_PAUSE, now_paused)) {
+        *paused = now_paused;
+    }
+    int now_palette = ui_get_palette();
+    if (now_palette != *palette && command_queue_push(commands, COMMAND_PALETTE, now_palette)) {
+        *palette = now_palette;
+    }
+    if (window_get_reset_requested()) command_queue_push(commands, COMMAND_RESET, 0);
+    if (window_get_save_state_requested()) command_queue_push(commands, COMMAND_SAVE_STATE, 0);
+    if (window_get_load_state_requested()) command_queue_push(commands, COMMAND_LOAD_STATE, 0);
+    if (window_get_screenshot_requested()) command_queue_push(commands, COMMAND_SCREENSHOT, 0);
+
+    Command notice;
+    while (command_queue_pop(&session->notices, &notice)) {
+        if (notice.type == COMMAND_NOTICE_BUSY) {
+            ui_show_status("Busy saving, try again");
+        } else if (notice.type == COMMAND_NOTICE_SPEED) {
+            ui_set_speed(notice.value == COMMAND_SPEED_MEASURING ? -1.0f : notice.value / 100.0f);
+        }
+    }
+}
+
+static double elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000.0 + (now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
 int main(int argc, char* argv[]) {
     int scale = 3;
     bool fullscreen = false;
     bool vsync = true;
+    bool audio_sync = false;
     bool verbose = false;
     bool profiling = false;
     bool gui_mode = true;  /* GUI mode is now the default */
+    size_t rewind_budget = REWIND_DEFAULT_BUDGET;
+    int rewind_interval = REWIND_DEFAULT_INTERVAL;
+    int run_ahead_frames = 0;
     const char* rom_file = NULL;
+    const char* capture_path = NULL;
+    const char* stems_path = NULL;
+    int ff_speed = FAST_FORWARD_DEFAULT_SPEED;
+    bool ff_mute = false;
+    int input_poll_us = INPUT_POLL_DEFAULT_US;
+    const char* opcode_profile_path = NULL;
 
     /* Parse command-line arguments */
     for (int i = 1; i < argc; i++) {
@@ -55,10 +534,91 @@ int main(int argc, char* argv[]) {
             vsync = true;
         } else if (strcmp(argv[i], "--no-vsync") == 0) {
             vsync = false;
+        } else if (strcmp(argv[i], "--audio-sync") == 0) {
+            audio_sync = true;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             verbose = true;
         } else if (strcmp(argv[i], "--profile") == 0) {
             profiling = true;
+        } else if (strcmp(argv[i], "--rewind-mb") == 0) {
+            if (i + 1 < argc) {
+                int mb = atoi(argv[++i]);
+                if (mb < 0) {
+                    fprintf(stderr, "Error: Rewind budget must not be negative\n");
+                    return 1;
+                }
+                rewind_budget = (size_t)mb * 1024u * 1024u;
+            } else {
+                fprintf(stderr, "Error: --rewind-mb requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--rewind-interval") == 0) {
+            if (i + 1 < argc) {
+                rewind_interval = atoi(argv[++i]);
+                if (rewind_interval <= 0) {
+                    fprintf(stderr, "Error: Rewind interval must be a positive integer\n");
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --rewind-interval requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--run-ahead") == 0) {
+            if (i + 1 < argc) {
+                run_ahead_frames = atoi(argv[++i]);
+                if (run_ahead_frames < 0 || run_ahead_frames > RUNAHEAD_MAX_FRAMES) {
+                    fprintf(stderr, "Error: Run-ahead must be between 0 and %d frames\n", RUNAHEAD_MAX_FRAMES);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --run-ahead requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--capture-audio") == 0) {
+            if (i + 1 < argc) {
+                capture_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --capture-audio requires a file name\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--capture-stems") == 0) {
+            if (i + 1 < argc) {
+                stems_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --capture-stems requires a file name\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ff-speed") == 0) {
+            if (i + 1 < argc) {
+                ff_speed = atoi(argv[++i]);
+                if (ff_speed < 0 || ff_speed == 1 || ff_speed > FAST_FORWARD_MAX_SPEED) {
+                    fprintf(stderr, "Error: Fast-forward speed must be 0 (uncapped) or 2-%d\n", FAST_FORWARD_MAX_SPEED);
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --ff-speed requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ff-mute") == 0) {
+            ff_mute = true;
+        } else if (strcmp(argv[i], "--input-poll-us") == 0) {
+            if (i + 1 < argc) {
+                input_poll_us = atoi(argv[++i]);
+                if (input_poll_us < 0) {
+                    fprintf(stderr, "Error: Input poll interval must not be negative\n");
+                    return 1;
+                }
+            } else {
+                fprintf(stderr, "Error: --input-poll-us requires a value\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--opcode-profile") == 0) {
+            if (i + 1 < argc) {
+                opcode_profile_path = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --opcode-profile requires a file name\n");
+                return 1;
+            }
         } else if (argv[i][0] == '-') {
             fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
             print_usage(argv[0]);
@@ -69,29 +629,35 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    /* Initialize error handling and profiling */
+    /* Initialize error handling */
     error_init();
-    profiler_init();
-    if (profiling) {
-        profiler_enable(true);
-        printf("Performance profiling enabled\n");
-    }
 
     /* No validation needed - GUI mode is default if no ROM specified */
 
-    GBEmulator gb;
-    gb_init(&gb);
+    Session* session = &s_session;
+    GBEmulator* gb = &session->gb;
+    session->verbose = verbose;
+    gb_init(gb);
+
+    if (profiling) {
+        profiler_enable(&gb->profiler, true);
+        printf("Performance profiling enabled\n");
+    }
+    if (opcode_profile_path) {
+        opcode_profile_init(&session->opcodes);
+        sm83_set_opcode_profile(&gb->cpu, &session->opcodes);
+    }
 
     /* Enable debug mode if verbose flag is set */
     if (verbose) {
-        gb_enable_debug(&gb);
+        gb_enable_debug(gb);
         printf("[DEBUG] Verbose mode enabled\n");
     }
 
     /* Load ROM if provided */
     bool rom_loaded = false;
     if (rom_file) {
-        if (!gb_load_rom(&gb, rom_file)) {
+        if (!gb_load_rom(gb, rom_file)) {
             printf("Failed to load ROM: %s\n", rom_file);
             return 1;
         }
@@ -101,13 +667,14 @@ int main(int argc, char* argv[]) {
         }
         
         /* Reset CPU to proper initial state after ROM load */
-        gb_reset(&gb);
+        gb_reset(gb);
+        load_battery_ram(gb, rom_file, verbose);
         
         if (verbose) {
             printf("[DEBUG] CPU reset - PC=0x%04X, AF=0x%04X, BC=0x%04X, DE=0x%04X, HL=0x%04X, SP=0x%04X\n",
-                   gb.cpu.pc, gb.cpu.af, gb.cpu.bc, gb.cpu.de, gb.cpu.hl, gb.cpu.sp);
-            printf("[DEBUG] LCDC=0x%02X (LCD %s)\n", gb.ppu.lcdc, 
-                   (gb.ppu.lcdc & 0x80) ? "enabled" : "disabled");
+                   gb->cpu.pc, gb->cpu.af, gb->cpu.bc, gb->cpu.de, gb->cpu.hl, gb->cpu.sp);
+            printf("[DEBUG] LCDC=0x%02X (LCD %s)\n", gb->ppu.lcdc, 
+                   (gb->ppu.lcdc & 0x80) ? "enabled" : "disabled");
         }
         
         /* Notify UI of ROM load for recent ROMs tracking */
@@ -119,7 +686,9 @@ int main(int argc, char* argv[]) {
         printf("Launching in GUI mode - use File > Open ROM to load a game\n");
     }
 
-    /* Initialize window with user-specified options. Requires SDL2 installed. */
+    /* Initialize window with user-specified options. Requires SDL2 installed.
+       Under audio pacing, waiting for vsync as well would fight the audio clock. */
+    vsync = vsync && !audio_sync;
     if (!window_init(scale, fullscreen, vsync)) {
         fprintf(stderr, "Failed to initialize window. Continuing without video.\n");
     }
@@ -128,17 +697,62 @@ int main(int argc, char* argv[]) {
     if (!audio_init()) {
         fprintf(stderr, "Failed to initialize audio. Continuing without sound.\n");
     }
+    if (audio_sync && !audio_set_paced(true)) {
+        fprintf(stderr, "Audio sync needs an audio device; running unpaced.\n");
+        audio_sync = false;
+    }
+    session->audio_sync = audio_sync;
+    session->ff_speed = ff_speed;
+    session->ff_mute = ff_mute;
+    session->input_poll_us = (uint32_t)input_poll_us;
+    session->present_interval_ns = 1000000000L / window_get_refresh_rate();
+    frame_pacer_init(&session->pacer, FRAME_RATE);
 
-    /* Main emulation loop with optimized timing */
     bool quit = false;
-    uint32_t frame_count = 0;
     
-    /* High-resolution timing for consistent frame rate */
-    struct timespec frame_start, frame_end, sleep_time;
-    const long target_frame_time_ns = 1000000000L / 60;  /* 60 FPS target */
+    /* With no ROM loaded, the menus are redrawn once per host refresh */
+    FramePacer menu_pacer;
+    frame_pacer_init(&menu_pacer, window_get_refresh_rate());
+    
+    /* Rewind history (disabled with --rewind-mb 0) */
+    session->rewind_enabled = rewind_budget > 0 &&
+                              rewind_init(&session->rewind, rewind_budget, (uint32_t)rewind_interval);
     
-    /* Initialize optimized CPU dispatch */
-    sm83_init_jump_tables();
+    /* Run-ahead (--run-ahead N); range already validated */
+    runahead_init(&session->run_ahead, run_ahead_frames);
+    
+    /* Audio capture (--capture-audio / --capture-stems), streamed off-thread */
+    if (capture_path) {
+        session->capturing = audio_capture_open(&session->capture, capture_path,
+                                                audio_capture_format_for_path(capture_path),
+                                                APU_OUTPUT_CHANNELS, SAMPLE_RATE);
+    }
+    if (stems_path) {
+        session->capturing_stems = apu_enable_stems(&gb->apu, true) &&
+                                   audio_capture_open(&session->stems_capture, stems_path,
+                                                      audio_capture_format_for_path(stems_path),
+                                                      APU_STEM_CHANNELS, SAMPLE_RATE);
+    }
+    if ((capture_path && !session->capturing) || (stems_path && !session->capturing_stems)) {
+        if (session->capturing) audio_capture_close(&session->capture);
+        if (session->capturing_stems) audio_capture_close(&session->stems_capture);
+        runahead_cleanup(&session->run_ahead);
+        if (session->rewind_enabled) rewind_cleanup(&session->rewind);
+        window_destroy();
+        gb_cleanup(gb);
+        return 1;
+    }
+    
+    /* Save states, screenshots and battery RAM are written off-thread */
+    if (!io_worker_start(&session->io)) {
+        if (session->capturing) audio_capture_close(&session->capture);
+        if (session->capturing_stems) audio_capture_close(&session->stems_capture);
+        runahead_cleanup(&session->run_ahead);
+        if (session->rewind_enabled) rewind_cleanup(&session->rewind);
+        window_destroy();
+        gb_cleanup(gb);
+        return 1;
+    }
     
     /* Create blank framebuffer for GUI-only mode - dark green/grey to match menu */
     uint32_t blank_framebuffer[160 * 144];
@@ -147,100 +761,55 @@ int main(int argc, char* argv[]) {
         blank_framebuffer[i] = bg_color;
     }
     
+    /* Last paused state and palette sent to the emulation thread (-1: not yet) */
+    int sent_paused = -1, sent_palette = -1;
+    if (rom_loaded && !session_start(session, rom_file)) quit = true;
+    
+    /* Presentation: a new frame is shown as soon as it is published; with
+       nothing new the menus are still redrawn about 60 times a second */
+    const double ui_refresh_ms = 1000.0 / 60.0;
+    struct timespec last_present;
+    clock_gettime(CLOCK_MONOTONIC, &last_present);
+    
     while (!quit) {
-        clock_gettime(CLOCK_MONOTONIC, &frame_start);
-        
         if (rom_loaded) {
-            /* Run emulation if ROM is loaded and not paused */
-            if (!ui_is_paused()) {
-                PROFILE_START(FRAME_RENDER);
-                gb_run_frame_optimized(&gb);
-                PROFILE_END(FRAME_RENDER);
-                
-                profiler_increment_frame_count();
-                profiler_update_metrics();
-
-                /* Handle frame completion: present PPU framebuffer to window */
-                if (gb.frame_complete) {
-                    frame_count++;
-                    if (verbose && (frame_count % 60 == 0)) {
-                        printf("[DEBUG] Frame %u - Cycles: %u, PC: 0x%04X, LY: %u, LCDC: 0x%02X\n",
-                               frame_count, gb.cycles, gb.cpu.pc, gb.ppu.ly, gb.ppu.lcdc);
-                    }
-                    /* Only present if LCD is currently enabled - avoids showing VRAM during tile uploads */
-                    if (gb.ppu.lcdc & 0x80) {  /* LCDC_DISPLAY_ENABLE */
-                        window_present(gb.ppu.framebuffer);
-                    }
-                    gb.frame_complete = false;
-                    
-                    /* Queue audio samples from APU buffer */
-                    float audio_samples[735];  /* SAMPLE_RATE / 60 */
-                    uint32_t sample_count = apu_get_samples(&gb.apu, audio_samples, sizeof(audio_samples) / sizeof(float));
-                    if (sample_count > 0) {
-                        audio_queue_samples(audio_samples, sample_count);
-                    }
-                }
-            } else {
-                /* When paused, keep displaying the last frame and handle UI events */
-                window_present(gb.ppu.framebuffer);
-                SDL_Delay(16);  /* ~60 FPS to keep UI responsive */
-            }
-            
-            /* Check if reset was requested */
-            if (window_get_reset_requested()) {
-                printf("Resetting emulator...\n");
-                gb_reset(&gb);
-                if (verbose) {
-                    printf("[DEBUG] Emulator reset\n");
-                }
-            }
+            session_forward_ui(session, &sent_paused, &sent_palette);
             
             /* Check if stop was requested */
             if (ui_get_stop_requested()) {
                 printf("Stopping emulation...\n");
-                gb_unload_rom(&gb);  /* Properly clean up ROM data */
+                session_stop(session);
+                ui_set_speed(0.0f);
+                flush_battery_ram(&session->io, gb, session->rom_path);
+                gb_unload_rom(gb);  /* Properly clean up ROM data */
+                if (session->rewind_enabled) rewind_clear(&session->rewind);
                 window_set_rom_loaded(false);
                 window_set_rom_path(NULL);  /* Clear ROM path */
                 rom_loaded = false;
                 if (verbose) {
                     printf("[DEBUG] Emulation stopped - returning to GUI mode\n");
                 }
+                continue;
             }
             
-            /* Check if save state was requested */
-            if (window_get_save_state_requested()) {
-                const char* rom_path = window_get_rom_path();
-                if (rom_path) {
-                    char save_path[2048];
-                    snprintf(save_path, sizeof(save_path), "%s.gbstate", rom_path);
-                    if (gb_save_state(&gb, save_path)) {
-                        printf("State saved successfully\n");
-                    } else {
-                        fprintf(stderr, "Failed to save state\n");
-                    }
-                } else {
-                    fprintf(stderr, "Cannot save state: no ROM loaded\n");
-                }
+            bool fresh;
+            const uint32_t* frame = triple_buffer_read(&session->frames, &fresh);
+            if (fresh || elapsed_ms(&last_present) >= ui_refresh_ms) {
+                window_present(frame ? frame : blank_framebuffer);
+                clock_gettime(CLOCK_MONOTONIC, &last_present);
+            } else {
+                SDL_Delay(1);
             }
             
-            /* Check if load state was requested */
-            if (window_get_load_state_requested()) {
-                const char* rom_path = window_get_rom_path();
-                if (rom_path) {
-                    char load_path[2048];
-                    snprintf(load_path, sizeof(load_path), "%s.gbstate", rom_path);
-                    if (gb_load_state(&gb, load_path)) {
-                        printf("State loaded successfully\n");
-                    } else {
-                        fprintf(stderr, "Failed to load state\n");
-                    }
-                } else {
-                    fprintf(stderr, "Cannot load state: no ROM loaded\n");
-                }
+            /* Report finished background writes */
+            IoResult io_result;
+            while (io_worker_poll(&session->io, &io_result)) {
+                report_io_result(&io_result, verbose);
             }
             
-            /* Poll window events and allow user to quit */
-            if (window_poll_events(&gb.memory)) quit = true;
+            /* Poll window events and allow user to quit; game input goes to
+               the emulation thread */
+            if (window_poll_events(&session->commands, &session->input)) quit = true;
         } else {
             /* GUI-only mode: just show blank screen and handle events */
             window_present(blank_framebuffer);
@@ -249,44 +818,73 @@ int main(int argc, char* argv[]) {
             const char* selected_rom = ui_get_selected_rom();
             if (selected_rom) {
                 printf("Loading ROM: %s\n", selected_rom);
-                if (gb_load_rom(&gb, selected_rom)) {
-                    gb_reset(&gb);
-                    ui_notify_rom_loaded(selected_rom);  /* Add to recent ROMs */
-                    window_set_rom_loaded(true);
-                    window_set_rom_path(selected_rom);  /* Track ROM path for save states */
-                    rom_loaded = true;
-                    if (verbose) {
-                        printf("[DEBUG] ROM loaded successfully\n");
+                if (gb_load_rom(gb, selected_rom)) {
+                    gb_reset(gb);
+                    load_battery_ram(gb, selected_rom, verbose);
+                    if (session->rewind_enabled) rewind_clear(&session->rewind);
+                    if (session_start(session, selected_rom)) {
+                        ui_notify_rom_loaded(selected_rom);  /* Add to recent ROMs */
+                        window_set_rom_loaded(true);
+                        window_set_rom_path(selected_rom);  /* Track ROM path for save states */
+                        rom_loaded = true;
+                        sent_paused = sent_palette = -1;
+                        if (verbose) {
+                            printf("[DEBUG] ROM loaded successfully\n");
+                        }
+                    } else {
+                        gb_unload_rom(gb);
                     }
                 } else {
                     fprintf(stderr, "Failed to load ROM: %s\n", selected_rom);
                 }
             }
             
-            /* Poll window events (pass NULL for memory since no ROM is loaded) */
-            if (window_poll_events(NULL)) quit = true;
-            
-            /* Precise timing control */
-            clock_gettime(CLOCK_MONOTONIC, &frame_end);
-            long elapsed_ns = (frame_end.tv_sec - frame_start.tv_sec) * 1000000000L + 
-                             (frame_end.tv_nsec - frame_start.tv_nsec);
+            /* Poll window events (nothing to send input to without a ROM) */
+            if (window_poll_events(NULL, NULL)) quit = true;
             
-            if (elapsed_ns < target_frame_time_ns) {
-                sleep_time.tv_sec = 0;
-                sleep_time.tv_nsec = target_frame_time_ns - elapsed_ns;
-                nanosleep(&sleep_time, NULL);
-            }
+            frame_pacer_wait(&menu_pacer);
         }
     }
+    
+    /* The emulator is this thread's again from here on */
+    session_stop(session);
 
     /* Print profiling report if enabled */
     if (profiling) {
         printf("\n=== Final Performance Report ===\n");
-        profiler_print_report();
-        profiler_print_memory_stats();
+        uint64_t underruns, overruns;
+        audio_get_stats(&underruns, &overruns);
+        profiler_set_audio_counters(&gb->profiler, underruns, overruns + gb->apu.output.buffer.dropped);
+        FramePacerStats pacing;
+        frame_pacer_stats(&session->pacer, &pacing);
+        profiler_set_frame_times(&gb->profiler, pacing.frames, pacing.p50_ns, pacing.p99_ns, pacing.max_ns);
+        profiler_print_report(&gb->profiler);
+        profiler_print_memory_stats(&gb->profiler);
+        printf("Frames published: %llu (%llu replaced before they were shown)\n",
+               (unsigned long long)triple_buffer_published(&session->frames),
+               (unsigned long long)triple_buffer_skipped(&session->frames));
+        if (session->input_events > 0) {
+            printf("Input latency: avg %.2f ms, max %.2f ms (%llu events)\n",
+                   session->input_latency_total_ns / 1e6 / session->input_events,
+                   session->input_latency_max_ns / 1e6,
+                   (unsigned long long)session->input_events);
+        }
+    }
+
+    if (opcode_profile_path) {
+        opcode_profile_print_report(&session->opcodes, stdout);
+        opcode_profile_export(&session->opcodes, opcode_profile_path);
     }
 
+    /* Finish pending writes (including a last battery RAM flush) before exit */
+    if (rom_loaded) flush_battery_ram(&session->io, gb, session->rom_path);
+    io_worker_stop(&session->io);
+    if (session->capturing) audio_capture_close(&session->capture);
+    if (session->capturing_stems) audio_capture_close(&session->stems_capture);
+    
+    if (session->rewind_enabled) rewind_cleanup(&session->rewind);
+    runahead_cleanup(&session->run_ahead);
     window_destroy();
-    gb_cleanup(&gb);
+    gb_cleanup(gb);
     return 0;
-}
\ No newline at end of file
+}
@@ -120,12 +120,11 @@ static void mbc3_write(Memory* mem, uint16_t addr, uint8_t value) {
     else if (addr < 0x8000) {
         /* Latch Clock Data */
         if (mbc->rtc_data) {
-            static uint8_t latch_state = 0;
-            if (latch_state == 0 && value == 0) latch_state = 1;
-            else if (latch_state == 1 && value == 1) {
+            if (mbc->rtc_latch_state == 0 && value == 0) mbc->rtc_latch_state = 1;
+            else if (mbc->rtc_latch_state == 1 && value == 1) {
                 RTC_Data* rtc = (RTC_Data*)mbc->rtc_data;
                 rtc_update(rtc);
-                latch_state = 0;
+                mbc->rtc_latch_state = 0;
             }
         }
     }
@@ -7,6 +7,20 @@
 #include <string.h>
 /* input.h not needed here; JOYP logic is implemented in this module */
 
+void memory_set_input_poll(Memory* mem, MemoryInputPoll poll, void* user, uint32_t interval_us) {
+    mem->input_poll = poll;
+    mem->input_poll_user = user;
+    mem->input_poll_interval_ns = (uint64_t)interval_us * 1000u;
+    mem->input_poll_last_ns = 0;
+}
+
+static void memory_poll_input(Memory* mem) {
+    uint64_t now = profiler_get_time_ns();
+    if (now - mem->input_poll_last_ns < mem->input_poll_interval_ns) return;
+    mem->input_poll_last_ns = now;
+    mem->input_poll(mem->input_poll_user);
+}
+
 /* Update JOYP register from internal input state (used by memory and input) */
 void memory_update_joyp(Memory* mem) {
     uint8_t reg = mem->io_registers[0x00] & 0xF0; /* keep upper bits */
@@ -85,26 +99,25 @@ void memory_init(Memory* mem) {
     /* Initialize timer state (DIV/TIMA) */
     memory_timer_init(mem);
 }
+void memory_release_rom(uint8_t* data, atomic_uint* refs) {
+    if (atomic_fetch_sub(refs, 1) == 1) {
+        free(data);
+        free(refs);
+    }
+}
+
+/* The ROM goes with the last user of it */
+static void mbc_state_free(MBC_State* mbc) {
+    memory_release_rom(mbc->rom_data, mbc->rom_refs);
+    free(mbc->ram_data);
+    free(mbc->rtc_data);
+    free(mbc->extra_data);
+    free(mbc);
+}
+
 void memory_cleanup(Memory* mem) {
     if (mem->mbc_data) {
-        MBC_State* mbc = (MBC_State*)mem->mbc_data;
-        
-        /* Additional safety checks to prevent corruption */
-        if (mbc != NULL) {
-            if (mbc->rom_data) {
-                free(mbc->rom_data);
-                mbc->rom_data = NULL;
-            }
-            if (mbc->ram_data) {
-                free(mbc->ram_data);
-                mbc->ram_data = NULL;
-            }
-            if (mbc->extra_data) {
-                free(mbc->extra_data);
-                mbc->extra_data = NULL;
-            }
-            free(mbc);
-        }
+        mbc_state_free((MBC_State*)mem->mbc_data);
         mem->mbc_data = NULL;
     }
     
@@ -282,6 +295,8 @@ uint8_t memory_read(Memory* mem, uint16_t addr) {
         uint8_t reg_addr = addr - 0xFF00;
         switch (reg_addr) {
             case 0x00: /* JOYP */
+                /* Sample the host's input now rather than at the frame boundary */
+                if (mem->input_poll) memory_poll_input(mem);
                 /* Update joypad state before read */
                 memory_update_joyp(mem);
                 /* Return current JOYP value */
@@ -405,7 +420,7 @@ void memory_write(Memory* mem, uint16_t addr, uint8_t value) {
     /* I/O Registers */
     if (addr < 0xFF80) {
         /* Debug output for important I/O writes */
-        if (addr >= 0xFF40 && addr <= 0xFF4B && gb_is_debug_enabled()) {
+        if (addr >= 0xFF40 && addr <= 0xFF4B && gb_is_debug_enabled(mem)) {
             printf("[MEM] I/O Write: 0x%04X = 0x%02X\n", addr, value);
         }
         
@@ -572,29 +587,50 @@ void memory_dma_transfer(Memory* mem, uint8_t start) {
 }
 
 /* ROM loading and MBC setup */
+static bool load_rom_image(Memory* mem, const uint8_t* data, size_t size, atomic_uint* shared_refs);
+
 bool memory_load_rom(Memory* mem, const char* filename) {
     FILE* file = fopen(filename, "rb");
     if (!file) return false;
 
-    /* Clean up any existing ROM data first */
-    if (mem->mbc_data) {
-        MBC_State* old_mbc = (MBC_State*)mem->mbc_data;
-        if (old_mbc->rom_data) free(old_mbc->rom_data);
-        if (old_mbc->ram_data) free(old_mbc->ram_data);
-        if (old_mbc->extra_data) free(old_mbc->extra_data);
-        free(old_mbc);
-        mem->mbc_data = NULL;
+    /* Read the whole image; memory_load_rom_data() checks it against the header */
+    uint8_t* data = NULL;
+    long file_size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) file_size = ftell(file);
+    if (file_size > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = malloc((size_t)file_size);
+        if (data && fread(data, 1, (size_t)file_size, file) != (size_t)file_size) {
+            free(data);
+            data = NULL;
+        }
     }
+    fclose(file);
+    if (!data) return false;
+
+    bool loaded = memory_load_rom_data(mem, data, (size_t)file_size);
+    free(data);
+    return loaded;
+}
+
+bool memory_load_rom_data(Memory* mem, const uint8_t* data, size_t size) {
+    return load_rom_image(mem, data, size, NULL);
+}
 
+bool memory_load_rom_shared(Memory* mem, uint8_t* data, size_t size, atomic_uint* refs) {
+    return load_rom_image(mem, data, size, refs);
+}
+
+/* Maps a cartridge image: copied with a count of its own, or, given
+   shared_refs, the caller's image with a reference taken on it */
+static bool load_rom_image(Memory* mem, const uint8_t* data, size_t size, atomic_uint* shared_refs) {
+    bool shared = shared_refs != NULL;
     /* Read ROM header */
-    uint8_t header[0x150];
-    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
-        fclose(file);
-        return false;
-    }
+    if (size < 0x150) return false;
+    const uint8_t* header = data;
 
     /* Get ROM size */
     size_t rom_size = 32768 << header[0x148];  /* ROM size from header */
+    if (header[0x148] > 8 || size < rom_size) return false;
     
     /* Get RAM size */
     size_t ram_size = 0;
@@ -606,24 +642,40 @@ bool memory_load_rom(Memory* mem, const char* filename) {
     }
 
     /* Determine MBC type */
+    MBC_Type mbc_type;
     switch (header[0x147]) {
         case 0x01:
         case 0x02:
         case 0x03:
-            mem->mbc_type = MBC1;
+            mbc_type = MBC1;
             break;
         case 0x00:
-            mem->mbc_type = ROM_ONLY;
+            mbc_type = ROM_ONLY;
             break;
         default:
-            fclose(file);
             return false;  /* Unsupported MBC type */
     }
 
     /* Allocate ROM and RAM */
-    MBC_State* mbc = malloc(sizeof(MBC_State));
-    mbc->rom_data = malloc(rom_size);
-    mbc->ram_data = ram_size > 0 ? malloc(ram_size) : NULL;
+    MBC_State* mbc = calloc(1, sizeof(MBC_State));
+    if (!mbc) return false;
+    mbc->rom_data = shared ? (uint8_t*)data : malloc(rom_size);
+    mbc->rom_refs = shared ? shared_refs : malloc(sizeof(atomic_uint));
+    mbc->ram_data = ram_size > 0 ? calloc(1, ram_size) : NULL;   /* Same RAM on every load */
+    if (!mbc->rom_data || (!shared && !mbc->rom_refs) || (ram_size > 0 && !mbc->ram_data)) {
+        if (!shared) {
+            free(mbc->rom_data);
+            free(mbc->rom_refs);
+        }
+        free(mbc->ram_data);
+        free(mbc);
+        return false;
+    }
+    if (shared) {
+        atomic_fetch_add(mbc->rom_refs, 1);
+    } else {
+        atomic_init(mbc->rom_refs, 1);
+    }
     mbc->rom_size = rom_size;
     mbc->ram_size = ram_size;
     mbc->rom_bank_count = rom_size / ROM_BANK_SIZE;
@@ -633,20 +685,13 @@ bool memory_load_rom(Memory* mem, const char* filename) {
     mbc->ram_enabled = false;
     mbc->rom_banking_enabled = true;
     mbc->banking_mode = 0;
+    if (!shared) memcpy(mbc->rom_data, data, rom_size);
 
-    /* Read ROM data */
-    fseek(file, 0, SEEK_SET);
-    if (fread(mbc->rom_data, 1, rom_size, file) != rom_size) {
-        free(mbc->rom_data);
-        if (mbc->ram_data) free(mbc->ram_data);
-        free(mbc);
-        fclose(file);
-        return false;
-    }
-
-    fclose(file);
+    /* Only now drop the old ROM, so a failed load leaves it mapped */
+    if (mem->mbc_data) mbc_state_free((MBC_State*)mem->mbc_data);
 
     /* Set up memory mapping */
+    mem->mbc_type = mbc_type;
     mem->mbc_data = mbc;
     mem->rom_bank0 = mbc->rom_data;
     mem->rom_bankn = mbc->rom_data + ROM_BANK_SIZE;
@@ -655,6 +700,60 @@ bool memory_load_rom(Memory* mem, const char* filename) {
     return true;
 }
 
+bool memory_clone(Memory* dst, const Memory* src) {
+    const MBC_State* src_mbc = (const MBC_State*)src->mbc_data;
+    MBC_State* mbc = NULL;
+    if (src_mbc) {
+        /* No loadable cartridge has extra MBC data; refuse rather than alias it */
+        if (src_mbc->extra_data) return false;
+
+        mbc = malloc(sizeof(MBC_State));
+        if (!mbc) return false;
+        *mbc = *src_mbc;
+        mbc->ram_data = src_mbc->ram_size ? malloc(src_mbc->ram_size) : NULL;
+        mbc->rtc_data = src_mbc->rtc_data ? malloc(sizeof(RTC_Data)) : NULL;
+        if ((src_mbc->ram_size && !mbc->ram_data) || (src_mbc->rtc_data && !mbc->rtc_data)) {
+            free(mbc->ram_data);
+            free(mbc->rtc_data);
+            free(mbc);
+            return false;
+        }
+        if (mbc->ram_data) memcpy(mbc->ram_data, src_mbc->ram_data, src_mbc->ram_size);
+        if (mbc->rtc_data) *mbc->rtc_data = *src_mbc->rtc_data;
+        atomic_fetch_add(mbc->rom_refs, 1);
+    }
+
+    memcpy(dst->vram, src->vram, VRAM_SIZE);
+    memcpy(dst->wram, src->wram, WRAM_SIZE);
+    memcpy(dst->oam, src->oam, OAM_SIZE);
+    memcpy(dst->hram, src->hram, HRAM_SIZE);
+    memcpy(dst->io_registers, src->io_registers, sizeof(dst->io_registers));
+    dst->ie_register = src->ie_register;
+    dst->joypad_state_buttons = src->joypad_state_buttons;
+    dst->joypad_state_dirs = src->joypad_state_dirs;
+    dst->div_internal = src->div_internal;
+    dst->div = src->div;
+    dst->tima = src->tima;
+    dst->tma = src->tma;
+    dst->tac = src->tac;
+    dst->timer_enabled = src->timer_enabled;
+    dst->tima_reload_delay = src->tima_reload_delay;
+    dst->tima_reload_pending = src->tima_reload_pending;
+    dst->last_timer_bit = src->last_timer_bit;
+    dst->mbc_type = src->mbc_type;
+    dst->current_rom_bank = src->current_rom_bank;
+    dst->current_ram_bank = src->current_ram_bank;
+    dst->ram_enabled = src->ram_enabled;
+    dst->rom_banking_enabled = src->rom_banking_enabled;
+
+    /* Same mapping, rebased onto the copy */
+    dst->mbc_data = mbc;
+    dst->rom_bank0 = src->rom_bank0;
+    dst->rom_bankn = src->rom_bankn;
+    dst->ext_ram = mbc && src->ext_ram ? mbc->ram_data + (src->ext_ram - src_mbc->ram_data) : NULL;
+    return true;
+}
+
 void memory_setup_banking(Memory* mem, MBC_Type type) {
     mem->mbc_type = type;
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <stdatomic.h>
 
 /* Forward declaration - PPU is defined in ppu.h */
 /* We can't include ppu.h here due to circular dependency, so use void* and cast */
@@ -78,6 +79,18 @@ typedef struct {
     time_t last_time;   /* Last update time */
 } RTC_Data;
 
+/* Memory statistics for profiling (memory_optimized.h) */
+typedef struct {
+    uint64_t read_count;
+    uint64_t write_count;
+    uint64_t rom_accesses;
+    uint64_t ram_accesses;
+    uint64_t vram_accesses;
+} MemoryStats;
+
+/* Host input callback for memory_set_input_poll() */
+typedef void (*MemoryInputPoll)(void* user);
+
 typedef struct Memory {
     /* Memory regions */
     uint8_t* rom_bank0;     /* 16KB ROM bank #0 */
@@ -114,17 +127,36 @@ typedef struct Memory {
     uint8_t current_ram_bank;
     bool ram_enabled;
     bool rom_banking_enabled;
+
+    /* CGB speed switching (memory_cgb.c) */
+    Speed_Mode current_speed;
+    bool speed_switch_pending;
+    uint32_t switch_delay_cycles;
     
     /* Back-reference to PPU for VRAM/OAM access restrictions (void* to avoid circular dependency) */
     void* ppu;
     /* Back-reference to APU for audio register access (void* to avoid circular dependency) */
     void* apu;
+    /* Block access counters, kept while stats_enabled */
+    MemoryStats stats;
+    bool stats_enabled;
+
+    /* Owning GBEmulator while its debug mode is on, else NULL (void* to avoid circular dependency) */
+    void* debug_gb;
+
+    /* Just-in-time input (memory_set_input_poll); not part of the state */
+    MemoryInputPoll input_poll;
+    void* input_poll_user;
+    uint64_t input_poll_interval_ns;
+    uint64_t input_poll_last_ns;
 } Memory;
 
 /* MBC state structure (used by MBC handlers)
    Defined here so MBC implementation files can access the concrete state */
 typedef struct {
     uint8_t* rom_data;          /* Full ROM data */
+    atomic_uint* rom_refs;      /* Users of rom_data (clones and memory_load_rom_shared
+                                   callers share it); the last one frees both */
     uint8_t* ram_data;          /* Full RAM data */
     size_t rom_size;            /* Total ROM size */
     size_t ram_size;            /* Total RAM size */
@@ -140,6 +172,7 @@ typedef struct {
     uint8_t banking_mode;       /* Current banking mode */
     /* Optional pointer to RTC data for MBC3 carts (allocated when needed) */
     RTC_Data* rtc_data;
+    uint8_t rtc_latch_state;    /* 1 after a 0 write to 6000-7FFF; a 1 then latches */
     /* Optional pointer for MBC-specific extra data (e.g. MBC7, Pocket Camera) */
     void* extra_data;
     /* Fields used by some extended MBCs (MMM01/MBC variants) */
@@ -147,21 +180,27 @@ typedef struct {
     uint8_t rom_bank_mask;
 } MBC_State;
 
-/* Save state structure version for compatibility */
-#define SAVE_STATE_VERSION 1
+/* In-memory snapshot layout version (see memory_snapshot_save) */
+#define MEMORY_SNAPSHOT_VERSION 1
 
-/* Persistent save state layout used by save/load functions.
-   The flexible array member at the end holds RAM contents when present. */
+/* Fixed-size header written by memory_snapshot_save().
+   Cartridge RAM (ram_size bytes) immediately follows the header. */
 typedef struct {
     uint32_t version;
-    MBC_Type mbc_type;
-    size_t rom_size;
-    size_t ram_size;
-    uint8_t current_rom_bank;
-    uint8_t current_ram_bank;
-    bool ram_enabled;
-    bool rom_banking_enabled;
-    uint8_t banking_mode;
+    uint32_t mbc_type;
+    uint32_t ram_size;
+    /* MBC controller state */
+    uint8_t mbc_rom_bank;
+    uint8_t mbc_ram_bank;
+    uint8_t mbc_rom_bank2;
+    uint8_t mbc_ram_bank2;
+    uint8_t mbc_base_rom_bank;
+    uint8_t mbc_rom_bank_mask;
+    uint8_t mbc_banking_mode;
+    bool mbc_ram_enabled;
+    bool mbc_rom_banking_enabled;
+    bool has_rtc;
+    RTC_Data rtc;
     /* Memory regions */
     uint8_t vram[0x2000];
     uint8_t wram[0x2000];
@@ -169,11 +208,25 @@ typedef struct {
     uint8_t hram[0x7F];
     uint8_t io_registers[0x80];
     uint8_t ie_register;
-    /* RTC data if present */
-    RTC_Data rtc;
-    /* RAM data follows */
-    uint8_t ram_data[];
-} SaveState;
+    /* Joypad */
+    uint8_t joypad_state_buttons;
+    uint8_t joypad_state_dirs;
+    /* Timer */
+    uint16_t div_internal;
+    uint8_t div;
+    uint8_t tima;
+    uint8_t tma;
+    uint8_t tac;
+    bool timer_enabled;
+    uint8_t tima_reload_delay;
+    bool tima_reload_pending;
+    uint8_t last_timer_bit;
+    /* Banking as seen by the Memory struct */
+    uint8_t current_rom_bank;
+    uint8_t current_ram_bank;
+    bool ram_enabled;
+    bool rom_banking_enabled;
+} MemorySnapshot;
 
 /* MBC1 function prototypes (used by other MBC implementation files) */
 uint8_t mbc1_read(Memory* mem, uint16_t addr);
@@ -197,14 +250,32 @@ void memory_switch_ram_bank(Memory* mem, uint8_t bank);
 
 /* ROM/RAM loading */
 bool memory_load_rom(Memory* mem, const char* filename);
+/* Same from an image in memory (copied; size may exceed the header's ROM size) */
+bool memory_load_rom_data(Memory* mem, const uint8_t* data, size_t size);
+/* Maps a malloc'd image without copying, so instances running the same ROM
+   share one. refs counts its users: the mapping takes a reference, and
+   whoever drops the last one (memory_release_rom()) frees data and refs */
+bool memory_load_rom_shared(Memory* mem, uint8_t* data, size_t size, atomic_uint* refs);
+/* Drops one reference to a shared ROM image */
+void memory_release_rom(uint8_t* data, atomic_uint* refs);
+
+/* Make dst, fresh from memory_init(), a copy of src: RAM, registers and
+   cartridge state are copied, the ROM image is shared. False if out of
+   memory. */
+bool memory_clone(Memory* dst, const Memory* src);
 void memory_setup_banking(Memory* mem, MBC_Type type);
 
-/* Save/Load state */
-bool memory_save_state(Memory* mem, const char* filename);
-bool memory_load_state(Memory* mem, const char* filename);
+/* Battery RAM */
 bool memory_save_ram(Memory* mem, const char* filename);
 bool memory_load_ram(Memory* mem, const char* filename);
 
+/* In-memory snapshots: serialize into a caller-provided buffer without
+   allocating. The buffer must hold memory_snapshot_size() bytes and be
+   aligned like a malloc() result. */
+size_t memory_snapshot_size(const Memory* mem);
+size_t memory_snapshot_save(const Memory* mem, void* buf);
+bool memory_snapshot_load(Memory* mem, const void* buf);
+
 /* Memory timing */
 uint8_t memory_read_timed(Memory* mem, uint16_t addr, uint32_t* cycles);
 void memory_write_timed(Memory* mem, uint16_t addr, uint8_t value, uint32_t* cycles);
@@ -214,15 +285,18 @@ void memory_timer_init(Memory* mem);
 void memory_timer_step(Memory* mem, uint32_t cycles);
 /* Update JOYP register from internal input state */
 void memory_update_joyp(Memory* mem);
+/* Just-in-time input: when the guest reads JOYP, call poll(user) first so
+   the host can apply input that arrived since the frame began (through
+   input_press()/input_release()). Called at most once per interval_us of
+   host time, 0 for every read; NULL turns it off. Clones do not inherit it. */
+void memory_set_input_poll(Memory* mem, MemoryInputPoll poll, void* user, uint32_t interval_us);
 /* CGB specific functions */
 void memory_init_cgb(Memory* mem);
 void memory_handle_speed_switch(Memory* mem);
 void memory_request_speed_switch(Memory* mem);
 Speed_Mode memory_get_current_speed(Memory* mem);
 
-/* Compressed state and RAM save functions */
-bool memory_save_state_compressed(Memory* mem, const char* filename);
-bool memory_load_state_compressed(Memory* mem, const char* filename);
+/* Compressed RAM save functions */
 bool memory_save_ram_compressed(Memory* mem, const char* filename);
 bool memory_load_ram_compressed(Memory* mem, const char* filename);
 
@@ -2,18 +2,14 @@
 #include <string.h>
 #include <stdio.h>
 
-/* Global memory profiling statistics */
-MemoryStats g_memory_stats = {0};
-static bool g_profiling_enabled = false;
-
 /* Batch memory operations */
 void memory_read_block(Memory* mem, uint16_t addr, uint8_t* buffer, size_t size) {
     for (size_t i = 0; i < size; i++) {
         buffer[i] = memory_read_fast(mem, addr + i);
     }
     
-    if (g_profiling_enabled) {
-        g_memory_stats.read_count += size;
+    if (mem->stats_enabled) {
+        mem->stats.read_count += size;
     }
 }
 
@@ -22,35 +18,36 @@ void memory_write_block(Memory* mem, uint16_t addr, const uint8_t* buffer, size_
         memory_write_fast(mem, addr + i, buffer[i]);
     }
     
-    if (g_profiling_enabled) {
-        g_memory_stats.write_count += size;
+    if (mem->stats_enabled) {
+        mem->stats.write_count += size;
     }
 }
 
 /* Memory profiling functions */
-void memory_profiling_enable(bool enable) {
-    g_profiling_enabled = enable;
+void memory_profiling_enable(Memory* mem, bool enable) {
+    mem->stats_enabled = enable;
 }
 
-void memory_profiling_reset(void) {
-    memset(&g_memory_stats, 0, sizeof(g_memory_stats));
+void memory_profiling_reset(Memory* mem) {
+    memset(&mem->stats, 0, sizeof(mem->stats));
 }
 
-void memory_profiling_report(void) {
-    if (!g_profiling_enabled) return;
+void memory_profiling_report(const Memory* mem) {
+    if (!mem->stats_enabled) return;
+    const MemoryStats* stats = &mem->stats;
     
     printf("Memory Access Statistics:\n");
-    printf("  Total reads:  %llu\n", (unsigned long long)g_memory_stats.read_count);
-    printf("  Total writes: %llu\n", (unsigned long long)g_memory_stats.write_count);
+    printf("  Total reads:  %llu\n", (unsigned long long)stats->read_count);
+    printf("  Total writes: %llu\n", (unsigned long long)stats->write_count);
     printf("  ROM accesses: %llu (%.1f%%)\n", 
-           (unsigned long long)g_memory_stats.rom_accesses,
-           100.0 * g_memory_stats.rom_accesses / (g_memory_stats.read_count + 1));
+           (unsigned long long)stats->rom_accesses,
+           100.0 * stats->rom_accesses / (stats->read_count + 1));
     printf("  RAM accesses: %llu (%.1f%%)\n", 
-           (unsigned long long)g_memory_stats.ram_accesses,
-           100.0 * g_memory_stats.ram_accesses / (g_memory_stats.read_count + 1));
+           (unsigned long long)stats->ram_accesses,
+           100.0 * stats->ram_accesses / (stats->read_count + 1));
     printf("  VRAM accesses: %llu (%.1f%%)\n", 
-           (unsigned long long)g_memory_stats.vram_accesses,
-           100.0 * g_memory_stats.vram_accesses / (g_memory_stats.read_count + 1));
+           (unsigned long long)stats->vram_accesses,
+           100.0 * stats->vram_accesses / (stats->read_count + 1));
 }
 
 /* Optimized DMA transfer with reduced overhead */
@@ -80,7 +77,7 @@ void memory_dma_transfer_optimized(Memory* mem, uint8_t start) {
         memory_copy_block(mem->oam, &mem->wram[src_addr - 0xC000], 0xA0);
     }
     
-    if (g_profiling_enabled) {
-        g_memory_stats.write_count += 0xA0;
+    if (mem->stats_enabled) {
+        mem->stats.write_count += 0xA0;
     }
 }
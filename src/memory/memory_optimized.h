@@ -149,20 +149,9 @@ static inline uint8_t memory_read_sequential(Memory* mem, uint16_t addr) {
 void memory_read_block(Memory* mem, uint16_t addr, uint8_t* buffer, size_t size);
 void memory_write_block(Memory* mem, uint16_t addr, const uint8_t* buffer, size_t size);
 
-/* Memory statistics for profiling */
-typedef struct {
-    uint64_t read_count;
-    uint64_t write_count;
-    uint64_t rom_accesses;
-    uint64_t ram_accesses;
-    uint64_t vram_accesses;
-} MemoryStats;
-
-extern MemoryStats g_memory_stats;
-
-/* Enable/disable memory profiling */
-void memory_profiling_enable(bool enable);
-void memory_profiling_reset(void);
-void memory_profiling_report(void);
+/* Enable/disable memory profiling (counts land in mem->stats) */
+void memory_profiling_enable(Memory* mem, bool enable);
+void memory_profiling_reset(Memory* mem);
+void memory_profiling_report(const Memory* mem);
 
 #endif /* MEMORY_OPTIMIZED_H */
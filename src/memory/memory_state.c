@@ -2,112 +2,6 @@
 #include <time.h>
 #include <stdio.h>
 
-/* SaveState is defined in memory.h so other modules can access it */
-
-bool memory_save_state(Memory* mem, const char* filename) {
-    FILE* file = fopen(filename, "wb");
-    if (!file) return false;
-    
-    MBC_State* mbc = (MBC_State*)mem->mbc_data;
-    size_t state_size = sizeof(SaveState) + (mbc ? mbc->ram_size : 0);
-    SaveState* state = malloc(state_size);
-    
-    /* Fill state data */
-    state->version = SAVE_STATE_VERSION;
-    state->mbc_type = mem->mbc_type;
-    if (mbc) {
-        state->rom_size = mbc->rom_size;
-        state->ram_size = mbc->ram_size;
-        state->current_rom_bank = mbc->current_rom_bank;
-        state->current_ram_bank = mbc->current_ram_bank;
-        state->ram_enabled = mbc->ram_enabled;
-        state->rom_banking_enabled = mbc->rom_banking_enabled;
-        state->banking_mode = mbc->banking_mode;
-        
-        if (mbc->rtc_data) {
-            memcpy(&state->rtc, mbc->rtc_data, sizeof(RTC_Data));
-        }
-        
-        if (mbc->ram_data) {
-            memcpy(state->ram_data, mbc->ram_data, mbc->ram_size);
-        }
-    }
-    
-    /* Copy memory regions */
-    memcpy(state->vram, mem->vram, sizeof(state->vram));
-    memcpy(state->wram, mem->wram, sizeof(state->wram));
-    memcpy(state->oam, mem->oam, sizeof(state->oam));
-    memcpy(state->hram, mem->hram, sizeof(state->hram));
-    memcpy(state->io_registers, mem->io_registers, sizeof(state->io_registers));
-    state->ie_register = mem->ie_register;
-    
-    /* Write state to file */
-    size_t written = fwrite(state, 1, state_size, file);
-    free(state);
-    fclose(file);
-    
-    return written == state_size;
-}
-
-bool memory_load_state(Memory* mem, const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) return false;
-    
-    /* Read header first to get sizes */
-    SaveState header;
-    if (fread(&header, 1, sizeof(header), file) != sizeof(header)) {
-        fclose(file);
-        return false;
-    }
-    
-    /* Verify version compatibility */
-    if (header.version != SAVE_STATE_VERSION) {
-        fclose(file);
-        return false;
-    }
-    
-    /* Rewind and read full state */
-    fseek(file, 0, SEEK_SET);
-    size_t state_size = sizeof(SaveState) + header.ram_size;
-    SaveState* state = malloc(state_size);
-    
-    if (fread(state, 1, state_size, file) != state_size) {
-        free(state);
-        fclose(file);
-        return false;
-    }
-    fclose(file);
-    
-    /* Restore MBC state */
-    if (mem->mbc_data) {
-        MBC_State* mbc = (MBC_State*)mem->mbc_data;
-        mbc->current_rom_bank = state->current_rom_bank;
-        mbc->current_ram_bank = state->current_ram_bank;
-        mbc->ram_enabled = state->ram_enabled;
-        mbc->rom_banking_enabled = state->rom_banking_enabled;
-        mbc->banking_mode = state->banking_mode;
-        
-        if (mbc->rtc_data) {
-            memcpy(mbc->rtc_data, &state->rtc, sizeof(RTC_Data));
-        }
-        
-        if (mbc->ram_data && header.ram_size == mbc->ram_size) {
-            memcpy(mbc->ram_data, state->ram_data, mbc->ram_size);
-        }
-    }
-    
-    /* Restore memory regions */
-    memcpy(mem->vram, state->vram, sizeof(state->vram));
-    memcpy(mem->wram, state->wram, sizeof(state->wram));
-    memcpy(mem->oam, state->oam, sizeof(state->oam));
-    memcpy(mem->hram, state->hram, sizeof(state->hram));
-    memcpy(mem->io_registers, state->io_registers, sizeof(state->io_registers));
-    mem->ie_register = state->ie_register;
-    
-    free(state);
-    return true;
-}
-
 bool memory_save_ram(Memory* mem, const char* filename) {
     if (!mem->mbc_data) return false;
     
@@ -138,6 +32,131 @@ bool memory_load_ram(Memory* mem, const char* filename) {
     return read == mbc->ram_size;
 }
 
+/* Cartridge RAM size of the loaded ROM (0 when none) */
+static size_t memory_cart_ram_size(const Memory* mem) {
+    const MBC_State* mbc = (const MBC_State*)mem->mbc_data;
+    return (mbc && mbc->ram_data) ? mbc->ram_size : 0;
+}
+
+size_t memory_snapshot_size(const Memory* mem) {
+    return sizeof(MemorySnapshot) + memory_cart_ram_size(mem);
+}
+
+size_t memory_snapshot_save(const Memory* mem, void* buf) {
+    MemorySnapshot* snap = (MemorySnapshot*)buf;
+    const MBC_State* mbc = (const MBC_State*)mem->mbc_data;
+    size_t ram_size = memory_cart_ram_size(mem);
+
+    memset(snap, 0, sizeof(*snap));
+    snap->version = MEMORY_SNAPSHOT_VERSION;
+    snap->mbc_type = (uint32_t)mem->mbc_type;
+    snap->ram_size = (uint32_t)ram_size;
+
+    if (mbc) {
+        snap->mbc_rom_bank = mbc->current_rom_bank;
+        snap->mbc_ram_bank = mbc->current_ram_bank;
+        snap->mbc_rom_bank2 = mbc->current_rom_bank2;
+        snap->mbc_ram_bank2 = mbc->current_ram_bank2;
+        snap->mbc_base_rom_bank = mbc->base_rom_bank;
+        snap->mbc_rom_bank_mask = mbc->rom_bank_mask;
+        snap->mbc_banking_mode = mbc->banking_mode;
+        snap->mbc_ram_enabled = mbc->ram_enabled;
+        snap->mbc_rom_banking_enabled = mbc->rom_banking_enabled;
+        if (mbc->rtc_data) {
+            snap->has_rtc = true;
+            memcpy(&snap->rtc, mbc->rtc_data, sizeof(RTC_Data));
+        }
+    }
+
+    memcpy(snap->vram, mem->vram, sizeof(snap->vram));
+    memcpy(snap->wram, mem->wram, sizeof(snap->wram));
+    memcpy(snap->oam, mem->oam, sizeof(snap->oam));
+    memcpy(snap->hram, mem->hram, sizeof(snap->hram));
+    memcpy(snap->io_registers, mem->io_registers, sizeof(snap->io_registers));
+    snap->ie_register = mem->ie_register;
+
+    snap->joypad_state_buttons = mem->joypad_state_buttons;
+    snap->joypad_state_dirs = mem->joypad_state_dirs;
+
+    snap->div_internal = mem->div_internal;
+    snap->div = mem->div;
+    snap->tima = mem->tima;
+    snap->tma = mem->tma;
+    snap->tac = mem->tac;
+    snap->timer_enabled = mem->timer_enabled;
+    snap->tima_reload_delay = mem->tima_reload_delay;
+    snap->tima_reload_pending = mem->tima_reload_pending;
+    snap->last_timer_bit = mem->last_timer_bit;
+
+    snap->current_rom_bank = mem->current_rom_bank;
+    snap->current_ram_bank = mem->current_ram_bank;
+    snap->ram_enabled = mem->ram_enabled;
+    snap->rom_banking_enabled = mem->rom_banking_enabled;
+
+    if (ram_size) {
+        memcpy((uint8_t*)buf + sizeof(MemorySnapshot), mbc->ram_data, ram_size);
+    }
+
+    return sizeof(MemorySnapshot) + ram_size;
+}
+
+bool memory_snapshot_load(Memory* mem, const void* buf) {
+    const MemorySnapshot* snap = (const MemorySnapshot*)buf;
+    MBC_State* mbc = (MBC_State*)mem->mbc_data;
+
+    /* Snapshots only apply to the cartridge they were taken from */
+    if (snap->version != MEMORY_SNAPSHOT_VERSION ||
+        snap->mbc_type != (uint32_t)mem->mbc_type ||
+        snap->ram_size != memory_cart_ram_size(mem)) {
+        return false;
+    }
+
+    if (mbc) {
+        mbc->current_rom_bank = snap->mbc_rom_bank;
+        mbc->current_ram_bank = snap->mbc_ram_bank;
+        mbc->current_rom_bank2 = snap->mbc_rom_bank2;
+        mbc->current_ram_bank2 = snap->mbc_ram_bank2;
+        mbc->base_rom_bank = snap->mbc_base_rom_bank;
+        mbc->rom_bank_mask = snap->mbc_rom_bank_mask;
+        mbc->banking_mode = snap->mbc_banking_mode;
+        mbc->ram_enabled = snap->mbc_ram_enabled;
+        mbc->rom_banking_enabled = snap->mbc_rom_banking_enabled;
+        if (mbc->rtc_data && snap->has_rtc) {
+            memcpy(mbc->rtc_data, &snap->rtc, sizeof(RTC_Data));
+        }
+        if (snap->ram_size) {
+            memcpy(mbc->ram_data, (const uint8_t*)buf + sizeof(MemorySnapshot), snap->ram_size);
+        }
+    }
+
+    memcpy(mem->vram, snap->vram, sizeof(snap->vram));
+    memcpy(mem->wram, snap->wram, sizeof(snap->wram));
+    memcpy(mem->oam, snap->oam, sizeof(snap->oam));
+    memcpy(mem->hram, snap->hram, sizeof(snap->hram));
+    memcpy(mem->io_registers, snap->io_registers, sizeof(snap->io_registers));
+    mem->ie_register = snap->ie_register;
+
+    mem->joypad_state_buttons = snap->joypad_state_buttons;
+    mem->joypad_state_dirs = snap->joypad_state_dirs;
+
+    mem->div_internal = snap->div_internal;
+    mem->div = snap->div;
+    mem->tima = snap->tima;
+    mem->tma = snap->tma;
+    mem->tac = snap->tac;
+    mem->timer_enabled = snap->timer_enabled;
+    mem->tima_reload_delay = snap->tima_reload_delay;
+    mem->tima_reload_pending = snap->tima_reload_pending;
+    mem->last_timer_bit = snap->last_timer_bit;
+
+    mem->current_rom_bank = snap->current_rom_bank;
+    mem->current_ram_bank = snap->current_ram_bank;
+    mem->ram_enabled = snap->ram_enabled;
+    mem->rom_banking_enabled = snap->rom_banking_enabled;
+
+    return true;
+}
+
 /* Memory timing implementation */
 uint8_t memory_read_timed(Memory* mem, uint16_t addr, uint32_t* cycles) {
     uint8_t value;
@@ -2,7 +2,7 @@
 #include "../memory/memory.h"
 #include "ppu_vram.h"
 #include "../gbendo.h"
-#include "../ui/ui.h"
+#include "../ui/ui_debug.h"
 #include <stdio.h>  /* For printf debug */
 
 /* PPU timing constants */
@@ -58,12 +58,9 @@ static const char* PALETTE_NAMES[] = {
     "Game Boy Light"
 };
 
-/* Current palette selection */
-static int current_palette_index = 0;
-
-/* Get the currently active palette */
-static const uint32_t* get_active_palette(void) {
-    switch (current_palette_index) {
+/* Get the palette selected for this PPU */
+static const uint32_t* get_active_palette(const PPU* ppu) {
+    switch (ppu->dmg_palette) {
         case 0: return PALETTE_AUTHENTIC;
         case 1: return PALETTE_GRAY;
         case 2: return PALETTE_BGB;
@@ -74,14 +71,14 @@ static const uint32_t* get_active_palette(void) {
 }
 
 /* Palette management functions */
-void ppu_set_palette(int palette_index) {
+void ppu_set_palette(PPU* ppu, int palette_index) {
     if (palette_index >= 0 && palette_index < 5) {
-        current_palette_index = palette_index;
+        ppu->dmg_palette = (uint8_t)palette_index;
     }
 }
 
-int ppu_get_palette_index(void) {
-    return current_palette_index;
+int ppu_get_palette_index(const PPU* ppu) {
+    return ppu->dmg_palette;
 }
 
 const char* ppu_get_palette_name(int index) {
@@ -117,11 +114,19 @@ void ppu_init(PPU* ppu, Memory* mem) {
     ppu->scx = 0;
     ppu->ly = 0;
     ppu->lyc = 0;
+    ppu->dmg_palette = 0;
     ppu->bgp = 0xFC;   /* Default background palette */
     ppu->obp0 = 0xFF;
     ppu->obp1 = 0xFF;
     ppu->wy = 0;
     ppu->wx = 0;
+    ppu->bgpi = 0;
+    ppu->obpi = 0;
+    memset(ppu->bgpd, 0, sizeof(ppu->bgpd));
+    memset(ppu->obpd, 0, sizeof(ppu->obpd));
+    memset(ppu->cgb_bg_colors, 0, sizeof(ppu->cgb_bg_colors));
+    memset(ppu->cgb_obj_colors, 0, sizeof(ppu->cgb_obj_colors));
+    ppu->cgb_window_line = 0;
     
     /* Initialize PPU registers in memory */
     if (mem) {
@@ -142,6 +147,7 @@ void ppu_init(PPU* ppu, Memory* mem) {
     ppu->line_cycles = 0;  /* Track cycles per line */
     ppu->clock = 0;
     ppu->frame_ready = false;
+    ppu->skip_render = false;
     
     /* Clear framebuffer */
     memset(ppu->framebuffer, 0xFF, sizeof(ppu->framebuffer));
@@ -153,12 +159,21 @@ void ppu_init(PPU* ppu, Memory* mem) {
     ppu->cgb_mode = false;
     ppu->vram_bank = 0;
     memset(ppu->vram, 0, sizeof(ppu->vram));
+    
+    /* No HDMA in flight */
+    ppu->hdma_active = false;
+    ppu->hdma_hblank = false;
+    ppu->hdma_source = 0;
+    ppu->hdma_dest = 0;
+    ppu->hdma_remaining = 0;
 }
 
 void ppu_reset(PPU* ppu) {
-    /* Keep current memory reference but reset state */
+    /* Keep current memory reference and display palette but reset state */
     Memory* mem = ppu->memory;
+    uint8_t dmg_palette = ppu->dmg_palette;
     ppu_init(ppu, mem);
+    ppu->dmg_palette = dmg_palette;
 }
 
 void ppu_step(PPU* ppu, uint32_t cycles) {
@@ -212,7 +227,7 @@ void ppu_step(PPU* ppu, uint32_t cycles) {
         if (ppu->ly >= VBLANK_START) {
             /* Enter VBlank period */
             if (ppu->mode != MODE_VBLANK) {  /* Only trigger once at start of VBlank */
-                GBEmulator* gb = gb_get_debug_gb();
+                GBEmulator* gb = gb_get_debug_gb(ppu->memory);
                 if (gb) {
                     ui_debug_log(UI_DEBUG_PPU, "[PPU] VBlank started - Frame ready (LY=%u, Cycles=%u)", ppu->ly, gb->cycles);
                 }
@@ -282,11 +297,13 @@ void ppu_step(PPU* ppu, uint32_t cycles) {
         } else {
             /* Mode 0 - HBlank */
             if (ppu->mode != MODE_HBLANK) {
-                /* Choose renderer based on mode */
-                if (ppu->cgb_mode) {
-                    ppu_render_scanline_cgb(ppu);
-                } else {
-                    ppu_render_scanline(ppu);  /* Render at start of HBlank */
+                /* Choose renderer based on mode (nothing to draw while frame skipping) */
+                if (!ppu->skip_render) {
+                    if (ppu->cgb_mode) {
+                        ppu_render_scanline_cgb(ppu);
+                    } else {
+                        ppu_render_scanline(ppu);  /* Render at start of HBlank */
+                    }
                 }
                 /* If HDMA in H-Blank mode is active, perform one HDMA block now */
                 if (ppu->hdma_active && ppu->hdma_hblank && ppu->memory) {
@@ -497,7 +514,7 @@ void ppu_render_scanline(PPU* ppu) {
             /* Background/window pixel - use background palette */
             palette_index = (ppu->bgp >> (scanline[x] * 2)) & 0x03;
         }
-        fb[x] = get_active_palette()[palette_index];
+        fb[x] = get_active_palette(ppu)[palette_index];
     }
 }
 
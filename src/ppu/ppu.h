@@ -55,6 +55,9 @@ typedef struct {
     uint8_t obpi;    /* Sprite Palette Index */
     uint8_t bgpd[64];/* Background Palette Data */
     uint8_t obpd[64];/* Sprite Palette Data */
+    uint32_t cgb_bg_colors[8][4];  /* BGPD converted to RGB32, 8 palettes of 4 */
+    uint32_t cgb_obj_colors[8][4]; /* OBPD converted to RGB32 */
+    uint8_t cgb_window_line;       /* Window line counter for CGB rendering */
     
     /* PPU state */
     PPU_Mode mode;
@@ -64,6 +67,8 @@ typedef struct {
     /* Frame buffer */
     uint32_t framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
     bool frame_ready;
+    bool skip_render;  /* Frame skipping: timing runs but scanlines are not drawn */
+    uint8_t dmg_palette; /* Display colours for the DMG shades (ppu_set_palette) */
 
     /* VRAM and CGB mode */
     uint8_t vram[2][0x2000]; /* support 2 VRAM banks for CGB */
@@ -133,8 +138,8 @@ void ppu_write_cgb_registers(PPU* ppu, uint16_t address, uint8_t value);
 void ppu_render_scanline_cgb(PPU* ppu);
 
 /* Palette management functions */
-void ppu_set_palette(int palette_index);
-int ppu_get_palette_index(void);
+void ppu_set_palette(PPU* ppu, int palette_index);
+int ppu_get_palette_index(const PPU* ppu);
 const char* ppu_get_palette_name(int index);
 int ppu_get_palette_count(void);
 const uint32_t* ppu_get_palette_colors(int index);
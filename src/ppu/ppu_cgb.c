@@ -14,16 +14,6 @@ static uint32_t cgb_color_to_rgb(uint16_t color) {
     return (0xFF << 24) | (r << 16) | (g << 8) | b;
 }
 
-/* CGB Background Color Cache */
-static struct {
-    uint32_t colors[8][4];  /* 8 palettes, 4 colors each */
-} bg_color_cache;
-
-/* CGB Sprite Color Cache */
-static struct {
-    uint32_t colors[8][4];  /* 8 palettes, 4 colors each */
-} sprite_color_cache;
-
 void ppu_init_cgb(PPU* ppu) {
     /* Initialize CGB-specific registers */
     memset(ppu->bgpd, 0, sizeof(ppu->bgpd));
@@ -33,8 +23,9 @@ void ppu_init_cgb(PPU* ppu) {
     ppu->vram_bank = 0;
     
     /* Clear color caches */
-    memset(&bg_color_cache, 0, sizeof(bg_color_cache));
-    memset(&sprite_color_cache, 0, sizeof(sprite_color_cache));
+    memset(ppu->cgb_bg_colors, 0, sizeof(ppu->cgb_bg_colors));
+    memset(ppu->cgb_obj_colors, 0, sizeof(ppu->cgb_obj_colors));
+    ppu->cgb_window_line = 0;
 }
 
 void ppu_write_cgb_registers(PPU* ppu, uint16_t address, uint8_t value) {
@@ -58,15 +49,15 @@ void ppu_write_cgb_registers(PPU* ppu, uint16_t address, uint8_t value) {
                 uint8_t color = (index >> 1) & 3;
                 if ((index & 1) == 0) {
                     /* Low byte */
-                    bg_color_cache.colors[palette][color] &= 0xFF00;
-                    bg_color_cache.colors[palette][color] |= value;
+                    ppu->cgb_bg_colors[palette][color] &= 0xFF00;
+                    ppu->cgb_bg_colors[palette][color] |= value;
                 } else {
                     /* High byte */
-                    bg_color_cache.colors[palette][color] &= 0x00FF;
-                    bg_color_cache.colors[palette][color] |= (value << 8);
+                    ppu->cgb_bg_colors[palette][color] &= 0x00FF;
+                    ppu->cgb_bg_colors[palette][color] |= (value << 8);
                     /* Convert to RGB32 */
-                    bg_color_cache.colors[palette][color] = 
-                        cgb_color_to_rgb(bg_color_cache.colors[palette][color]);
+                    ppu->cgb_bg_colors[palette][color] = 
+                        cgb_color_to_rgb(ppu->cgb_bg_colors[palette][color]);
                 }
             }
             break;
@@ -90,15 +81,15 @@ void ppu_write_cgb_registers(PPU* ppu, uint16_t address, uint8_t value) {
                 uint8_t color = (index >> 1) & 3;
                 if ((index & 1) == 0) {
                     /* Low byte */
-                    sprite_color_cache.colors[palette][color] &= 0xFF00;
-                    sprite_color_cache.colors[palette][color] |= value;
+                    ppu->cgb_obj_colors[palette][color] &= 0xFF00;
+                    ppu->cgb_obj_colors[palette][color] |= value;
                 } else {
                     /* High byte */
-                    sprite_color_cache.colors[palette][color] &= 0x00FF;
-                    sprite_color_cache.colors[palette][color] |= (value << 8);
+                    ppu->cgb_obj_colors[palette][color] &= 0x00FF;
+                    ppu->cgb_obj_colors[palette][color] |= (value << 8);
                     /* Convert to RGB32 */
-                    sprite_color_cache.colors[palette][color] = 
-                        cgb_color_to_rgb(sprite_color_cache.colors[palette][color]);
+                    ppu->cgb_obj_colors[palette][color] = 
+                        cgb_color_to_rgb(ppu->cgb_obj_colors[palette][color]);
                 }
             }
             break;
@@ -165,9 +156,9 @@ void ppu_render_scanline_cgb(PPU* ppu) {
         
         /* Get final color based on the layer (BG or Sprite) */
         if (attrs & 0x80) {  /* Sprite pixel */
-            fb[x] = sprite_color_cache.colors[palette][color_idx];
+            fb[x] = ppu->cgb_obj_colors[palette][color_idx];
         } else {  /* Background pixel */
-            fb[x] = bg_color_cache.colors[palette][color_idx];
+            fb[x] = ppu->cgb_bg_colors[palette][color_idx];
         }
     }
 }
@@ -175,8 +166,6 @@ void ppu_render_scanline_cgb(PPU* ppu) {
 /* CGB-specific tile rendering with attributes */
 /* Render window layer with CGB attributes */
 void ppu_render_window_cgb(PPU* ppu, uint8_t* scanline, uint8_t* attributes, uint8_t* priorities) {
-    static uint8_t window_line = 0;
-    
     /* Only render window if within visible area */
     if (ppu->ly < ppu->wy || ppu->wx > 166) return;
     
@@ -184,8 +173,8 @@ void ppu_render_window_cgb(PPU* ppu, uint8_t* scanline, uint8_t* attributes, uin
     uint16_t tile_data = (ppu->lcdc & LCDC_TILE_SELECT) ? 0x8000 : 0x9000;
     uint8_t win_x_start = ppu->wx - 7;
     
-    uint8_t tile_y = window_line / 8;
-    uint8_t fine_y = window_line % 8;
+    uint8_t tile_y = ppu->cgb_window_line / 8;
+    uint8_t fine_y = ppu->cgb_window_line % 8;
     
     for (int x = win_x_start; x < SCREEN_WIDTH; x++) {
         uint8_t tile_x = (x - win_x_start) / 8;
@@ -224,7 +213,7 @@ void ppu_render_window_cgb(PPU* ppu, uint8_t* scanline, uint8_t* attributes, uin
         attributes[x] = (palette << 2) | (tile_attrs & 0x80);
         priorities[x] = priority;
     }
-    window_line++;
+    ppu->cgb_window_line++;
 }
 
 /* CGB-specific tile rendering with attributes */
@@ -1,29 +1,19 @@
 #include "profiler.h"
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#if PROFILER_TSC
+#include <cpuid.h>
+#endif
 
-/* Global profiler state */
-ProfilerStats g_profiler_stats[PROFILE_COUNT] = {0};
-bool g_profiler_enabled = false;
+#define PROFILER_CALIBRATION_NS 20000000ULL  /* 20 ms against CLOCK_MONOTONIC */
 
-/* Memory tracking */
-uint64_t g_total_memory_allocated = 0;
-uint64_t g_peak_memory_usage = 0;
-uint64_t g_current_memory_usage = 0;
-
-/* Performance counters */
-uint64_t g_frame_count = 0;
-uint64_t g_instruction_count = 0;
-uint64_t g_memory_access_count = 0;
-
-/* Real-time metrics */
-static PerformanceMetrics g_current_metrics = {0};
-static uint64_t g_last_update_time = 0;
-static uint64_t g_last_frame_count = 0;
-static uint64_t g_last_instruction_count = 0;
+static pthread_once_t calibration_once = PTHREAD_ONCE_INIT;
+static double ns_per_tick = 1.0;
+static bool tsc_invariant;
 
 /* Profile point names */
-static const char* profile_point_names[PROFILE_COUNT] = {
+static const char* const profile_point_names[PROFILE_COUNT] = {
     "CPU Step",
     "PPU Step",
     "APU Step", 
@@ -32,39 +22,66 @@ static const char* profile_point_names[PROFILE_COUNT] = {
     "Frame Render",
     "DMA Transfer",
     "Interrupt Handler",
-    "ROM Access"
+    "ROM Access",
+    "Run-Ahead"
 };
 
-void profiler_init(void) {
-    memset(g_profiler_stats, 0, sizeof(g_profiler_stats));
-    g_profiler_enabled = false;
-    g_total_memory_allocated = 0;
-    g_peak_memory_usage = 0;
-    g_current_memory_usage = 0;
-    g_frame_count = 0;
-    g_instruction_count = 0;
-    g_memory_access_count = 0;
+/* Counts ticks across a spin of a fixed monotonic interval. Shared by every
+   instance; the TSC rate is a property of the host, not of the emulator. */
+static void calibrate_tick_rate(void) {
+#if PROFILER_TSC
+    unsigned int eax, ebx, ecx, edx;
+    /* CPUID 0x80000007 EDX bit 8: the TSC runs at a constant rate in all
+       P-states and C-states */
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        tsc_invariant = (edx & (1u << 8)) != 0;
+    }
+
+    uint64_t start_ns = profiler_get_time_ns();
+    uint64_t start_ticks = profiler_ticks();
+    uint64_t now_ns;
+    do {
+        now_ns = profiler_get_time_ns();
+    } while (now_ns - start_ns < PROFILER_CALIBRATION_NS);
+    uint64_t ticks = profiler_ticks_end() - start_ticks;
+    if (ticks > 0) {
+        ns_per_tick = (double)(now_ns - start_ns) / (double)ticks;
+    }
+#endif
+}
+
+void profiler_calibrate(void) {
+    pthread_once(&calibration_once, calibrate_tick_rate);
+}
+
+double profiler_ticks_to_ns(uint64_t ticks) {
+    return ticks * ns_per_tick;
+}
+
+void profiler_init(Profiler* prof) {
+    memset(prof, 0, sizeof(*prof));
 }
 
-void profiler_enable(bool enable) {
-    g_profiler_enabled = enable;
+void profiler_enable(Profiler* prof, bool enable) {
+    prof->enabled = enable;
     if (enable) {
-        g_last_update_time = profiler_get_time_ns();
+        profiler_calibrate();
+        prof->last_update_time = profiler_get_time_ns();
     }
 }
 
-void profiler_reset(void) {
-    memset(g_profiler_stats, 0, sizeof(g_profiler_stats));
-    g_frame_count = 0;
-    g_instruction_count = 0;
-    g_memory_access_count = 0;
-    g_last_update_time = profiler_get_time_ns();
-    g_last_frame_count = 0;
-    g_last_instruction_count = 0;
+void profiler_reset(Profiler* prof) {
+    memset(prof->stats, 0, sizeof(prof->stats));
+    prof->frame_count = 0;
+    prof->instruction_count = 0;
+    prof->memory_access_count = 0;
+    prof->last_update_time = profiler_get_time_ns();
+    prof->last_frame_count = 0;
+    prof->last_instruction_count = 0;
 }
 
-void profiler_print_report(void) {
-    if (!g_profiler_enabled) {
+void profiler_print_report(const Profiler* prof) {
+    if (!prof->enabled) {
         printf("Profiler is disabled\n");
         return;
     }
@@ -76,12 +93,12 @@ void profiler_print_report(void) {
            "--------", "-----", "----------", "--------", "--------", "--------");
     
     for (int i = 0; i < PROFILE_COUNT; i++) {
-        ProfilerStats* stats = &g_profiler_stats[i];
+        const ProfilerStats* stats = &prof->stats[i];
         if (stats->call_count > 0) {
-            double total_ms = stats->total_time_ns / 1000000.0;
-            double avg_us = (stats->total_time_ns / (double)stats->call_count) / 1000.0;
-            double min_us = stats->min_time_ns / 1000.0;
-            double max_us = stats->max_time_ns / 1000.0;
+            double total_ms = profiler_ticks_to_ns(stats->total_ticks) / 1000000.0;
+            double avg_us = profiler_ticks_to_ns(stats->total_ticks) / stats->call_count / 1000.0;
+            double min_us = profiler_ticks_to_ns(stats->min_ticks) / 1000.0;
+            double max_us = profiler_ticks_to_ns(stats->max_ticks) / 1000.0;
             
             printf("%-20s %10llu %15.3f %10.2f %10.2f %10.2f\n",
                    profile_point_names[i],
@@ -90,87 +107,128 @@ void profiler_print_report(void) {
         }
     }
     
+#if GBENDO_PROFILING == 0
+    printf("(Timing probes compiled out; rebuild with PROFILING=1 or 2)\n");
+#endif
+#if PROFILER_TSC
+    printf("Clock: TSC at %.3f GHz%s\n", 1.0 / ns_per_tick,
+           tsc_invariant ? "" : " (not invariant: frequency changes skew the times)");
+#else
+    printf("Clock: CLOCK_MONOTONIC\n");
+#endif
+
     printf("\n=== Performance Counters ===\n");
-    printf("Frames rendered:     %llu\n", (unsigned long long)g_frame_count);
-    printf("Instructions executed: %llu\n", (unsigned long long)g_instruction_count);
-    printf("Memory accesses:     %llu\n", (unsigned long long)g_memory_access_count);
+    printf("Frames rendered:     %llu\n", (unsigned long long)prof->frame_count);
+    printf("Instructions executed: %llu\n", (unsigned long long)prof->instruction_count);
+    printf("Memory accesses:     %llu\n", (unsigned long long)prof->memory_access_count);
+    printf("Audio underruns:     %llu samples\n", (unsigned long long)prof->audio_underrun_count);
+    printf("Audio overruns:      %llu samples\n", (unsigned long long)prof->audio_overrun_count);
+    if (prof->paced_frames > 0) {
+        printf("Frame time:          p50 %.2f ms, p99 %.2f ms, max %.2f ms (%llu frames)\n",
+               prof->frame_time_p50_ns / 1e6, prof->frame_time_p99_ns / 1e6,
+               prof->frame_time_max_ns / 1e6, (unsigned long long)prof->paced_frames);
+    }
     
-    if (g_frame_count > 0) {
-        printf("Instructions/frame:  %.0f\n", (double)g_instruction_count / g_frame_count);
-        printf("Memory accesses/frame: %.0f\n", (double)g_memory_access_count / g_frame_count);
+    if (prof->frame_count > 0) {
+        printf("Instructions/frame:  %.0f\n", (double)prof->instruction_count / prof->frame_count);
+        printf("Memory accesses/frame: %.0f\n", (double)prof->memory_access_count / prof->frame_count);
     }
     
     printf("\n=== Current Metrics ===\n");
-    printf("FPS:                 %.2f\n", g_current_metrics.fps);
-    printf("CPU usage:           %.1f%%\n", g_current_metrics.cpu_usage);
-    printf("Memory bandwidth:    %.2f MB/s\n", g_current_metrics.memory_bandwidth_mb_s);
-    printf("Instructions/sec:    %llu\n", (unsigned long long)g_current_metrics.instructions_per_second);
+    printf("FPS:                 %.2f\n", prof->current_metrics.fps);
+    printf("CPU usage:           %.1f%%\n", prof->current_metrics.cpu_usage);
+    printf("Memory bandwidth:    %.2f MB/s\n", prof->current_metrics.memory_bandwidth_mb_s);
+    printf("Instructions/sec:    %llu\n", (unsigned long long)prof->current_metrics.instructions_per_second);
 }
 
-void profiler_track_allocation(size_t size) {
-    g_total_memory_allocated += size;
-    g_current_memory_usage += size;
-    if (g_current_memory_usage > g_peak_memory_usage) {
-        g_peak_memory_usage = g_current_memory_usage;
+void profiler_track_allocation(Profiler* prof, size_t size) {
+    prof->total_memory_allocated += size;
+    prof->current_memory_usage += size;
+    if (prof->current_memory_usage > prof->peak_memory_usage) {
+        prof->peak_memory_usage = prof->current_memory_usage;
     }
 }
 
-void profiler_track_deallocation(size_t size) {
-    if (g_current_memory_usage >= size) {
-        g_current_memory_usage -= size;
+void profiler_track_deallocation(Profiler* prof, size_t size) {
+    if (prof->current_memory_usage >= size) {
+        prof->current_memory_usage -= size;
     }
 }
 
-void profiler_print_memory_stats(void) {
+void profiler_print_memory_stats(const Profiler* prof) {
     printf("\n=== Memory Usage Statistics ===\n");
-    printf("Total allocated:     %llu bytes\n", (unsigned long long)g_total_memory_allocated);
+    printf("Total allocated:     %llu bytes\n", (unsigned long long)prof->total_memory_allocated);
     printf("Current usage:       %llu bytes (%.2f MB)\n", 
-           (unsigned long long)g_current_memory_usage,
-           g_current_memory_usage / (1024.0 * 1024.0));
+           (unsigned long long)prof->current_memory_usage,
+           prof->current_memory_usage / (1024.0 * 1024.0));
     printf("Peak usage:          %llu bytes (%.2f MB)\n",
-           (unsigned long long)g_peak_memory_usage,
-           g_peak_memory_usage / (1024.0 * 1024.0));
+           (unsigned long long)prof->peak_memory_usage,
+           prof->peak_memory_usage / (1024.0 * 1024.0));
 }
 
-void profiler_increment_frame_count(void) {
-    g_frame_count++;
+void profiler_increment_frame_count(Profiler* prof) {
+    prof->frame_count++;
 }
 
-void profiler_increment_instruction_count(void) {
-    g_instruction_count++;
+void profiler_increment_instruction_count(Profiler* prof) {
+    prof->instruction_count++;
 }
 
-void profiler_increment_memory_access_count(void) {
-    g_memory_access_count++;
+void profiler_increment_memory_access_count(Profiler* prof) {
+    prof->memory_access_count++;
 }
 
-PerformanceMetrics profiler_get_current_metrics(void) {
-    return g_current_metrics;
+/* Sampled from GBEmulator.instructions; counting from the CPU would add a
+   call per instruction */
+void profiler_set_instruction_count(Profiler* prof, uint64_t instructions) {
+    prof->instruction_count = instructions;
 }
 
-void profiler_update_metrics(void) {
-    if (!g_profiler_enabled) return;
-    
+void profiler_set_audio_counters(Profiler* prof, uint64_t underruns, uint64_t overruns) {
+    prof->audio_underrun_count = underruns;
+    prof->audio_overrun_count = overruns;
+}
+
+void profiler_set_frame_times(Profiler* prof, uint64_t frames, uint64_t p50_ns, uint64_t p99_ns, uint64_t max_ns) {
+    prof->paced_frames = frames;
+    prof->frame_time_p50_ns = p50_ns;
+    prof->frame_time_p99_ns = p99_ns;
+    prof->frame_time_max_ns = max_ns;
+}
+
+PerformanceMetrics profiler_get_current_metrics(const Profiler* prof) {
+    return prof->current_metrics;
+}
+
+void profiler_update_metrics(Profiler* prof) {
+    /* Cheap enough to keep with profiling off, where the frame rate drives
+       the fast-forward speed indicator */
     uint64_t current_time = profiler_get_time_ns();
-    uint64_t time_delta = current_time - g_last_update_time;
+    if (prof->last_update_time == 0) {
+        prof->last_update_time = current_time;
+        prof->last_frame_count = prof->frame_count;
+        prof->last_instruction_count = prof->instruction_count;
+        return;
+    }
+    uint64_t time_delta = current_time - prof->last_update_time;
     
     if (time_delta >= 1000000000ULL) { /* Update every second */
-        uint64_t frame_delta = g_frame_count - g_last_frame_count;
-        uint64_t instruction_delta = g_instruction_count - g_last_instruction_count;
+        uint64_t frame_delta = prof->frame_count - prof->last_frame_count;
+        uint64_t instruction_delta = prof->instruction_count - prof->last_instruction_count;
         
         double seconds = time_delta / 1000000000.0;
         
-        g_current_metrics.fps = frame_delta / seconds;
-        g_current_metrics.instructions_per_second = instruction_delta / seconds;
-        g_current_metrics.memory_bandwidth_mb_s = (g_memory_access_count * 8.0) / (seconds * 1024.0 * 1024.0);
+        prof->current_metrics.fps = frame_delta / seconds;
+        prof->current_metrics.instructions_per_second = instruction_delta / seconds;
+        prof->current_metrics.memory_bandwidth_mb_s = (prof->memory_access_count * 8.0) / (seconds * 1024.0 * 1024.0);
         
         /* CPU usage estimation based on instruction execution rate */
         double target_ips = 4194304.0; /* 4.19 MHz target */
-        g_current_metrics.cpu_usage = (g_current_metrics.instructions_per_second / target_ips) * 100.0;
-        if (g_current_metrics.cpu_usage > 100.0) g_current_metrics.cpu_usage = 100.0;
+        prof->current_metrics.cpu_usage = (prof->current_metrics.instructions_per_second / target_ips) * 100.0;
+        if (prof->current_metrics.cpu_usage > 100.0) prof->current_metrics.cpu_usage = 100.0;
         
-        g_last_update_time = current_time;
-        g_last_frame_count = g_frame_count;
-        g_last_instruction_count = g_instruction_count;
+        prof->last_update_time = current_time;
+        prof->last_frame_count = prof->frame_count;
+        prof->last_instruction_count = prof->instruction_count;
     }
 }
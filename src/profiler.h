@@ -3,15 +3,36 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <time.h>
-
-/* Performance profiler for the emulator */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_TSC 1
+#else
+#define PROFILER_TSC 0
+#endif
+
+/* Performance profiler for the emulator
+ *
+ * Probes read the time stamp counter (rdtsc to start, rdtscp to end, a few
+ * nanoseconds each) and convert to nanoseconds only in the report, using a
+ * rate measured against CLOCK_MONOTONIC when profiling is first enabled.
+ * Without a TSC they fall back to CLOCK_MONOTONIC.
+ *
+ * GBENDO_PROFILING (make PROFILING=N) decides which probes are compiled in:
+ * 0 none, 1 (default) per-frame probes, 2 also per-instruction CPU and
+ * per-batch PPU/APU probes (PROFILE_DETAIL_*). Probes compiled in cost a
+ * predictable branch while profiling is disabled at run time. */
+
+#ifndef GBENDO_PROFILING
+#define GBENDO_PROFILING 1
+#endif
 
 typedef struct {
-    uint64_t total_time_ns;
+    uint64_t total_ticks;
     uint64_t call_count;
-    uint64_t min_time_ns;
-    uint64_t max_time_ns;
+    uint64_t min_ticks;
+    uint64_t max_ticks;
 } ProfilerStats;
 
 typedef enum {
@@ -24,18 +45,51 @@ typedef enum {
     PROFILE_DMA_TRANSFER,
     PROFILE_INTERRUPT_HANDLER,
     PROFILE_ROM_ACCESS,
+    PROFILE_RUN_AHEAD,
     PROFILE_COUNT  /* Keep this last */
 } ProfilerPoint;
 
-/* Global profiler state */
-extern ProfilerStats g_profiler_stats[PROFILE_COUNT];
-extern bool g_profiler_enabled;
+/* Real-time performance monitoring */
+typedef struct {
+    float fps;
+    float cpu_usage;
+    float memory_bandwidth_mb_s;
+    uint64_t instructions_per_second;
+} PerformanceMetrics;
+
+/* Profiler state, one per emulator instance (GBEmulator.profiler) */
+typedef struct {
+    ProfilerStats stats[PROFILE_COUNT];
+    bool enabled;
+
+    /* Memory tracking */
+    uint64_t total_memory_allocated;
+    uint64_t peak_memory_usage;
+    uint64_t current_memory_usage;
+
+    /* Performance counters */
+    uint64_t frame_count;
+    uint64_t instruction_count;
+    uint64_t memory_access_count;
+    uint64_t audio_underrun_count;   /* Sampled from the audio ring (in samples) */
+    uint64_t audio_overrun_count;
+    uint64_t paced_frames;           /* Frame times from the frame pacer */
+    uint64_t frame_time_p50_ns;
+    uint64_t frame_time_p99_ns;
+    uint64_t frame_time_max_ns;
+
+    /* Real-time metrics */
+    PerformanceMetrics current_metrics;
+    uint64_t last_update_time;
+    uint64_t last_frame_count;
+    uint64_t last_instruction_count;
+} Profiler;
 
 /* Profiler control */
-void profiler_init(void);
-void profiler_enable(bool enable);
-void profiler_reset(void);
-void profiler_print_report(void);
+void profiler_init(Profiler* prof);
+void profiler_enable(Profiler* prof, bool enable);
+void profiler_reset(Profiler* prof);
+void profiler_print_report(const Profiler* prof);
 
 /* High-precision timing */
 static inline uint64_t profiler_get_time_ns(void) {
@@ -44,87 +98,117 @@ static inline uint64_t profiler_get_time_ns(void) {
     return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
-/* Profiling macros for easy instrumentation */
-#define PROFILE_START(point) \
-    uint64_t _profile_start_##point = g_profiler_enabled ? profiler_get_time_ns() : 0
+/* Probe timestamps in ticks (TSC cycles, or ns without a TSC) */
+static inline uint64_t profiler_ticks(void) {
+#if PROFILER_TSC
+    return __rdtsc();
+#else
+    return profiler_get_time_ns();
+#endif
+}
 
-#define PROFILE_END(point) \
-    do { \
-        if (g_profiler_enabled) { \
-            uint64_t end_time = profiler_get_time_ns(); \
-            uint64_t duration = end_time - _profile_start_##point; \
-            ProfilerStats* stats = &g_profiler_stats[PROFILE_##point]; \
-            stats->total_time_ns += duration; \
-            stats->call_count++; \
-            if (stats->call_count == 1 || duration < stats->min_time_ns) { \
-                stats->min_time_ns = duration; \
-            } \
-            if (stats->call_count == 1 || duration > stats->max_time_ns) { \
-                stats->max_time_ns = duration; \
-            } \
-        } \
-    } while (0)
+/* End of a measured span: rdtscp waits for the span's instructions to finish */
+static inline uint64_t profiler_ticks_end(void) {
+#if PROFILER_TSC
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return profiler_get_time_ns();
+#endif
+}
+
+/* Measures the tick rate, once per process; profiler_enable() calls it */
+void profiler_calibrate(void);
+
+/* Converts ticks to ns with the calibrated rate (1 before calibration) */
+double profiler_ticks_to_ns(uint64_t ticks);
+
+static inline void profiler_record(Profiler* prof, ProfilerPoint point, uint64_t ticks) {
+    ProfilerStats* stats = &prof->stats[point];
+    stats->total_ticks += ticks;
+    stats->call_count++;
+    if (stats->call_count == 1 || ticks < stats->min_ticks) {
+        stats->min_ticks = ticks;
+    }
+    if (stats->call_count == 1 || ticks > stats->max_ticks) {
+        stats->max_ticks = ticks;
+    }
+}
 
 /* Automatic scope-based profiling */
 typedef struct {
+    Profiler* profiler;
     ProfilerPoint point;
-    uint64_t start_time;
+    uint64_t start_ticks;
 } ScopeProfiler;
 
-static inline ScopeProfiler profiler_scope_start(ProfilerPoint point) {
-    ScopeProfiler prof = {point, 0};
-    if (g_profiler_enabled) {
-        prof.start_time = profiler_get_time_ns();
+static inline ScopeProfiler profiler_scope_start(Profiler* prof, ProfilerPoint point) {
+    ScopeProfiler scope = {prof, point, 0};
+    if (prof->enabled) {
+        scope.start_ticks = profiler_ticks();
     }
-    return prof;
+    return scope;
 }
 
-static inline void profiler_scope_end(ScopeProfiler* prof) {
-    if (g_profiler_enabled && prof->start_time != 0) {
-        uint64_t duration = profiler_get_time_ns() - prof->start_time;
-        ProfilerStats* stats = &g_profiler_stats[prof->point];
-        stats->total_time_ns += duration;
-        stats->call_count++;
-        if (stats->call_count == 1 || duration < stats->min_time_ns) {
-            stats->min_time_ns = duration;
-        }
-        if (stats->call_count == 1 || duration > stats->max_time_ns) {
-            stats->max_time_ns = duration;
-        }
+static inline void profiler_scope_end(ScopeProfiler* scope) {
+    if (scope->profiler->enabled && scope->start_ticks != 0) {
+        profiler_record(scope->profiler, scope->point, profiler_ticks_end() - scope->start_ticks);
     }
 }
 
-#define PROFILE_SCOPE(point) \
-    ScopeProfiler _scope_prof = profiler_scope_start(PROFILE_##point); \
-    __attribute__((cleanup(profiler_scope_end))) ScopeProfiler* _cleanup_prof = &_scope_prof
+/* Profiling macros for easy instrumentation */
+#if GBENDO_PROFILING >= 1
+#define PROFILE_START(prof, point) \
+    uint64_t _profile_start_##point = (prof)->enabled ? profiler_ticks() : 0
 
-/* Memory allocation profiler */
-extern uint64_t g_total_memory_allocated;
-extern uint64_t g_peak_memory_usage;
-extern uint64_t g_current_memory_usage;
+#define PROFILE_END(prof, point) \
+    do { \
+        if ((prof)->enabled) { \
+            profiler_record((prof), PROFILE_##point, \
+                            profiler_ticks_end() - _profile_start_##point); \
+        } \
+    } while (0)
+
+#define PROFILE_SCOPE(prof, point) \
+    __attribute__((cleanup(profiler_scope_end))) ScopeProfiler _scope_prof = \
+        profiler_scope_start((prof), PROFILE_##point)
+#else
+#define PROFILE_START(prof, point) do { (void)(prof); } while (0)
+#define PROFILE_END(prof, point) do { (void)(prof); } while (0)
+#define PROFILE_SCOPE(prof, point) (void)(prof)
+#endif
+
+/* Fine-grained probes for the inner loops, compiled in with PROFILING=2 */
+#if GBENDO_PROFILING >= 2
+#define PROFILE_DETAIL_START(prof, point) PROFILE_START(prof, point)
+#define PROFILE_DETAIL_END(prof, point) PROFILE_END(prof, point)
+#else
+#define PROFILE_DETAIL_START(prof, point) do { } while (0)
+#define PROFILE_DETAIL_END(prof, point) do { } while (0)
+#endif
 
-void profiler_track_allocation(size_t size);
-void profiler_track_deallocation(size_t size);
-void profiler_print_memory_stats(void);
+/* Memory allocation profiler */
+void profiler_track_allocation(Profiler* prof, size_t size);
+void profiler_track_deallocation(Profiler* prof, size_t size);
+void profiler_print_memory_stats(const Profiler* prof);
 
 /* Performance counters */
-extern uint64_t g_frame_count;
-extern uint64_t g_instruction_count;
-extern uint64_t g_memory_access_count;
+void profiler_increment_frame_count(Profiler* prof);
+void profiler_increment_instruction_count(Profiler* prof);
+void profiler_increment_memory_access_count(Profiler* prof);
 
-void profiler_increment_frame_count(void);
-void profiler_increment_instruction_count(void);
-void profiler_increment_memory_access_count(void);
+/* Instructions executed so far, from GBEmulator.instructions */
+void profiler_set_instruction_count(Profiler* prof, uint64_t instructions);
 
-/* Real-time performance monitoring */
-typedef struct {
-    float fps;
-    float cpu_usage;
-    float memory_bandwidth_mb_s;
-    uint64_t instructions_per_second;
-} PerformanceMetrics;
+/* Audio queue health, sampled from the audio ring (in samples) */
+void profiler_set_audio_counters(Profiler* prof, uint64_t underruns, uint64_t overruns);
+
+/* Frame time percentiles, sampled from the frame pacer */
+void profiler_set_frame_times(Profiler* prof, uint64_t frames, uint64_t p50_ns, uint64_t p99_ns, uint64_t max_ns);
 
-PerformanceMetrics profiler_get_current_metrics(void);
-void profiler_update_metrics(void);
+PerformanceMetrics profiler_get_current_metrics(const Profiler* prof);
+/* Call once per frame; the metrics are refreshed about once a second,
+   whether or not profiling is enabled */
+void profiler_update_metrics(Profiler* prof);
 
 #endif /* PROFILER_H */
@@ -0,0 +1,245 @@
+#include "rewind.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Minimum number of zero bytes that ends a literal run in the encoder */
+#define REWIND_MIN_ZERO_RUN 4
+
+/* Average encoded delta size assumed when sizing the metadata ring */
+#define REWIND_BYTES_PER_ENTRY 512
+
+/* ---- Delta encoding ----
+ * A delta is a sequence of (zero_run, literal_len, literal bytes) tokens,
+ * lengths as LEB128 varints. Literal bytes are prev ^ next. */
+
+static uint8_t* put_varint(uint8_t* out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static const uint8_t* get_varint(const uint8_t* in, size_t* value) {
+    size_t v = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *in++;
+        v |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *value = v;
+    return in;
+}
+
+/* Length of the run of identical bytes starting at i, compared a word at a time */
+static size_t equal_run(const uint8_t* a, const uint8_t* b, size_t i, size_t n) {
+    size_t start = i;
+    while (i + 8 <= n) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa != wb) break;
+        i += 8;
+    }
+    while (i < n && a[i] == b[i]) i++;
+    return i - start;
+}
+
+/* Worst case: every token carries at least one literal and REWIND_MIN_ZERO_RUN
+   skipped bytes, so the varints never cost more than half the input */
+static size_t encode_bound(size_t n) {
+    return n + n / 2 + 16;
+}
+
+static size_t encode_delta(const uint8_t* prev, const uint8_t* next, size_t n, uint8_t* out) {
+    uint8_t* p = out;
+    size_t i = 0;
+
+    while (i < n) {
+        size_t run = equal_run(prev, next, i, n);
+        size_t lit = i + run;
+        size_t end = lit;
+
+        /* Extend the literal until a long enough zero run or the end */
+        while (end < n) {
+            if (prev[end] != next[end]) {
+                end++;
+                continue;
+            }
+            size_t zeros = equal_run(prev, next, end, n);
+            if (zeros >= REWIND_MIN_ZERO_RUN || end + zeros == n) break;
+            end += zeros;
+        }
+
+        p = put_varint(p, run);
+        p = put_varint(p, end - lit);
+        for (size_t j = lit; j < end; j++) {
+            *p++ = prev[j] ^ next[j];
+        }
+        i = end;
+    }
+
+    return (size_t)(p - out);
+}
+
+/* XOR an encoded delta into buf, turning the newer snapshot into the older one */
+static void apply_delta(uint8_t* buf, size_t n, const uint8_t* in, size_t length) {
+    const uint8_t* end = in + length;
+    size_t pos = 0;
+
+    while (in < end) {
+        size_t run, lit;
+        in = get_varint(in, &run);
+        in = get_varint(in, &lit);
+        pos += run;
+        if (pos + lit > n) return;  /* Corrupt delta - stop rather than overrun */
+        for (size_t j = 0; j < lit; j++) {
+            buf[pos + j] ^= in[j];
+        }
+        in += lit;
+        pos += lit;
+    }
+}
+
+/* ---- Ring management ---- */
+
+static RewindEntry* entry_at(RewindBuffer* rw, size_t index) {
+    return &rw->entries[(rw->head + index) % rw->max_entries];
+}
+
+static void drop_oldest(RewindBuffer* rw) {
+    rw->head = (rw->head + 1) % rw->max_entries;
+    rw->count--;
+}
+
+/* Reserve space for a delta, evicting the oldest ones that are in the way.
+   Live deltas always lie in age order walking forward from write_pos. */
+static size_t reserve(RewindBuffer* rw, size_t length) {
+    size_t pos = rw->write_pos;
+
+    if (pos + length > rw->budget) {
+        /* Deltas between write_pos and the end are the oldest; the gap is lost */
+        while (rw->count > 0 && entry_at(rw, 0)->offset >= pos) {
+            drop_oldest(rw);
+        }
+        pos = 0;
+    }
+
+    while (rw->count > 0) {
+        const RewindEntry* oldest = entry_at(rw, 0);
+        bool overlaps = oldest->offset < pos + length && oldest->offset + oldest->length > pos;
+        if (!overlaps && rw->count < rw->max_entries) break;
+        drop_oldest(rw);
+    }
+
+    return pos;
+}
+
+static bool rewind_resize(RewindBuffer* rw, size_t snapshot_size) {
+    free(rw->current);
+    free(rw->next);
+    free(rw->encode_buf);
+    rw->current = malloc(snapshot_size);
+    rw->next = malloc(snapshot_size);
+    rw->encode_buf = malloc(encode_bound(snapshot_size));
+    if (!rw->current || !rw->next || !rw->encode_buf) {
+        fprintf(stderr, "Failed to allocate rewind snapshot buffers\n");
+        rw->snapshot_size = 0;
+        return false;
+    }
+    rw->snapshot_size = snapshot_size;
+    rewind_clear(rw);
+    return true;
+}
+
+bool rewind_init(RewindBuffer* rw, size_t budget, uint32_t interval) {
+    memset(rw, 0, sizeof(*rw));
+    if (budget == 0) return false;
+
+    rw->budget = budget;
+    rw->interval = interval ? interval : 1;
+    rw->max_entries = budget / REWIND_BYTES_PER_ENTRY + 1;
+    rw->data = malloc(budget);
+    rw->entries = malloc(rw->max_entries * sizeof(RewindEntry));
+    if (!rw->data || !rw->entries) {
+        fprintf(stderr, "Failed to allocate rewind buffer (%zu bytes)\n", budget);
+        rewind_cleanup(rw);
+        return false;
+    }
+    return true;
+}
+
+void rewind_cleanup(RewindBuffer* rw) {
+    free(rw->data);
+    free(rw->entries);
+    free(rw->current);
+    free(rw->next);
+    free(rw->encode_buf);
+    memset(rw, 0, sizeof(*rw));
+}
+
+void rewind_clear(RewindBuffer* rw) {
+    rw->write_pos = 0;
+    rw->head = 0;
+    rw->count = 0;
+    rw->has_current = false;
+    rw->frame_counter = 0;
+}
+
+void rewind_capture(RewindBuffer* rw, GBEmulator* gb) {
+    if (!rw->data) return;
+
+    size_t size = gb_snapshot_size(gb);
+    if (size != rw->snapshot_size && !rewind_resize(rw, size)) return;
+    if (rw->frame_counter++ % rw->interval != 0) return;
+
+    if (!rw->has_current) {
+        gb_snapshot_save(gb, rw->current);
+        rw->has_current = true;
+        return;
+    }
+
+    /* Store how to get from the new snapshot back to the current one */
+    gb_snapshot_save(gb, rw->next);
+    size_t length = encode_delta(rw->current, rw->next, size, rw->encode_buf);
+
+    if (length > rw->budget) {
+        /* Cannot be stored; older deltas would no longer chain up */
+        rw->count = 0;
+        rw->write_pos = 0;
+    } else {
+        size_t pos = reserve(rw, length);
+        memcpy(rw->data + pos, rw->encode_buf, length);
+        RewindEntry* entry = &rw->entries[(rw->head + rw->count) % rw->max_entries];
+        entry->offset = pos;
+        entry->length = length;
+        rw->count++;
+        rw->write_pos = pos + length;
+    }
+
+    uint8_t* tmp = rw->current;
+    rw->current = rw->next;
+    rw->next = tmp;
+}
+
+bool rewind_step(RewindBuffer* rw, GBEmulator* gb) {
+    if (!rw->has_current || rw->count == 0) return false;
+    if (gb_snapshot_size(gb) != rw->snapshot_size) return false;
+
+    RewindEntry* newest = entry_at(rw, rw->count - 1);
+    apply_delta(rw->current, rw->snapshot_size, rw->data + newest->offset, newest->length);
+    rw->write_pos = newest->offset;
+    rw->count--;
+
+    /* Keep the capture cadence aligned to the restored snapshot */
+    rw->frame_counter = 1;
+    return gb_snapshot_load(gb, rw->current);
+}
+
+size_t rewind_available(const RewindBuffer* rw) {
+    return rw->count;
+}
@@ -0,0 +1,63 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gbendo.h"
+
+/* Rewind buffer.
+ *
+ * Every `interval` frames a snapshot is taken and the XOR delta against the
+ * previous snapshot is stored zero-run-length encoded in a byte ring bounded
+ * by `budget` bytes. Only the newest snapshot is kept in full; stepping back
+ * undoes one delta at a time. The oldest deltas are dropped when the budget
+ * is exhausted. */
+
+#define REWIND_DEFAULT_BUDGET   (16u * 1024u * 1024u)  /* 16MB */
+#define REWIND_DEFAULT_INTERVAL 2                      /* frames per capture */
+
+typedef struct {
+    size_t offset;  /* Start of the encoded delta in the data ring */
+    size_t length;  /* Encoded length in bytes */
+} RewindEntry;
+
+typedef struct {
+    /* Encoded deltas */
+    uint8_t* data;
+    size_t budget;
+    size_t write_pos;
+
+    /* Delta metadata ring (oldest at head) */
+    RewindEntry* entries;
+    size_t max_entries;
+    size_t head;
+    size_t count;
+
+    /* Newest full snapshot plus scratch space for the next capture */
+    uint8_t* current;
+    uint8_t* next;
+    uint8_t* encode_buf;
+    size_t snapshot_size;
+    bool has_current;
+
+    uint32_t interval;
+    uint32_t frame_counter;
+} RewindBuffer;
+
+/* Lifecycle. budget is the byte limit for encoded deltas. */
+bool rewind_init(RewindBuffer* rw, size_t budget, uint32_t interval);
+void rewind_cleanup(RewindBuffer* rw);
+void rewind_clear(RewindBuffer* rw);
+
+/* Call once per emulated frame; captures every `interval` frames */
+void rewind_capture(RewindBuffer* rw, GBEmulator* gb);
+
+/* Restore the previous capture. Returns false when the history is empty. */
+bool rewind_step(RewindBuffer* rw, GBEmulator* gb);
+
+/* Number of captures that can currently be stepped back */
+size_t rewind_available(const RewindBuffer* rw);
+
+#endif /* REWIND_H */
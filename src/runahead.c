@@ -0,0 +1,95 @@
+#include "runahead.h"
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool runahead_init(RunAhead* ra, int frames) {
+    memset(ra, 0, sizeof(*ra));
+    if (frames < 0 || frames > RUNAHEAD_MAX_FRAMES) {
+        fprintf(stderr, "Run-ahead must be between 0 and %d frames\n", RUNAHEAD_MAX_FRAMES);
+        return false;
+    }
+    ra->frames = frames;
+    return true;
+}
+
+void runahead_cleanup(RunAhead* ra) {
+    free(ra->snapshot);
+    free(ra->stems);
+    memset(ra, 0, sizeof(*ra));
+}
+
+/* Snapshot size only changes with the cartridge */
+static bool runahead_reserve(RunAhead* ra, const GBEmulator* gb) {
+    size_t size = gb_snapshot_size(gb);
+    if (size == ra->snapshot_size) return true;
+
+    free(ra->snapshot);
+    ra->snapshot = malloc(size);
+    ra->snapshot_size = ra->snapshot ? size : 0;
+    if (!ra->snapshot) {
+        fprintf(stderr, "Failed to allocate run-ahead snapshot\n");
+        return false;
+    }
+    return true;
+}
+
+/* The sample buffers may have been reallocated while running ahead: keep
+   the current storage (its first frames are the real ones) and roll back
+   everything else */
+static void restore_output(APU_Output* out, const APU_Output* saved) {
+    APU_SampleBuffer buffer = out->buffer;
+    *out = *saved;
+    out->buffer.data = buffer.data;
+    out->buffer.capacity = buffer.capacity;
+}
+
+static void restore_stems(APU_Stems* stems, const APU_Stems* saved) {
+    APU_SampleBuffer buffer = stems->buffer;
+    *stems = *saved;
+    stems->buffer.data = buffer.data;
+    stems->buffer.capacity = buffer.capacity;
+}
+
+void runahead_run_frame(RunAhead* ra, GBEmulator* gb) {
+    if (ra->frames == 0 || !runahead_reserve(ra, gb)) {
+        gb_run_frame_optimized(gb);
+        return;
+    }
+
+    /* Real frame: emulated and heard, but never shown */
+    gb->ppu.skip_render = true;
+    gb_run_frame_optimized(gb);
+
+    PROFILE_START(&gb->profiler, RUN_AHEAD);
+    gb_snapshot_save(gb, ra->snapshot);
+    ra->audio = gb->apu.output;
+    if (gb->apu.stems && !ra->stems) {
+        ra->stems = malloc(sizeof(APU_Stems));
+    }
+    bool keep_stems = gb->apu.stems && ra->stems;
+    if (keep_stems) *ra->stems = *gb->apu.stems;
+
+    /* Input polled during the future frames would be lost with them, and
+       their instructions were never really executed */
+    MemoryInputPoll input_poll = gb->memory.input_poll;
+    struct OpcodeProfile* opcode_profile = gb->cpu.opcode_profile;
+    uint64_t instructions = gb->instructions;
+    gb->memory.input_poll = NULL;
+    gb->cpu.opcode_profile = NULL;
+    for (int i = 0; i < ra->frames; i++) {
+        gb->ppu.skip_render = (i + 1 < ra->frames);
+        gb_run_frame_optimized(gb);
+    }
+    gb->memory.input_poll = input_poll;
+    gb->cpu.opcode_profile = opcode_profile;
+    gb->instructions = instructions;
+
+    /* Back to the real timeline; the framebuffer keeps the future frame */
+    gb_snapshot_load(gb, ra->snapshot);
+    restore_output(&gb->apu.output, &ra->audio);
+    if (keep_stems) restore_stems(gb->apu.stems, ra->stems);
+    gb->ppu.skip_render = false;
+    PROFILE_END(&gb->profiler, RUN_AHEAD);
+}
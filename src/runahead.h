@@ -0,0 +1,36 @@
+#ifndef RUNAHEAD_H
+#define RUNAHEAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gbendo.h"
+
+/* Run-ahead latency reduction.
+ *
+ * Each displayed frame runs the real frame without drawing, snapshots,
+ * runs `frames` more frames with the current input (only the last one is
+ * drawn, their audio is dropped), then restores the snapshot. The
+ * framebuffer therefore shows the game `frames` frames into the future
+ * while emulation and audio stay on the real timeline. */
+
+#define RUNAHEAD_MAX_FRAMES 4
+
+typedef struct {
+    int frames;              /* Extra frames per displayed frame, 0 = off */
+    uint8_t* snapshot;
+    size_t snapshot_size;
+
+    /* Real-frame audio output kept aside while running ahead */
+    APU_Output audio;
+    APU_Stems* stems;        /* Allocated once stems are enabled */
+} RunAhead;
+
+bool runahead_init(RunAhead* ra, int frames);
+void runahead_cleanup(RunAhead* ra);
+
+/* Run one displayed frame; falls back to a plain frame when disabled */
+void runahead_run_frame(RunAhead* ra, GBEmulator* gb);
+
+#endif /* RUNAHEAD_H */
@@ -0,0 +1,759 @@
+#include "savestate.h"
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+/* ---- Little-endian helpers ---- */
+
+static inline void store_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void store_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t load_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t load_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ---- Chunk table ---- */
+
+typedef enum {
+    CHUNK_CPU,
+    CHUNK_PPU,
+    CHUNK_VRAM,
+    CHUNK_OAM,
+    CHUNK_APU,
+    CHUNK_MEM,
+    CHUNK_WRAM,
+    CHUNK_MVRM,
+    CHUNK_MBC,
+    CHUNK_SRAM,
+    CHUNK_RTC,
+    CHUNK_COUNT
+} ChunkId;
+
+typedef struct {
+    char tag[4];
+    uint16_t version;
+    uint32_t min_length;  /* Payload size of the version 1 layout */
+    bool required;
+    bool bulk;            /* Raw memory copy; may be stored deflated */
+} ChunkSpec;
+
+static const ChunkSpec chunk_specs[CHUNK_COUNT] = {
+    [CHUNK_CPU]  = { {'C','P','U',' '}, 1, 25,     true,  false },
+    [CHUNK_PPU]  = { {'P','P','U',' '}, 1, 161,    true,  false },
+    [CHUNK_VRAM] = { {'V','R','A','M'}, 1, 0x4000, true,  true  },  /* PPU VRAM, both banks */
+    [CHUNK_OAM]  = { {'O','A','M',' '}, 1, 160,    true,  true  },
+    [CHUNK_APU]  = { {'A','P','U',' '}, 2, 108,    true,  false },
+    [CHUNK_MEM]  = { {'M','E','M',' '}, 1, 432,    true,  false },
+    [CHUNK_WRAM] = { {'W','R','A','M'}, 1, 0x2000, true,  true  },
+    [CHUNK_MVRM] = { {'M','V','R','M'}, 1, 0x2000, true,  true  },  /* Memory-side VRAM */
+    [CHUNK_MBC]  = { {'M','B','C',' '}, 1, 14,     true,  false },
+    [CHUNK_SRAM] = { {'S','R','A','M'}, 1, 0,      false, true  },  /* Cartridge RAM */
+    [CHUNK_RTC]  = { {'R','T','C',' '}, 1, 14,     false, false },
+};
+
+static bool find_chunk(const uint8_t tag[4], ChunkId* id) {
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        if (memcmp(tag, chunk_specs[i].tag, 4) == 0) {
+            *id = (ChunkId)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ---- Writer ---- */
+
+typedef struct {
+    uint8_t* out;        /* NULL when only measuring */
+    size_t capacity;
+    size_t pos;
+    size_t chunk_start;
+    uint32_t chunk_count;
+    bool overflow;
+} ChunkWriter;
+
+static void put_bytes(ChunkWriter* w, const void* src, size_t n) {
+    if (w->out) {
+        if (w->pos + n > w->capacity) {
+            w->overflow = true;
+        } else {
+            memcpy(w->out + w->pos, src, n);
+        }
+    }
+    w->pos += n;
+}
+
+static void put_u8(ChunkWriter* w, uint8_t v) {
+    put_bytes(w, &v, 1);
+}
+
+static void put_u16(ChunkWriter* w, uint16_t v) {
+    uint8_t b[2];
+    store_u16(b, v);
+    put_bytes(w, b, 2);
+}
+
+static void put_u32(ChunkWriter* w, uint32_t v) {
+    uint8_t b[4];
+    store_u32(b, v);
+    put_bytes(w, b, 4);
+}
+
+static void put_u64(ChunkWriter* w, uint64_t v) {
+    put_u32(w, (uint32_t)v);
+    put_u32(w, (uint32_t)(v >> 32));
+}
+
+static void begin_chunk(ChunkWriter* w, ChunkId id) {
+    const ChunkSpec* spec = &chunk_specs[id];
+    w->chunk_start = w->pos;
+    put_bytes(w, spec->tag, 4);
+    put_u16(w, spec->version);
+    put_u16(w, 0);  /* flags */
+    put_u32(w, 0);  /* length, patched in end_chunk */
+    put_u32(w, 0);  /* crc32, patched in end_chunk */
+}
+
+static void end_chunk(ChunkWriter* w) {
+    size_t payload = w->chunk_start + SAVESTATE_CHUNK_HEADER_SIZE;
+    uint32_t length = (uint32_t)(w->pos - payload);
+    if (w->out && !w->overflow) {
+        store_u32(w->out + w->chunk_start + 8, length);
+        store_u32(w->out + w->chunk_start + 12,
+                  (uint32_t)crc32(0L, w->out + payload, length));
+    }
+    w->chunk_count++;
+}
+
+/* ---- Reader (bounds are validated before decoding starts) ---- */
+
+typedef struct {
+    const uint8_t* p;
+} ChunkReader;
+
+static uint8_t get_u8(ChunkReader* r) {
+    return *r->p++;
+}
+
+static bool get_bool(ChunkReader* r) {
+    return *r->p++ != 0;
+}
+
+static uint16_t get_u16(ChunkReader* r) {
+    uint16_t v = load_u16(r->p);
+    r->p += 2;
+    return v;
+}
+
+static uint32_t get_u32(ChunkReader* r) {
+    uint32_t v = load_u32(r->p);
+    r->p += 4;
+    return v;
+}
+
+static uint64_t get_u64(ChunkReader* r) {
+    uint64_t lo = get_u32(r);
+    uint64_t hi = get_u32(r);
+    return lo | (hi << 32);
+}
+
+static void get_bytes(ChunkReader* r, void* dst, size_t n) {
+    memcpy(dst, r->p, n);
+    r->p += n;
+}
+
+/* ---- Per-chunk encoders ---- */
+
+static void encode_cpu(ChunkWriter* w, const GBEmulator* gb) {
+    const SM83_CPU* cpu = &gb->cpu;
+    begin_chunk(w, CHUNK_CPU);
+    put_u16(w, cpu->af);
+    put_u16(w, cpu->bc);
+    put_u16(w, cpu->de);
+    put_u16(w, cpu->hl);
+    put_u16(w, cpu->sp);
+    put_u16(w, cpu->pc);
+    put_u8(w, cpu->ime);
+    put_u8(w, cpu->ei_delay);
+    put_u8(w, cpu->halted);
+    put_u8(w, cpu->stopped);
+    put_u32(w, cpu->cycles);
+    /* Emulator frame timing */
+    put_u32(w, gb->cycles);
+    put_u8(w, gb->frame_complete);
+    end_chunk(w);
+}
+
+static void encode_ppu(ChunkWriter* w, const PPU* ppu) {
+    begin_chunk(w, CHUNK_PPU);
+    put_u8(w, ppu->lcdc);
+    put_u8(w, ppu->stat);
+    put_u8(w, ppu->scy);
+    put_u8(w, ppu->scx);
+    put_u8(w, ppu->ly);
+    put_u8(w, ppu->lyc);
+    put_u8(w, ppu->bgp);
+    put_u8(w, ppu->obp0);
+    put_u8(w, ppu->obp1);
+    put_u8(w, ppu->wy);
+    put_u8(w, ppu->wx);
+    put_u8(w, ppu->bgpi);
+    put_u8(w, ppu->obpi);
+    put_bytes(w, ppu->bgpd, sizeof(ppu->bgpd));
+    put_bytes(w, ppu->obpd, sizeof(ppu->obpd));
+    put_u8(w, (uint8_t)ppu->mode);
+    put_u32(w, ppu->clock);
+    put_u32(w, ppu->line_cycles);
+    put_u8(w, ppu->frame_ready);
+    put_u8(w, ppu->cgb_mode);
+    put_u8(w, ppu->vram_bank);
+    put_u8(w, ppu->hdma_active);
+    put_u8(w, ppu->hdma_hblank);
+    put_u16(w, ppu->hdma_source);
+    put_u16(w, ppu->hdma_dest);
+    put_u16(w, ppu->hdma_remaining);
+    end_chunk(w);
+
+    begin_chunk(w, CHUNK_VRAM);
+    put_bytes(w, ppu->vram, sizeof(ppu->vram));
+    end_chunk(w);
+
+    begin_chunk(w, CHUNK_OAM);
+    put_bytes(w, ppu->oam, sizeof(ppu->oam));
+    end_chunk(w);
+}
+
+static void encode_pulse(ChunkWriter* w, const PulseChannel* ch) {
+    put_u8(w, ch->enabled);
+    put_u8(w, ch->volume);
+    put_u16(w, ch->frequency);
+    put_u8(w, ch->counter_selection);
+    put_u16(w, ch->length_timer);
+    put_u8(w, ch->duty);
+    put_u8(w, ch->duty_position);
+    put_u16(w, ch->frequency_timer);
+    put_u8(w, ch->initial_volume);
+    put_u8(w, ch->envelope_increase);
+    put_u8(w, ch->envelope_period);
+    put_u8(w, ch->envelope_timer);
+    put_u8(w, ch->sweep_period);
+    put_u8(w, ch->sweep_decrease);
+    put_u8(w, ch->sweep_shift);
+    put_u8(w, ch->sweep_timer);
+}
+
+static void encode_apu(ChunkWriter* w, const APU* apu) {
+    begin_chunk(w, CHUNK_APU);
+    encode_pulse(w, &apu->pulse1);
+    encode_pulse(w, &apu->pulse2);
+
+    put_u8(w, apu->wave.enabled);
+    put_u8(w, apu->wave.volume);
+    put_u16(w, apu->wave.frequency);
+    put_u16(w, apu->wave.length_timer);
+    put_u16(w, apu->wave.frequency_timer);
+    put_u8(w, apu->wave.wave_position);
+    put_bytes(w, apu->wave.wave_pattern, sizeof(apu->wave.wave_pattern));
+    put_u8(w, apu->wave.wave_table_enabled);
+
+    put_u8(w, apu->noise.enabled);
+    put_u8(w, apu->noise.volume);
+    put_u8(w, apu->noise.divisor_code);
+    put_u8(w, apu->noise.width_mode);
+    put_u8(w, apu->noise.clock_shift);
+    put_u16(w, apu->noise.length_timer);
+    put_u16(w, apu->noise.frequency_timer);
+    put_u16(w, apu->noise.lfsr);
+    put_u8(w, apu->noise.initial_volume);
+    put_u8(w, apu->noise.envelope_increase);
+    put_u8(w, apu->noise.envelope_period);
+    put_u8(w, apu->noise.envelope_timer);
+
+    put_u8(w, apu->power);
+    put_u8(w, apu->left_volume);
+    put_u8(w, apu->right_volume);
+    put_u8(w, apu->left_enables);
+    put_u8(w, apu->right_enables);
+    put_u32(w, 0);  /* Formerly the sample timer; output is no longer state */
+    put_u32(w, apu->frame_sequencer);
+    /* Version 2 */
+    put_u32(w, apu->frame_sequencer_timer);
+    put_u32(w, apu->pending_cycles);
+    end_chunk(w);
+}
+
+static void encode_memory(ChunkWriter* w, const Memory* mem) {
+    begin_chunk(w, CHUNK_MEM);
+    put_bytes(w, mem->io_registers, sizeof(mem->io_registers));
+    put_bytes(w, mem->hram, 0x7F);
+    put_u8(w, mem->ie_register);
+    put_bytes(w, mem->oam, 0xA0);
+    put_u8(w, mem->joypad_state_buttons);
+    put_u8(w, mem->joypad_state_dirs);
+    put_u16(w, mem->div_internal);
+    put_u8(w, mem->div);
+    put_u8(w, mem->tima);
+    put_u8(w, mem->tma);
+    put_u8(w, mem->tac);
+    put_u8(w, mem->timer_enabled);
+    put_u8(w, mem->tima_reload_delay);
+    put_u8(w, mem->tima_reload_pending);
+    put_u8(w, mem->last_timer_bit);
+    put_u8(w, mem->current_rom_bank);
+    put_u8(w, mem->current_ram_bank);
+    put_u8(w, mem->ram_enabled);
+    put_u8(w, mem->rom_banking_enabled);
+    end_chunk(w);
+
+    begin_chunk(w, CHUNK_WRAM);
+    put_bytes(w, mem->wram, 0x2000);
+    end_chunk(w);
+
+    begin_chunk(w, CHUNK_MVRM);
+    put_bytes(w, mem->vram, 0x2000);
+    end_chunk(w);
+
+    const MBC_State* mbc = (const MBC_State*)mem->mbc_data;
+    uint32_t ram_size = (mbc && mbc->ram_data) ? (uint32_t)mbc->ram_size : 0;
+
+    begin_chunk(w, CHUNK_MBC);
+    put_u8(w, (uint8_t)mem->mbc_type);
+    put_u32(w, ram_size);
+    put_u8(w, mbc ? mbc->current_rom_bank : 0);
+    put_u8(w, mbc ? mbc->current_ram_bank : 0);
+    put_u8(w, mbc ? mbc->current_rom_bank2 : 0);
+    put_u8(w, mbc ? mbc->current_ram_bank2 : 0);
+    put_u8(w, mbc ? mbc->base_rom_bank : 0);
+    put_u8(w, mbc ? mbc->rom_bank_mask : 0);
+    put_u8(w, mbc ? mbc->banking_mode : 0);
+    put_u8(w, mbc ? mbc->ram_enabled : 0);
+    put_u8(w, mbc ? mbc->rom_banking_enabled : 0);
+    end_chunk(w);
+
+    if (ram_size) {
+        begin_chunk(w, CHUNK_SRAM);
+        put_bytes(w, mbc->ram_data, ram_size);
+        end_chunk(w);
+    }
+
+    if (mbc && mbc->rtc_data) {
+        const RTC_Data* rtc = mbc->rtc_data;
+        begin_chunk(w, CHUNK_RTC);
+        put_u8(w, rtc->seconds);
+        put_u8(w, rtc->minutes);
+        put_u8(w, rtc->hours);
+        put_u16(w, rtc->days);
+        put_u8(w, rtc->halt);
+        put_u64(w, (uint64_t)(int64_t)rtc->last_time);
+        end_chunk(w);
+    }
+}
+
+size_t savestate_encode(const GBEmulator* gb, uint8_t* out, size_t capacity) {
+    ChunkWriter w = { out, capacity, 0, 0, 0, false };
+
+    /* Header; chunk_count is patched once all chunks are written */
+    put_bytes(&w, SAVESTATE_MAGIC, 4);
+    put_u16(&w, SAVESTATE_FORMAT_VERSION);
+    put_u16(&w, SAVESTATE_HEADER_SIZE);
+    put_u32(&w, 0);
+    put_u32(&w, 0);
+
+    encode_cpu(&w, gb);
+    encode_ppu(&w, &gb->ppu);
+    encode_apu(&w, &gb->apu);
+    encode_memory(&w, &gb->memory);
+
+    if (w.overflow) return 0;
+    if (out) store_u32(out + 8, w.chunk_count);
+    return w.pos;
+}
+
+/* ---- Compression ---- */
+
+size_t savestate_deflate_bound(size_t size) {
+    /* Every chunk may also carry the 4 byte uncompressed length */
+    return compressBound((uLong)size) + CHUNK_COUNT * 4 + SAVESTATE_HEADER_SIZE;
+}
+
+size_t savestate_deflate(const uint8_t* in, size_t size, uint8_t* out, size_t capacity) {
+    if (size < SAVESTATE_HEADER_SIZE || capacity < SAVESTATE_HEADER_SIZE) return 0;
+
+    uint16_t header_size = load_u16(in + 6);
+    uint32_t chunk_count = load_u32(in + 8);
+    if (header_size < SAVESTATE_HEADER_SIZE || header_size > size || header_size > capacity) return 0;
+    memcpy(out, in, header_size);
+
+    size_t pos = header_size;
+    size_t out_pos = header_size;
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        if (size - pos < SAVESTATE_CHUNK_HEADER_SIZE) return 0;
+        const uint8_t* header = in + pos;
+        uint32_t length = load_u32(header + 8);
+        if (length > size - pos - SAVESTATE_CHUNK_HEADER_SIZE) return 0;
+        size_t total = SAVESTATE_CHUNK_HEADER_SIZE + (size_t)length;
+
+        ChunkId id;
+        bool packable = find_chunk(header, &id) && chunk_specs[id].bulk &&
+                        load_u16(header + 6) == 0 && length > 0;
+        if (packable && capacity - out_pos > SAVESTATE_CHUNK_HEADER_SIZE + 4) {
+            uint8_t* dst = out + out_pos + SAVESTATE_CHUNK_HEADER_SIZE;
+            uLongf packed = (uLongf)(capacity - out_pos - SAVESTATE_CHUNK_HEADER_SIZE - 4);
+            if (compress2(dst + 4, &packed, header + SAVESTATE_CHUNK_HEADER_SIZE, length,
+                          Z_DEFAULT_COMPRESSION) == Z_OK && packed + 4 < length) {
+                uint32_t stored = (uint32_t)packed + 4;
+                store_u32(dst, length);
+                memcpy(out + out_pos, header, 6);
+                store_u16(out + out_pos + 6, SAVESTATE_CHUNK_DEFLATE);
+                store_u32(out + out_pos + 8, stored);
+                store_u32(out + out_pos + 12, (uint32_t)crc32(0L, dst, stored));
+                out_pos += SAVESTATE_CHUNK_HEADER_SIZE + stored;
+                pos += total;
+                continue;
+            }
+        }
+
+        if (total > capacity - out_pos) return 0;
+        memcpy(out + out_pos, header, total);
+        out_pos += total;
+        pos += total;
+    }
+
+    return out_pos;
+}
+
+/* ---- Per-chunk decoders ---- */
+
+static void decode_cpu(ChunkReader* r, GBEmulator* gb) {
+    SM83_CPU* cpu = &gb->cpu;
+    cpu->af = get_u16(r);
+    cpu->bc = get_u16(r);
+    cpu->de = get_u16(r);
+    cpu->hl = get_u16(r);
+    cpu->sp = get_u16(r);
+    cpu->pc = get_u16(r);
+    cpu->ime = get_bool(r);
+    cpu->ei_delay = get_bool(r);
+    cpu->halted = get_bool(r);
+    cpu->stopped = get_bool(r);
+    cpu->cycles = get_u32(r);
+    gb->cycles = get_u32(r);
+    gb->frame_complete = get_bool(r);
+}
+
+static void decode_ppu(ChunkReader* r, PPU* ppu) {
+    ppu->lcdc = get_u8(r);
+    ppu->stat = get_u8(r);
+    ppu->scy = get_u8(r);
+    ppu->scx = get_u8(r);
+    ppu->ly = get_u8(r);
+    ppu->lyc = get_u8(r);
+    ppu->bgp = get_u8(r);
+    ppu->obp0 = get_u8(r);
+    ppu->obp1 = get_u8(r);
+    ppu->wy = get_u8(r);
+    ppu->wx = get_u8(r);
+    ppu->bgpi = get_u8(r);
+    ppu->obpi = get_u8(r);
+    get_bytes(r, ppu->bgpd, sizeof(ppu->bgpd));
+    get_bytes(r, ppu->obpd, sizeof(ppu->obpd));
+    ppu->mode = (PPU_Mode)get_u8(r);
+    ppu->clock = get_u32(r);
+    ppu->line_cycles = get_u32(r);
+    ppu->frame_ready = get_bool(r);
+    ppu->cgb_mode = get_bool(r);
+    ppu->vram_bank = get_u8(r);
+    ppu->hdma_active = get_bool(r);
+    ppu->hdma_hblank = get_bool(r);
+    ppu->hdma_source = get_u16(r);
+    ppu->hdma_dest = get_u16(r);
+    ppu->hdma_remaining = get_u16(r);
+}
+
+static void decode_pulse(ChunkReader* r, PulseChannel* ch) {
+    ch->enabled = get_bool(r);
+    ch->volume = get_u8(r);
+    ch->frequency = get_u16(r);
+    ch->counter_selection = get_bool(r);
+    ch->length_timer = get_u16(r);
+    ch->duty = get_u8(r);
+    ch->duty_position = get_u8(r);
+    ch->frequency_timer = get_u16(r);
+    ch->initial_volume = get_u8(r);
+    ch->envelope_increase = get_bool(r);
+    ch->envelope_period = get_u8(r);
+    ch->envelope_timer = get_u8(r);
+    ch->sweep_period = get_u8(r);
+    ch->sweep_decrease = get_bool(r);
+    ch->sweep_shift = get_u8(r);
+    ch->sweep_timer = get_u8(r);
+}
+
+static void decode_apu(ChunkReader* r, APU* apu, uint32_t length) {
+    decode_pulse(r, &apu->pulse1);
+    decode_pulse(r, &apu->pulse2);
+
+    apu->wave.enabled = get_bool(r);
+    apu->wave.volume = get_u8(r);
+    apu->wave.frequency = get_u16(r);
+    apu->wave.length_timer = get_u16(r);
+    apu->wave.frequency_timer = get_u16(r);
+    apu->wave.wave_position = get_u8(r);
+    get_bytes(r, apu->wave.wave_pattern, sizeof(apu->wave.wave_pattern));
+    apu->wave.wave_table_enabled = get_bool(r);
+
+    apu->noise.enabled = get_bool(r);
+    apu->noise.volume = get_u8(r);
+    apu->noise.divisor_code = get_u8(r);
+    apu->noise.width_mode = get_u8(r);
+    apu->noise.clock_shift = get_u8(r);
+    apu->noise.length_timer = get_u16(r);
+    apu->noise.frequency_timer = get_u16(r);
+    apu->noise.lfsr = get_u16(r);
+    apu->noise.initial_volume = get_u8(r);
+    apu->noise.envelope_increase = get_bool(r);
+    apu->noise.envelope_period = get_u8(r);
+    apu->noise.envelope_timer = get_u8(r);
+
+    apu->power = get_bool(r);
+    apu->left_volume = get_u8(r);
+    apu->right_volume = get_u8(r);
+    apu->left_enables = get_u8(r);
+    apu->right_enables = get_u8(r);
+    get_u32(r);  /* Formerly the sample timer */
+    apu->frame_sequencer = get_u32(r);
+
+    if (length >= chunk_specs[CHUNK_APU].min_length + 8) {
+        apu->frame_sequencer_timer = get_u32(r);
+        apu->pending_cycles = get_u32(r);
+    } else {
+        /* Version 1 kept a cycle count here rather than a step */
+        apu->frame_sequencer &= 7;
+        apu->frame_sequencer_timer = CPU_CLOCK_SPEED / FRAME_SEQUENCER_RATE;
+        apu->pending_cycles = 0;
+    }
+}
+
+static void decode_memory(ChunkReader* r, Memory* mem) {
+    get_bytes(r, mem->io_registers, sizeof(mem->io_registers));
+    get_bytes(r, mem->hram, 0x7F);
+    mem->ie_register = get_u8(r);
+    get_bytes(r, mem->oam, 0xA0);
+    mem->joypad_state_buttons = get_u8(r);
+    mem->joypad_state_dirs = get_u8(r);
+    mem->div_internal = get_u16(r);
+    mem->div = get_u8(r);
+    mem->tima = get_u8(r);
+    mem->tma = get_u8(r);
+    mem->tac = get_u8(r);
+    mem->timer_enabled = get_bool(r);
+    mem->tima_reload_delay = get_u8(r);
+    mem->tima_reload_pending = get_bool(r);
+    mem->last_timer_bit = get_u8(r);
+    mem->current_rom_bank = get_u8(r);
+    mem->current_ram_bank = get_u8(r);
+    mem->ram_enabled = get_bool(r);
+    mem->rom_banking_enabled = get_bool(r);
+}
+
+static void decode_mbc(ChunkReader* r, MBC_State* mbc) {
+    get_u8(r);   /* mbc_type, checked during validation */
+    get_u32(r);  /* ram_size, checked during validation */
+    mbc->current_rom_bank = get_u8(r);
+    mbc->current_ram_bank = get_u8(r);
+    mbc->current_rom_bank2 = get_u8(r);
+    mbc->current_ram_bank2 = get_u8(r);
+    mbc->base_rom_bank = get_u8(r);
+    mbc->rom_bank_mask = get_u8(r);
+    mbc->banking_mode = get_u8(r);
+    mbc->ram_enabled = get_bool(r);
+    mbc->rom_banking_enabled = get_bool(r);
+}
+
+static void decode_rtc(ChunkReader* r, RTC_Data* rtc) {
+    rtc->seconds = get_u8(r);
+    rtc->minutes = get_u8(r);
+    rtc->hours = get_u8(r);
+    rtc->days = get_u16(r);
+    rtc->halt = get_bool(r);
+    rtc->last_time = (time_t)(int64_t)get_u64(r);
+}
+
+/* ---- Loading ---- */
+
+typedef struct {
+    const uint8_t* payload;
+    uint32_t length;  /* Uncompressed length */
+    uint32_t stored;  /* Bytes in the file */
+    bool deflated;
+} ChunkRef;
+
+/* Inflate a deflated chunk payload into out. With out == NULL the stream is
+   only checked to decode to exactly its declared length. */
+static bool inflate_payload(const ChunkRef* chunk, uint8_t* out, size_t out_size) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit(&strm) != Z_OK) return false;
+
+    strm.next_in = (Bytef*)(chunk->payload + 4);
+    strm.avail_in = chunk->stored - 4;
+
+    int ret;
+    if (out) {
+        strm.next_out = out;
+        strm.avail_out = (uInt)out_size;
+        ret = inflate(&strm, Z_FINISH);
+        /* A longer (newer) payload leaves data behind; the prefix is enough */
+        bool ok = strm.total_out == out_size && (ret == Z_STREAM_END || ret == Z_BUF_ERROR || ret == Z_OK);
+        inflateEnd(&strm);
+        return ok;
+    }
+
+    uint8_t scratch[4096];
+    do {
+        strm.next_out = scratch;
+        strm.avail_out = sizeof(scratch);
+        ret = inflate(&strm, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+    bool ok = ret == Z_STREAM_END && strm.total_out == chunk->length;
+    inflateEnd(&strm);
+    return ok;
+}
+
+static void copy_bulk(const ChunkRef* chunk, void* dst, size_t n) {
+    if (chunk->deflated) {
+        inflate_payload(chunk, dst, n);  /* Already verified */
+    } else {
+        memcpy(dst, chunk->payload, n);
+    }
+}
+
+bool savestate_decode(GBEmulator* gb, const uint8_t* data, size_t size) {
+    if (size < SAVESTATE_HEADER_SIZE || memcmp(data, SAVESTATE_MAGIC, 4) != 0) {
+        fprintf(stderr, "Not a GBendo save state\n");
+        return false;
+    }
+
+    uint16_t version = load_u16(data + 4);
+    uint16_t header_size = load_u16(data + 6);
+    uint32_t chunk_count = load_u32(data + 8);
+    if (version != SAVESTATE_FORMAT_VERSION) {
+        fprintf(stderr, "Incompatible save state version: %u (expected %u)\n",
+                version, SAVESTATE_FORMAT_VERSION);
+        return false;
+    }
+    if (header_size < SAVESTATE_HEADER_SIZE || header_size > size) {
+        fprintf(stderr, "Corrupt save state header\n");
+        return false;
+    }
+
+    /* Pass 1: locate and verify every chunk before touching the emulator */
+    ChunkRef chunks[CHUNK_COUNT] = {{0}};
+    size_t pos = header_size;
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        if (size - pos < SAVESTATE_CHUNK_HEADER_SIZE) {
+            fprintf(stderr, "Save state truncated in chunk header %u\n", i);
+            return false;
+        }
+        const uint8_t* header = data + pos;
+        uint16_t flags = load_u16(header + 6);
+        uint32_t length = load_u32(header + 8);
+        uint32_t crc = load_u32(header + 12);
+        const uint8_t* payload = header + SAVESTATE_CHUNK_HEADER_SIZE;
+        pos += SAVESTATE_CHUNK_HEADER_SIZE;
+
+        if (length > size - pos) {
+            fprintf(stderr, "Save state truncated in chunk %.4s\n", (const char*)header);
+            return false;
+        }
+        pos += length;
+
+        ChunkId id;
+        if (!find_chunk(header, &id)) continue;  /* Unknown chunk: skip */
+
+        bool deflated = flags == SAVESTATE_CHUNK_DEFLATE && chunk_specs[id].bulk && length >= 4;
+        if (flags != 0 && !deflated) {
+            fprintf(stderr, "Unsupported flags 0x%04X in chunk %.4s\n", flags, (const char*)header);
+            return false;
+        }
+        if ((uint32_t)crc32(0L, payload, length) != crc) {
+            fprintf(stderr, "Checksum mismatch in chunk %.4s\n", (const char*)header);
+            return false;
+        }
+
+        ChunkRef* chunk = &chunks[id];
+        chunk->payload = payload;
+        chunk->stored = length;
+        chunk->deflated = deflated;
+        chunk->length = deflated ? load_u32(payload) : length;
+        if (chunk->length < chunk_specs[id].min_length) {
+            fprintf(stderr, "Chunk %.4s too short (%u bytes)\n", (const char*)header, chunk->length);
+            return false;
+        }
+        if (deflated && !inflate_payload(chunk, NULL, 0)) {
+            fprintf(stderr, "Corrupt compressed data in chunk %.4s\n", (const char*)header);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        if (chunk_specs[i].required && !chunks[i].payload) {
+            fprintf(stderr, "Save state is missing chunk %.4s\n", chunk_specs[i].tag);
+            return false;
+        }
+    }
+
+    /* The state must belong to the loaded cartridge */
+    MBC_State* mbc = (MBC_State*)gb->memory.mbc_data;
+    uint32_t ram_size = (mbc && mbc->ram_data) ? (uint32_t)mbc->ram_size : 0;
+    uint8_t saved_type = chunks[CHUNK_MBC].payload[0];
+    uint32_t saved_ram = load_u32(chunks[CHUNK_MBC].payload + 1);
+    if (saved_type != (uint8_t)gb->memory.mbc_type || saved_ram != ram_size ||
+        (ram_size && chunks[CHUNK_SRAM].length != ram_size)) {
+        fprintf(stderr, "Save state does not match the loaded cartridge\n");
+        return false;
+    }
+
+    /* Pass 2: copy straight into place; wiring pointers are never touched */
+    ChunkReader r;
+
+    r.p = chunks[CHUNK_CPU].payload;
+    decode_cpu(&r, gb);
+    r.p = chunks[CHUNK_PPU].payload;
+    decode_ppu(&r, &gb->ppu);
+    copy_bulk(&chunks[CHUNK_VRAM], gb->ppu.vram, sizeof(gb->ppu.vram));
+    copy_bulk(&chunks[CHUNK_OAM], gb->ppu.oam, sizeof(gb->ppu.oam));
+    r.p = chunks[CHUNK_APU].payload;
+    decode_apu(&r, &gb->apu, chunks[CHUNK_APU].length);
+    r.p = chunks[CHUNK_MEM].payload;
+    decode_memory(&r, &gb->memory);
+    copy_bulk(&chunks[CHUNK_WRAM], gb->memory.wram, 0x2000);
+    copy_bulk(&chunks[CHUNK_MVRM], gb->memory.vram, 0x2000);
+
+    if (mbc) {
+        r.p = chunks[CHUNK_MBC].payload;
+        decode_mbc(&r, mbc);
+        if (ram_size) {
+            copy_bulk(&chunks[CHUNK_SRAM], mbc->ram_data, ram_size);
+        }
+        if (mbc->rtc_data && chunks[CHUNK_RTC].payload) {
+            r.p = chunks[CHUNK_RTC].payload;
+            decode_rtc(&r, mbc->rtc_data);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gbendo.h"
+
+/* Chunked save state file format.
+ *
+ * All multi-byte fields are little-endian and fixed width.
+ *
+ *   Header (16 bytes)
+ *     char     magic[4]      "GBST"
+ *     uint16   version       SAVESTATE_FORMAT_VERSION
+ *     uint16   header_size   bytes from file start to the first chunk
+ *     uint32   chunk_count
+ *     uint32   reserved      0
+ *
+ *   Chunk (16 byte header + payload)
+ *     char     tag[4]        e.g. "CPU ", "PPU ", "MEM "
+ *     uint16   version       per-chunk layout version
+ *     uint16   flags         SAVESTATE_CHUNK_DEFLATE or 0
+ *     uint32   length        payload bytes
+ *     uint32   crc32         zlib crc32 of the payload
+ *
+ * Chunk versions only ever append fields, so readers take the prefix they
+ * know and ignore the rest. Unknown chunks are skipped.
+ *
+ * Bulk memory chunks (VRAM, OAM, WRAM, MVRM, SRAM) may be deflated: the
+ * payload is then a uint32 uncompressed length followed by a zlib stream,
+ * and the crc32 covers the stored (compressed) payload. */
+
+#define SAVESTATE_MAGIC            "GBST"
+#define SAVESTATE_FORMAT_VERSION   1
+#define SAVESTATE_HEADER_SIZE      16
+#define SAVESTATE_CHUNK_HEADER_SIZE 16
+
+#define SAVESTATE_CHUNK_DEFLATE    0x0001
+
+/* Encode the emulator into out. Returns the encoded size, or 0 if
+   capacity is too small. Pass out = NULL to only compute the size. */
+size_t savestate_encode(const GBEmulator* gb, uint8_t* out, size_t capacity);
+
+/* Upper bound for savestate_deflate() output given an encoded image size */
+size_t savestate_deflate_bound(size_t size);
+
+/* Re-pack an encoded image with its bulk memory chunks deflated. Chunks
+   that do not shrink are copied unchanged. Returns the packed size, or 0 if
+   the input is malformed or capacity is too small. */
+size_t savestate_deflate(const uint8_t* in, size_t size, uint8_t* out, size_t capacity);
+
+/* Decode a save state image into gb. The whole image is validated
+   (header, checksums, required chunks, cartridge match) before anything
+   is written, so gb is untouched on failure. */
+bool savestate_decode(GBEmulator* gb, const uint8_t* data, size_t size);
+
+#endif /* SAVESTATE_H */
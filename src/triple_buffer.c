@@ -0,0 +1,55 @@
+#include "triple_buffer.h"
+#include <string.h>
+
+#define TRIPLE_BUFFER_FRESH 0x4u
+#define TRIPLE_BUFFER_INDEX 0x3u
+
+void triple_buffer_init(TripleBuffer* tb) {
+    memset(tb->frames, 0, sizeof(tb->frames));
+    tb->back = 0;
+    tb->front = 2;
+    tb->has_frame = false;
+    atomic_init(&tb->middle, 1);
+    atomic_init(&tb->published, 0);
+    atomic_init(&tb->skipped, 0);
+}
+
+uint32_t* triple_buffer_back(TripleBuffer* tb) {
+    return tb->frames[tb->back];
+}
+
+void triple_buffer_publish(TripleBuffer* tb) {
+    /* Release: the pixels are visible before the index is; acquire: the
+       slot we get back is no longer being read */
+    unsigned previous = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH,
+                                                 memory_order_acq_rel);
+    if (previous & TRIPLE_BUFFER_FRESH) {
+        atomic_fetch_add_explicit(&tb->skipped, 1, memory_order_relaxed);
+    }
+    tb->back = previous & TRIPLE_BUFFER_INDEX;
+    atomic_fetch_add_explicit(&tb->published, 1, memory_order_relaxed);
+}
+
+void triple_buffer_write(TripleBuffer* tb, const uint32_t* frame) {
+    memcpy(triple_buffer_back(tb), frame, sizeof(tb->frames[0]));
+    triple_buffer_publish(tb);
+}
+
+const uint32_t* triple_buffer_read(TripleBuffer* tb, bool* fresh) {
+    *fresh = false;
+    if (atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+        unsigned previous = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = previous & TRIPLE_BUFFER_INDEX;
+        tb->has_frame = true;
+        *fresh = true;
+    }
+    return tb->has_frame ? tb->frames[tb->front] : NULL;
+}
+
+uint64_t triple_buffer_published(const TripleBuffer* tb) {
+    return atomic_load_explicit(&tb->published, memory_order_relaxed);
+}
+
+uint64_t triple_buffer_skipped(const TripleBuffer* tb) {
+    return atomic_load_explicit(&tb->skipped, memory_order_relaxed);
+}
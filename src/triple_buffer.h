@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ppu/ppu.h"
+
+/* Lock-free frame handoff from the emulation thread to the presenter.
+ *
+ * Three framebuffers: the writer fills its back buffer and publishes it by
+ * swapping it with the middle one; the reader takes the middle one in
+ * exchange for its front buffer whenever a newer frame is there. Neither
+ * side ever waits for the other, and each only touches the slot it owns, so
+ * a frame is never shown half written. A frame published before the reader
+ * took the previous one replaces it and is counted as skipped. */
+
+#define TRIPLE_BUFFER_PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+
+typedef struct {
+    uint32_t frames[3][TRIPLE_BUFFER_PIXELS];
+    uint32_t back;                  /* Writer only */
+    uint32_t front;                 /* Reader only */
+    bool has_frame;                 /* Reader only: front holds a published frame */
+    atomic_uint middle;             /* Slot index, plus TRIPLE_BUFFER_FRESH when unread */
+    atomic_uint_fast64_t published;
+    atomic_uint_fast64_t skipped;
+} TripleBuffer;
+
+void triple_buffer_init(TripleBuffer* tb);
+
+/* Writer: the buffer to draw the next frame into */
+uint32_t* triple_buffer_back(TripleBuffer* tb);
+
+/* Writer: hand the back buffer to the reader */
+void triple_buffer_publish(TripleBuffer* tb);
+
+/* Writer: copy a finished frame in and publish it */
+void triple_buffer_write(TripleBuffer* tb, const uint32_t* frame);
+
+/* Reader: the newest published frame (the previous one again if nothing
+   new arrived; *fresh says which), or NULL before the first publish */
+const uint32_t* triple_buffer_read(TripleBuffer* tb, bool* fresh);
+
+uint64_t triple_buffer_published(const TripleBuffer* tb);
+uint64_t triple_buffer_skipped(const TripleBuffer* tb);
+
+#endif /* TRIPLE_BUFFER_H */
@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include <SDL2/SDL_image.h>
 
 /* Simple immediate mode UI state */
@@ -32,6 +33,13 @@ static struct {
     bool show_debug;
     bool show_settings;
     
+    /* Status message shown at the bottom of the window until status_until */
+    char status_message[96];
+    uint32_t status_until;
+    
+    /* Fast-forward indicator (ui_set_speed), hidden at 0 */
+    float speed;
+    
     /* Mouse state */
     int mouse_x, mouse_y;
     bool mouse_down;
@@ -92,6 +100,9 @@ static struct {
     int debug_scroll_offset;
 } ui_state = {0};
 
+/* The core logs from the emulation thread; the console renders on the GUI thread */
+static pthread_mutex_t g_debug_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Menu constants */
 #define MENU_HEIGHT 20
 #define MENU_ITEM_HEIGHT 20
@@ -327,6 +338,10 @@ void ui_set_paused(bool paused) {
     ui_state.paused = paused;
 }
 
+int ui_get_palette(void) {
+    return ui_state.selected_palette;
+}
+
 bool ui_is_muted(void) {
     return ui_state.muted;
 }
@@ -356,6 +371,15 @@ void ui_notify_rom_loaded(const char* rom_path) {
     rebuild_file_menu();
 }
 
+void ui_show_status(const char* message) {
+    snprintf(ui_state.status_message, sizeof(ui_state.status_message), "%s", message);
+    ui_state.status_until = SDL_GetTicks() + 2500;
+}
+
+void ui_set_speed(float speed) {
+    ui_state.speed = speed;
+}
+
 /* File browser functions */
 static bool build_rom_path(const char* dir, const char* filename) {
     /* Always use snprintf with buffer size - let it handle truncation safely */
@@ -642,7 +666,6 @@ static void load_palette_setting(void) {
     const char* home = getenv("HOME");
     if (!home) {
         ui_state.selected_palette = 0;
-        ppu_set_palette(0);
         return;
     }
     
@@ -652,7 +675,6 @@ static void load_palette_setting(void) {
     FILE* f = fopen(config_path, "r");
     if (!f) {
         ui_state.selected_palette = 0;
-        ppu_set_palette(0);
         return;
     }
     
@@ -660,14 +682,11 @@ static void load_palette_setting(void) {
     if (fscanf(f, "%d", &palette_index) == 1) {
         if (palette_index >= 0 && palette_index < ppu_get_palette_count()) {
             ui_state.selected_palette = palette_index;
-            ppu_set_palette(palette_index);
         } else {
             ui_state.selected_palette = 0;
-            ppu_set_palette(0);
         }
     } else {
         ui_state.selected_palette = 0;
-        ppu_set_palette(0);
     }
     
     fclose(f);
@@ -771,6 +790,10 @@ static void cb_load_state(void) {
     ui_on_load_state();
 }
 
+static void cb_screenshot(void) {
+    ui_on_screenshot();
+}
+
 /* Menu definitions */
 static MenuItem emulation_menu[] = {
     {"Pause", "P", false, true, &ui_state.paused, cb_pause},
@@ -779,6 +802,7 @@ static MenuItem emulation_menu[] = {
     {"", NULL, true, false, NULL, NULL},
     {"Save State", "F5", false, false, NULL, cb_save_state},
     {"Load State", "F7", false, false, NULL, cb_load_state},
+    {"Screenshot", "F12", false, false, NULL, cb_screenshot},
     {"", NULL, true, false, NULL, NULL},
     {"Mute Sound", "M", false, true, &ui_state.paused, cb_mute},
 };
@@ -809,7 +833,7 @@ typedef struct {
 
 static Menu menus[] = {
     {"File", file_menu_items, 0},  /* count will be updated dynamically */
-    {"Emulation", emulation_menu, 8},
+    {"Emulation", emulation_menu, 9},
     {"Settings", settings_menu, 5},
     {"Help", help_menu, 3},
 };
@@ -988,7 +1012,7 @@ void ui_render(void) {
     }
     
     if (ui_state.show_controls) {
-        int dw = 300, dh = 200;
+        int dw = 300, dh = 260;
         int win_w, win_h;
         SDL_GetWindowSize(ui_state.window, &win_w, &win_h);
         int dx = (win_w - dw) / 2;
@@ -1002,7 +1026,10 @@ void ui_render(void) {
         draw_text("X: B Button", dx + 20, dy + 90, text);
         draw_text("Enter: Start", dx + 20, dy + 110, text);
         draw_text("Shift: Select", dx + 20, dy + 130, text);
-        draw_text("Click anywhere to close", dx + 20, dy + 160, (SDL_Color){90, 160, 90, 255});
+        draw_text("Backspace: Rewind (hold)", dx + 20, dy + 150, text);
+        draw_text("Tab: Fast-forward (hold)", dx + 20, dy + 170, text);
+        draw_text("`: Fast-forward on/off", dx + 20, dy + 190, text);
+        draw_text("Click anywhere to close", dx + 20, dy + 220, (SDL_Color){90, 160, 90, 255});
     }
     
     
@@ -1063,6 +1090,7 @@ void ui_render(void) {
         draw_rect_outline(dx + 10, output_y, output_w, output_h, (SDL_Color){55, 120, 55, 255});
         
         /* Render debug buffer contents */
+        pthread_mutex_lock(&g_debug_lock);
         if (ui_state.debug_buffer[0] != '\0') {
             int line_y = output_y + 5;
             int max_lines = (output_h - 10) / 8;  /* 8 pixels per line of text */
@@ -1099,6 +1127,7 @@ void ui_render(void) {
             SDL_Color hint_color = {90, 160, 90, 255};
             draw_text("Enable components to see debug output...", dx + 20, output_y + 10, hint_color);
         }
+        pthread_mutex_unlock(&g_debug_lock);
         
         /* Scrollbar */
         int scroll_x = dx + output_w + 15;
@@ -1710,6 +1739,35 @@ void ui_render(void) {
             }
         }
     }
+    
+    /* Transient status message (e.g. background save finished) */
+    if (ui_state.status_message[0] && SDL_GetTicks() < ui_state.status_until) {
+        int win_w, win_h;
+        SDL_GetWindowSize(ui_state.window, &win_w, &win_h);
+        int w = (int)strlen(ui_state.status_message) * 6 + 16;
+        int y = win_h - 22;
+        draw_rect_filled(8, y, w, 18, bg);
+        draw_rect_outline(8, y, w, 18, (SDL_Color){55, 120, 55, 255});
+        draw_text(ui_state.status_message, 16, y + 6, text);
+    }
+    
+    /* Fast-forward indicator, top right below the menu bar */
+    if (ui_state.speed != 0.0f) {
+        int win_w, win_h;
+        SDL_GetWindowSize(ui_state.window, &win_w, &win_h);
+        char label[32];
+        if (ui_state.speed < 0.0f) {
+            snprintf(label, sizeof(label), ">>");
+        } else {
+            snprintf(label, sizeof(label), ">> %.1fx", ui_state.speed);
+        }
+        int w = (int)strlen(label) * 6 + 16;
+        int x = win_w - w - 8;
+        int y = MENU_HEIGHT + 8;
+        draw_rect_filled(x, y, w, 18, bg);
+        draw_rect_outline(x, y, w, 18, (SDL_Color){55, 120, 55, 255});
+        draw_text(label, x + 8, y + 6, text);
+    }
 }
 
 bool ui_handle_event(SDL_Event* event) {
@@ -1935,7 +1993,6 @@ bool ui_handle_event(SDL_Event* event) {
                                     if (event->button.x >= dropdown_x && event->button.x < dropdown_x + dropdown_w &&
                                         event->button.y >= dd_y + i * 18 && event->button.y < dd_y + (i + 1) * 18) {
                                         ui_state.selected_palette = i;
-                                        ppu_set_palette(i);
                                         save_palette_setting();
                                         ui_state.active_settings_dropdown = -1;
                                         return true;
@@ -2026,8 +2083,10 @@ bool ui_handle_event(SDL_Event* event) {
                 /* Clear button */
                 if (event->button.x >= dx + 10 && event->button.x < dx + 90 &&
                     event->button.y >= btn_y && event->button.y < btn_y + 20) {
+                    pthread_mutex_lock(&g_debug_lock);
                     memset(ui_state.debug_buffer, 0, sizeof(ui_state.debug_buffer));
                     ui_state.debug_buffer_offset = 0;
+                    pthread_mutex_unlock(&g_debug_lock);
                     ui_state.debug_scroll_offset = 0;
                     return true;
                 }
@@ -2651,6 +2710,10 @@ bool ui_handle_event(SDL_Event* event) {
             cb_load_state();
             return true;
         }
+        if (event->key.keysym.sym == SDLK_F12) {
+            cb_screenshot();
+            return true;
+        }
     }
     
     return false;
@@ -2685,6 +2748,8 @@ void ui_debug_log(UIDebugComponent component, const char* format, ...) {
     int msg_len = strlen(temp_buffer);
     bool needs_newline = (msg_len == 0 || temp_buffer[msg_len - 1] != '\n');
     
+    pthread_mutex_lock(&g_debug_lock);
+    
     /* Calculate space needed */
     int space_needed = msg_len + (needs_newline ? 1 : 0);
     int buffer_size = sizeof(ui_state.debug_buffer);
@@ -2696,6 +2761,7 @@ void ui_debug_log(UIDebugComponent component, const char* format, ...) {
         strncpy(ui_state.debug_buffer, temp_buffer + start_pos, buffer_size - 1);
         ui_state.debug_buffer[buffer_size - 1] = '\0';
         ui_state.debug_buffer_offset = strlen(ui_state.debug_buffer);
+        pthread_mutex_unlock(&g_debug_lock);
         return;
     }
     
@@ -2722,6 +2788,7 @@ void ui_debug_log(UIDebugComponent component, const char* format, ...) {
         ui_state.debug_buffer[ui_state.debug_buffer_offset++] = '\n';
         ui_state.debug_buffer[ui_state.debug_buffer_offset] = '\0';
     }
+    pthread_mutex_unlock(&g_debug_lock);
 }
 
 /* Placeholder implementations - to be defined in window.c */
@@ -2740,3 +2807,7 @@ void __attribute__((weak)) ui_on_save_state(void) {
 void __attribute__((weak)) ui_on_load_state(void) {
     printf("Load state requested\n");
 }
+
+void __attribute__((weak)) ui_on_screenshot(void) {
+    printf("Screenshot requested\n");
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <SDL2/SDL.h>
+#include "ui_debug.h"
 
 struct Memory;
 
@@ -25,9 +26,12 @@ int ui_get_menu_height(void);
 void ui_on_reset(void);
 void ui_on_save_state(void);
 void ui_on_load_state(void);
+void ui_on_screenshot(void);
 bool ui_is_paused(void);
 void ui_set_paused(bool paused);
 bool ui_is_muted(void);
+/* Display palette chosen in the settings (see ppu_set_palette) */
+int ui_get_palette(void);
 void ui_set_muted(bool muted);
 
 /* Get selected ROM file path (returns NULL if no file selected) */
@@ -39,16 +43,11 @@ bool ui_get_stop_requested(void);
 /* Notify UI that a ROM was loaded (for recent ROMs tracking) */
 void ui_notify_rom_loaded(const char* rom_path);
 
-/* Debug logging functions */
-typedef enum {
-    UI_DEBUG_PPU = 0,
-    UI_DEBUG_APU = 1,
-    UI_DEBUG_CPU = 2,
-    UI_DEBUG_MEM = 3,
-    UI_DEBUG_UI = 4
-} UIDebugComponent;
-
-bool ui_is_debug_enabled(UIDebugComponent component);
-void ui_debug_log(UIDebugComponent component, const char* format, ...);
+/* Show a short status message at the bottom of the window */
+void ui_show_status(const char* message);
+
+/* Fast-forward indicator: speed as a multiple of real time, negative while
+   not yet measured, 0 hides it */
+void ui_set_speed(float speed);
 
 #endif /* GB_UI_H */
@@ -0,0 +1,20 @@
+#ifndef GB_UI_DEBUG_H
+#define GB_UI_DEBUG_H
+
+#include <stdbool.h>
+
+/* Debug logging used by the emulation core. Kept apart from ui.h so the core
+   builds without SDL; the GUI implements it in ui.c, the headless runner in
+   headless.c. */
+typedef enum {
+    UI_DEBUG_PPU = 0,
+    UI_DEBUG_APU = 1,
+    UI_DEBUG_CPU = 2,
+    UI_DEBUG_MEM = 3,
+    UI_DEBUG_UI = 4
+} UIDebugComponent;
+
+bool ui_is_debug_enabled(UIDebugComponent component);
+void ui_debug_log(UIDebugComponent component, const char* format, ...);
+
+#endif /* GB_UI_DEBUG_H */
@@ -3,6 +3,9 @@
 #include "embedded_assets.h"
 #include "../ppu/ppu.h"
 #include "../input/input.h"
+#include "../apu/apu.h"
+#include "../audio/audio_ring.h"
+#include "../audio/resampler.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
@@ -19,16 +22,24 @@ static int g_windowed_w = 800;  /* Store windowed width */
 static int g_windowed_h = 600;  /* Store windowed height */
 static bool g_save_state_requested = false;
 static bool g_load_state_requested = false;
+static bool g_screenshot_requested = false;
 static char g_current_rom_path[2048] = {0};
 
 /* Audio state */
 static SDL_AudioDeviceID g_audio_device = 0;
-#define AUDIO_BUFFER_SIZE 4096
-static float g_audio_buffer[AUDIO_BUFFER_SIZE];
-static uint32_t g_audio_write_pos = 0;
-static uint32_t g_audio_read_pos = 0;
-static SDL_mutex* g_audio_mutex = NULL;
-static bool g_audio_muted = false;
+#define AUDIO_BUFFER_SIZE 8192   /* Floats, i.e. 4096 stereo frames */
+#define AUDIO_CALLBACK_CHUNK 512
+#define AUDIO_RESAMPLE_BLOCK 512
+static AudioRing g_audio_ring;
+static Resampler g_resampler;        /* Emulation thread only */
+static uint32_t g_audio_target_fill = 0;
+static uint32_t g_audio_period = 0;  /* Device buffer, in frames */
+static bool g_audio_paced = false;
+
+/* Audio-clock pacing: queue up to this many device buffers, then wait */
+#define AUDIO_PACE_BUFFERS 2
+#define AUDIO_PACE_TIMEOUT_MS 100
+static atomic_bool g_audio_muted = false;
 
 /* UI callback implementations */
 void ui_on_reset(void) {
@@ -43,35 +54,38 @@ void ui_on_load_state(void) {
     g_load_state_requested = true;
 }
 
+void ui_on_screenshot(void) {
+    g_screenshot_requested = true;
+}
+
 static void audio_callback(void* userdata, Uint8* stream, int len) {
     (void)userdata;
     int16_t* output = (int16_t*)stream;
     int samples_needed = len / sizeof(int16_t);
     
-    /* If muted, output silence */
-    if (g_audio_muted) {
-        memset(output, 0, len);
-        return;
-    }
-    
-    SDL_LockMutex(g_audio_mutex);
-    
-    int samples_available = (g_audio_write_pos - g_audio_read_pos + AUDIO_BUFFER_SIZE) % AUDIO_BUFFER_SIZE;
-    int samples_to_copy = samples_needed < samples_available ? samples_needed : samples_available;
-    
-    for (int i = 0; i < samples_to_copy; i++) {
-        float sample = g_audio_buffer[g_audio_read_pos];
-        /* Convert float [-1.0, 1.0] to int16_t */
-        output[i] = (int16_t)(sample * 32767.0f);
-        g_audio_read_pos = (g_audio_read_pos + 1) % AUDIO_BUFFER_SIZE;
-    }
-    
-    /* Fill remaining with silence */
-    for (int i = samples_to_copy; i < samples_needed; i++) {
-        output[i] = 0;
+    bool muted = atomic_load(&g_audio_muted);
+    
+    /* Never waits on the emulation thread: take what is there, pad with
+       silence (the ring counts the shortfall as an underrun). When muted the
+       samples are still consumed at the device rate, so audio pacing keeps
+       its clock. */
+    float chunk[AUDIO_CALLBACK_CHUNK];
+    for (int done = 0; done < samples_needed; ) {
+        uint32_t want = (uint32_t)(samples_needed - done);
+        if (want > AUDIO_CALLBACK_CHUNK) want = AUDIO_CALLBACK_CHUNK;
+        uint32_t got = audio_ring_read(&g_audio_ring, chunk, want);
+        if (muted) got = 0;
+        
+        for (uint32_t i = 0; i < got; i++) {
+            /* Convert float [-1.0, 1.0] to int16_t; band-limited steps may overshoot */
+            float sample = chunk[i];
+            if (sample > 1.0f) sample = 1.0f;
+            if (sample < -1.0f) sample = -1.0f;
+            output[done + i] = (int16_t)(sample * 32767.0f);
+        }
+        memset(output + done + got, 0, (want - got) * sizeof(int16_t));
+        done += want;
     }
-    
-    SDL_UnlockMutex(g_audio_mutex);
 }
 
 bool window_init(int scale, bool fullscreen, bool vsync) {
@@ -177,30 +191,35 @@ void window_destroy(void) {
 bool audio_init(void) {
     SDL_AudioSpec desired, obtained;
     
-    desired.freq = 44100;
+    desired.freq = SAMPLE_RATE;
     desired.format = AUDIO_S16SYS;
-    desired.channels = 1;
+    desired.channels = APU_OUTPUT_CHANNELS;
     desired.samples = 512;
     desired.callback = audio_callback;
     desired.userdata = NULL;
     
-    g_audio_mutex = SDL_CreateMutex();
-    if (!g_audio_mutex) {
-        fprintf(stderr, "Failed to create audio mutex: %s\n", SDL_GetError());
+    if (!audio_ring_init(&g_audio_ring, AUDIO_BUFFER_SIZE)) {
         return false;
     }
     
-    g_audio_device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, 0);
+    /* Take the device's native rate; the resampler converts to it */
+    g_audio_device = SDL_OpenAudioDevice(NULL, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
     if (g_audio_device == 0) {
         fprintf(stderr, "Failed to open audio device: %s\n", SDL_GetError());
-        SDL_DestroyMutex(g_audio_mutex);
-        g_audio_mutex = NULL;
+        audio_ring_cleanup(&g_audio_ring);
+        return false;
+    }
+    
+    if (!resampler_init(&g_resampler, SAMPLE_RATE, (uint32_t)obtained.freq)) {
+        SDL_CloseAudioDevice(g_audio_device);
+        g_audio_device = 0;
+        audio_ring_cleanup(&g_audio_ring);
         return false;
     }
     
-    memset(g_audio_buffer, 0, sizeof(g_audio_buffer));
-    g_audio_write_pos = 0;
-    g_audio_read_pos = 0;
+    /* Aim for the buffer being played plus two more queued (in frames) */
+    g_audio_period = obtained.samples;
+    g_audio_target_fill = obtained.samples * 3u;
     
     SDL_PauseAudioDevice(g_audio_device, 0);
     return true;
@@ -208,32 +227,57 @@ bool audio_init(void) {
 
 void audio_cleanup(void) {
     if (g_audio_device != 0) {
+        /* Closing stops the callback, so the ring can go */
         SDL_CloseAudioDevice(g_audio_device);
         g_audio_device = 0;
     }
-    if (g_audio_mutex) {
-        SDL_DestroyMutex(g_audio_mutex);
-        g_audio_mutex = NULL;
-    }
+    audio_ring_cleanup(&g_audio_ring);
 }
 
-void audio_queue_samples(const float* samples, uint32_t count) {
-    if (!g_audio_mutex || g_audio_device == 0) return;
-    
-    SDL_LockMutex(g_audio_mutex);
+void audio_queue_samples(const float* samples, uint32_t frames) {
+    if (g_audio_device == 0) return;
     
-    for (uint32_t i = 0; i < count; i++) {
-        uint32_t next_pos = (g_audio_write_pos + 1) % AUDIO_BUFFER_SIZE;
-        /* Don't overwrite unread samples */
-        if (next_pos == g_audio_read_pos) {
-            /* Buffer full, skip this sample */
-            break;
-        }
-        g_audio_buffer[g_audio_write_pos] = samples[i];
-        g_audio_write_pos = next_pos;
+    /* Steer the conversion ratio towards the target queue fill. Under audio
+       pacing production already follows the device, so the ratio stays put. */
+    if (!g_audio_paced) {
+        uint32_t queued = audio_ring_available(&g_audio_ring) / APU_OUTPUT_CHANNELS;
+        resampler_set_fill(&g_resampler, queued, g_audio_target_fill);
     }
     
-    SDL_UnlockMutex(g_audio_mutex);
+    /* Room for the largest rate change the device may ask for */
+    static float resampled[AUDIO_RESAMPLE_BLOCK * 8 * APU_OUTPUT_CHANNELS];
+    while (frames > 0) {
+        uint32_t block = frames < AUDIO_RESAMPLE_BLOCK ? frames : AUDIO_RESAMPLE_BLOCK;
+        uint32_t produced = resampler_process(&g_resampler, samples, block,
+                                              resampled, AUDIO_RESAMPLE_BLOCK * 8);
+        /* Whole frames only, so the ring never splits a left/right pair.
+           Whatever does not fit is dropped and counted as an overrun. */
+        audio_ring_write(&g_audio_ring, resampled, produced * APU_OUTPUT_CHANNELS);
+        samples += block * APU_OUTPUT_CHANNELS;
+        frames -= block;
+    }
+}
+
+bool audio_set_paced(bool paced) {
+    if (paced && g_audio_device == 0) return false;
+    g_audio_paced = paced;
+    if (paced) {
+        /* Back to the nominal ratio */
+        resampler_set_fill(&g_resampler, g_audio_target_fill, g_audio_target_fill);
+    }
+    return true;
+}
+
+void audio_wait_for_room(void) {
+    if (!g_audio_paced) return;
+    uint32_t level = g_audio_period * AUDIO_PACE_BUFFERS * APU_OUTPUT_CHANNELS;
+    /* A stalled device must not hang the emulator; carry on after the timeout */
+    audio_ring_wait(&g_audio_ring, level, AUDIO_PACE_TIMEOUT_MS);
+}
+
+void audio_get_stats(uint64_t* underruns, uint64_t* overruns) {
+    *underruns = audio_ring_underruns(&g_audio_ring);
+    *overruns = audio_ring_overruns(&g_audio_ring);
 }
 
 void window_present(const uint32_t* framebuffer) {
@@ -284,7 +328,31 @@ void window_present(const uint32_t* framebuffer) {
     SDL_RenderPresent(g_renderer);
 }
 
-bool window_poll_events(struct Memory* mem) {
+int window_get_refresh_rate(void) {
+    SDL_DisplayMode mode;
+    if (g_window && SDL_GetWindowDisplayMode(g_window, &mode) == 0 && mode.refresh_rate > 0) {
+        return mode.refresh_rate;
+    }
+    return 60;
+}
+
+/* Keyboard mapping; 0 for keys that are not a Game Boy button */
+static Joypad_Button key_button(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_RIGHT:  return JP_RIGHT;
+        case SDLK_LEFT:   return JP_LEFT;
+        case SDLK_UP:     return JP_UP;
+        case SDLK_DOWN:   return JP_DOWN;
+        case SDLK_z:      return JP_A;
+        case SDLK_x:      return JP_B;
+        case SDLK_RETURN: return JP_START;
+        case SDLK_RSHIFT:
+        case SDLK_LSHIFT: return JP_SELECT;
+        default:          return (Joypad_Button)0;
+    }
+}
+
+bool window_poll_events(CommandQueue* commands, CommandQueue* input) {
     SDL_Event ev;
     while (SDL_PollEvent(&ev)) {
         /* Let UI handle the event first */
@@ -328,35 +396,31 @@ bool window_poll_events(struct Memory* mem) {
                 return true;
             }
             
-            /* Game input only when not paused and UI not using keyboard */
-            if (mem && !ui_is_paused() && !ui_wants_keyboard()) {
-                switch (ev.key.keysym.sym) {
-                    case SDLK_RIGHT: input_press(mem, JP_RIGHT); break;
-                    case SDLK_LEFT:  input_press(mem, JP_LEFT);  break;
-                    case SDLK_UP:    input_press(mem, JP_UP);    break;
-                    case SDLK_DOWN:  input_press(mem, JP_DOWN);  break;
-                    case SDLK_z:     input_press(mem, JP_A);     break; /* A */
-                    case SDLK_x:     input_press(mem, JP_B);     break; /* B */
-                    case SDLK_RETURN:input_press(mem, JP_START); break;
-                    case SDLK_RSHIFT:input_press(mem, JP_SELECT);break;
-                    case SDLK_LSHIFT:input_press(mem, JP_SELECT);break;
-                    default: break;
+            /* Game input only when not paused and UI not using keyboard;
+               key repeat would only resend a held button */
+            if (commands && !ev.key.repeat && !ui_is_paused() && !ui_wants_keyboard()) {
+                if (ev.key.keysym.sym == SDLK_BACKSPACE) {
+                    command_queue_push(commands, COMMAND_REWIND, 1);   /* Hold to rewind */
+                } else if (ev.key.keysym.sym == SDLK_TAB) {
+                    command_queue_push(commands, COMMAND_FAST_FORWARD, 1);   /* Hold to fast-forward */
+                } else if (ev.key.keysym.sym == SDLK_BACKQUOTE) {
+                    command_queue_push(commands, COMMAND_FAST_FORWARD_TOGGLE, 0);
                 }
+                Joypad_Button button = key_button(ev.key.keysym.sym);
+                if (button) command_queue_push(input, COMMAND_BUTTON_PRESS, button);
             }
         } else if (ev.type == SDL_KEYUP) {
-            if (mem && !ui_is_paused() && !ui_wants_keyboard()) {
-                switch (ev.key.keysym.sym) {
-                    case SDLK_RIGHT: input_release(mem, JP_RIGHT); break;
-                    case SDLK_LEFT:  input_release(mem, JP_LEFT);  break;
-                    case SDLK_UP:    input_release(mem, JP_UP);    break;
-                    case SDLK_DOWN:  input_release(mem, JP_DOWN);  break;
-                    case SDLK_z:     input_release(mem, JP_A);     break;
-                    case SDLK_x:     input_release(mem, JP_B);     break;
-                    case SDLK_RETURN:input_release(mem, JP_START); break;
-                    case SDLK_RSHIFT:input_release(mem, JP_SELECT);break;
-                    case SDLK_LSHIFT:input_release(mem, JP_SELECT);break;
-                    default: break;
-                }
+            if (!commands) continue;
+            /* Always release rewind and fast-forward so they cannot get
+               stuck behind a menu */
+            if (ev.key.keysym.sym == SDLK_BACKSPACE) {
+                command_queue_push(commands, COMMAND_REWIND, 0);
+            } else if (ev.key.keysym.sym == SDLK_TAB) {
+                command_queue_push(commands, COMMAND_FAST_FORWARD, 0);
+            }
+            if (!ui_is_paused() && !ui_wants_keyboard()) {
+                Joypad_Button button = key_button(ev.key.keysym.sym);
+                if (button) command_queue_push(input, COMMAND_BUTTON_RELEASE, button);
             }
         }
     }
@@ -364,7 +428,7 @@ bool window_poll_events(struct Memory* mem) {
 }
 
 void audio_set_muted(bool muted) {
-    g_audio_muted = muted;
+    atomic_store(&g_audio_muted, muted);
 }
 
 void window_request_reset(void) {
@@ -443,6 +507,12 @@ bool window_get_save_state_requested(void) {
     return requested;
 }
 
+bool window_get_screenshot_requested(void) {
+    bool requested = g_screenshot_requested;
+    g_screenshot_requested = false;  /* Clear flag after reading */
+    return requested;
+}
+
 bool window_get_load_state_requested(void) {
     bool requested = g_load_state_requested;
     g_load_state_requested = false;  /* Clear flag after reading */
@@ -4,7 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-struct Memory;
+#include "../command_queue.h"
 
 /* Initialize the video/window subsystem.
  * scale: integer scale factor for the 160x144 framebuffer (default: 3)
@@ -19,15 +19,32 @@ void window_destroy(void);
 */
 void window_present(const uint32_t* framebuffer);
 
-/* Poll window events and map keyboard to GB input. Returns true if user requested quit. */
-bool window_poll_events(struct Memory* mem);
+/* Refresh rate of the display the window is on, 60 if unknown */
+int window_get_refresh_rate(void);
+
+/* Poll window events and send keyboard input to the emulation thread:
+   COMMAND_REWIND and COMMAND_FAST_FORWARD* on commands, COMMAND_BUTTON_* on
+   input, which the emulation thread also drains mid-frame when the game
+   reads the joypad. Nothing is sent with commands NULL (no ROM running).
+   Returns true if user requested quit. */
+bool window_poll_events(CommandQueue* commands, CommandQueue* input);
 
 /* Audio functions */
 bool audio_init(void);
 void audio_cleanup(void);
-void audio_queue_samples(const float* samples, uint32_t count);
+/* Queue frames of interleaved left/right samples */
+void audio_queue_samples(const float* samples, uint32_t frames);
 void audio_set_muted(bool muted);
 
+/* Audio-clock pacing: instead of the display, the audio device sets the
+   emulation speed. audio_wait_for_room() blocks until the queue is down to
+   two device buffers. Fails without an audio device. */
+bool audio_set_paced(bool paced);
+void audio_wait_for_room(void);
+
+/* Samples the audio callback went without / the queue had to drop */
+void audio_get_stats(uint64_t* underruns, uint64_t* overruns);
+
 /* Emulator control functions */
 void window_request_reset(void);
 bool window_get_reset_requested(void);
@@ -45,6 +62,7 @@ int window_get_scaling_mode(void);  /* returns: 0=nearest, 1=linear, 2=best */
 /* Save/load state functions */
 bool window_get_save_state_requested(void);
 bool window_get_load_state_requested(void);
+bool window_get_screenshot_requested(void);
 void window_set_rom_path(const char* path);
 const char* window_get_rom_path(void);
 
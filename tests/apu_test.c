@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "../src/gbendo.h"
+
+#define FRAME_CYCLES 70224
+
+static APU a, b;
+static float out_a[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+static float out_b[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+
+/* All four channels running, with length counters enabled on the pulses */
+static void start_channels(APU* apu) {
+    apu_cleanup(apu);
+    apu_init(apu);
+    apu_write_register(apu, 0xFF11, 0x80 | 0x20);   /* 50% duty, length 32 */
+    apu_write_register(apu, 0xFF12, 0xF3);          /* Decaying envelope */
+    apu_write_register(apu, 0xFF13, 0x40);
+    apu_write_register(apu, 0xFF14, 0xC6);          /* Length enable, trigger */
+    apu_write_register(apu, 0xFF17, 0xA0);
+    apu_write_register(apu, 0xFF18, 0x10);
+    apu_write_register(apu, 0xFF19, 0x85);
+    for (uint16_t addr = 0xFF30; addr < 0xFF40; addr++) {
+        apu_write_register(apu, addr, (uint8_t)(addr * 37));
+    }
+    apu_write_register(apu, 0xFF1A, 0x80);
+    apu_write_register(apu, 0xFF1C, 0x20);
+    apu_write_register(apu, 0xFF1D, 0x80);
+    apu_write_register(apu, 0xFF1E, 0x87);
+    apu_write_register(apu, 0xFF21, 0x81);
+    apu_write_register(apu, 0xFF22, 0x21);
+    apu_write_register(apu, 0xFF23, 0x80);
+}
+
+static void test_length_counter_runs_at_256hz(void) {
+    start_channels(&a);
+
+    /* 32 length clocks at 256 Hz: 32 * 16384 cycles */
+    apu_step(&a, 32 * 16384 - 16384);
+    TEST_ASSERT_EQUAL_HEX8(0x01, apu_read_register(&a, 0xFF26) & 0x01);
+    apu_step(&a, 16384);
+    TEST_ASSERT_EQUAL_HEX8(0x00, apu_read_register(&a, 0xFF26) & 0x01);
+    TEST_ASSERT_EQUAL_HEX8(0x02, apu_read_register(&a, 0xFF26) & 0x02);
+}
+
+static void test_lazy_sync_matches_fine_stepping(void) {
+    start_channels(&a);
+    start_channels(&b);
+
+    for (int frame = 0; frame < 20; frame++) {
+        /* a: synced after every instruction; b: the whole frame at once */
+        for (uint32_t c = 0; c < FRAME_CYCLES; c += 4) {
+            apu_step(&a, 4);
+            apu_read_register(&a, 0xFF26);
+        }
+        apu_step(&b, FRAME_CYCLES);
+        apu_end_frame(&a);
+        apu_end_frame(&b);
+
+        uint32_t count = apu_drain(&a, out_a, APU_BUFFER_SAMPLES);
+        TEST_ASSERT_EQUAL_UINT32(count, apu_drain(&b, out_b, APU_BUFFER_SAMPLES));
+        /* Deltas may be summed in another order */
+        for (uint32_t i = 0; i < count * APU_OUTPUT_CHANNELS; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, out_a[i], out_b[i]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(a.pulse1.duty_position, b.pulse1.duty_position);
+    TEST_ASSERT_EQUAL_UINT16(a.pulse2.frequency_timer, b.pulse2.frequency_timer);
+    TEST_ASSERT_EQUAL_UINT8(a.wave.wave_position, b.wave.wave_position);
+    TEST_ASSERT_EQUAL_UINT16(a.noise.lfsr, b.noise.lfsr);
+    TEST_ASSERT_EQUAL_UINT8(a.noise.volume, b.noise.volume);
+}
+
+static void test_register_write_syncs_first(void) {
+    start_channels(&a);
+    start_channels(&b);
+
+    /* Panning pulse 2 off mid-frame must not rewrite what it already played */
+    apu_step(&a, 30000);
+    apu_step(&b, 30000);
+    apu_write_register(&a, 0xFF25, 0xDD);
+    apu_step(&a, FRAME_CYCLES - 30000);
+    apu_step(&b, FRAME_CYCLES - 30000);
+    apu_end_frame(&a);
+    apu_end_frame(&b);
+
+    uint32_t count = apu_drain(&a, out_a, APU_BUFFER_SAMPLES);
+    apu_drain(&b, out_b, APU_BUFFER_SAMPLES);
+    uint32_t write_sample = (uint32_t)(30000.0 * SAMPLE_RATE / CPU_CLOCK_SPEED);
+    TEST_ASSERT_EQUAL_MEMORY(out_a, out_b,
+                             (write_sample - BLIP_KERNEL_TAPS) * APU_OUTPUT_CHANNELS * sizeof(float));
+    TEST_ASSERT_FALSE(memcmp(out_a, out_b, count * APU_OUTPUT_CHANNELS * sizeof(float)) == 0);
+}
+
+static void test_panning_reaches_one_side_only(void) {
+    start_channels(&a);
+    apu_write_register(&a, 0xFF25, 0x10);   /* Pulse 1, left only */
+    apu_write_register(&a, 0xFF24, 0x70);   /* Left at full volume, right muted */
+
+    float left_peak = 0.0f, right_peak = 0.0f;
+    for (int frame = 0; frame < 5; frame++) {
+        apu_step(&a, FRAME_CYCLES);
+        apu_end_frame(&a);
+        uint32_t count = apu_drain(&a, out_a, APU_BUFFER_SAMPLES);
+        for (uint32_t i = 0; i < count; i++) {
+            float l = out_a[i * 2], r = out_a[i * 2 + 1];
+            if (l < 0) l = -l;
+            if (r < 0) r = -r;
+            if (l > left_peak) left_peak = l;
+            if (r > right_peak) right_peak = r;
+        }
+    }
+    TEST_ASSERT_TRUE(left_peak > 0.1f);
+    /* Only the start_channels() writes before panning reach the right side */
+    TEST_ASSERT_TRUE(right_peak < 0.01f);
+}
+
+static void test_stems_separate_the_channels(void) {
+    static float stems[APU_BUFFER_SAMPLES * APU_STEM_CHANNELS];
+    start_channels(&a);
+    TEST_ASSERT_EQUAL_UINT32(0, apu_drain_stems(&a, stems, APU_BUFFER_SAMPLES));
+    TEST_ASSERT_TRUE(apu_enable_stems(&a, true));
+    apu_write_register(&a, 0xFF25, 0x11);   /* Only pulse 1 is heard */
+
+    apu_step(&a, FRAME_CYCLES);
+    apu_end_frame(&a);
+    uint32_t count = apu_drain_stems(&a, stems, APU_BUFFER_SAMPLES);
+    TEST_ASSERT_TRUE(count == 738 || count == 739);
+
+    float peak[APU_STEM_CHANNELS] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        for (int ch = 0; ch < APU_STEM_CHANNELS; ch++) {
+            float s = stems[i * APU_STEM_CHANNELS + ch];
+            if (s > peak[ch]) peak[ch] = s;
+        }
+    }
+    TEST_ASSERT_TRUE(peak[0] > 0.5f);
+    TEST_ASSERT_TRUE(peak[1] < 0.01f && peak[2] < 0.01f && peak[3] < 0.01f);
+
+    /* Reset keeps them on, cleanup frees them */
+    apu_reset(&a);
+    TEST_ASSERT_NOT_NULL(a.stems);
+    apu_cleanup(&a);
+    TEST_ASSERT_NULL(a.stems);
+}
+
+static void test_undrained_output_is_kept(void) {
+    start_channels(&a);
+    start_channels(&b);
+
+    /* a drains every frame; b only after five, more than one buffer's worth */
+    static float all_a[5 * APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    uint32_t total_a = 0;
+    for (int frame = 0; frame < 5; frame++) {
+        apu_step(&a, FRAME_CYCLES);
+        apu_step(&b, FRAME_CYCLES);
+        apu_end_frame(&a);
+        apu_end_frame(&b);
+        total_a += apu_drain(&a, all_a + total_a * APU_OUTPUT_CHANNELS, APU_BUFFER_SAMPLES);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, apu_drain(&a, out_a, APU_BUFFER_SAMPLES));
+
+    /* Drained in small pieces, b yields the same stream, in order */
+    uint32_t total_b = 0, n;
+    while ((n = apu_drain(&b, out_b, 100)) > 0) {
+        TEST_ASSERT_EQUAL_MEMORY(all_a + total_b * APU_OUTPUT_CHANNELS, out_b,
+                                 n * APU_OUTPUT_CHANNELS * sizeof(float));
+        total_b += n;
+    }
+    TEST_ASSERT_EQUAL_UINT32(total_a, total_b);
+    TEST_ASSERT_TRUE(total_b > 5 * 738 - 1);
+    TEST_ASSERT_EQUAL_UINT64(0, b.output.buffer.dropped);
+}
+
+static void test_decimation_keeps_the_stream_continuous(void) {
+    start_channels(&a);
+    apu_set_decimation(&a, 4);
+
+    /* The frame in progress still runs at the old rate */
+    apu_step(&a, FRAME_CYCLES);
+    apu_end_frame(&a);
+    uint32_t count = apu_drain(&a, out_a, APU_BUFFER_SAMPLES);
+    TEST_ASSERT_TRUE(count == 738 || count == 739);
+
+    /* Four frames of emulation now make one frame of audio */
+    count = 0;
+    for (int frame = 0; frame < 4; frame++) {
+        apu_step(&a, FRAME_CYCLES);
+        apu_end_frame(&a);
+        count += apu_drain(&a, out_a, APU_BUFFER_SAMPLES);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 738, count);
+
+    apu_set_decimation(&a, 1000);
+    TEST_ASSERT_EQUAL_UINT32(APU_MAX_DECIMATION, a.output.decimation);
+    apu_cleanup(&a);
+    apu_cleanup(&b);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_length_counter_runs_at_256hz);
+    RUN_TEST(test_lazy_sync_matches_fine_stepping);
+    RUN_TEST(test_register_write_syncs_first);
+    RUN_TEST(test_panning_reaches_one_side_only);
+    RUN_TEST(test_stems_separate_the_channels);
+    RUN_TEST(test_undrained_output_is_kept);
+    RUN_TEST(test_decimation_keeps_the_stream_continuous);
+    return UnityEnd();
+}
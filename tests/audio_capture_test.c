@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "../src/audio/audio_capture.h"
+
+#define CAPTURE_WAV "/tmp/gbendo_capture_test.wav"
+#define CAPTURE_RAW "/tmp/gbendo_capture_test.raw"
+
+/* More than the ring holds, so the producer has to wait for the writer */
+#define FRAMES 100000
+
+static float frames[FRAMES * 2];
+static float read_back[FRAMES * 2];
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void fill_frames(void) {
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        frames[i * 2] = (float)i;
+        frames[i * 2 + 1] = -(float)i;
+    }
+}
+
+static void test_wav_holds_every_frame(void) {
+    fill_frames();
+    AudioCapture cap;
+    TEST_ASSERT_EQUAL_INT(AUDIO_CAPTURE_WAV, audio_capture_format_for_path(CAPTURE_WAV));
+    TEST_ASSERT_TRUE(audio_capture_open(&cap, CAPTURE_WAV, AUDIO_CAPTURE_WAV, 2, 44100));
+
+    /* Uneven blocks, like a frame's worth of samples at a time */
+    for (uint32_t done = 0; done < FRAMES; ) {
+        uint32_t n = FRAMES - done < 738 ? FRAMES - done : 738;
+        TEST_ASSERT_TRUE(audio_capture_write(&cap, frames + done * 2, n));
+        done += n;
+    }
+    TEST_ASSERT_TRUE(audio_capture_close(&cap));
+
+    FILE* f = fopen(CAPTURE_WAV, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t header[58];
+    TEST_ASSERT_EQUAL_UINT32(sizeof(header), fread(header, 1, sizeof(header), f));
+    TEST_ASSERT_EQUAL_MEMORY("RIFF", header, 4);
+    TEST_ASSERT_EQUAL_MEMORY("WAVE", header + 8, 4);
+    TEST_ASSERT_EQUAL_UINT32(3, header[20] | (header[21] << 8));       /* IEEE float */
+    TEST_ASSERT_EQUAL_UINT32(2, header[22] | (header[23] << 8));
+    TEST_ASSERT_EQUAL_UINT32(44100, read_u32(header + 24));
+    TEST_ASSERT_EQUAL_UINT32(FRAMES, read_u32(header + 46));
+    TEST_ASSERT_EQUAL_MEMORY("data", header + 50, 4);
+    TEST_ASSERT_EQUAL_UINT32(FRAMES * 2 * sizeof(float), read_u32(header + 54));
+
+    TEST_ASSERT_EQUAL_UINT32(FRAMES * 2, fread(read_back, sizeof(float), FRAMES * 2, f));
+    TEST_ASSERT_EQUAL_MEMORY(frames, read_back, sizeof(frames));
+    fclose(f);
+    remove(CAPTURE_WAV);
+}
+
+static void test_raw_has_no_header(void) {
+    fill_frames();
+    AudioCapture cap;
+    TEST_ASSERT_EQUAL_INT(AUDIO_CAPTURE_RAW, audio_capture_format_for_path(CAPTURE_RAW));
+    TEST_ASSERT_TRUE(audio_capture_open(&cap, CAPTURE_RAW, AUDIO_CAPTURE_RAW, 4, 44100));
+    TEST_ASSERT_TRUE(audio_capture_write(&cap, frames, FRAMES / 2));
+    TEST_ASSERT_TRUE(audio_capture_close(&cap));
+
+    FILE* f = fopen(CAPTURE_RAW, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_UINT32(FRAMES * 2, fread(read_back, sizeof(float), FRAMES * 2 + 1, f));
+    TEST_ASSERT_EQUAL_MEMORY(frames, read_back, sizeof(frames));
+    fclose(f);
+    remove(CAPTURE_RAW);
+
+    TEST_ASSERT_FALSE(audio_capture_open(&cap, "/nonexistent/dir/x.wav", AUDIO_CAPTURE_WAV, 2, 44100));
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_wav_holds_every_frame);
+    RUN_TEST(test_raw_has_no_header);
+    return UnityEnd();
+}
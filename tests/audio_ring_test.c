@@ -0,0 +1,133 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+#include "vendor/unity.h"
+#include "../src/audio/audio_ring.h"
+
+static void test_capacity_rounds_to_power_of_two(void) {
+    AudioRing ring;
+    TEST_ASSERT_TRUE(audio_ring_init(&ring, 3000));
+    TEST_ASSERT_EQUAL_UINT32(4096, audio_ring_capacity(&ring));
+    audio_ring_cleanup(&ring);
+
+    TEST_ASSERT_TRUE(audio_ring_init(&ring, 1024));
+    TEST_ASSERT_EQUAL_UINT32(1024, audio_ring_capacity(&ring));
+    audio_ring_cleanup(&ring);
+}
+
+static void test_wraps_in_order_and_counts(void) {
+    AudioRing ring;
+    TEST_ASSERT_TRUE(audio_ring_init(&ring, 8));
+    float in[8], out[8];
+    for (int i = 0; i < 8; i++) in[i] = (float)i;
+
+    /* Move the indices so the next write straddles the end */
+    TEST_ASSERT_EQUAL_UINT32(6, audio_ring_write(&ring, in, 6));
+    TEST_ASSERT_EQUAL_UINT32(6, audio_ring_read(&ring, out, 6));
+
+    /* 8 asked, 8 fit; 3 more overrun */
+    TEST_ASSERT_EQUAL_UINT32(8, audio_ring_write(&ring, in, 8));
+    TEST_ASSERT_EQUAL_UINT32(0, audio_ring_write(&ring, in, 3));
+    TEST_ASSERT_EQUAL_UINT64(3, audio_ring_overruns(&ring));
+    TEST_ASSERT_EQUAL_UINT32(8, audio_ring_available(&ring));
+
+    TEST_ASSERT_EQUAL_UINT32(5, audio_ring_read(&ring, out, 5));
+    for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL_FLOAT((float)i, out[i]);
+
+    /* 3 left, 8 asked: 5 underrun */
+    TEST_ASSERT_EQUAL_UINT32(3, audio_ring_read(&ring, out, 8));
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_FLOAT((float)(i + 5), out[i]);
+    TEST_ASSERT_EQUAL_UINT64(5, audio_ring_underruns(&ring));
+
+    audio_ring_write(&ring, in, 4);
+    audio_ring_clear(&ring);
+    TEST_ASSERT_EQUAL_UINT32(0, audio_ring_available(&ring));
+    audio_ring_cleanup(&ring);
+}
+
+#define STRESS_SAMPLES 200000
+
+static AudioRing stress_ring;
+
+static void* stress_producer(void* arg) {
+    (void)arg;
+    float block[97];
+    uint32_t next = 0;
+    while (next < STRESS_SAMPLES) {
+        uint32_t n = STRESS_SAMPLES - next < 97 ? STRESS_SAMPLES - next : 97;
+        for (uint32_t i = 0; i < n; i++) block[i] = (float)(next + i);
+        /* Retry what did not fit so the sequence stays unbroken */
+        uint32_t done = 0;
+        while ((done += audio_ring_write(&stress_ring, block + done, n - done)) < n) {
+            sched_yield();
+        }
+        next += n;
+    }
+    return NULL;
+}
+
+static void test_threads_see_one_ordered_stream(void) {
+    TEST_ASSERT_TRUE(audio_ring_init(&stress_ring, 256));
+    pthread_t producer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&producer, NULL, stress_producer, NULL));
+
+    float block[61];
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < STRESS_SAMPLES) {
+        uint32_t got = audio_ring_read(&stress_ring, block, 61);
+        if (got == 0) sched_yield();
+        for (uint32_t i = 0; i < got; i++) {
+            if (block[i] != (float)expected++) in_order = false;
+        }
+    }
+    pthread_join(producer, NULL);
+
+    TEST_ASSERT_TRUE(in_order);
+    TEST_ASSERT_EQUAL_UINT32(0, audio_ring_available(&stress_ring));
+    audio_ring_cleanup(&stress_ring);
+}
+
+static AudioRing paced_ring;
+
+/* Plays 64 samples every millisecond, like a small device buffer */
+static void* paced_consumer(void* arg) {
+    (void)arg;
+    float block[64];
+    struct timespec period = {0, 1000000L};
+    for (int i = 0; i < 24; i++) {
+        nanosleep(&period, NULL);
+        audio_ring_read(&paced_ring, block, 64);
+    }
+    return NULL;
+}
+
+static void test_wait_blocks_until_drained(void) {
+    TEST_ASSERT_TRUE(audio_ring_init(&paced_ring, 1024));
+    static float block[1024];
+    TEST_ASSERT_EQUAL_UINT32(1024, audio_ring_write(&paced_ring, block, 1024));
+
+    /* Already below the level: returns at once */
+    TEST_ASSERT_TRUE(audio_ring_wait(&paced_ring, 1024, 1000));
+
+    pthread_t consumer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&consumer, NULL, paced_consumer, NULL));
+    TEST_ASSERT_TRUE(audio_ring_wait(&paced_ring, 512, 1000));
+    TEST_ASSERT_TRUE(audio_ring_available(&paced_ring) <= 512);
+    pthread_join(consumer, NULL);
+
+    /* Nobody reading: gives up after the timeout */
+    audio_ring_write(&paced_ring, block, 1024);
+    TEST_ASSERT_FALSE(audio_ring_wait(&paced_ring, 0, 20));
+    audio_ring_cleanup(&paced_ring);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_capacity_rounds_to_power_of_two);
+    RUN_TEST(test_wraps_in_order_and_counts);
+    RUN_TEST(test_threads_see_one_ordered_stream);
+    RUN_TEST(test_wait_blocks_until_drained);
+    return UnityEnd();
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/headless/batch.h"
+
+#define GOOD_ROM  "tests/batch_test_good.gb"
+#define CRASH_ROM "tests/batch_test_crash.gb"
+#define HANG_ROM  "tests/batch_test_hang.gb"
+#define JOBS_PATH "tests/batch_test_jobs.txt"
+
+#define JOB_COUNT 12
+
+/* 32KB ROM-only cartridge running code at 0150 */
+static bool write_program(const char* path, const uint8_t* program, size_t size) {
+    static uint8_t rom[0x8000];
+    memset(rom, 0, sizeof(rom));
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    memcpy(&rom[0x100], entry, sizeof(entry));
+    memcpy(&rom[0x150], program, size);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t written = fwrite(rom, 1, sizeof(rom), f);
+    fclose(f);
+    return written == sizeof(rom);
+}
+
+static void write_roms(void) {
+    TEST_ASSERT_TRUE(test_rom_write(GOOD_ROM, 0x03, 0x02));
+
+    const uint8_t crash[] = { 0x00, 0xD3 };                     /* NOP / invalid */
+    TEST_ASSERT_TRUE(write_program(CRASH_ROM, crash, sizeof(crash)));
+
+    const uint8_t hang[] = { 0xF3, 0xAF, 0xE0, 0xFF, 0x76 };    /* DI / IE=0 / HALT */
+    TEST_ASSERT_TRUE(write_program(HANG_ROM, hang, sizeof(hang)));
+}
+
+static void remove_roms(void) {
+    remove(GOOD_ROM);
+    remove(CRASH_ROM);
+    remove(HANG_ROM);
+}
+
+static void make_job(BatchJob* job, const char* rom, uint32_t frames) {
+    snprintf(job->rom, sizeof(job->rom), "%s", rom);
+    job->frames = frames;
+}
+
+static void test_pool_runs_every_job_and_detects_failures(void) {
+    write_roms();
+
+    BatchJob jobs[JOB_COUNT];
+    for (int i = 0; i < JOB_COUNT; i++) {
+        /* Uneven lengths so the workers have to steal */
+        make_job(&jobs[i], GOOD_ROM, i < 3 ? 40 : 5);
+    }
+    make_job(&jobs[4], CRASH_ROM, 30);
+    make_job(&jobs[7], HANG_ROM, 30);
+    make_job(&jobs[9], "tests/no_such_rom.gb", 30);
+
+    BatchResult serial[JOB_COUNT];
+    BatchResult parallel[JOB_COUNT];
+    TEST_ASSERT_TRUE(batch_run(jobs, serial, JOB_COUNT, 1));
+    TEST_ASSERT_TRUE(batch_run(jobs, parallel, JOB_COUNT, 4));
+
+    for (int i = 0; i < JOB_COUNT; i++) {
+        BatchStatus expected = i == 4 ? BATCH_CRASHED : i == 7 ? BATCH_HUNG :
+                               i == 9 ? BATCH_LOAD_FAILED : BATCH_OK;
+        TEST_ASSERT_EQUAL_INT(expected, parallel[i].status);
+        TEST_ASSERT_EQUAL_INT(serial[i].status, parallel[i].status);
+        TEST_ASSERT_EQUAL_UINT32(serial[i].frames, parallel[i].frames);
+        TEST_ASSERT_EQUAL_UINT64(serial[i].cycles, parallel[i].cycles);
+        TEST_ASSERT_EQUAL_UINT64(serial[i].instructions, parallel[i].instructions);
+        TEST_ASSERT_EQUAL_UINT64(serial[i].final_hash, parallel[i].final_hash);
+        if (expected == BATCH_OK) {
+            TEST_ASSERT_EQUAL_UINT32(jobs[i].frames, parallel[i].frames);
+        }
+    }
+
+    /* Failures stop on the frame they are found, where the CPU stopped */
+    TEST_ASSERT_EQUAL_UINT32(1, parallel[4].frames);
+    TEST_ASSERT_EQUAL_HEX16(0x0152, parallel[4].pc);
+    TEST_ASSERT_EQUAL_UINT32(1, parallel[7].frames);
+    TEST_ASSERT_EQUAL_HEX16(0x0155, parallel[7].pc);
+    TEST_ASSERT_EQUAL_UINT32(0, parallel[9].frames);
+
+    /* A reused emulator gives the same result as a fresh one */
+    GBEmulator* gb = malloc(sizeof(GBEmulator));
+    gb_init(gb);
+    BatchResult fresh;
+    batch_run_job(gb, &jobs[5], &fresh);
+    gb_cleanup(gb);
+    free(gb);
+    TEST_ASSERT_EQUAL_UINT64(fresh.final_hash, parallel[5].final_hash);
+    TEST_ASSERT_EQUAL_UINT64(fresh.instructions, parallel[5].instructions);
+
+    remove_roms();
+}
+
+static void test_job_list_parsing(void) {
+    FILE* f = fopen(JOBS_PATH, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fputs("# nightly sweep\n"
+          "\n"
+          "roms/a game.gb\n"
+          "  roms/b.gbc frames=120  \n", f);
+    fclose(f);
+
+    BatchJob* jobs;
+    uint32_t count;
+    TEST_ASSERT_TRUE(batch_load_jobs(JOBS_PATH, 600, &jobs, &count));
+    TEST_ASSERT_EQUAL_UINT32(2, count);
+    TEST_ASSERT_EQUAL_STRING("roms/a game.gb", jobs[0].rom);
+    TEST_ASSERT_EQUAL_UINT32(600, jobs[0].frames);
+    TEST_ASSERT_EQUAL_STRING("roms/b.gbc", jobs[1].rom);
+    TEST_ASSERT_EQUAL_UINT32(120, jobs[1].frames);
+    free(jobs);
+
+    f = fopen(JOBS_PATH, "w");
+    fputs("roms/a.gb frames=abc\n", f);
+    fclose(f);
+    TEST_ASSERT_FALSE(batch_load_jobs(JOBS_PATH, 600, &jobs, &count));
+    TEST_ASSERT_NULL(jobs);
+
+    f = fopen(JOBS_PATH, "w");
+    fputs("# nothing to do\n", f);
+    fclose(f);
+    TEST_ASSERT_FALSE(batch_load_jobs(JOBS_PATH, 600, &jobs, &count));
+    remove(JOBS_PATH);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_pool_runs_every_job_and_detects_failures);
+    RUN_TEST(test_job_list_parsing);
+    return UnityEnd();
+}
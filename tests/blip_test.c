@@ -0,0 +1,102 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "../src/gbendo.h"
+#include "../src/apu/blip.h"
+
+#define FRAME_CYCLES 70224
+
+static BlipBuffer blip;
+static float samples[BLIP_MAX_SAMPLES];
+
+static void test_step_settles_within_kernel(void) {
+    blip_init(&blip, CPU_CLOCK_SPEED, SAMPLE_RATE);
+    blip_add_delta(&blip, 1000, 1.0f);
+    uint32_t count = blip_end_frame(&blip, FRAME_CYCLES, samples, BLIP_MAX_SAMPLES);
+    TEST_ASSERT_TRUE(count >= 738);
+
+    /* Silent before the kernel, settled after it, bounded overshoot between */
+    uint32_t start = (uint32_t)(1000.0 * SAMPLE_RATE / CPU_CLOCK_SPEED);
+    float peak = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i < start) TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, samples[i]);
+        if (i > start + BLIP_KERNEL_TAPS) TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, samples[i]);
+        if (samples[i] > peak) peak = samples[i];
+    }
+    TEST_ASSERT_TRUE(peak > 1.0f && peak < 1.15f);
+}
+
+static void test_sample_count_tracks_clock(void) {
+    blip_init(&blip, CPU_CLOCK_SPEED, SAMPLE_RATE);
+
+    /* 600 frames: the fractional sample carried between frames adds up */
+    uint64_t total = 0;
+    for (int frame = 0; frame < 600; frame++) {
+        uint32_t count = blip_end_frame(&blip, FRAME_CYCLES, samples, BLIP_MAX_SAMPLES);
+        TEST_ASSERT_TRUE(count == 738 || count == 739);
+        total += count;
+    }
+    uint64_t expected = (uint64_t)600 * FRAME_CYCLES * SAMPLE_RATE / CPU_CLOCK_SPEED;
+    TEST_ASSERT_TRUE(total + 1 >= expected && total <= expected);
+}
+
+static void test_tail_carries_into_next_frame(void) {
+    blip_init(&blip, CPU_CLOCK_SPEED, SAMPLE_RATE);
+
+    /* A step right at the end of a frame finishes rising in the next one */
+    blip_add_delta(&blip, FRAME_CYCLES - 1, 0.5f);
+    uint32_t count = blip_end_frame(&blip, FRAME_CYCLES, samples, BLIP_MAX_SAMPLES);
+    TEST_ASSERT_TRUE(samples[count - 1] < 0.5f);
+
+    count = blip_end_frame(&blip, FRAME_CYCLES, samples, BLIP_MAX_SAMPLES);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.5f, samples[count - 1]);
+
+    /* Samples that do not fit are dropped but still integrated */
+    blip_add_delta(&blip, 0, -0.5f);
+    count = blip_end_frame(&blip, FRAME_CYCLES, samples, 4);
+    TEST_ASSERT_TRUE(count > 4);
+    count = blip_end_frame(&blip, FRAME_CYCLES, samples, BLIP_MAX_SAMPLES);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, samples[count - 1]);
+}
+
+static void test_apu_square_wave_has_no_dc(void) {
+    static APU apu;
+    apu_init(&apu);
+    apu_write_register(&apu, 0xFF12, 0xF0);   /* Full volume, no envelope */
+    apu_write_register(&apu, 0xFF13, 0x00);
+    apu_write_register(&apu, 0xFF14, 0x87);   /* 512 Hz, trigger */
+
+    static float out[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    uint32_t count = 0;
+    for (int frame = 0; frame < 30; frame++) {
+        for (uint32_t c = 0; c < FRAME_CYCLES; c += 4) {
+            apu_step(&apu, 4);
+        }
+        apu_end_frame(&apu);
+        count = apu_drain(&apu, out, APU_BUFFER_SAMPLES);
+        TEST_ASSERT_TRUE(count == 738 || count == 739);
+    }
+
+    /* After the high-pass settles the wave swings around zero on both sides
+       (one frame holds a partial period, hence the tolerance) */
+    for (int side = 0; side < APU_OUTPUT_CHANNELS; side++) {
+        float sum = 0.0f, peak = 0.0f;
+        for (uint32_t i = 0; i < count; i++) {
+            float s = out[i * APU_OUTPUT_CHANNELS + side];
+            sum += s;
+            if (fabsf(s) > peak) peak = fabsf(s);
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, sum / count);
+        TEST_ASSERT_TRUE(peak > 0.3f && peak < 0.8f);
+    }
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_step_settles_within_kernel);
+    RUN_TEST(test_sample_count_tracks_clock);
+    RUN_TEST(test_tail_carries_into_next_frame);
+    RUN_TEST(test_apu_square_wave_has_no_dc);
+    return UnityEnd();
+}
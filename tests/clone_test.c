@@ -0,0 +1,192 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/headless/branch.h"
+
+#define ROM_PATH    "tests/clone_test.gb"
+#define BRANCH_ROM  "tests/clone_test_branch.gb"
+#define BRANCHES    8
+
+static GBEmulator s_parent, s_child, s_grandchild;
+
+static void boot(GBEmulator* gb) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, 0x03));
+    gb_init(gb);
+    TEST_ASSERT_TRUE(gb_load_rom(gb, ROM_PATH));
+    gb_reset(gb);
+    remove(ROM_PATH);
+}
+
+static void run_frames(GBEmulator* gb, int frames) {
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    for (int i = 0; i < frames; i++) {
+        gb_run_frame_optimized(gb);
+        gb->frame_complete = false;
+        while (apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+    }
+}
+
+static void assert_same_state(const GBEmulator* a, const GBEmulator* b) {
+    size_t size = gb_snapshot_size(a);
+    TEST_ASSERT_EQUAL_UINT32(size, gb_snapshot_size(b));
+    uint8_t* sa = malloc(size);
+    uint8_t* sb = malloc(size);
+    gb_snapshot_save(a, sa);
+    gb_snapshot_save(b, sb);
+    TEST_ASSERT_EQUAL_MEMORY(sa, sb, size);
+    TEST_ASSERT_EQUAL_MEMORY(a->ppu.framebuffer, b->ppu.framebuffer, sizeof(a->ppu.framebuffer));
+    TEST_ASSERT_EQUAL_UINT64(a->instructions, b->instructions);
+    free(sa);
+    free(sb);
+}
+
+static void test_clone_runs_on_like_its_parent(void) {
+    boot(&s_parent);
+    memory_write(&s_parent.memory, 0xFF40, 0x91);   /* LCD on, so frames draw */
+    run_frames(&s_parent, 7);
+
+    TEST_ASSERT_TRUE(gb_clone(&s_child, &s_parent));
+    assert_same_state(&s_parent, &s_child);
+
+    /* Same future, audio included */
+    run_frames(&s_parent, 5);
+    run_frames(&s_child, 5);
+    assert_same_state(&s_parent, &s_child);
+
+    gb_cleanup(&s_parent);
+    gb_cleanup(&s_child);
+}
+
+static void test_clone_memory_is_independent(void) {
+    boot(&s_parent);
+    run_frames(&s_parent, 2);
+    TEST_ASSERT_TRUE(gb_clone(&s_child, &s_parent));
+
+    /* Work RAM, video RAM, high RAM and cartridge RAM are the clone's own */
+    uint8_t wram = memory_read(&s_parent.memory, 0xD000);
+    uint8_t hram = memory_read(&s_parent.memory, 0xFF90);
+    uint8_t cart = memory_read(&s_parent.memory, 0xA001);
+    memory_write(&s_child.memory, 0xD000, wram + 1);
+    memory_write(&s_child.memory, 0xFF90, hram + 1);
+    memory_write(&s_child.memory, 0xA001, cart + 1);
+    memory_write(&s_child.memory, 0x8000, 0x5A);
+    TEST_ASSERT_EQUAL_HEX8(wram, memory_read(&s_parent.memory, 0xD000));
+    TEST_ASSERT_EQUAL_HEX8(hram, memory_read(&s_parent.memory, 0xFF90));
+    TEST_ASSERT_EQUAL_HEX8(cart, memory_read(&s_parent.memory, 0xA001));
+    TEST_ASSERT_EQUAL_HEX8((uint8_t)(cart + 1), memory_read(&s_child.memory, 0xA001));
+    TEST_ASSERT_NOT_EQUAL(s_parent.memory.vram[0], s_child.memory.vram[0]);
+
+    /* Input held on one does not reach the other */
+    s_child.memory.joypad_state_buttons = 0x0F;
+    TEST_ASSERT_EQUAL_HEX8(0, s_parent.memory.joypad_state_buttons);
+
+    /* The ROM is shared, not copied */
+    const MBC_State* pm = s_parent.memory.mbc_data;
+    const MBC_State* cm = s_child.memory.mbc_data;
+    TEST_ASSERT_EQUAL_PTR(pm->rom_data, cm->rom_data);
+    TEST_ASSERT_NOT_EQUAL(pm->ram_data, cm->ram_data);
+    TEST_ASSERT_EQUAL_UINT32(2, atomic_load(pm->rom_refs));
+
+    gb_cleanup(&s_parent);
+    gb_cleanup(&s_child);
+}
+
+static void test_shared_rom_outlives_the_parent(void) {
+    boot(&s_parent);
+    run_frames(&s_parent, 3);
+    TEST_ASSERT_TRUE(gb_clone(&s_child, &s_parent));
+    TEST_ASSERT_TRUE(gb_clone(&s_grandchild, &s_child));
+    const MBC_State* mbc = s_child.memory.mbc_data;
+    TEST_ASSERT_EQUAL_UINT32(3, atomic_load(mbc->rom_refs));
+
+    /* The parent goes first; the clones keep running on the image */
+    gb_cleanup(&s_parent);
+    TEST_ASSERT_EQUAL_UINT32(2, atomic_load(mbc->rom_refs));
+    run_frames(&s_child, 3);
+    run_frames(&s_grandchild, 3);
+    assert_same_state(&s_child, &s_grandchild);
+
+    /* The last one frees it (checked by the leak sanitizer in debug builds) */
+    gb_cleanup(&s_grandchild);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(mbc->rom_refs));
+    gb_cleanup(&s_child);
+}
+
+/* Selects the d-pad and polls it; pressing Right runs into an invalid opcode */
+static bool write_branch_rom(void) {
+    static uint8_t rom[0x8000];
+    memset(rom, 0, sizeof(rom));
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    const uint8_t program[] = {
+        0x3E, 0x20,             /* LD A,20                          */
+        0xE0, 0x00,             /* LDH (00),A                       */
+        0xF0, 0x00,             /* 0154: LDH A,(00)                 */
+        0xCB, 0x47,             /* BIT 0,A                          */
+        0x20, 0xFA,             /* JR NZ,0154                       */
+        0xD3                    /* Invalid                          */
+    };
+    memcpy(&rom[0x100], entry, sizeof(entry));
+    memcpy(&rom[0x150], program, sizeof(program));
+
+    FILE* f = fopen(BRANCH_ROM, "wb");
+    if (!f) return false;
+    size_t written = fwrite(rom, 1, sizeof(rom), f);
+    fclose(f);
+    return written == sizeof(rom);
+}
+
+static void test_forked_branches_match_in_process_replays(void) {
+    TEST_ASSERT_TRUE(write_branch_rom());
+    gb_init(&s_parent);
+    TEST_ASSERT_TRUE(gb_load_rom(&s_parent, BRANCH_ROM));
+    gb_reset(&s_parent);
+    remove(BRANCH_ROM);
+    run_frames(&s_parent, 2);
+    uint64_t checkpoint_instructions = s_parent.instructions;
+
+    BranchOptions options = { BRANCHES, 8, 100, 3 };
+    BranchResult forked[BRANCHES];
+    TEST_ASSERT_TRUE(branch_run(&s_parent, &options, forked));
+    TEST_ASSERT_EQUAL_UINT64(checkpoint_instructions, s_parent.instructions);
+
+    /* Each branch is reproducible from its seed, and the random input both
+       finds the crash and misses it */
+    int crashed = 0;
+    for (uint32_t i = 0; i < BRANCHES; i++) {
+        BranchResult replay;
+        TEST_ASSERT_TRUE(gb_clone(&s_child, &s_parent));
+        branch_play(&s_child, options.seed + i, options.frames, &replay);
+        gb_cleanup(&s_child);
+
+        TEST_ASSERT_TRUE(forked[i].reported);
+        TEST_ASSERT_EQUAL_UINT32(options.seed + i, forked[i].seed);
+        TEST_ASSERT_EQUAL_INT(replay.status, forked[i].status);
+        TEST_ASSERT_EQUAL_UINT32(replay.frames, forked[i].frames);
+        TEST_ASSERT_EQUAL_UINT64(replay.instructions, forked[i].instructions);
+        TEST_ASSERT_EQUAL_UINT64(replay.final_hash, forked[i].final_hash);
+        TEST_ASSERT_EQUAL_HEX16(replay.pc, forked[i].pc);
+        if (forked[i].status == BATCH_CRASHED) {
+            TEST_ASSERT_EQUAL_HEX16(0x015B, forked[i].pc);
+            crashed++;
+        } else {
+            TEST_ASSERT_EQUAL_INT(BATCH_OK, forked[i].status);
+            TEST_ASSERT_EQUAL_UINT32(options.frames, forked[i].frames);
+        }
+    }
+    TEST_ASSERT_GREATER_THAN_INT(0, crashed);
+    TEST_ASSERT_LESS_THAN_INT(BRANCHES, crashed);
+
+    gb_cleanup(&s_parent);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_clone_runs_on_like_its_parent);
+    RUN_TEST(test_clone_memory_is_independent);
+    RUN_TEST(test_shared_rom_outlives_the_parent);
+    RUN_TEST(test_forked_branches_match_in_process_replays);
+    return UnityEnd();
+}
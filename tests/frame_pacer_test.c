@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include <time.h>
+#include "vendor/unity.h"
+#include "../src/frame_pacer.h"
+
+static FramePacer s_pacer;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_ns(long ns) {
+    struct timespec t = { ns / 1000000000L, ns % 1000000000L };
+    nanosleep(&t, NULL);
+}
+
+static void test_waits_never_return_early(void) {
+    const long period = 5000000L;   /* 200 Hz */
+    int64_t start = now_ns();
+    frame_pacer_init(&s_pacer, 200.0);
+    TEST_ASSERT_EQUAL_INT64(period, s_pacer.period_ns);
+
+    for (int i = 1; i <= 20; i++) {
+        frame_pacer_wait(&s_pacer);
+        /* The schedule is absolute: frame i is due i periods after start */
+        TEST_ASSERT_TRUE(now_ns() - start >= (int64_t)i * period);
+    }
+    TEST_ASSERT_EQUAL_UINT64(0, s_pacer.resyncs);
+}
+
+static void test_falling_behind_restarts_the_schedule(void) {
+    frame_pacer_init(&s_pacer, 200.0);
+    sleep_ns(20000000L);            /* Four periods late */
+
+    int64_t before = now_ns();
+    frame_pacer_wait(&s_pacer);     /* No burst of catch-up frames */
+    TEST_ASSERT_TRUE(now_ns() - before < 5000000L);
+    TEST_ASSERT_EQUAL_UINT64(1, s_pacer.resyncs);
+
+    before = now_ns();
+    frame_pacer_wait(&s_pacer);
+    TEST_ASSERT_TRUE(now_ns() - before >= 4000000L);
+}
+
+static void test_percentiles_from_the_histogram(void) {
+    frame_pacer_init(&s_pacer, 60.0);
+    FramePacerStats stats;
+    frame_pacer_stats(&s_pacer, &stats);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.frames);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.p99_ns);
+
+    /* 98 frames of ~16.7 ms, one of 20 ms and one of 33 ms */
+    s_pacer.histogram[16740000 / FRAME_PACER_BUCKET_NS] = 98;
+    s_pacer.histogram[20000000 / FRAME_PACER_BUCKET_NS] = 1;
+    s_pacer.histogram[33000000 / FRAME_PACER_BUCKET_NS] = 1;
+    s_pacer.frames = 100;
+    s_pacer.max_ns = 33004000;
+    frame_pacer_stats(&s_pacer, &stats);
+    TEST_ASSERT_EQUAL_UINT64(100, stats.frames);
+    TEST_ASSERT_EQUAL_UINT64(16745000, stats.p50_ns);
+    TEST_ASSERT_EQUAL_UINT64(20005000, stats.p99_ns);
+    TEST_ASSERT_EQUAL_UINT64(33004000, stats.max_ns);
+}
+
+static void test_marks_record_frame_times(void) {
+    frame_pacer_init(&s_pacer, 200.0);
+    frame_pacer_mark(&s_pacer);     /* First mark only starts the clock */
+    for (int i = 0; i < 5; i++) {
+        frame_pacer_wait(&s_pacer);
+        frame_pacer_mark(&s_pacer);
+    }
+    FramePacerStats stats;
+    frame_pacer_stats(&s_pacer, &stats);
+    TEST_ASSERT_EQUAL_UINT64(5, stats.frames);
+    TEST_ASSERT_TRUE(stats.p50_ns >= 4000000 && stats.p50_ns <= stats.max_ns);
+
+    /* A period change breaks the chain: the interval across it is not a frame */
+    frame_pacer_set_period(&s_pacer, 2500000L);
+    sleep_ns(10000000L);
+    frame_pacer_mark(&s_pacer);
+    frame_pacer_stats(&s_pacer, &stats);
+    TEST_ASSERT_EQUAL_UINT64(5, stats.frames);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_waits_never_return_early);
+    RUN_TEST(test_falling_behind_restarts_the_schedule);
+    RUN_TEST(test_percentiles_from_the_histogram);
+    RUN_TEST(test_marks_record_frame_times);
+    return UnityEnd();
+}
@@ -0,0 +1,154 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include "vendor/unity.h"
+#include "../src/triple_buffer.h"
+#include "../src/command_queue.h"
+
+static TripleBuffer s_tb;
+
+static void fill(uint32_t* frame, uint32_t value) {
+    for (int i = 0; i < TRIPLE_BUFFER_PIXELS; i++) frame[i] = value;
+}
+
+static void test_reader_gets_the_newest_frame(void) {
+    triple_buffer_init(&s_tb);
+    bool fresh;
+    TEST_ASSERT_NULL(triple_buffer_read(&s_tb, &fresh));
+    TEST_ASSERT_FALSE(fresh);
+
+    uint32_t frame[TRIPLE_BUFFER_PIXELS];
+    fill(frame, 1);
+    triple_buffer_write(&s_tb, frame);
+    const uint32_t* shown = triple_buffer_read(&s_tb, &fresh);
+    TEST_ASSERT_TRUE(fresh);
+    TEST_ASSERT_EQUAL_HEX32(1, shown[0]);
+
+    /* Nothing new: the same frame again */
+    shown = triple_buffer_read(&s_tb, &fresh);
+    TEST_ASSERT_FALSE(fresh);
+    TEST_ASSERT_EQUAL_HEX32(1, shown[TRIPLE_BUFFER_PIXELS - 1]);
+
+    /* Two frames before the reader looks: the older one is skipped */
+    fill(frame, 2);
+    triple_buffer_write(&s_tb, frame);
+    fill(frame, 3);
+    triple_buffer_write(&s_tb, frame);
+    shown = triple_buffer_read(&s_tb, &fresh);
+    TEST_ASSERT_TRUE(fresh);
+    TEST_ASSERT_EQUAL_HEX32(3, shown[0]);
+    TEST_ASSERT_EQUAL_UINT64(3, triple_buffer_published(&s_tb));
+    TEST_ASSERT_EQUAL_UINT64(1, triple_buffer_skipped(&s_tb));
+
+    /* The writer never draws into the frame on screen */
+    TEST_ASSERT_TRUE(triple_buffer_back(&s_tb) != shown);
+}
+
+#define STRESS_FRAMES 3000
+
+static void* frame_writer(void* arg) {
+    (void)arg;
+    for (uint32_t n = 1; n <= STRESS_FRAMES; n++) {
+        fill(triple_buffer_back(&s_tb), n);
+        triple_buffer_publish(&s_tb);
+    }
+    return NULL;
+}
+
+static void test_frames_are_never_torn_or_out_of_order(void) {
+    triple_buffer_init(&s_tb);
+    pthread_t writer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, frame_writer, NULL));
+
+    uint32_t last = 0, seen = 0;
+    bool whole = true, ordered = true;
+    while (last < STRESS_FRAMES) {
+        bool fresh;
+        const uint32_t* frame = triple_buffer_read(&s_tb, &fresh);
+        if (!fresh) {
+            sched_yield();
+            continue;
+        }
+        uint32_t n = frame[0];
+        for (int i = 1; i < TRIPLE_BUFFER_PIXELS; i += 97) {
+            if (frame[i] != n) whole = false;
+        }
+        if (frame[TRIPLE_BUFFER_PIXELS - 1] != n) whole = false;
+        if (n <= last) ordered = false;
+        last = n;
+        seen++;
+    }
+    pthread_join(writer, NULL);
+
+    TEST_ASSERT_TRUE(whole);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT64(STRESS_FRAMES, triple_buffer_published(&s_tb));
+    /* Every frame was either shown or skipped */
+    TEST_ASSERT_EQUAL_UINT64(STRESS_FRAMES, seen + triple_buffer_skipped(&s_tb));
+}
+
+static CommandQueue s_queue;
+
+static void test_commands_keep_their_order(void) {
+    command_queue_init(&s_queue);
+    Command command;
+    TEST_ASSERT_FALSE(command_queue_pop(&s_queue, &command));
+
+    TEST_ASSERT_TRUE(command_queue_push(&s_queue, COMMAND_BUTTON_PRESS, 0x01));
+    TEST_ASSERT_TRUE(command_queue_push(&s_queue, COMMAND_BUTTON_RELEASE, 0x01));
+    TEST_ASSERT_TRUE(command_queue_pop(&s_queue, &command));
+    TEST_ASSERT_EQUAL_INT(COMMAND_BUTTON_PRESS, command.type);
+    TEST_ASSERT_TRUE(command_queue_pop(&s_queue, &command));
+    TEST_ASSERT_EQUAL_INT(COMMAND_BUTTON_RELEASE, command.type);
+    TEST_ASSERT_EQUAL_INT32(0x01, command.value);
+
+    /* Full: the extra command is dropped and counted */
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        TEST_ASSERT_TRUE(command_queue_push(&s_queue, COMMAND_PALETTE, i));
+    }
+    TEST_ASSERT_FALSE(command_queue_push(&s_queue, COMMAND_RESET, 0));
+    TEST_ASSERT_EQUAL_UINT64(1, command_queue_dropped(&s_queue));
+    for (int i = 0; i < COMMAND_QUEUE_SIZE; i++) {
+        TEST_ASSERT_TRUE(command_queue_pop(&s_queue, &command));
+        TEST_ASSERT_EQUAL_INT32(i, command.value);
+    }
+    TEST_ASSERT_FALSE(command_queue_pop(&s_queue, &command));
+}
+
+#define STRESS_COMMANDS 100000
+
+static void* command_writer(void* arg) {
+    (void)arg;
+    for (int32_t i = 0; i < STRESS_COMMANDS; i++) {
+        while (!command_queue_push(&s_queue, COMMAND_PALETTE, i)) sched_yield();
+    }
+    return NULL;
+}
+
+static void test_threads_see_one_ordered_command_stream(void) {
+    command_queue_init(&s_queue);
+    pthread_t writer;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, command_writer, NULL));
+
+    int32_t expected = 0;
+    bool in_order = true;
+    while (expected < STRESS_COMMANDS) {
+        Command command;
+        if (!command_queue_pop(&s_queue, &command)) {
+            sched_yield();
+            continue;
+        }
+        if (command.value != expected++) in_order = false;
+    }
+    pthread_join(writer, NULL);
+    TEST_ASSERT_TRUE(in_order);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_reader_gets_the_newest_frame);
+    RUN_TEST(test_frames_are_never_torn_or_out_of_order);
+    RUN_TEST(test_commands_keep_their_order);
+    RUN_TEST(test_threads_see_one_ordered_command_stream);
+    return UnityEnd();
+}
@@ -25,8 +25,55 @@ static void test_input_press_release(void) {
     TEST_ASSERT_EQUAL_UINT8(0x01, mem.io_registers[0x00] & 0x01);
 }
 
+typedef struct {
+    Memory* mem;
+    int calls;
+} PollState;
+
+/* Stands in for the host: a press arrives while the frame is running */
+static void poll_press_a(void* user) {
+    PollState* state = user;
+    state->calls++;
+    input_press(state->mem, JP_A);
+}
+
+static void test_joyp_read_polls_input(void) {
+    Memory mem;
+    memory_init(&mem);
+    input_init(&mem);
+    PollState state = { &mem, 0 };
+
+    /* Select buttons; nothing pressed yet */
+    memory_write(&mem, 0xFF00, 0x10);
+    TEST_ASSERT_EQUAL_UINT8(0x01, mem.io_registers[0x00] & 0x01);
+
+    /* The read that polls already sees the press */
+    memory_set_input_poll(&mem, poll_press_a, &state, 0);
+    TEST_ASSERT_EQUAL_UINT8(0x00, memory_read(&mem, 0xFF00) & 0x01);
+    TEST_ASSERT_EQUAL_INT(1, state.calls);
+    memory_read(&mem, 0xFF00);
+    TEST_ASSERT_EQUAL_INT(2, state.calls);
+
+    /* Rate limited: a second read within the interval does not poll */
+    memory_set_input_poll(&mem, poll_press_a, &state, 1000000);
+    memory_read(&mem, 0xFF00);
+    memory_read(&mem, 0xFF00);
+    TEST_ASSERT_EQUAL_INT(3, state.calls);
+
+    /* Only JOYP reads poll, and NULL turns it off */
+    memory_set_input_poll(&mem, poll_press_a, &state, 0);
+    memory_read(&mem, 0xFF0F);
+    memory_write(&mem, 0xFF00, 0x20);
+    TEST_ASSERT_EQUAL_INT(3, state.calls);
+    memory_set_input_poll(&mem, NULL, NULL, 0);
+    memory_read(&mem, 0xFF00);
+    TEST_ASSERT_EQUAL_INT(3, state.calls);
+    memory_cleanup(&mem);
+}
+
 int main(void) {
     UnityBegin();
     RUN_TEST(test_input_press_release);
+    RUN_TEST(test_joyp_read_polls_input);
     return UnityEnd();
 }
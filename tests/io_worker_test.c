@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/savestate.h"
+#include "../src/io_worker.h"
+
+#define ROM_PATH "tests/io_worker_test.gb"
+#define STATE_PATH "tests/io_worker_test.gbstate"
+#define SHOT_PATH "tests/io_worker_test.png"
+#define SAV_PATH "tests/io_worker_test.sav"
+
+static GBEmulator gb;
+static IoWorker io;
+
+static void setUp_worker(void) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, 0x02));
+    gb_init(&gb);
+    TEST_ASSERT_TRUE(gb_load_rom(&gb, ROM_PATH));
+    TEST_ASSERT_TRUE(io_worker_start(&io));
+}
+
+static void tearDown_worker(void) {
+    io_worker_stop(&io);
+    gb_cleanup(&gb);
+}
+
+static size_t read_file(const char* path, uint8_t* buf, size_t capacity) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return 0;
+    size_t size = fread(buf, 1, capacity, file);
+    fclose(file);
+    return size;
+}
+
+static void test_save_state_is_compressed_and_loads(void) {
+    setUp_worker();
+    gb_run_frame(&gb);
+    uint8_t counter = gb.memory.wram[0];
+
+    TEST_ASSERT_TRUE(io_worker_save_state(&io, &gb, STATE_PATH));
+    io_worker_flush(&io);
+
+    IoResult result;
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+    TEST_ASSERT_EQUAL_INT(IO_JOB_SAVE_STATE, result.type);
+    TEST_ASSERT_TRUE(result.ok);
+    TEST_ASSERT_EQUAL_STRING(STATE_PATH, result.path);
+    TEST_ASSERT_FALSE(io_worker_poll(&io, &result));
+
+    /* Mostly-empty memory deflates far below the plain encoding */
+    static uint8_t file[128 * 1024];
+    size_t size = read_file(STATE_PATH, file, sizeof(file));
+    TEST_ASSERT_TRUE(size > 0);
+    TEST_ASSERT_TRUE(size < savestate_encode(&gb, NULL, 0) / 4);
+
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(gb_load_state(&gb, STATE_PATH));
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+
+    remove(STATE_PATH);
+    tearDown_worker();
+}
+
+static void test_screenshot_writes_png(void) {
+    setUp_worker();
+    gb_run_frame(&gb);
+
+    TEST_ASSERT_TRUE(io_worker_screenshot(&io, gb.ppu.framebuffer, SHOT_PATH));
+    io_worker_flush(&io);
+
+    IoResult result;
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+    TEST_ASSERT_EQUAL_INT(IO_JOB_SCREENSHOT, result.type);
+    TEST_ASSERT_TRUE(result.ok);
+
+    uint8_t header[24];
+    TEST_ASSERT_EQUAL_UINT32(sizeof(header), read_file(SHOT_PATH, header, sizeof(header)));
+    TEST_ASSERT_EQUAL_MEMORY("\x89PNG\r\n\x1a\n", header, 8);
+    TEST_ASSERT_EQUAL_MEMORY("IHDR", header + 12, 4);
+    TEST_ASSERT_EQUAL_UINT8(SCREEN_WIDTH, header[19]);
+    TEST_ASSERT_EQUAL_UINT8(SCREEN_HEIGHT, header[23]);
+
+    remove(SHOT_PATH);
+    tearDown_worker();
+}
+
+static void test_battery_ram_only_written_when_changed(void) {
+    setUp_worker();
+    MBC_State* mbc = (MBC_State*)gb.memory.mbc_data;
+    mbc->ram_data[0] = 0x5A;
+
+    IoResult result;
+    TEST_ASSERT_TRUE(io_worker_save_ram(&io, &gb.memory, SAV_PATH));
+    io_worker_flush(&io);
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+    TEST_ASSERT_EQUAL_INT(IO_JOB_BATTERY_RAM, result.type);
+    TEST_ASSERT_TRUE(result.ok);
+
+    /* Unchanged: nothing queued */
+    TEST_ASSERT_TRUE(io_worker_save_ram(&io, &gb.memory, SAV_PATH));
+    io_worker_flush(&io);
+    TEST_ASSERT_FALSE(io_worker_poll(&io, &result));
+
+    mbc->ram_data[1] = 0xA5;
+    TEST_ASSERT_TRUE(io_worker_save_ram(&io, &gb.memory, SAV_PATH));
+    io_worker_flush(&io);
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+
+    static uint8_t file[0x2000];
+    TEST_ASSERT_EQUAL_UINT32(mbc->ram_size, read_file(SAV_PATH, file, sizeof(file)));
+    TEST_ASSERT_EQUAL_MEMORY(mbc->ram_data, file, mbc->ram_size);
+
+    remove(SAV_PATH);
+    tearDown_worker();
+}
+
+static void test_battery_ram_not_rewritten_after_load(void) {
+    setUp_worker();
+    MBC_State* mbc = (MBC_State*)gb.memory.mbc_data;
+    memset(mbc->ram_data, 0x3C, mbc->ram_size);
+    TEST_ASSERT_TRUE(memory_save_ram(&gb.memory, SAV_PATH));
+    memset(mbc->ram_data, 0, mbc->ram_size);
+    TEST_ASSERT_TRUE(memory_load_ram(&gb.memory, SAV_PATH));
+    io_worker_track_ram(&io, &gb.memory);
+
+    /* Loaded and untouched: nothing is written (with the file gone, a write would show) */
+    IoResult result;
+    remove(SAV_PATH);
+    TEST_ASSERT_TRUE(io_worker_save_ram(&io, &gb.memory, SAV_PATH));
+    io_worker_flush(&io);
+    TEST_ASSERT_FALSE(io_worker_poll(&io, &result));
+    TEST_ASSERT_NULL(fopen(SAV_PATH, "rb"));
+
+    mbc->ram_data[0] = 0x5A;
+    TEST_ASSERT_TRUE(io_worker_save_ram(&io, &gb.memory, SAV_PATH));
+    io_worker_flush(&io);
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+    TEST_ASSERT_TRUE(result.ok);
+
+    remove(SAV_PATH);
+    tearDown_worker();
+}
+
+static void test_failure_is_reported(void) {
+    setUp_worker();
+
+    TEST_ASSERT_TRUE(io_worker_save_state(&io, &gb, "tests/no_such_dir/state.gbstate"));
+    io_worker_flush(&io);
+
+    IoResult result;
+    TEST_ASSERT_TRUE(io_worker_poll(&io, &result));
+    TEST_ASSERT_FALSE(result.ok);
+
+    tearDown_worker();
+}
+
+static void test_stop_drains_queue(void) {
+    setUp_worker();
+
+    /* Queue both slots and stop at once: both files must still be written */
+    TEST_ASSERT_TRUE(io_worker_save_state(&io, &gb, STATE_PATH));
+    TEST_ASSERT_TRUE(io_worker_screenshot(&io, gb.ppu.framebuffer, SHOT_PATH));
+    io_worker_stop(&io);
+
+    uint8_t byte;
+    TEST_ASSERT_EQUAL_UINT32(1, read_file(STATE_PATH, &byte, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, read_file(SHOT_PATH, &byte, 1));
+
+    remove(STATE_PATH);
+    remove(SHOT_PATH);
+    gb_cleanup(&gb);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_save_state_is_compressed_and_loads);
+    RUN_TEST(test_screenshot_writes_png);
+    RUN_TEST(test_battery_ram_only_written_when_changed);
+    RUN_TEST(test_battery_ram_not_rewritten_after_load);
+    RUN_TEST(test_failure_is_reported);
+    RUN_TEST(test_stop_drains_queue);
+    remove(ROM_PATH);
+    return UnityEnd();
+}
@@ -0,0 +1,269 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "../src/lib/libgbendo.h"
+
+/* Only the public header: this test links libgbendo.a like any embedder */
+
+#define FRAMES 30
+
+static uint8_t s_rom[0x8000];
+
+/* 32KB ROM-only cartridge that shows the joypad on screen and plays a tone:
+ *
+ *   0150: sound on, channel 1 square wave panned to both sides, LCD on
+ *   0170: select directions, LDH A,(00) / LDH (47),A / JR 0170
+ *
+ * so the background palette follows the direction buttons. */
+static void build_rom(void) {
+    memset(s_rom, 0, sizeof(s_rom));
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    memcpy(&s_rom[0x100], entry, sizeof(entry));
+
+    const uint8_t program[] = {
+        0x3E, 0x80, 0xE0, 0x26,     /* NR52 = 80: sound on     */
+        0x3E, 0x77, 0xE0, 0x24,     /* NR50 = 77: full volume  */
+        0x3E, 0xFF, 0xE0, 0x25,     /* NR51 = FF: both sides   */
+        0x3E, 0x80, 0xE0, 0x11,     /* NR11 = 80: 50% duty     */
+        0x3E, 0xF0, 0xE0, 0x12,     /* NR12 = F0: max volume   */
+        0x3E, 0x00, 0xE0, 0x13,     /* NR13 = 00               */
+        0x3E, 0x87, 0xE0, 0x14,     /* NR14 = 87: trigger      */
+        0x3E, 0x91, 0xE0, 0x40,     /* LCDC = 91: LCD on       */
+        0x3E, 0x20, 0xE0, 0x00,     /* JOYP = 20: directions   */
+        0xF0, 0x00,                 /* LDH A,(00)              */
+        0xE0, 0x47,                 /* LDH (47),A: BGP         */
+        0x18, 0xFA                  /* JR back to LDH A,(00)   */
+    };
+    memcpy(&s_rom[0x150], program, sizeof(program));
+}
+
+static uint64_t hash_framebuffer(const Gbendo* gb) {
+    const uint32_t* pixels = gbendo_framebuffer(gb);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < GBENDO_SCREEN_WIDTH * GBENDO_SCREEN_HEIGHT; i++) {
+        hash ^= pixels[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint32_t drain_audio(Gbendo* gb) {
+    float samples[1024 * GBENDO_AUDIO_CHANNELS];
+    uint32_t total = 0, n;
+    while ((n = gbendo_read_audio(gb, samples, 1024)) > 0) total += n;
+    return total;
+}
+
+static void test_runs_frames_and_produces_audio(void) {
+    TEST_ASSERT_EQUAL_UINT32(GBENDO_API_VERSION, gbendo_api_version());
+
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_NOT_NULL(gb);
+    TEST_ASSERT_FALSE(gbendo_load_rom(gb, s_rom, 0x100));     /* No header */
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+
+    uint32_t audio = 0;
+    for (int i = 0; i < FRAMES; i++) {
+        TEST_ASSERT_TRUE(gbendo_run_frame(gb));
+        audio += drain_audio(gb);
+    }
+    /* ~735 stereo frames per video frame */
+    TEST_ASSERT_UINT32_WITHIN(GBENDO_AUDIO_RATE / 60, FRAMES * GBENDO_AUDIO_RATE / 60, audio);
+
+    /* A second of cycles gives a second of audio */
+    TEST_ASSERT_TRUE(gbendo_run_cycles(gb, 4194304));
+    TEST_ASSERT_UINT32_WITHIN(GBENDO_AUDIO_RATE / 100, GBENDO_AUDIO_RATE, drain_audio(gb));
+
+    /* The ROM was copied */
+    uint64_t before = hash_framebuffer(gb);
+    memset(&s_rom[0x150], 0xD3, 0x40);
+    TEST_ASSERT_TRUE(gbendo_run_frame(gb));
+    TEST_ASSERT_EQUAL_UINT64(before, hash_framebuffer(gb));
+    build_rom();
+
+    gbendo_destroy(gb);
+}
+
+static void test_input_reaches_the_program(void) {
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+    for (int i = 0; i < 3; i++) gbendo_run_frame(gb);
+    uint64_t idle = hash_framebuffer(gb);
+
+    gbendo_set_input(gb, GBENDO_BUTTON_RIGHT | GBENDO_BUTTON_A);
+    for (int i = 0; i < 3; i++) gbendo_run_frame(gb);
+    uint64_t held = hash_framebuffer(gb);
+    TEST_ASSERT_NOT_EQUAL_UINT64(idle, held);
+
+    /* Only directions are selected, so A alone looks like nothing held */
+    gbendo_set_input(gb, GBENDO_BUTTON_A);
+    for (int i = 0; i < 3; i++) gbendo_run_frame(gb);
+    TEST_ASSERT_EQUAL_UINT64(idle, hash_framebuffer(gb));
+
+    gbendo_destroy(gb);
+}
+
+static void test_snapshot_restores_and_replays(void) {
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+    for (int i = 0; i < 10; i++) gbendo_run_frame(gb);
+
+    size_t size = gbendo_snapshot_size(gb);
+    TEST_ASSERT_TRUE(size > 0);
+    void* snapshot = malloc(size);
+    TEST_ASSERT_EQUAL_size_t(size, gbendo_snapshot_save(gb, snapshot));
+
+    gbendo_set_input(gb, GBENDO_BUTTON_LEFT);
+    for (int i = 0; i < 10; i++) gbendo_run_frame(gb);
+    uint64_t first = hash_framebuffer(gb);
+
+    /* Held buttons are machine state too, so the replay presses them again */
+    TEST_ASSERT_TRUE(gbendo_snapshot_load(gb, snapshot));
+    gbendo_set_input(gb, GBENDO_BUTTON_LEFT);
+    for (int i = 0; i < 10; i++) gbendo_run_frame(gb);
+    TEST_ASSERT_EQUAL_UINT64(first, hash_framebuffer(gb));
+
+    free(snapshot);
+    gbendo_destroy(gb);
+}
+
+static void test_clone_branches_from_the_same_state(void) {
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+    for (int i = 0; i < 5; i++) gbendo_run_frame(gb);
+    drain_audio(gb);
+
+    Gbendo* left = gbendo_clone(gb);
+    Gbendo* right = gbendo_clone(gb);
+    TEST_ASSERT_NOT_NULL(left);
+    TEST_ASSERT_NOT_NULL(right);
+    gbendo_destroy(gb);     /* The clones keep the ROM */
+
+    gbendo_set_input(left, GBENDO_BUTTON_LEFT);
+    gbendo_set_input(right, GBENDO_BUTTON_RIGHT);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(gbendo_run_frame(left));
+        TEST_ASSERT_TRUE(gbendo_run_frame(right));
+    }
+    TEST_ASSERT_NOT_EQUAL_UINT64(hash_framebuffer(left), hash_framebuffer(right));
+
+    /* Same input from the same state gives the same frame */
+    Gbendo* again = gbendo_clone(right);
+    TEST_ASSERT_NOT_NULL(again);
+    TEST_ASSERT_TRUE(gbendo_run_frame(right));
+    TEST_ASSERT_TRUE(gbendo_run_frame(again));
+    TEST_ASSERT_EQUAL_UINT64(hash_framebuffer(right), hash_framebuffer(again));
+
+    gbendo_destroy(again);
+    gbendo_destroy(left);
+    gbendo_destroy(right);
+}
+
+static void test_invalid_opcode_stops_the_handle(void) {
+    static uint8_t rom[0x8000];
+    memcpy(rom, s_rom, sizeof(rom));
+    rom[0x150] = 0xD3;
+
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, rom, sizeof(rom)));
+    TEST_ASSERT_FALSE(gbendo_run_frame(gb));
+    TEST_ASSERT_FALSE(gbendo_run_cycles(gb, 1000));
+
+    /* Loading fails without touching the ROM, reset starts it over */
+    TEST_ASSERT_FALSE(gbendo_load_rom(gb, NULL, 0));
+    gbendo_reset(gb);
+    TEST_ASSERT_FALSE(gbendo_run_frame(gb));
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+    TEST_ASSERT_TRUE(gbendo_run_frame(gb));
+    gbendo_destroy(gb);
+}
+
+static void test_runs_nothing_without_a_rom(void) {
+    Gbendo* gb = gbendo_create();
+    TEST_ASSERT_FALSE(gbendo_run_frame(gb));
+    TEST_ASSERT_FALSE(gbendo_run_cycles(gb, 1000));
+
+    /* A failed first load leaves the handle without a ROM */
+    TEST_ASSERT_FALSE(gbendo_load_rom(gb, s_rom, 0x100));
+    TEST_ASSERT_FALSE(gbendo_run_frame(gb));
+    TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+    TEST_ASSERT_TRUE(gbendo_run_frame(gb));
+    gbendo_destroy(gb);
+}
+
+static void test_batch_matches_single_handles(void) {
+    enum { COUNT = 3 };
+    GbendoBatch* batch = gbendo_batch_create(s_rom, sizeof(s_rom), COUNT);
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_EQUAL_UINT32(COUNT, gbendo_batch_count(batch));
+    TEST_ASSERT_NULL(gbendo_batch_create(s_rom, 0x100, COUNT));
+
+    const uint8_t buttons[COUNT] = { 0, GBENDO_BUTTON_RIGHT, GBENDO_BUTTON_DOWN };
+    size_t stride = gbendo_batch_observation_size(GBENDO_OBSERVE_SCREEN);
+    TEST_ASSERT_EQUAL_size_t(GBENDO_SCREEN_WIDTH * GBENDO_SCREEN_HEIGHT * sizeof(uint32_t), stride);
+    TEST_ASSERT_EQUAL_size_t(GBENDO_RAM_SIZE, gbendo_batch_observation_size(GBENDO_OBSERVE_RAM));
+    uint8_t* screens = malloc(COUNT * stride);
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, gbendo_batch_step(batch, buttons, GBENDO_OBSERVE_SCREEN, screens));
+    }
+    for (int i = 0; i < COUNT; i++) {
+        Gbendo* gb = gbendo_create();
+        TEST_ASSERT_TRUE(gbendo_load_rom(gb, s_rom, sizeof(s_rom)));
+        gbendo_set_input(gb, buttons[i]);
+        for (int f = 0; f < 5; f++) gbendo_run_frame(gb);
+        TEST_ASSERT_EQUAL_MEMORY(gbendo_framebuffer(gb), screens + i * stride, stride);
+        TEST_ASSERT_EQUAL_MEMORY(gbendo_framebuffer(gbendo_batch_instance(batch, i)),
+                                 screens + i * stride, stride);
+        gbendo_destroy(gb);
+    }
+    TEST_ASSERT_NULL(gbendo_batch_instance(batch, COUNT));
+
+    /* Instances snapshot like any handle, e.g. to branch a search */
+    Gbendo* first = gbendo_batch_instance(batch, 0);
+    void* snapshot = malloc(gbendo_snapshot_size(first));
+    gbendo_snapshot_save(first, snapshot);
+    TEST_ASSERT_TRUE(gbendo_snapshot_load(gbendo_batch_instance(batch, 1), snapshot));
+    free(snapshot);
+
+    free(screens);
+    gbendo_batch_destroy(batch);
+}
+
+static void test_batch_clone_outlives_the_batch(void) {
+    GbendoBatch* batch = gbendo_batch_create(s_rom, sizeof(s_rom), 2);
+    TEST_ASSERT_NOT_NULL(batch);
+    uint8_t* screens = malloc(2 * gbendo_batch_observation_size(GBENDO_OBSERVE_SCREEN));
+    for (int i = 0; i < 5; i++) gbendo_batch_step(batch, NULL, GBENDO_OBSERVE_SCREEN, screens);
+    free(screens);
+
+    Gbendo* clone = gbendo_clone(gbendo_batch_instance(batch, 0));
+    TEST_ASSERT_NOT_NULL(clone);
+    gbendo_batch_destroy(batch);    /* The clone keeps the shared ROM */
+
+    Gbendo* single = gbendo_create();
+    TEST_ASSERT_TRUE(gbendo_load_rom(single, s_rom, sizeof(s_rom)));
+    for (int i = 0; i < 5; i++) gbendo_run_frame(single);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(gbendo_run_frame(clone));
+        TEST_ASSERT_TRUE(gbendo_run_frame(single));
+    }
+    TEST_ASSERT_EQUAL_UINT64(hash_framebuffer(single), hash_framebuffer(clone));
+    gbendo_destroy(single);
+    gbendo_destroy(clone);
+}
+
+int main(void) {
+    build_rom();
+    UnityBegin();
+    RUN_TEST(test_runs_frames_and_produces_audio);
+    RUN_TEST(test_input_reaches_the_program);
+    RUN_TEST(test_snapshot_restores_and_replays);
+    RUN_TEST(test_clone_branches_from_the_same_state);
+    RUN_TEST(test_invalid_opcode_stops_the_handle);
+    RUN_TEST(test_runs_nothing_without_a_rom);
+    RUN_TEST(test_batch_matches_single_handles);
+    RUN_TEST(test_batch_clone_outlives_the_batch);
+    return UnityEnd();
+}
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "../src/gbendo.h"
+#include "../src/lockstep.h"
+#include "../src/input/input.h"
+
+#define INSTANCES 6
+#define FRAMES 20
+
+static uint8_t s_rom[0x8000];
+
+/* 32KB ROM-only cartridge whose path depends on the Right button:
+ *
+ *   0150: select directions, LCD on
+ *   0158: LDH A,(00) / BIT 0,A / JR Z,0164
+ *   015E: INC (C000) / JR 0158             Right released
+ *   0164: INC (C001) / LDH (47),A / JR 0158 Right held
+ *
+ * so instances with different input diverge in PC, RAM and picture. */
+static void build_rom(uint8_t* rom) {
+    memset(rom, 0, 0x8000);
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    memcpy(&rom[0x100], entry, sizeof(entry));
+
+    const uint8_t program[] = {
+        0x3E, 0x20, 0xE0, 0x00,     /* JOYP = 20: directions   */
+        0x3E, 0x91, 0xE0, 0x40,     /* LCDC = 91: LCD on       */
+        0xF0, 0x00,                 /* LDH A,(00)              */
+        0xCB, 0x47,                 /* BIT 0,A                 */
+        0x28, 0x06,                 /* JR Z,0164               */
+        0x21, 0x00, 0xC0,           /* LD HL,C000              */
+        0x34,                       /* INC (HL)                */
+        0x18, 0xF4,                 /* JR 0158                 */
+        0x21, 0x01, 0xC0,           /* LD HL,C001              */
+        0x34,                       /* INC (HL)                */
+        0xE0, 0x47,                 /* LDH (47),A: BGP         */
+        0x18, 0xEC                  /* JR 0158                 */
+    };
+    memcpy(&rom[0x150], program, sizeof(program));
+}
+
+static uint8_t buttons_for(uint32_t instance, int frame) {
+    /* Odd instances hold Right, every fourth taps it, the rest never do */
+    if (instance % 2) return JP_RIGHT;
+    return (frame / 4) % 2 && instance % 4 == 0 ? JP_RIGHT : 0;
+}
+
+static void test_instances_match_separate_emulators(void) {
+    Lockstep ls;
+    TEST_ASSERT_TRUE(lockstep_init(&ls, s_rom, sizeof(s_rom), INSTANCES));
+
+    static GBEmulator ref[INSTANCES];
+    for (int i = 0; i < INSTANCES; i++) {
+        gb_init(&ref[i]);
+        TEST_ASSERT_TRUE(gb_load_rom_data(&ref[i], s_rom, sizeof(s_rom)));
+        gb_reset(&ref[i]);
+    }
+
+    static uint8_t ram[INSTANCES][LOCKSTEP_RAM_SIZE];
+    static uint32_t screens[INSTANCES][SCREEN_WIDTH * SCREEN_HEIGHT];
+    for (int frame = 0; frame < FRAMES; frame++) {
+        uint8_t buttons[INSTANCES];
+        for (int i = 0; i < INSTANCES; i++) {
+            buttons[i] = buttons_for(i, frame);
+            input_set_held(&ref[i].memory, buttons[i]);
+            gb_run_frame_optimized(&ref[i]);
+        }
+
+        /* Alternate observations; skipping the drawing must not change RAM */
+        bool screen = frame % 2;
+        TEST_ASSERT_EQUAL_UINT32(0, lockstep_step(&ls, buttons,
+                                 screen ? LOCKSTEP_OBSERVE_SCREEN : LOCKSTEP_OBSERVE_RAM,
+                                 screen ? (void*)screens : (void*)ram));
+        for (int i = 0; i < INSTANCES; i++) {
+            if (screen) {
+                TEST_ASSERT_EQUAL_MEMORY(ref[i].ppu.framebuffer, screens[i], sizeof(screens[i]));
+            } else {
+                TEST_ASSERT_EQUAL_MEMORY(ref[i].memory.wram, ram[i], 0x2000);
+                TEST_ASSERT_EQUAL_MEMORY(ref[i].memory.hram, ram[i] + 0x2000, 0x7F);
+            }
+            TEST_ASSERT_EQUAL_HEX16(ref[i].cpu.pc, ls.instances[i].cpu.pc);
+        }
+    }
+
+    /* The inputs really took different paths */
+    TEST_ASSERT_TRUE(ram[2][1] == 0 && ram[2][0] > 0);
+    TEST_ASSERT_TRUE(ram[1][0] == 0 && ram[1][1] > 0);
+    TEST_ASSERT_NOT_EQUAL(0, memcmp(screens[2], screens[1], sizeof(screens[2])));
+    TEST_ASSERT_EQUAL_UINT64(FRAMES, ls.frames);
+
+    /* One ROM image, mapped by all of them */
+    for (int i = 0; i < INSTANCES; i++) {
+        const MBC_State* mbc = ls.instances[i].memory.mbc_data;
+        TEST_ASSERT_EQUAL_PTR(ls.rom, mbc->rom_data);
+        TEST_ASSERT_EQUAL_PTR(ls.rom_refs, mbc->rom_refs);
+        gb_cleanup(&ref[i]);
+    }
+
+    /* Reset puts every instance back at the start */
+    lockstep_reset(&ls);
+    TEST_ASSERT_EQUAL_UINT64(0, ls.frames);
+    for (int i = 0; i < INSTANCES; i++) {
+        TEST_ASSERT_EQUAL_HEX16(0x0100, ls.instances[i].cpu.pc);
+    }
+    lockstep_cleanup(&ls);
+}
+
+static void test_faulted_instances_stop(void) {
+    static uint8_t rom[0x8000];
+    build_rom(rom);
+    rom[0x164] = 0xD3;              /* Holding Right reaches an invalid opcode */
+
+    Lockstep ls;
+    TEST_ASSERT_TRUE(lockstep_init(&ls, rom, sizeof(rom), 4));
+    const uint8_t buttons[4] = { 0, JP_RIGHT, 0, JP_RIGHT };
+    TEST_ASSERT_EQUAL_UINT32(2, lockstep_step(&ls, buttons, LOCKSTEP_OBSERVE_NONE, NULL));
+    TEST_ASSERT_EQUAL_UINT32(2, lockstep_step(&ls, NULL, LOCKSTEP_OBSERVE_NONE, NULL));
+    TEST_ASSERT_FALSE(ls.instances[0].cpu_fault);
+    TEST_ASSERT_TRUE(ls.instances[1].cpu_fault);
+
+    lockstep_reset(&ls);
+    TEST_ASSERT_FALSE(ls.instances[1].cpu_fault);
+    lockstep_cleanup(&ls);
+
+    /* A ROM the core cannot map is refused */
+    rom[0x147] = 0xFE;
+    TEST_ASSERT_FALSE(lockstep_init(&ls, rom, sizeof(rom), 4));
+}
+
+int main(void) {
+    build_rom(s_rom);
+    UnityBegin();
+    RUN_TEST(test_instances_match_separate_emulators);
+    RUN_TEST(test_faulted_instances_stop);
+    return UnityEnd();
+}
@@ -0,0 +1,199 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "vendor/unity.h"
+#include "../src/gbendo.h"
+
+#define ROM_PATH "tests/multi_instance_test.gb"
+#define INSTANCES 4
+#define FRAMES 30
+
+/* Each instance keeps hashes of everything it produced, so runs on
+   different threads can be compared with a single-threaded reference */
+typedef struct {
+    int palette;
+    uint64_t framebuffer_hash;
+    uint64_t audio_hash;
+    uint64_t audio_frames;
+    uint64_t snapshot_hash;
+    uint64_t instructions;
+    bool ok;
+} InstanceResult;
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* p = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* 32KB ROM-only cartridge that keeps the PPU and APU busy:
+ *
+ *   0150: sound on, channel 1 square wave panned to both sides, LCD on
+ *   0170: LD A,(C000) / INC A / LD (C000),A / LDH (47),A / LDH (13),A / JR 0170
+ *
+ * so the background palette and the tone change on every pass. */
+static bool write_rom(const char* path) {
+    static uint8_t rom[0x8000];
+    memset(rom, 0, sizeof(rom));
+
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    memcpy(&rom[0x100], entry, sizeof(entry));
+
+    const uint8_t program[] = {
+        0x3E, 0x80, 0xE0, 0x26,     /* NR52 = 80: sound on     */
+        0x3E, 0x77, 0xE0, 0x24,     /* NR50 = 77: full volume  */
+        0x3E, 0xFF, 0xE0, 0x25,     /* NR51 = FF: both sides   */
+        0x3E, 0x80, 0xE0, 0x11,     /* NR11 = 80: 50% duty     */
+        0x3E, 0xF0, 0xE0, 0x12,     /* NR12 = F0: max volume   */
+        0x3E, 0x00, 0xE0, 0x13,     /* NR13 = 00               */
+        0x3E, 0x87, 0xE0, 0x14,     /* NR14 = 87: trigger      */
+        0x3E, 0x91, 0xE0, 0x40,     /* LCDC = 91: LCD on       */
+        0xFA, 0x00, 0xC0,           /* LD A,(C000)             */
+        0x3C,                       /* INC A                   */
+        0xEA, 0x00, 0xC0,           /* LD (C000),A             */
+        0xE0, 0x47,                 /* LDH (47),A: BGP         */
+        0xE0, 0x13,                 /* LDH (13),A: NR13        */
+        0x18, 0xF3                  /* JR 0170                 */
+    };
+    memcpy(&rom[0x150], program, sizeof(program));
+
+    rom[0x147] = 0x00;              /* ROM only */
+    rom[0x148] = 0x00;              /* 32KB */
+    rom[0x149] = 0x00;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t written = fwrite(rom, 1, sizeof(rom), f);
+    fclose(f);
+    return written == sizeof(rom);
+}
+
+static void* run_instance(void* arg) {
+    InstanceResult* result = arg;
+    GBEmulator* gb = malloc(sizeof(GBEmulator));
+    result->ok = false;
+    if (!gb) return NULL;
+
+    gb_init(gb);
+    if (!gb_load_rom(gb, ROM_PATH)) {
+        free(gb);
+        return NULL;
+    }
+    gb_reset(gb);
+    ppu_set_palette(&gb->ppu, result->palette);
+    profiler_enable(&gb->profiler, true);
+
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    uint64_t audio_hash = 0xcbf29ce484222325ULL;
+    uint64_t audio_frames = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        PROFILE_START(&gb->profiler, FRAME_RENDER);
+        gb_run_frame_optimized(gb);
+        PROFILE_END(&gb->profiler, FRAME_RENDER);
+        gb->frame_complete = false;
+        profiler_increment_frame_count(&gb->profiler);
+
+        uint32_t n;
+        while ((n = apu_drain(&gb->apu, samples, APU_BUFFER_SAMPLES)) > 0) {
+            audio_hash = fnv1a(audio_hash, samples, n * APU_OUTPUT_CHANNELS * sizeof(float));
+            audio_frames += n;
+        }
+    }
+
+    size_t size = gb_snapshot_size(gb);
+    void* snapshot = malloc(size);
+    if (snapshot) {
+        gb_snapshot_save(gb, snapshot);
+        result->snapshot_hash = fnv1a(0xcbf29ce484222325ULL, snapshot, size);
+        result->framebuffer_hash = fnv1a(0xcbf29ce484222325ULL, gb->ppu.framebuffer,
+                                         sizeof(gb->ppu.framebuffer));
+        result->audio_hash = audio_hash;
+        result->audio_frames = audio_frames;
+        result->instructions = gb->instructions;
+        result->ok = gb->profiler.frame_count == FRAMES &&
+                     gb->profiler.stats[PROFILE_FRAME_RENDER].call_count == FRAMES;
+        free(snapshot);
+    }
+
+    gb_cleanup(gb);
+    free(gb);
+    return NULL;
+}
+
+static void test_concurrent_instances_match_single_threaded_runs(void) {
+    TEST_ASSERT_TRUE(write_rom(ROM_PATH));
+
+    /* Reference: one instance at a time */
+    InstanceResult reference[INSTANCES];
+    for (int i = 0; i < INSTANCES; i++) {
+        memset(&reference[i], 0, sizeof(reference[i]));
+        reference[i].palette = i;
+        run_instance(&reference[i]);
+        TEST_ASSERT_TRUE(reference[i].ok);
+        TEST_ASSERT_TRUE(reference[i].audio_frames > 0);
+    }
+    /* The palette is per instance, so the pictures differ */
+    TEST_ASSERT_NOT_EQUAL_UINT64(reference[0].framebuffer_hash, reference[1].framebuffer_hash);
+
+    /* All at once, one thread each */
+    InstanceResult results[INSTANCES];
+    pthread_t threads[INSTANCES];
+    for (int i = 0; i < INSTANCES; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+        results[i].palette = i;
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, run_instance, &results[i]));
+    }
+    for (int i = 0; i < INSTANCES; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < INSTANCES; i++) {
+        TEST_ASSERT_TRUE(results[i].ok);
+        TEST_ASSERT_EQUAL_UINT64(reference[i].framebuffer_hash, results[i].framebuffer_hash);
+        TEST_ASSERT_EQUAL_UINT64(reference[i].audio_frames, results[i].audio_frames);
+        TEST_ASSERT_EQUAL_UINT64(reference[i].audio_hash, results[i].audio_hash);
+        TEST_ASSERT_EQUAL_UINT64(reference[i].snapshot_hash, results[i].snapshot_hash);
+        TEST_ASSERT_EQUAL_UINT64(reference[i].instructions, results[i].instructions);
+    }
+    remove(ROM_PATH);
+}
+
+static void test_debug_profiler_and_speed_state_are_per_instance(void) {
+    static GBEmulator a, b;
+    gb_init(&a);
+    gb_init(&b);
+
+    gb_enable_debug(&a);
+    TEST_ASSERT_TRUE(gb_is_debug_enabled(&a.memory));
+    TEST_ASSERT_FALSE(gb_is_debug_enabled(&b.memory));
+    TEST_ASSERT_EQUAL_PTR(&a, gb_get_debug_gb(&a.memory));
+    TEST_ASSERT_NULL(gb_get_debug_gb(&b.memory));
+    gb_disable_debug(&a);
+    TEST_ASSERT_FALSE(gb_is_debug_enabled(&a.memory));
+
+    profiler_enable(&a.profiler, true);
+    TEST_ASSERT_TRUE(a.profiler.enabled);
+    TEST_ASSERT_FALSE(b.profiler.enabled);
+
+    memory_init_cgb(&a.memory);
+    memory_init_cgb(&b.memory);
+    memory_request_speed_switch(&a.memory);
+    for (int i = 0; i <= CGB_SPEED_SWITCH_DELAY; i++) memory_handle_speed_switch(&a.memory);
+    TEST_ASSERT_EQUAL(SPEED_DOUBLE, memory_get_current_speed(&a.memory));
+    TEST_ASSERT_EQUAL(SPEED_NORMAL, memory_get_current_speed(&b.memory));
+    TEST_ASSERT_FALSE(b.memory.speed_switch_pending);
+
+    gb_cleanup(&a);
+    gb_cleanup(&b);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_concurrent_instances_match_single_threaded_runs);
+    RUN_TEST(test_debug_profiler_and_speed_state_are_per_instance);
+    return UnityEnd();
+}
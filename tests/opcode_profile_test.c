@@ -0,0 +1,147 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/cpu/opcode_profile.h"
+
+#define ROM_PATH "tests/opcode_profile_test.gb"
+
+static GBEmulator s_gb;
+static OpcodeProfile s_profile;
+
+static void boot(void) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, 0x03));
+    gb_init(&s_gb);
+    TEST_ASSERT_TRUE(gb_load_rom(&s_gb, ROM_PATH));
+    gb_reset(&s_gb);
+    remove(ROM_PATH);
+    opcode_profile_init(&s_profile);
+    sm83_set_opcode_profile(&s_gb.cpu, &s_profile);
+}
+
+static void run_frames(int frames) {
+    float samples[APU_BUFFER_SAMPLES * APU_OUTPUT_CHANNELS];
+    for (int i = 0; i < frames; i++) {
+        gb_run_frame_optimized(&s_gb);
+        s_gb.frame_complete = false;
+        while (apu_drain(&s_gb.apu, samples, APU_BUFFER_SAMPLES) > 0) {}
+    }
+}
+
+static void test_counts_match_the_program(void) {
+    boot();
+    run_frames(3);
+
+    /* The loop body runs in order from INC (HL), so later opcodes trail it
+       by at most one */
+    uint64_t loops = s_profile.main[0x34].count;   /* INC (HL) */
+    TEST_ASSERT_TRUE(loops > 1000);
+    TEST_ASSERT_TRUE(loops - s_profile.main[0xFA].count <= 1);
+    TEST_ASSERT_TRUE(loops - s_profile.main[0x18].count <= 1);
+    TEST_ASSERT_EQUAL_UINT64(1, s_profile.main[0xC3].count);   /* The entry jump */
+    TEST_ASSERT_EQUAL_UINT64(1, s_profile.main[0x21].count);
+
+    /* Every instruction and every cycle is accounted for */
+    uint64_t instructions = 0, cycles = 0, samples = 0;
+    for (int op = 0; op < 256; op++) {
+        instructions += s_profile.main[op].count + s_profile.cb[op].count;
+        cycles += s_profile.main[op].cycles + s_profile.cb[op].cycles;
+        samples += s_profile.main[op].samples + s_profile.cb[op].samples;
+    }
+    TEST_ASSERT_EQUAL_UINT64(s_gb.instructions, instructions);
+    TEST_ASSERT_EQUAL_UINT64(s_gb.cycles, cycles);
+    TEST_ASSERT_EQUAL_UINT64(12, s_profile.main[0x18].cycles / s_profile.main[0x18].count);   /* Taken JR */
+
+    /* About one in OPCODE_PROFILE_SAMPLE_INTERVAL, spread over the loop */
+    TEST_ASSERT_TRUE(samples > instructions / (2 * OPCODE_PROFILE_SAMPLE_INTERVAL));
+    TEST_ASSERT_TRUE(samples < instructions * 2 / OPCODE_PROFILE_SAMPLE_INTERVAL);
+    TEST_ASSERT_TRUE(s_profile.main[0x34].samples > 0);
+    TEST_ASSERT_TRUE(s_profile.main[0x3C].samples > 0);
+
+    /* A clone starts without the parent's profile */
+    GBEmulator* clone = malloc(sizeof(GBEmulator));
+    TEST_ASSERT_NOT_NULL(clone);
+    TEST_ASSERT_TRUE(gb_clone(clone, &s_gb));
+    TEST_ASSERT_NULL(clone->cpu.opcode_profile);
+    gb_cleanup(clone);
+    free(clone);
+
+    sm83_set_opcode_profile(&s_gb.cpu, NULL);
+    uint64_t before = s_profile.main[0x34].count;
+    run_frames(1);
+    TEST_ASSERT_EQUAL_UINT64(before, s_profile.main[0x34].count);
+    gb_cleanup(&s_gb);
+}
+
+static void test_cb_opcodes_counted_by_second_byte(void) {
+    boot();
+    /* SWAP A; BIT 7,H; JR -6 in work RAM */
+    const uint8_t program[] = { 0xCB, 0x37, 0xCB, 0x7C, 0x18, 0xFA };
+    for (size_t i = 0; i < sizeof(program); i++) {
+        memory_write(&s_gb.memory, 0xC100 + i, program[i]);
+    }
+    s_gb.cpu.pc = 0xC100;
+    for (int i = 0; i < 30; i++) {
+        TEST_ASSERT_TRUE(sm83_step(&s_gb.cpu) > 0);
+    }
+    TEST_ASSERT_EQUAL_UINT64(10, s_profile.cb[0x37].count);
+    TEST_ASSERT_EQUAL_UINT64(10, s_profile.cb[0x7C].count);
+    TEST_ASSERT_EQUAL_UINT64(80, s_profile.cb[0x37].cycles);
+    TEST_ASSERT_EQUAL_UINT64(0, s_profile.main[0xCB].count);
+    TEST_ASSERT_EQUAL_STRING("ROT/SHIFT", opcode_profile_class(true, 0x37));
+    TEST_ASSERT_EQUAL_STRING("BIT", opcode_profile_class(true, 0x7C));
+    TEST_ASSERT_EQUAL_STRING("JR", opcode_profile_class(false, 0x18));
+    gb_cleanup(&s_gb);
+}
+
+static void test_export_formats(void) {
+    boot();
+    run_frames(1);
+    gb_cleanup(&s_gb);
+
+    const char* csv_path = "tests/opcode_profile_test.csv";
+    const char* json_path = "tests/opcode_profile_test.json";
+    TEST_ASSERT_TRUE(opcode_profile_export(&s_profile, csv_path));
+    TEST_ASSERT_TRUE(opcode_profile_export(&s_profile, json_path));
+
+    char line[256];
+    FILE* f = fopen(csv_path, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), f));
+    TEST_ASSERT_EQUAL_STRING("prefix,opcode,class,count,cycles,samples,avg_ns,host_ns\n", line);
+    int rows = 0;
+    bool found_jr = false;
+    while (fgets(line, sizeof(line), f)) {
+        rows++;
+        if (strncmp(line, ",18,JR,", 7) == 0) found_jr = true;
+    }
+    fclose(f);
+    TEST_ASSERT_EQUAL_INT(8, rows);     /* Entry jump, setup and loop opcodes */
+    TEST_ASSERT_TRUE(found_jr);
+
+    f = fopen(json_path, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), f));
+    TEST_ASSERT_EQUAL_STRING("{\n", line);
+    bool found_opcodes = false;
+    while (fgets(line, sizeof(line), f)) {
+        if (strstr(line, "\"opcodes\": [")) found_opcodes = true;
+    }
+    fclose(f);
+    TEST_ASSERT_TRUE(found_opcodes);
+
+    remove(csv_path);
+    remove(json_path);
+    TEST_ASSERT_FALSE(opcode_profile_export(&s_profile, "tests/no_such_dir/profile.csv"));
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_counts_match_the_program);
+    RUN_TEST(test_cb_opcodes_counted_by_second_byte);
+    RUN_TEST(test_export_formats);
+    return UnityEnd();
+}
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <time.h>
+#include "vendor/unity.h"
+#include "../src/profiler.h"
+
+static Profiler s_prof;
+
+static void busy_wait_ns(uint64_t ns) {
+    uint64_t start = profiler_get_time_ns();
+    while (profiler_get_time_ns() - start < ns) {}
+}
+
+static void test_ticks_convert_to_monotonic_time(void) {
+    profiler_init(&s_prof);
+    profiler_enable(&s_prof, true);     /* Calibrates the tick rate */
+
+    uint64_t start_ns = profiler_get_time_ns();
+    uint64_t start = profiler_ticks();
+    busy_wait_ns(5000000ULL);
+    uint64_t ticks = profiler_ticks_end() - start;
+    double elapsed_ns = (double)(profiler_get_time_ns() - start_ns);
+
+    /* Within 5% of CLOCK_MONOTONIC over 5 ms */
+    double measured_ns = profiler_ticks_to_ns(ticks);
+    TEST_ASSERT_TRUE(measured_ns > elapsed_ns * 0.95);
+    TEST_ASSERT_TRUE(measured_ns < elapsed_ns * 1.05);
+}
+
+static void test_probes_record_only_when_enabled(void) {
+    profiler_init(&s_prof);
+    {
+        PROFILE_START(&s_prof, FRAME_RENDER);
+        PROFILE_END(&s_prof, FRAME_RENDER);
+    }
+    TEST_ASSERT_EQUAL_UINT64(0, s_prof.stats[PROFILE_FRAME_RENDER].call_count);
+
+    profiler_enable(&s_prof, true);
+    for (int i = 0; i < 3; i++) {
+        PROFILE_START(&s_prof, FRAME_RENDER);
+        busy_wait_ns(100000ULL);
+        PROFILE_END(&s_prof, FRAME_RENDER);
+    }
+    const ProfilerStats* stats = &s_prof.stats[PROFILE_FRAME_RENDER];
+#if GBENDO_PROFILING == 0
+    /* Compiled out: enabling at run time changes nothing */
+    TEST_ASSERT_EQUAL_UINT64(0, stats->call_count);
+    return;
+#endif
+    TEST_ASSERT_EQUAL_UINT64(3, stats->call_count);
+    TEST_ASSERT_TRUE(stats->min_ticks <= stats->max_ticks);
+    TEST_ASSERT_TRUE(stats->total_ticks >= stats->min_ticks * 3);
+    TEST_ASSERT_TRUE(profiler_ticks_to_ns(stats->min_ticks) >= 90000.0);
+}
+
+static void test_scope_probe_records_on_exit(void) {
+    profiler_init(&s_prof);
+    profiler_enable(&s_prof, true);
+    {
+        PROFILE_SCOPE(&s_prof, RUN_AHEAD);
+        busy_wait_ns(10000ULL);
+    }
+    TEST_ASSERT_EQUAL_UINT64(GBENDO_PROFILING ? 1 : 0, s_prof.stats[PROFILE_RUN_AHEAD].call_count);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_ticks_convert_to_monotonic_time);
+    RUN_TEST(test_probes_record_only_when_enabled);
+    RUN_TEST(test_scope_probe_records_on_exit);
+    return UnityEnd();
+}
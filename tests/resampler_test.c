@@ -0,0 +1,95 @@
+#include <math.h>
+#include <stdint.h>
+#include "vendor/unity.h"
+#include "../src/audio/resampler.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define INPUT_RATE 44100
+#define BLOCK 735
+
+static Resampler rs;
+static float input[BLOCK * RESAMPLER_CHANNELS];
+static float output[BLOCK * 4 * RESAMPLER_CHANNELS];
+
+/* Feed a sine (or DC when freq is 0) on the left and its quarter on the
+   right; return frames produced */
+static uint32_t feed(double freq, uint32_t blocks, float peak_after_settle[2]) {
+    uint32_t total = 0;
+    uint64_t t = 0;
+    float peak[2] = {0.0f, 0.0f};
+    for (uint32_t b = 0; b < blocks; b++) {
+        for (uint32_t i = 0; i < BLOCK; i++, t++) {
+            float s = freq == 0.0 ? 0.5f : (float)(0.5 * sin(2.0 * M_PI * freq * t / INPUT_RATE));
+            input[i * 2] = s;
+            input[i * 2 + 1] = s * 0.25f;
+        }
+        uint32_t n = resampler_process(&rs, input, BLOCK, output, BLOCK * 4);
+        for (uint32_t i = 0; i < n; i++) {
+            if (total + i < RESAMPLER_TAPS) continue;
+            for (int c = 0; c < 2; c++) {
+                if (fabsf(output[i * 2 + c]) > peak[c]) peak[c] = fabsf(output[i * 2 + c]);
+            }
+        }
+        total += n;
+    }
+    if (peak_after_settle) {
+        peak_after_settle[0] = peak[0];
+        peak_after_settle[1] = peak[1];
+    }
+    return total;
+}
+
+static void test_passes_dc_and_tones_at_unity_gain(void) {
+    TEST_ASSERT_TRUE(resampler_init(&rs, INPUT_RATE, INPUT_RATE));
+    float peak[2];
+    feed(0.0, 20, peak);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, peak[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.125f, peak[1]);
+
+    /* The channels stay apart */
+    resampler_reset(&rs);
+    feed(1000.0, 20, peak);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, peak[0]);
+    TEST_ASSERT_FLOAT_WITHIN(0.0025f, 0.125f, peak[1]);
+}
+
+static void test_converts_to_device_rate(void) {
+    TEST_ASSERT_TRUE(resampler_init(&rs, INPUT_RATE, 48000));
+    /* 60 blocks of 735 is one second of input */
+    uint32_t produced = feed(440.0, 60, NULL);
+    TEST_ASSERT_UINT32_WITHIN(RESAMPLER_TAPS, 48000, produced);
+    TEST_ASSERT_FALSE(resampler_init(&rs, 0, 48000));
+}
+
+static void test_queue_fill_steers_the_ratio(void) {
+    TEST_ASSERT_TRUE(resampler_init(&rs, INPUT_RATE, INPUT_RATE));
+
+    /* A full queue slows production by the maximum, clamped beyond that */
+    resampler_set_fill(&rs, 4096, 1024);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0 / (1.0 + RESAMPLER_DRC_MAX) - 1.0, resampler_get_adjust(&rs));
+    uint32_t slow = feed(440.0, 60, NULL);
+
+    resampler_reset(&rs);
+    resampler_set_fill(&rs, 0, 1024);
+    TEST_ASSERT_TRUE(resampler_get_adjust(&rs) > 0.0);
+    uint32_t fast = feed(440.0, 60, NULL);
+
+    resampler_reset(&rs);
+    resampler_set_fill(&rs, 1024, 1024);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, resampler_get_adjust(&rs));
+
+    /* +-0.5% of 44100 is about 220 samples either way */
+    TEST_ASSERT_UINT32_WITHIN(RESAMPLER_TAPS, 44100 - 219, slow);
+    TEST_ASSERT_UINT32_WITHIN(RESAMPLER_TAPS, 44100 + 222, fast);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_passes_dc_and_tones_at_unity_gain);
+    RUN_TEST(test_converts_to_device_rate);
+    RUN_TEST(test_queue_fill_steers_the_ratio);
+    return UnityEnd();
+}
@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/rewind.h"
+
+#define ROM_PATH "tests/rewind_test.gb"
+#define FRAMES 12
+
+static GBEmulator gb;
+static uint8_t* history[FRAMES];
+static size_t snap_size;
+
+static void boot(void) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, 0x02));
+    gb_init(&gb);
+    TEST_ASSERT_TRUE(gb_load_rom(&gb, ROM_PATH));
+    snap_size = gb_snapshot_size(&gb);
+}
+
+/* Run FRAMES frames, capturing after each and keeping a full copy for reference */
+static void record(RewindBuffer* rw) {
+    for (int i = 0; i < FRAMES; i++) {
+        gb_run_frame(&gb);
+        rewind_capture(rw, &gb);
+        history[i] = malloc(snap_size);
+        gb_snapshot_save(&gb, history[i]);
+    }
+}
+
+static void release(void) {
+    for (int i = 0; i < FRAMES; i++) {
+        free(history[i]);
+        history[i] = NULL;
+    }
+    gb_cleanup(&gb);
+}
+
+static void assert_state_is(int frame) {
+    uint8_t* now = malloc(snap_size);
+    gb_snapshot_save(&gb, now);
+    TEST_ASSERT_EQUAL_MEMORY(history[frame], now, snap_size);
+    free(now);
+}
+
+static void test_step_back_restores_each_capture(void) {
+    RewindBuffer rw;
+    boot();
+    TEST_ASSERT_TRUE(rewind_init(&rw, 1024 * 1024, 1));
+    record(&rw);
+
+    TEST_ASSERT_EQUAL_UINT32(FRAMES - 1, rewind_available(&rw));
+    for (int i = FRAMES - 2; i >= 0; i--) {
+        TEST_ASSERT_TRUE(rewind_step(&rw, &gb));
+        assert_state_is(i);
+    }
+    TEST_ASSERT_FALSE(rewind_step(&rw, &gb));
+
+    rewind_cleanup(&rw);
+    release();
+}
+
+static void test_resume_after_rewind(void) {
+    RewindBuffer rw;
+    boot();
+    TEST_ASSERT_TRUE(rewind_init(&rw, 1024 * 1024, 1));
+    record(&rw);
+
+    /* Go back three captures, play one frame, then rewind over it again */
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(rewind_step(&rw, &gb));
+    assert_state_is(FRAMES - 4);
+    gb_run_frame(&gb);
+    rewind_capture(&rw, &gb);
+    assert_state_is(FRAMES - 3);
+
+    TEST_ASSERT_TRUE(rewind_step(&rw, &gb));
+    assert_state_is(FRAMES - 4);
+
+    rewind_cleanup(&rw);
+    release();
+}
+
+static void test_budget_drops_oldest(void) {
+    RewindBuffer rw;
+    boot();
+
+    /* Room for only a few deltas */
+    TEST_ASSERT_TRUE(rewind_init(&rw, 256, 1));
+    record(&rw);
+
+    size_t available = rewind_available(&rw);
+    TEST_ASSERT_TRUE(available > 0);
+    TEST_ASSERT_TRUE(available < FRAMES - 1);
+    for (size_t i = 0; i < available; i++) {
+        TEST_ASSERT_TRUE(rewind_step(&rw, &gb));
+        assert_state_is(FRAMES - 2 - (int)i);
+    }
+    TEST_ASSERT_FALSE(rewind_step(&rw, &gb));
+
+    rewind_cleanup(&rw);
+    release();
+}
+
+static void test_interval_skips_frames(void) {
+    RewindBuffer rw;
+    boot();
+    TEST_ASSERT_TRUE(rewind_init(&rw, 1024 * 1024, 3));
+    record(&rw);
+
+    /* Captures after frames 0, 3, 6, 9 */
+    TEST_ASSERT_EQUAL_UINT32(3, rewind_available(&rw));
+    TEST_ASSERT_TRUE(rewind_step(&rw, &gb));
+    assert_state_is(6);
+
+    rewind_cleanup(&rw);
+    release();
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_step_back_restores_each_capture);
+    RUN_TEST(test_resume_after_rewind);
+    RUN_TEST(test_budget_drops_oldest);
+    RUN_TEST(test_interval_skips_frames);
+    remove(ROM_PATH);
+    return UnityEnd();
+}
@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/runahead.h"
+
+#define ROM_PATH "tests/runahead_test.gb"
+
+static void boot(GBEmulator* gb) {
+    gb_init(gb);
+    TEST_ASSERT_TRUE(gb_load_rom(gb, ROM_PATH));
+}
+
+static void test_runahead_keeps_real_timeline(void) {
+    GBEmulator ref, gb;
+    RunAhead ra;
+    boot(&ref);
+    boot(&gb);
+    TEST_ASSERT_TRUE(runahead_init(&ra, 2));
+
+    for (int i = 0; i < 5; i++) {
+        gb_run_frame_optimized(&ref);
+        runahead_run_frame(&ra, &gb);
+    }
+
+    /* Emulated state matches a plain run frame for frame */
+    size_t size = gb_snapshot_size(&ref);
+    uint8_t* a = malloc(size);
+    uint8_t* b = malloc(size);
+    gb_snapshot_save(&ref, a);
+    gb_snapshot_save(&gb, b);
+    TEST_ASSERT_EQUAL_MEMORY(a, b, size);
+    TEST_ASSERT_FALSE(gb.ppu.skip_render);
+    TEST_ASSERT_EQUAL_UINT64(ref.instructions, gb.instructions);
+
+    /* Audio of the real frame is kept, the look-ahead audio is dropped */
+    TEST_ASSERT_EQUAL_UINT32(ref.apu.output.buffer.frames, gb.apu.output.buffer.frames);
+
+    free(a);
+    free(b);
+    runahead_cleanup(&ra);
+    gb_cleanup(&ref);
+    gb_cleanup(&gb);
+}
+
+static void test_runahead_shows_future_frame(void) {
+    GBEmulator ref, gb;
+    RunAhead ra;
+    boot(&ref);
+    boot(&gb);
+    TEST_ASSERT_TRUE(runahead_init(&ra, 2));
+
+    /* Turn the LCD on so frames are actually drawn */
+    memory_write(&ref.memory, 0xFF40, 0x91);
+    memory_write(&gb.memory, 0xFF40, 0x91);
+
+    runahead_run_frame(&ra, &gb);
+    for (int i = 0; i < 3; i++) gb_run_frame_optimized(&ref);
+
+    TEST_ASSERT_EQUAL_MEMORY(ref.ppu.framebuffer, gb.ppu.framebuffer, sizeof(ref.ppu.framebuffer));
+
+    runahead_cleanup(&ra);
+    gb_cleanup(&ref);
+    gb_cleanup(&gb);
+}
+
+static void test_runahead_disabled_is_plain_frame(void) {
+    GBEmulator gb;
+    RunAhead ra;
+    boot(&gb);
+    TEST_ASSERT_TRUE(runahead_init(&ra, 0));
+    TEST_ASSERT_FALSE(runahead_init(&ra, RUNAHEAD_MAX_FRAMES + 1));
+    TEST_ASSERT_TRUE(runahead_init(&ra, 0));
+
+    runahead_run_frame(&ra, &gb);
+    TEST_ASSERT_NULL(ra.snapshot);
+    TEST_ASSERT_TRUE(gb.frame_complete);
+
+    runahead_cleanup(&ra);
+    gb_cleanup(&gb);
+}
+
+int main(void) {
+    UnityBegin();
+    if (!test_rom_write(ROM_PATH, 0x03, 0x02)) return 1;
+    RUN_TEST(test_runahead_keeps_real_timeline);
+    RUN_TEST(test_runahead_shows_future_frame);
+    RUN_TEST(test_runahead_disabled_is_plain_frame);
+    remove(ROM_PATH);
+    return UnityEnd();
+}
@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+#include "../src/savestate.h"
+
+#define ROM_PATH "tests/savestate_test.gb"
+#define STATE_PATH "tests/savestate_test.gbstate"
+
+static void boot(GBEmulator* gb, uint8_t ram_code) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, ram_code));
+    gb_init(gb);
+    TEST_ASSERT_TRUE(gb_load_rom(gb, ROM_PATH));
+}
+
+static uint8_t* encode(const GBEmulator* gb, size_t* size) {
+    *size = savestate_encode(gb, NULL, 0);
+    uint8_t* buf = malloc(*size);
+    TEST_ASSERT_EQUAL_UINT32(*size, savestate_encode(gb, buf, *size));
+    return buf;
+}
+
+/* Offset of the chunk with the given tag, or 0 if absent */
+static size_t find_chunk(const uint8_t* buf, size_t size, const char* tag) {
+    size_t pos = SAVESTATE_HEADER_SIZE;
+    while (pos + SAVESTATE_CHUNK_HEADER_SIZE <= size) {
+        if (memcmp(buf + pos, tag, 4) == 0) return pos;
+        uint32_t length = buf[pos + 8] | (buf[pos + 9] << 8) | (buf[pos + 10] << 16) | ((uint32_t)buf[pos + 11] << 24);
+        pos += SAVESTATE_CHUNK_HEADER_SIZE + length;
+    }
+    return 0;
+}
+
+static void test_header_layout(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    size_t size;
+    uint8_t* buf = encode(&gb, &size);
+
+    TEST_ASSERT_EQUAL_MEMORY("GBST", buf, 4);
+    TEST_ASSERT_EQUAL_UINT8(SAVESTATE_FORMAT_VERSION, buf[4]);
+    TEST_ASSERT_EQUAL_UINT8(0, buf[5]);
+    TEST_ASSERT_EQUAL_UINT8(SAVESTATE_HEADER_SIZE, buf[6]);
+    TEST_ASSERT_TRUE(find_chunk(buf, size, "CPU ") != 0);
+    TEST_ASSERT_TRUE(find_chunk(buf, size, "SRAM") != 0);
+    TEST_ASSERT_EQUAL_UINT32(0, find_chunk(buf, size, "RTC "));
+    TEST_ASSERT_EQUAL_UINT32(0, savestate_encode(&gb, buf, size - 1));
+
+    free(buf);
+    gb_cleanup(&gb);
+}
+
+static void test_roundtrip_restores_full_state(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    size_t size;
+    uint8_t* state = encode(&gb, &size);
+    size_t snap_size = gb_snapshot_size(&gb);
+    uint8_t* before = malloc(snap_size);
+    uint8_t* after = malloc(snap_size);
+    gb_snapshot_save(&gb, before);
+
+    gb_run_frame(&gb);
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(savestate_decode(&gb, state, size));
+    gb_snapshot_save(&gb, after);
+    TEST_ASSERT_EQUAL_MEMORY(before, after, snap_size);
+
+    free(state);
+    free(before);
+    free(after);
+    gb_cleanup(&gb);
+}
+
+static void test_unknown_chunk_is_skipped(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    size_t size;
+    uint8_t* state = encode(&gb, &size);
+
+    /* Append a chunk from a hypothetical newer writer */
+    static const uint8_t extra[] = { 'X', 'T', 'R', 'A', 1, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3 };
+    uint8_t* grown = malloc(size + sizeof(extra));
+    memcpy(grown, state, size);
+    memcpy(grown + size, extra, sizeof(extra));
+    grown[8]++;  /* chunk_count */
+
+    uint8_t counter = gb.memory.wram[0];
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(savestate_decode(&gb, grown, size + sizeof(extra)));
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+
+    free(state);
+    free(grown);
+    gb_cleanup(&gb);
+}
+
+static void test_corrupt_state_leaves_emulator_untouched(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    size_t size;
+    uint8_t* state = encode(&gb, &size);
+    gb_run_frame(&gb);
+    uint16_t pc = gb.cpu.pc;
+    uint8_t counter = gb.memory.wram[0];
+
+    /* Flip a WRAM byte: the chunk checksum no longer matches */
+    size_t wram = find_chunk(state, size, "WRAM");
+    TEST_ASSERT_TRUE(wram != 0);
+    state[wram + SAVESTATE_CHUNK_HEADER_SIZE] ^= 0xFF;
+    TEST_ASSERT_FALSE(savestate_decode(&gb, state, size));
+    state[wram + SAVESTATE_CHUNK_HEADER_SIZE] ^= 0xFF;
+
+    /* Truncated anywhere */
+    TEST_ASSERT_FALSE(savestate_decode(&gb, state, size - 1));
+    TEST_ASSERT_FALSE(savestate_decode(&gb, state, SAVESTATE_HEADER_SIZE - 1));
+
+    /* Wrong magic */
+    state[0] = 'X';
+    TEST_ASSERT_FALSE(savestate_decode(&gb, state, size));
+
+    TEST_ASSERT_EQUAL_UINT16(pc, gb.cpu.pc);
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+
+    free(state);
+    gb_cleanup(&gb);
+}
+
+static void test_deflated_state_roundtrip(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    size_t size;
+    uint8_t* state = encode(&gb, &size);
+    size_t bound = savestate_deflate_bound(size);
+    uint8_t* packed = malloc(bound);
+    size_t packed_size = savestate_deflate(state, size, packed, bound);
+    TEST_ASSERT_TRUE(packed_size > 0 && packed_size < size);
+
+    size_t wram = find_chunk(packed, packed_size, "WRAM");
+    TEST_ASSERT_TRUE(wram != 0);
+    TEST_ASSERT_EQUAL_UINT8(SAVESTATE_CHUNK_DEFLATE, packed[wram + 6]);
+
+    uint8_t counter = gb.memory.wram[0];
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(savestate_decode(&gb, packed, packed_size));
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+
+    /* A wrong uncompressed length is caught before anything is written */
+    gb_run_frame(&gb);
+    uint16_t pc = gb.cpu.pc;
+    packed[wram + SAVESTATE_CHUNK_HEADER_SIZE]++;
+    TEST_ASSERT_FALSE(savestate_decode(&gb, packed, packed_size));
+    TEST_ASSERT_EQUAL_UINT16(pc, gb.cpu.pc);
+
+    free(state);
+    free(packed);
+    gb_cleanup(&gb);
+}
+
+static void test_rejects_other_cartridge(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    size_t size;
+    uint8_t* state = encode(&gb, &size);
+    gb_cleanup(&gb);
+
+    /* Same program, 32KB of cart RAM instead of 8KB */
+    boot(&gb, 0x03);
+    TEST_ASSERT_FALSE(savestate_decode(&gb, state, size));
+
+    free(state);
+    gb_cleanup(&gb);
+}
+
+static void test_file_roundtrip(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(gb_save_state(&gb, STATE_PATH));
+    uint8_t counter = gb.memory.wram[0];
+    uint8_t sram = ((MBC_State*)gb.memory.mbc_data)->ram_data[0];
+
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(gb_load_state(&gb, STATE_PATH));
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+    TEST_ASSERT_EQUAL_UINT8(sram, ((MBC_State*)gb.memory.mbc_data)->ram_data[0]);
+
+    remove(STATE_PATH);
+    TEST_ASSERT_FALSE(gb_load_state(&gb, STATE_PATH));
+    gb_cleanup(&gb);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_header_layout);
+    RUN_TEST(test_roundtrip_restores_full_state);
+    RUN_TEST(test_unknown_chunk_is_skipped);
+    RUN_TEST(test_corrupt_state_leaves_emulator_untouched);
+    RUN_TEST(test_deflated_state_roundtrip);
+    RUN_TEST(test_rejects_other_cartridge);
+    RUN_TEST(test_file_roundtrip);
+    remove(ROM_PATH);
+    return UnityEnd();
+}
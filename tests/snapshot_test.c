@@ -0,0 +1,109 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vendor/unity.h"
+#include "test_rom.h"
+#include "../src/gbendo.h"
+
+#define ROM_PATH "tests/snapshot_test.gb"
+#define STATE_PATH "tests/snapshot_test.gbstate"
+
+static void boot(GBEmulator* gb, uint8_t ram_code) {
+    TEST_ASSERT_TRUE(test_rom_write(ROM_PATH, 0x03, ram_code));
+    gb_init(gb);
+    TEST_ASSERT_TRUE(gb_load_rom(gb, ROM_PATH));
+}
+
+static void test_snapshot_roundtrip_is_deterministic(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    size_t size = gb_snapshot_size(&gb);
+    uint8_t* start = malloc(size);
+    uint8_t* after = malloc(size);
+    uint8_t* replay = malloc(size);
+    TEST_ASSERT_EQUAL_UINT32(size, gb_snapshot_save(&gb, start));
+
+    gb_run_frame(&gb);
+    gb_run_frame(&gb);
+    gb_snapshot_save(&gb, after);
+    uint16_t pc = gb.cpu.pc;
+    uint8_t counter = gb.memory.wram[0];
+
+    /* Rewinding and replaying the same frames must reproduce the state */
+    TEST_ASSERT_TRUE(gb_snapshot_load(&gb, start));
+    TEST_ASSERT_NOT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+    gb_run_frame(&gb);
+    gb_run_frame(&gb);
+    gb_snapshot_save(&gb, replay);
+
+    TEST_ASSERT_EQUAL_UINT16(pc, gb.cpu.pc);
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+    TEST_ASSERT_EQUAL_MEMORY(after, replay, size);
+
+    free(start);
+    free(after);
+    free(replay);
+    gb_cleanup(&gb);
+}
+
+static void test_snapshot_includes_cart_ram(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+
+    MBC_State* mbc = (MBC_State*)gb.memory.mbc_data;
+    uint8_t* buf = malloc(gb_snapshot_size(&gb));
+    gb_snapshot_save(&gb, buf);
+    uint8_t saved = mbc->ram_data[0];
+
+    mbc->ram_data[0] = (uint8_t)(saved + 1);
+    TEST_ASSERT_TRUE(gb_snapshot_load(&gb, buf));
+    TEST_ASSERT_EQUAL_UINT8(saved, mbc->ram_data[0]);
+
+    free(buf);
+    gb_cleanup(&gb);
+}
+
+static void test_snapshot_rejects_other_cartridge(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    uint8_t* buf = malloc(gb_snapshot_size(&gb));
+    gb_snapshot_save(&gb, buf);
+    gb_cleanup(&gb);
+
+    /* Same program, 32KB of cart RAM instead of 8KB */
+    boot(&gb, 0x03);
+    uint16_t pc = gb.cpu.pc;
+    TEST_ASSERT_FALSE(gb_snapshot_load(&gb, buf));
+    TEST_ASSERT_EQUAL_UINT16(pc, gb.cpu.pc);
+
+    free(buf);
+    gb_cleanup(&gb);
+}
+
+static void test_file_state_roundtrip(void) {
+    GBEmulator gb;
+    boot(&gb, 0x02);
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(gb_save_state(&gb, STATE_PATH));
+    uint8_t counter = gb.memory.wram[0];
+
+    gb_run_frame(&gb);
+    TEST_ASSERT_TRUE(gb_load_state(&gb, STATE_PATH));
+    TEST_ASSERT_EQUAL_UINT8(counter, gb.memory.wram[0]);
+
+    remove(STATE_PATH);
+    gb_cleanup(&gb);
+}
+
+int main(void) {
+    UnityBegin();
+    RUN_TEST(test_snapshot_roundtrip_is_deterministic);
+    RUN_TEST(test_snapshot_includes_cart_ram);
+    RUN_TEST(test_snapshot_rejects_other_cartridge);
+    RUN_TEST(test_file_state_roundtrip);
+    remove(ROM_PATH);
+    return UnityEnd();
+}
@@ -1,12 +1,12 @@
 #include <stdbool.h>
 #include <stdarg.h>
 #include "../../src/gbendo.h"
-#include "../../src/ui/ui.h"
+#include "../../src/ui/ui_debug.h"
 
 static GBEmulator* s_dbg = NULL;
 
-bool gb_is_debug_enabled(void) { return false; }
-GBEmulator* gb_get_debug_gb(void) { return s_dbg; }
+bool gb_is_debug_enabled(const Memory* mem) { (void)mem; return false; }
+GBEmulator* gb_get_debug_gb(const Memory* mem) { (void)mem; return s_dbg; }
 
 /* UI debug function stubs */
 bool ui_is_debug_enabled(UIDebugComponent component) { 
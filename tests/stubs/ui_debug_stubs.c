@@ -0,0 +1,15 @@
+#include <stdbool.h>
+#include <stdarg.h>
+#include "../../src/ui/ui_debug.h"
+
+/* UI debug stubs for tests that link the real gb.c */
+bool ui_is_debug_enabled(UIDebugComponent component) {
+    (void)component; /* Suppress unused parameter warning */
+    return false;
+}
+
+void ui_debug_log(UIDebugComponent component, const char* format, ...) {
+    (void)component; /* Suppress unused parameter warning */
+    (void)format;    /* Suppress unused parameter warning */
+    /* Do nothing in tests */
+}
@@ -0,0 +1,47 @@
+#ifndef GBENDO_TEST_ROM_H
+#define GBENDO_TEST_ROM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* Writes a 32KB MBC1 cartridge with 8KB RAM whose program enables cart RAM
+ * and then increments 0xA000 and 0xC000 forever:
+ *
+ *   0100: JP 0150
+ *   0150: LD A,0A / LD (0000),A / LD HL,A000
+ *   0158: INC (HL) / LD A,(C000) / INC A / LD (C000),A / JR 0158
+ *
+ * cart_type/ram_code go straight into the header (0x147/0x149). */
+static inline bool test_rom_write(const char* path, uint8_t cart_type, uint8_t ram_code) {
+    static uint8_t rom[0x8000];
+    memset(rom, 0, sizeof(rom));
+
+    const uint8_t entry[] = { 0xC3, 0x50, 0x01 };
+    memcpy(&rom[0x100], entry, sizeof(entry));
+
+    const uint8_t program[] = {
+        0x3E, 0x0A,             /* LD A,0A      */
+        0xEA, 0x00, 0x00,       /* LD (0000),A  */
+        0x21, 0x00, 0xA0,       /* LD HL,A000   */
+        0x34,                   /* INC (HL)     */
+        0xFA, 0x00, 0xC0,       /* LD A,(C000)  */
+        0x3C,                   /* INC A        */
+        0xEA, 0x00, 0xC0,       /* LD (C000),A  */
+        0x18, 0xF6              /* JR 0158      */
+    };
+    memcpy(&rom[0x150], program, sizeof(program));
+
+    rom[0x147] = cart_type;
+    rom[0x148] = 0x00;          /* 32KB */
+    rom[0x149] = ram_code;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t written = fwrite(rom, 1, sizeof(rom), f);
+    fclose(f);
+    return written == sizeof(rom);
+}
+
+#endif /* GBENDO_TEST_ROM_H */